@@ -0,0 +1,256 @@
+"""Pipelined communication with the firmware using asyncio.
+
+`Communicator` sends one command and blocks until its response arrives, so a
+slow command holds up everything behind it. `AsyncCommunicator` tags each
+command with a request ID (`#ID -COMMAND`), which the firmware echoes at the
+start of the response, so several commands can be in flight at once and
+responses are matched to them by ID. Lines without an ID, e.g. from firmware
+that streams data on its own, are telemetry and are queued separately.
+
+Serial ports can't be awaited portably, so a thread reads lines and hands them
+to the event loop. Each command is written with a single write, including any
+additional lines it needs, so concurrent commands never interleave. If the
+port fails, the commands in flight and any sent later raise `ConnectionError`.
+
+Example:
+
+    async with AsyncCommunicator('/dev/ttyACM0') as pad:
+        values, _ = await asyncio.gather(
+            pad.get_sensor_values(),
+            pad.set_config_u16('brightness', 100))
+"""
+
+import asyncio
+import threading
+from typing import Mapping, Sequence, Tuple, Union
+
+import serial
+
+from base.communicator import Communicator
+
+
+class AsyncCommunicator:
+    """Send commands to the firmware without waiting for earlier responses.
+    """
+
+    DEFAULT_TIMEOUT_S = 1.0
+    DEFAULT_MAX_IN_FLIGHT = 8
+    DEFAULT_TELEMETRY_SIZE = 1024
+
+    # IDs wrap around well before a response could be mistaken for that of an
+    # older request
+    MAX_REQUEST_ID = 1000000
+
+    # How often the reader thread checks whether it should stop
+    READ_TIMEOUT_S = 0.1
+
+    def __init__(
+        self,
+        ser: Union[serial.Serial, str],
+        max_in_flight: int = DEFAULT_MAX_IN_FLIGHT,
+        telemetry_size: int = DEFAULT_TELEMETRY_SIZE,
+    ) -> None:
+        """Communicate with the firmware using a serial interface. Call
+        `open()` or use `async with` before sending commands.
+
+        Args:
+            ser: Serial object or the path of a serial port.
+            max_in_flight: Commands sent before waiting for a response, which
+                keeps the firmware's input buffer from overflowing.
+            telemetry_size: Telemetry lines kept until read. The oldest are
+                dropped when it's full.
+        """
+        if isinstance(ser, str):
+            ser = serial.Serial(ser)
+
+        self._ser = ser
+        self._max_in_flight = max_in_flight
+        self._telemetry_size = telemetry_size
+        self._loop = None
+        self._thread = None
+        self._stop = threading.Event()
+        self._slots = None
+        self._telemetry = None
+        self._pending = {}
+        self._error = None
+        self._next_id = 1
+        self.lost_telemetry = 0
+        self.unmatched_responses = 0
+
+    async def open(self) -> None:
+        """Start reading responses."""
+        self._loop = asyncio.get_running_loop()
+        self._slots = asyncio.Semaphore(self._max_in_flight)
+        self._telemetry = asyncio.Queue()
+        self._ser.timeout = self.READ_TIMEOUT_S
+        self._error = None
+        self._stop.clear()
+        self._thread = threading.Thread(target=self._read_lines, daemon=True)
+        self._thread.start()
+
+    async def close(self) -> None:
+        """Stop reading responses and fail the commands still in flight."""
+        self._stop.set()
+        if self._thread:
+            await self._loop.run_in_executor(None, self._thread.join)
+            self._thread = None
+        self._fail_pending('Communicator closed')
+
+    async def __aenter__(self):
+        await self.open()
+        return self
+
+    async def __aexit__(self, *args):
+        await self.close()
+
+    async def request(
+        self,
+        command: str,
+        *lines: str,
+        timeout: float = DEFAULT_TIMEOUT_S,
+    ) -> str:
+        """Send a command and wait for its response.
+
+        Args:
+            command: Command string without the `-` prefix.
+            lines: Additional lines the command reads.
+            timeout: Seconds to wait for the response.
+
+        Returns:
+            The response without its request ID. Empty for commands that
+            don't respond otherwise.
+
+        Raises:
+            asyncio.TimeoutError: The response didn't arrive in time.
+            ConnectionError: The communicator was closed or responses can no
+                longer be read.
+        """
+        async with self._slots:
+            if self._error:
+                raise ConnectionError(self._error)
+            request_id = self._next_id
+            self._next_id = self._next_id % self.MAX_REQUEST_ID + 1
+            future = self._loop.create_future()
+            self._pending[request_id] = future
+
+            text = ''.join(f'{line}\n' for line in lines)
+            self._ser.write(f'#{request_id} -{command}\n{text}'.encode('ascii'))
+            try:
+                return await asyncio.wait_for(future, timeout)
+            finally:
+                self._pending.pop(request_id, None)
+
+    async def telemetry(self) -> str:
+        """Wait for the next line that isn't a response to a command."""
+        return await self._telemetry.get()
+
+    def _read_lines(self) -> None:
+        """Read lines until stopped or the port fails. Runs in its own
+        thread.
+        """
+        partial = b''
+        while not self._stop.is_set():
+            try:
+                partial += self._ser.readline()
+            except (serial.SerialException, OSError) as error:
+                # Nothing else will be read, so nothing may wait for it
+                self._loop.call_soon_threadsafe(
+                    self._fail_pending, f'Serial port failed: {error}')
+                break
+            # readline() returns what it has when it times out. Noise on the
+            # line mustn't stop the reader.
+            if partial.endswith(b'\n'):
+                self._loop.call_soon_threadsafe(
+                    self._dispatch,
+                    partial.decode('ascii', errors='replace').strip())
+                partial = b''
+
+    def _fail_pending(self, error: str) -> None:
+        """Fail the commands in flight and any sent later with `error`."""
+        self._error = error
+        for future in self._pending.values():
+            if not future.done():
+                future.set_exception(ConnectionError(error))
+        self._pending.clear()
+
+    def _dispatch(self, line: str) -> None:
+        """Resolve the command a line responds to or queue it as telemetry."""
+        if line.startswith('#'):
+            request_id, _, response = line[1:].partition(' ')
+            future = self._pending.get(
+                int(request_id) if request_id.isdigit() else None)
+            if future and not future.done():
+                future.set_result(response)
+            else:
+                # The command timed out or was sent by another host
+                self.unmatched_responses += 1
+            return
+
+        if self._telemetry.qsize() >= self._telemetry_size:
+            self._telemetry.get_nowait()
+            self.lost_telemetry += 1
+        self._telemetry.put_nowait(line)
+
+    async def get_version(self) -> str:
+        """Get firmware version string."""
+        return await self.request(Communicator.COMMAND_VERSION)
+
+    async def get_sensor_values(self) -> Mapping[str, Mapping[str, int]]:
+        """Get current raw sensor values. See
+        `Communicator.get_sensor_values()`.
+        """
+        return Communicator.parse_sensor_values(
+            await self.request(Communicator.COMMAND_VALUES))
+
+    async def get_events(
+        self,
+        cursor: int = 0,
+    ) -> Tuple[int, int, Sequence[dict]]:
+        """Get press and release events after a cursor. See
+        `Communicator.get_events()`.
+        """
+        return Communicator.parse_events(
+            await self.request(Communicator.COMMAND_EVENTS, str(cursor)))
+
+    async def set_config(
+        self,
+        value_type: str,
+        key: str,
+        value,
+    ) -> None:
+        """Set a configuration item.
+
+        Args:
+            value_type: One of {`str`, `u16`, `u32`}.
+            key: Name of configuration item.
+            value: The value to set the configuration item to.
+        """
+        if value_type not in Communicator.CONFIG_VALUE_TYPES:
+            raise ValueError(
+                '`value_type` must be one of '
+                f"{', '.join(Communicator.CONFIG_VALUE_TYPES)}")
+        response = await self.request(
+            Communicator.COMMAND_SETCONFIG, f'{value_type} {key}={value}')
+        if response != Communicator.RESPONSE_SUCCESS:
+            raise ValueError(
+                f'Failed to set config {key}[{value_type}]={value}')
+
+    async def set_config_u16(self, key: str, value: int) -> None:
+        """Set a configuration item for an unsigned 16-bit integer."""
+        await self.set_config(Communicator.CONFIG_TYPE_U16, key, value)
+
+    async def calibrate(self) -> None:
+        """Force calibration of the sensors."""
+        await self.request(Communicator.COMMAND_CALIBRATE)
+
+    async def persist(self) -> None:
+        """Save configuration items to EEPROM.
+
+        Raises:
+            ValueError: The configuration doesn't fit in the EEPROM and
+                wasn't saved.
+        """
+        if (await self.request(Communicator.COMMAND_PERSIST)
+                != Communicator.RESPONSE_SUCCESS):
+            raise ValueError(
+                'Configuration is too large for the EEPROM and was not saved')
@@ -0,0 +1,235 @@
+"""Benchmark the serial protocol of a pad.
+
+Runs workloads against a pad, or the firmware running as a virtual pad, and
+prints the results as JSON so firmware and protocol changes can be compared:
+
+- `values`: round trip time of the sensor values command, `-v`.
+- `set`: time from sending `-set` to its acknowledgement.
+- `sextet`: SextetStream packets taken in per second.
+- `scanning`: commands answered per second when sent back to back, with the
+  statistics of the scan task over the same time, so commands that delay the
+  scans show up as overruns or latency.
+
+Times are in milliseconds. Benchmark a pad with:
+
+    python -m base.bench /dev/ttyACM0
+
+or the virtual pad built with `pio run -e virtualpad`:
+
+    python -m base.bench --virtual-pad
+"""
+
+import argparse
+import contextlib
+import json
+import os
+import subprocess
+import sys
+import time
+from typing import Callable, Iterator, Mapping, Sequence
+
+from serial import Serial
+
+from base.communicator import Communicator
+
+DEFAULT_VIRTUAL_PAD = os.path.join(
+    os.path.dirname(__file__), '..', '..', 'Firmware', '.pio', 'build',
+    'virtualpad', 'program')
+
+WORKLOADS = ('values', 'set', 'sextet', 'scanning')
+PERCENTILES = (50, 90, 99)
+
+# Packet and newline, see `Communicator.set_panel_lights()`
+SEXTET_PACKET_BYTES = 14
+
+
+def percentile(values: Sequence[float], percent: float) -> float:
+    """Value below which `percent` percent of the values fall."""
+    values = sorted(values)
+    return values[int(percent / 100 * (len(values) - 1))]
+
+
+def summarize(times_s: Sequence[float]) -> Mapping[str, float]:
+    """Summarize durations in seconds as milliseconds.
+
+    Returns:
+        Dictionary with the `count`, `min_ms`, `mean_ms`, `max_ms`, and a
+        `pN_ms` for each of `PERCENTILES`.
+    """
+    times_ms = [time_s * 1000 for time_s in times_s]
+    summary = dict(
+        count=len(times_ms),
+        min_ms=min(times_ms),
+        mean_ms=sum(times_ms) / len(times_ms),
+    )
+    for percent in PERCENTILES:
+        summary[f'p{percent}_ms'] = percentile(times_ms, percent)
+    summary['max_ms'] = max(times_ms)
+    return summary
+
+
+def time_calls(function: Callable[[int], object], count: int) -> Sequence[float]:
+    """Call `function` with the indices up to `count` and return how long each
+    call took in seconds.
+    """
+    times_s = []
+    for index in range(count):
+        start = time.perf_counter()
+        function(index)
+        times_s.append(time.perf_counter() - start)
+    return times_s
+
+
+def bench_values(communicator: Communicator, count: int) -> dict:
+    """Round trip time of `-v`."""
+    return summarize(time_calls(
+        lambda _: communicator.get_sensor_values(), count))
+
+
+def bench_set(communicator: Communicator, count: int) -> dict:
+    """Time from sending `-set` to its acknowledgement. Brightness is toggled
+    between two values, then restored.
+    """
+    brightness = communicator.sync_config()['brightness']
+    try:
+        return summarize(time_calls(
+            lambda index: communicator.set_brightness(
+                brightness ^ 1 if index % 2 == 0 else brightness),
+            count))
+    finally:
+        communicator.set_brightness(brightness)
+
+
+def bench_sextet(communicator: Communicator, count: int) -> dict:
+    """Rate at which SextetStream packets are taken in. Packets aren't
+    acknowledged, so a command is sent after them and answered once they have
+    all been read.
+    """
+    panels = Communicator.PANEL_ORDER
+    start = time.perf_counter()
+    for index in range(count):
+        communicator.set_panel_lights([panels[index % len(panels)]])
+    communicator.get_version()
+    seconds = time.perf_counter() - start
+    communicator.set_panel_lights(())
+    return dict(
+        packets=count,
+        seconds=seconds,
+        packets_per_second=count / seconds,
+        bytes_per_second=count * SEXTET_PACKET_BYTES / seconds,
+    )
+
+
+def bench_scanning(communicator: Communicator, duration: float) -> dict:
+    """Commands answered per second while the pad scans, and what they cost
+    the scan task.
+    """
+    # Reading the task statistics resets them
+    communicator.get_task_stats()
+    times_s = []
+    start = time.perf_counter()
+    while time.perf_counter() - start < duration:
+        command_start = time.perf_counter()
+        communicator.get_sensor_values()
+        times_s.append(time.perf_counter() - command_start)
+    seconds = time.perf_counter() - start
+    scan = communicator.get_task_stats()['scan']
+    return dict(
+        commands=len(times_s),
+        seconds=seconds,
+        commands_per_second=len(times_s) / seconds,
+        round_trip=summarize(times_s),
+        scans_per_second=scan['runs'] / seconds,
+        scan=scan,
+    )
+
+
+def run(
+    communicator: Communicator,
+    workloads: Sequence[str] = WORKLOADS,
+    count: int = 1000,
+    duration: float = 5.0,
+) -> dict:
+    """Run workloads against a pad.
+
+    Args:
+        communicator: Communicator of the pad.
+        workloads: Names of the workloads to run, from `WORKLOADS`.
+        count: Commands or packets sent by the `values`, `set`, and `sextet`
+            workloads.
+        duration: Seconds the `scanning` workload runs for.
+
+    Returns:
+        Dictionary with the firmware `version` and the results of each
+        workload in `workloads`.
+    """
+    unknown = set(workloads) - set(WORKLOADS)
+    if unknown:
+        raise ValueError(f'Unknown workloads: {", ".join(sorted(unknown))}')
+
+    results = {}
+    for workload in workloads:
+        if workload == 'values':
+            results[workload] = bench_values(communicator, count)
+        elif workload == 'set':
+            results[workload] = bench_set(communicator, count)
+        elif workload == 'sextet':
+            results[workload] = bench_sextet(communicator, count)
+        elif workload == 'scanning':
+            results[workload] = bench_scanning(communicator, duration)
+    return dict(version=communicator.get_version(), workloads=results)
+
+
+@contextlib.contextmanager
+def virtual_pad(path: str = DEFAULT_VIRTUAL_PAD) -> Iterator[str]:
+    """Run the virtual pad with presses on every panel while in the context.
+
+    Returns:
+        Path of its serial port.
+    """
+    process = subprocess.Popen(
+        [path, '--presses'], stdout=subprocess.PIPE, text=True)
+    try:
+        yield process.stdout.readline().strip()
+    finally:
+        process.terminate()
+        process.wait(timeout=5)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description='Benchmark the serial protocol of a pad and print the '
+                    'results as JSON.')
+    parser.add_argument('port', nargs='?', help='Serial port of the pad')
+    parser.add_argument('--virtual-pad', nargs='?', const=DEFAULT_VIRTUAL_PAD,
+                        metavar='PATH',
+                        help='Run the virtual pad instead of using a port')
+    parser.add_argument('--workloads', default=','.join(WORKLOADS),
+                        help='Comma-separated workloads to run')
+    parser.add_argument('--count', type=int, default=1000,
+                        help='Commands or packets per workload')
+    parser.add_argument('--duration', type=float, default=5.0,
+                        help='Seconds the scanning workload runs for')
+    parser.add_argument('--output', help='File to write instead of stdout')
+    args = parser.parse_args()
+    if (args.port is None) == (args.virtual_pad is None):
+        parser.error('Give either a port or --virtual-pad')
+
+    with contextlib.ExitStack() as stack:
+        port = args.port
+        if args.virtual_pad is not None:
+            port = stack.enter_context(virtual_pad(args.virtual_pad))
+        ser = stack.enter_context(Serial(port, timeout=2))
+        ser.reset_input_buffer()
+        results = dict(port=port, **run(
+            Communicator(ser), args.workloads.split(','), args.count,
+            args.duration))
+
+    with (open(args.output, 'w') if args.output
+          else contextlib.nullcontext(sys.stdout)) as output:
+        json.dump(results, output, indent=2)
+        output.write('\n')
+
+
+if __name__ == '__main__':
+    main()
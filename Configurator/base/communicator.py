@@ -2,7 +2,7 @@
 """
 
 from enum import Enum
-from typing import Mapping, Tuple, Union
+from typing import Mapping, Optional, Sequence, Tuple, Union
 import serial
 
 
@@ -31,6 +31,27 @@ class PanelOrientation(Enum):
             raise KeyError(f'Invalid panel orientation: {degrees}')
 
 
+class SensorHealth(Enum):
+    """Problem most recently detected in a sensor's signal by the firmware.
+    """
+
+    OK = 0
+    Stuck = 1
+    Drifting = 2
+    Oscillating = 3
+
+
+class BaselineCheck(Enum):
+    """How a sensor's saved baseline was used by the firmware at boot.
+    """
+
+    Kept = 0
+    Loaded = 1
+    Stale = 2
+    Missing = 3
+    Expired = 4
+
+
 class Color:
 
     @staticmethod
@@ -65,6 +86,31 @@ class Communicator:
     COMMAND_PERSIST = 'persist'
     COMMAND_VALUES = 'v'
     COMMAND_CALIBRATE = 'calibrate'
+    COMMAND_HEALTH = 'health'
+    COMMAND_ADC = 'adc'
+    COMMAND_TASKS = 'tasks'
+    COMMAND_GENERATION = 'gen'
+    COMMAND_CHANGES = 'changes'
+    COMMAND_SCHEMA = 'schema'
+    COMMAND_LAYOUT = 'layout'
+    COMMAND_BOOT = 'boot'
+    COMMAND_PROFILES = 'profiles'
+    COMMAND_PROFILE = 'profile'
+    COMMAND_SAVE_PROFILE = 'saveprofile'
+    COMMAND_EVENTS = 'events'
+    COMMAND_LOG = 'log'
+    COMMAND_LEDS = 'leds'
+    COMMAND_SCAN = 'scan'
+    COMMAND_CROSSTALK = 'crosstalk'
+    COMMAND_CROSSTALK_MATRIX = 'crosstalkmatrix'
+    COMMAND_LEARN_CROSSTALK = 'learncrosstalk'
+    COMMAND_FINISH_CROSSTALK = 'finishcrosstalk'
+    COMMAND_CLEAR_CROSSTALK = 'clearcrosstalk'
+    COMMAND_SAVE_CROSSTALK = 'savecrosstalk'
+    COMMAND_BASELINES = 'baselines'
+    COMMAND_STATS = 'stats'
+    COMMAND_RESET_STATS = 'resetstats'
+    COMMAND_STREAM = 'stream'
 
     CONFIG_TYPE_STRING = 'str'
     CONFIG_TYPE_U16 = 'u16'
@@ -74,8 +120,17 @@ class Communicator:
     RESPONSE_FAILURE = '?'
 
     DIRECTIONS = {'up', 'down', 'left', 'right'}
+    PANEL_ORDER = ('up', 'down', 'left', 'right')
+    SENSOR_ORDER = ('north', 'east', 'south', 'west')
+    SEXTET_PANEL_BITS = dict(left=0x01, right=0x02, up=0x04, down=0x08)
     CONFIG_VALUE_TYPES = {CONFIG_TYPE_STRING, CONFIG_TYPE_U16, CONFIG_TYPE_U32}
 
+    MAX_LINEARIZATION_POINTS = 8
+    MAX_PROFILE_NAME_LENGTH = 11
+    NO_PROFILE = 255
+    NO_PANEL = 255
+    CROSSTALK_FRACTION_BITS = 14
+
     def __init__(
         self,
         ser: Union[serial.Serial, str],
@@ -90,6 +145,14 @@ class Communicator:
 
         self._ser = ser
 
+        # Configuration items mirrored from the device, the generation and
+        # boot epoch they are current as of, and the schema used to convert
+        # their values.
+        self._config = {}
+        self._config_generation = 0
+        self._config_epoch = None
+        self._schema = None
+
     def __send_line(self, line: str) -> None:
         """Send line terminated with newline character.
 
@@ -112,6 +175,16 @@ class Communicator:
         """
         self.__send_line(f'-{command}')
 
+    def __check_response(self, response: str, message: str) -> None:
+        """Raise an error if a command failed.
+
+        Args:
+            response: Response to the command.
+            message: Description of the failure.
+        """
+        if response != self.RESPONSE_SUCCESS:
+            raise ValueError(message)
+
     def __set_config(self, value_type: str, key: str, value) -> None:
         """Set a configuration item.
 
@@ -204,60 +277,238 @@ class Communicator:
         self.__set_config_u16(key_name + 'trigger', trigger)
         self.__set_config_u16(key_name + 'release', release)
 
+    def set_linearization(self, pin: int, points: Sequence[Tuple[int, int]]) -> None:
+        """Set the piecewise-linear table mapping raw readings from a sensor to
+        a linear force scale before thresholds are applied.
+
+        Args:
+            pin: Pin on the Teensy connected to the sensor.
+            points: Increasing (raw, force) pairs given for 10-bit readings.
+                An empty sequence disables the table.
+        """
+        if len(points) == 1 or len(points) > self.MAX_LINEARIZATION_POINTS:
+            raise ValueError(
+                f'`points` must be empty or have 2-{self.MAX_LINEARIZATION_POINTS} entries')
+        for index, (raw, force) in enumerate(points):
+            if not 0 <= raw < 1024 or not 0 <= force < 1024:
+                raise ValueError('Points must be in range [0, 1024).')
+            if index > 0 and raw <= points[index - 1][0]:
+                raise ValueError('Raw values of points must be increasing.')
+
+        value = ';'.join(f'{raw}:{force}' for raw, force in points)
+        self.__set_config_str(f'sensor{pin}lut', value)
+
+    def get_adc_info(self) -> Mapping[str, int]:
+        """Get the ADC profile and the time it takes to sample the sensors.
+
+        Returns:
+            Dictionary with `profile`, `num_profiles`, `resolution`,
+            `averaging`, `max_value`, `sample_time_ns`, `scan_time_us`, and
+            `max_scan_time_us` values.
+        """
+        self.__send_command(self.COMMAND_ADC)
+        values = [int(value) for value in self.__get_line().split(',')]
+        return dict(zip((
+            'profile',
+            'num_profiles',
+            'resolution',
+            'averaging',
+            'max_value',
+            'sample_time_ns',
+            'scan_time_us',
+            'max_scan_time_us',
+        ), values))
+
+    def get_task_stats(self) -> Mapping[str, dict]:
+        """Get the statistics of each scheduled task since the last call.
+        Reading them resets them on the device.
+
+        Returns:
+            Dictionary mapping task names to the number of `runs`, `overruns`
+            past the task's period, periods `skipped`, the longest run
+            (`max_run_us`), and the longest delay from when the task was due
+            to when it ran (`max_latency_us`).
+        """
+        self.__send_command(self.COMMAND_TASKS)
+        stats = {}
+        for item in self.__get_line().split(','):
+            name, runs, overruns, skipped, max_run_us, max_latency_us = (
+                item.split(':'))
+            stats[name] = dict(
+                runs=int(runs),
+                overruns=int(overruns),
+                skipped=int(skipped),
+                max_run_us=int(max_run_us),
+                max_latency_us=int(max_latency_us),
+            )
+        return stats
+
+    def get_boot_timing(self) -> Mapping[str, int]:
+        """Get how long the firmware took to start.
+
+        Returns:
+            Dictionary with `config_read_us`, the time taken to read the
+            configuration, and `setup_done_us` and `first_report_us`, which
+            are measured from reset.
+        """
+        self.__send_command(self.COMMAND_BOOT)
+        values = [int(value) for value in self.__get_line().split(',')]
+        return dict(zip((
+            'config_read_us',
+            'setup_done_us',
+            'first_report_us',
+        ), values))
+
+    def set_adc_profile(self, profile: int) -> None:
+        """Select the resolution and averaging used to sample the sensors.
+
+        Thresholds are still given for 10-bit readings, but sensor values are
+        reported at the resolution of the profile.
+
+        Args:
+            profile: Index of the profile. See `get_adc_info()`.
+        """
+        if profile < 0:
+            raise ValueError('`profile` must not be negative')
+
+        self.__set_config_u16('adc_profile', profile)
+
+    def get_generation(self) -> int:
+        """Get the configuration generation. It increases each time an item
+        is added or changed.
+        """
+        self.__send_command(self.COMMAND_GENERATION)
+        return int(self.__get_line())
+
+    def get_config_changes(
+        self,
+        since: int,
+        epoch: Optional[int] = None,
+    ) -> Tuple[int, Optional[int], Mapping[str, str], bool]:
+        """Get configuration items changed after a generation.
+
+        Args:
+            since: Generation returned by a previous call, or 0 for all items.
+            epoch: Epoch returned with `since`, so a generation from before
+                the device rebooted is treated as a reset.
+
+        Returns:
+            Tuple of the current generation, the epoch of the current boot
+            (None for older firmware), a dictionary of changed items, and
+            whether the configuration was reset after `since`. After a
+            reset, all items are included and any others should be
+            discarded.
+        """
+        self.__send_command(self.COMMAND_CHANGES)
+        self.__send_line(str(since) if epoch is None else f'{since}:{epoch}')
+        split = self.__get_line().split(',')
+
+        generation, _, current_epoch = split.pop(0).partition(':')
+        reset = bool(split) and split[0] == '*'
+        if reset:
+            split.pop(0)
+
+        items = dict(entry.split('=', 1) for entry in split)
+        return (
+            int(generation),
+            int(current_epoch) if current_epoch else None,
+            items,
+            reset,
+        )
+
+    def get_schema(self) -> Mapping[str, dict]:
+        """Get the type and range of each configuration item.
+
+        Returns:
+            Dictionary mapping item names to dictionaries with `type` and,
+            for integers with a range, `min` and `max` values.
+        """
+        self.__send_command(self.COMMAND_SCHEMA)
+        schema = {}
+        for entry in self.__get_line().split(','):
+            fields = entry.split(':')
+            item = dict(type=fields[1])
+            if len(fields) == 4:
+                item['min'] = int(fields[2])
+                item['max'] = int(fields[3])
+            schema[fields[0]] = item
+        return schema
+
+    def get_layout(self) -> Mapping[str, dict]:
+        """Get the orientation and sensor pins of each panel.
+
+        Returns:
+            Nested dictionary mapping arrow directions to `orientation`,
+            `north_pin`, `east_pin`, `south_pin`, and `west_pin` values.
+        """
+        self.__send_command(self.COMMAND_LAYOUT)
+        layout = {}
+        for entry in self.__get_line().split(','):
+            name, fields = entry.split('=')
+            values = [int(value) for value in fields.split(':')]
+            layout[name] = dict(
+                orientation=PanelOrientation.from_degrees(values[0]),
+                north_pin=values[1],
+                east_pin=values[2],
+                south_pin=values[3],
+                west_pin=values[4],
+            )
+        return layout
+
+    def sync_config(self) -> Mapping[str, Union[int, str]]:
+        """Bring the local copy of the configuration up to date by fetching
+        only the items that changed since the last call.
+
+        Returns:
+            Dictionary of all configuration items. Integer items are
+            converted to `int`.
+        """
+        generation, epoch, items, reset = self.get_config_changes(
+            self._config_generation, self._config_epoch)
+        if not reset and generation < self._config_generation:
+            # Generations restarted when the device rebooted, and firmware
+            # that doesn't report that as a reset only sent the items changed
+            # since the cached generation
+            generation, epoch, items, reset = self.get_config_changes(0)
+
+        if reset:
+            self._config = {}
+        if self._schema is None or any(key not in self._schema for key in items):
+            self._schema = self.get_schema()
+
+        for key, value in items.items():
+            value_type = self._schema.get(key, {}).get('type')
+            if value_type in {self.CONFIG_TYPE_U16, self.CONFIG_TYPE_U32}:
+                value = int(value)
+            self._config[key] = value
+
+        self._config_generation = generation
+        self._config_epoch = epoch
+        return self._config
+
     def get_config(self) -> Mapping[str, Enum]:
         """Get configuration.
 
         Returns:
             Dictionary of configuration items.
         """
-        self.__send_command(self.COMMAND_GETCONFIG)
-        response = self.__get_line()
-        split = response.split(',')
-
-        key_value_entries = dict(entry.split('=') for entry in split[20:])
+        layout = self.get_layout()
+        items = self.sync_config()
 
         config = dict(
-            up=dict(
-                orientation=PanelOrientation.from_degrees(int(split.pop(0))),
-                color=Color.from_int(int(key_value_entries['color_up'])),
-                north_pin=int(split.pop(0)),
-                east_pin=int(split.pop(0)),
-                south_pin=int(split.pop(0)),
-                west_pin=int(split.pop(0)),
-            ),
-            down=dict(
-                orientation=PanelOrientation.from_degrees(int(split.pop(0))),
-                color=Color.from_int(int(key_value_entries['color_down'])),
-                north_pin=int(split.pop(0)),
-                east_pin=int(split.pop(0)),
-                south_pin=int(split.pop(0)),
-                west_pin=int(split.pop(0)),
-            ),
-            left=dict(
-                orientation=PanelOrientation.from_degrees(int(split.pop(0))),
-                color=Color.from_int(int(key_value_entries['color_left'])),
-                north_pin=int(split.pop(0)),
-                east_pin=int(split.pop(0)),
-                south_pin=int(split.pop(0)),
-                west_pin=int(split.pop(0)),
-            ),
-            right=dict(
-                orientation=PanelOrientation.from_degrees(int(split.pop(0))),
-                color=Color.from_int(int(key_value_entries['color_right'])),
-                north_pin=int(split.pop(0)),
-                east_pin=int(split.pop(0)),
-                south_pin=int(split.pop(0)),
-                west_pin=int(split.pop(0)),
-            ),
-            brightness=int(key_value_entries['brightness']),
-            auto_lights=int(key_value_entries['auto_lights']) > 0,
+            brightness=items['brightness'],
+            # Not stored until it's set, and off by default
+            auto_lights=int(items.get('auto_lights', 0)) > 0,
         )
 
-        # Add trigger/release thresholds
-        for panel in {'up', 'down', 'left', 'right'}:
-            for direction in {'north', 'east', 'south', 'west'}:
-                for opt in {'trigger', 'release'}:
-                    config[panel][f'{direction}_{opt}'] = key_value_entries['sensor{num}{opt}'.format(
+        for panel in self.PANEL_ORDER:
+            config[panel] = dict(layout[panel])
+            config[panel]['color'] = Color.from_int(items[f'color_{panel}'])
+
+            # Add trigger/release thresholds
+            for direction in self.SENSOR_ORDER:
+                for opt in ('trigger', 'release'):
+                    config[panel][f'{direction}_{opt}'] = items['sensor{num}{opt}'.format(
                         num=config[panel][f'{direction}_pin'], opt=opt)]
 
         return config
@@ -271,8 +522,13 @@ class Communicator:
             `release_threshold` values.
         """
         self.__send_command(self.COMMAND_VALUES)
-        line = self.__get_line()
-        # print(line)
+        return self.parse_sensor_values(self.__get_line())
+
+    @staticmethod
+    def parse_sensor_values(line: str) -> Mapping[str, Mapping[str, int]]:
+        """Parse the response to the values command. See
+        `get_sensor_values()`.
+        """
         values = line.split(',')
         return dict(
             up=dict(
@@ -365,6 +621,386 @@ class Communicator:
             ),
         )
 
+    def get_sensor_health(self) -> Mapping[str, Mapping[str, dict]]:
+        """Get the health of each sensor.
+
+        Faulty sensors are ignored by the firmware until their signal looks
+        plausible again.
+
+        Returns:
+            Nested dictionary mapping arrow directions to cardinal
+            direction sensors with `faulty`, `status`, and `strikes` values.
+        """
+        self.__send_command(self.COMMAND_HEALTH)
+        values = self.__get_line().split(',')
+        health = {}
+        for panel in self.PANEL_ORDER:
+            health[panel] = {}
+            for sensor in self.SENSOR_ORDER:
+                health[panel][sensor] = dict(
+                    faulty=int(values.pop(0)) != 0,
+                    status=SensorHealth(int(values.pop(0))),
+                    strikes=int(values.pop(0)),
+                )
+        return health
+
+    def get_profiles(self) -> Tuple[Union[int, None], Sequence[str]]:
+        """Get the stored profiles.
+
+        Returns:
+            Tuple of the index of the active profile, or None if no profile
+            has been applied, and the name of each profile slot. Empty slots
+            have empty names.
+        """
+        self.__send_command(self.COMMAND_PROFILES)
+        split = self.__get_line().split(',')
+        active = int(split.pop(0))
+        return (None if active == self.NO_PROFILE else active), split
+
+    def select_profile(self, index: int) -> None:
+        """Switch to a stored profile. Thresholds and lighting settings
+        change immediately without writing to the EEPROM.
+
+        Args:
+            index: Index of the profile.
+        """
+        self.__send_command(self.COMMAND_PROFILE)
+        self.__send_line(str(index))
+        self.__check_response(
+            self.__get_line(), f'Profile {index} is not stored')
+
+    def save_profile(self, index: int, name: str) -> None:
+        """Store the current thresholds and lighting settings in a profile.
+
+        Args:
+            index: Index of the profile.
+            name: Name of the profile.
+        """
+        if not name or len(name) > self.MAX_PROFILE_NAME_LENGTH:
+            raise ValueError(
+                f'`name` must have 1-{self.MAX_PROFILE_NAME_LENGTH} characters')
+        if ',' in name:
+            raise ValueError('`name` must not contain commas')
+
+        self.__send_command(self.COMMAND_SAVE_PROFILE)
+        self.__send_line(f'{index} {name}')
+        self.__check_response(
+            self.__get_line(), f'Failed to save profile {index}')
+
+    def get_events(self, cursor: int = 0) -> Tuple[int, int, Sequence[dict]]:
+        """Get press and release events of each sensor after a cursor.
+
+        The firmware sends a limited number of events per request, so call
+        again with the returned cursor until no events are returned.
+
+        Args:
+            cursor: 0 or the cursor returned by the previous call.
+
+        Returns:
+            Tuple of the cursor for the next call, the number of events
+            overwritten before they could be fetched, and the events. Each
+            event is a dictionary with `time_us`, `panel` (a direction),
+            `sensor` (a cardinal direction before correcting for
+            orientation), `pressed`, and `peak` pressure.
+        """
+        self.__send_command(self.COMMAND_EVENTS)
+        self.__send_line(str(cursor))
+        return self.parse_events(self.__get_line())
+
+    @classmethod
+    def parse_events(cls, line: str) -> Tuple[int, int, Sequence[dict]]:
+        """Parse the response to the events command. See `get_events()`.
+        """
+        split = line.split(',')
+        next_cursor = int(split.pop(0))
+        lost = int(split.pop(0))
+        events = []
+        for item in split:
+            time_us, panel, sensor, pressed, peak = (
+                int(value) for value in item.split(':'))
+            events.append(dict(
+                time_us=time_us,
+                panel=cls.PANEL_ORDER[panel],
+                sensor=cls.SENSOR_ORDER[sensor],
+                pressed=pressed != 0,
+                peak=peak,
+            ))
+        return next_cursor, lost, events
+
+    def get_log(self, cursor: int = 0) -> Tuple[int, int, Sequence[dict]]:
+        """Get log records after a cursor.
+
+        The firmware sends a limited number of records per request, so call
+        again with the returned cursor until no records are returned. Expand
+        the records to text with `base.log_decoder.LogDecoder`.
+
+        Args:
+            cursor: 0 or the cursor returned by the previous call.
+
+        Returns:
+            Tuple of the cursor for the next call, the number of records
+            overwritten before they could be fetched, and the records. Each
+            record is a dictionary with `time_us`, `level`, the index of its
+            `message`, and its `args` as unsigned 32-bit integers.
+        """
+        self.__send_command(self.COMMAND_LOG)
+        self.__send_line(str(cursor))
+        return self.parse_log(self.__get_line())
+
+    @staticmethod
+    def parse_log(line: str) -> Tuple[int, int, Sequence[dict]]:
+        """Parse the response to the log command. See `get_log()`.
+        """
+        split = line.split(',')
+        next_cursor = int(split.pop(0))
+        lost = int(split.pop(0))
+        records = []
+        for item in split:
+            time_us, level, message, *args = (
+                int(value) for value in item.split(':'))
+            records.append(dict(
+                time_us=time_us,
+                level=level,
+                message=message,
+                args=args,
+            ))
+        return next_cursor, lost, records
+
+    def get_led_topology(self) -> dict:
+        """Get the LED strands and the runs of LEDs of each light group.
+
+        Returns:
+            Dictionary with the number of `strands`, `leds_per_strand`,
+            `frames_sent` and `frames_skipped` because nothing changed, and
+            `segments`. Each segment is a dictionary with its light `group`,
+            `strand`, `offset` on the strand, `count` of LEDs, position `x`
+            and `y` of its first LED, and `step_x` and `step_y` to the next.
+        """
+        self.__send_command(self.COMMAND_LEDS)
+        split = self.__get_line().split(',')
+        strands, leds_per_strand, frames_sent, frames_skipped = (
+            int(value) for value in split[:4])
+        segments = []
+        for item in split[4:]:
+            group, strand, offset, count, x, y, step_x, step_y = (
+                int(value) for value in item.split(':'))
+            segments.append(dict(
+                group=group, strand=strand, offset=offset, count=count,
+                x=x, y=y, step_x=step_x, step_y=step_y))
+        return dict(
+            strands=strands,
+            leds_per_strand=leds_per_strand,
+            frames_sent=frames_sent,
+            frames_skipped=frames_skipped,
+            segments=segments,
+        )
+
+    def get_scan_state(self) -> dict:
+        """Get how often each panel is being sampled.
+
+        Returns:
+            Dictionary with `adaptive` scanning in use, `sleeping` while
+            nobody is on the pad, `active` panels sampled on every scan,
+            `max_latency_us` a press can go unseen, and `rates` mapping each
+            panel to its samples per second.
+        """
+        self.__send_command(self.COMMAND_SCAN)
+        values = [int(value) for value in self.__get_line().split(',')]
+        adaptive, sleeping, active, max_latency_us = values[:4]
+        return dict(
+            adaptive=adaptive != 0,
+            sleeping=sleeping != 0,
+            active=[panel for index, panel in enumerate(self.PANEL_ORDER)
+                    if active & (1 << index)],
+            max_latency_us=max_latency_us,
+            rates=dict(zip(self.PANEL_ORDER, values[4:])),
+        )
+
+    def set_adaptive_scan(self, enabled: bool) -> None:
+        """Sample idle panels less often than active ones.
+        """
+        self.__set_config_u16('adaptive_scan', 1 if enabled else 0)
+
+    def get_crosstalk_state(self) -> dict:
+        """Get the state of crosstalk compensation between panels.
+
+        Returns:
+            Dictionary with `enabled`, `learning_panel` (a direction or None),
+            `samples` taken while learning, and `cycles` and `max_cycles`
+            taken by the firmware to compensate a scan.
+        """
+        self.__send_command(self.COMMAND_CROSSTALK)
+        values = [int(value) for value in self.__get_line().split(',')]
+        return dict(
+            enabled=values[0] != 0,
+            learning_panel=(
+                None if values[1] == self.NO_PANEL
+                else self.PANEL_ORDER[values[1]]),
+            samples=values[2],
+            cycles=values[3],
+            max_cycles=values[4],
+        )
+
+    def get_crosstalk_matrix(self) -> Sequence[Sequence[float]]:
+        """Get the crosstalk coefficients.
+
+        Returns:
+            A row for each sensor in panel order (see `PANEL_ORDER` and
+            `SENSOR_ORDER`, without correcting for orientation). Each value is
+            the fraction of a sensor's load that appears on the row's sensor.
+        """
+        self.__send_command(self.COMMAND_CROSSTALK_MATRIX)
+        scale = 1 << self.CROSSTALK_FRACTION_BITS
+        values = [int(value) / scale for value in self.__get_line().split(',')]
+        size = len(self.PANEL_ORDER) * len(self.SENSOR_ORDER)
+        return [values[row * size:(row + 1) * size] for row in range(size)]
+
+    def learn_crosstalk(self, panel: str) -> None:
+        """Start learning the crosstalk from a panel. Only that panel should
+        be pressed until `finish_crosstalk()` is called, with the weight moved
+        around all of its sensors.
+
+        Args:
+            panel: Direction of the panel.
+        """
+        if panel not in self.PANEL_ORDER:
+            raise ValueError(
+                f'`panel` must be one of: {", ".join(self.PANEL_ORDER)}')
+
+        self.__send_command(self.COMMAND_LEARN_CROSSTALK)
+        self.__send_line(str(self.PANEL_ORDER.index(panel)))
+        self.__check_response(
+            self.__get_line(), f'Failed to learn crosstalk from {panel}')
+
+    def finish_crosstalk(self) -> None:
+        """Update the coefficients of the panel being learned. They are kept
+        in memory until `save_crosstalk()` is called.
+        """
+        self.__send_command(self.COMMAND_FINISH_CROSSTALK)
+        self.__check_response(
+            self.__get_line(), 'Too few presses to learn crosstalk')
+
+    def clear_crosstalk(self) -> None:
+        """Set all crosstalk coefficients to 0 in memory.
+        """
+        self.__send_command(self.COMMAND_CLEAR_CROSSTALK)
+
+    def save_crosstalk(self) -> None:
+        """Save the crosstalk coefficients to EEPROM.
+        """
+        self.__send_command(self.COMMAND_SAVE_CROSSTALK)
+
+    def set_crosstalk_enabled(self, enabled: bool) -> None:
+        """Subtract the crosstalk from other panels on every scan.
+        """
+        self.__set_config_u16('crosstalk', 1 if enabled else 0)
+
+    def get_baselines(self) -> dict:
+        """Get the saved baselines and how they were used at boot.
+
+        The firmware saves the baselines of idle sensors now and then and
+        seeds the thresholds from them at boot. A saved baseline is kept if a
+        live reading agrees with it or is above it (`Loaded`, assumed to be a
+        press), and replaced by the live reading if it is below it (`Stale`)
+        or there was no plausible record (`Missing`). A loaded sensor that
+        stays pressed without its reading moving has its baseline replaced by
+        the reading later on (`Expired`), and the record is dropped.
+
+        Returns:
+            Dictionary with `saved` if there is a valid record, `seeded`
+            sensors seeded from it at boot, `writes` of the record since, and
+            `sensors`, a nested dictionary mapping arrow directions to
+            cardinal direction sensors with `check`, `baseline`, and `noise`
+            values for 10-bit readings.
+        """
+        self.__send_command(self.COMMAND_BASELINES)
+        values = self.__get_line().split(',')
+        saved, seeded, writes = (int(value) for value in values[:3])
+        values = values[3:]
+        sensors = {}
+        for panel in self.PANEL_ORDER:
+            sensors[panel] = {}
+            for sensor in self.SENSOR_ORDER:
+                check, baseline, noise = (
+                    int(value) for value in values.pop(0).split(':'))
+                sensors[panel][sensor] = dict(
+                    check=BaselineCheck(check),
+                    baseline=baseline,
+                    noise=noise,
+                )
+        return dict(
+            saved=saved != 0,
+            seeded=seeded,
+            writes=writes,
+            sensors=sensors,
+        )
+
+    def get_sensor_stats(self, panel: str, sensor: str) -> dict:
+        """Get the statistics the firmware keeps of a sensor's readings.
+
+        The firmware keeps exact sums, so the mean and variance are computed
+        here without rounding. All values are for 10-bit readings.
+
+        Args:
+            panel: Direction of the panel.
+            sensor: Cardinal direction of the sensor before correcting for
+                orientation.
+
+        Returns:
+            Dictionary with `elapsed_s` since the statistics were reset and
+            summaries of the `idle` distances from the baseline, the `pressed`
+            loads, and the `peaks` of each press, each with `count`, `mean`,
+            `variance`, `min`, and `max`. `idle_bins` and `pressed_bins` are
+            histograms of the same values with the `low` end of the first
+            bin, the `width` of each bin, and their `counts`. The first and
+            last bins include everything outside them.
+        """
+        if panel not in self.PANEL_ORDER:
+            raise ValueError(
+                f'`panel` must be one of: {", ".join(self.PANEL_ORDER)}')
+        if sensor not in self.SENSOR_ORDER:
+            raise ValueError(
+                f'`sensor` must be one of: {", ".join(self.SENSOR_ORDER)}')
+
+        index = (self.PANEL_ORDER.index(panel) * len(self.SENSOR_ORDER) +
+                 self.SENSOR_ORDER.index(sensor))
+        self.__send_command(self.COMMAND_STATS)
+        self.__send_line(str(index))
+        split = self.__get_line().split(',')
+        scale = 1 << int(split[0])
+
+        def summary(item):
+            count, total, squares, low, high = (
+                int(value) for value in item.split(':'))
+            mean = total / count / scale if count else 0.0
+            variance = ((count * squares - total * total) /
+                        (count * count * scale * scale) if count else 0.0)
+            return dict(count=count, mean=mean, variance=variance,
+                        min=low / scale, max=high / scale)
+
+        def histogram(item):
+            low, width, *counts = (int(value) for value in item.split(':'))
+            return dict(low=low / scale, width=width / scale, counts=counts)
+
+        return dict(
+            elapsed_s=int(split[1]) / 1000,
+            idle=summary(split[2]),
+            pressed=summary(split[3]),
+            peaks=summary(split[4]),
+            idle_bins=histogram(split[5]),
+            pressed_bins=histogram(split[6]),
+        )
+
+    def reset_sensor_stats(self) -> None:
+        """Clear the statistics of every sensor.
+        """
+        self.__send_command(self.COMMAND_RESET_STATS)
+
+    def set_sensor_stats_enabled(self, enabled: bool) -> None:
+        """Keep statistics of every sensor's readings on the device.
+        """
+        self.__set_config_u16('sensor_stats', 1 if enabled else 0)
+
     def set_color(self, panel, r, g, b) -> None:
         """Set the color of an arrow light.
         """
@@ -388,10 +1024,49 @@ class Communicator:
     def set_arrow_lights(self, enabled) -> None:
         """Turn all the arrow lights on or off.
         """
-        if enabled:
-            self.__send_line('@@@O@@@@@@@@@')
-        else:
-            self.__send_line('@@@@@@@@@@@@@')
+        self.set_panel_lights(self.DIRECTIONS if enabled else ())
+
+    def set_panel_lights(self, panels) -> None:
+        """Light the arrows of some panels and turn off the others, as a
+        SextetStream packet would.
+
+        Args:
+            panels: Directions of the panels to light.
+        """
+        bits = 0
+        for panel in panels:
+            bits |= self.SEXTET_PANEL_BITS[panel]
+        # Six bits per character, offset into the printable range
+        self.__send_line('@@@' + chr(0x40 | bits) + '@' * 9)
+
+    def send_led_frame(self, frame: bytes) -> None:
+        """Send a frame of colors for every LED, encoded by
+        `base.led_frames.LedFrameEncoder`. The frame replaces the lights until
+        frames stop arriving for a second.
+        """
+        self._ser.write(frame)
+
+    def get_led_stream_state(self) -> dict:
+        """Get the state of streamed LED frames.
+
+        Returns:
+            Dictionary with `streaming` while frames are being shown, `frames`
+            shown, `dropped` frames that were invalid or waiting for a
+            keyframe, and the CPU cycles taken to decode the last frame
+            (`cycles`), the slowest one (`max_cycles`), and the slowest slice
+            of a frame decoded between two scans (`max_slice_cycles`).
+        """
+        self.__send_command(self.COMMAND_STREAM)
+        streaming, frames, dropped, cycles, max_cycles, max_slice_cycles = (
+            int(value) for value in self.__get_line().split(','))
+        return dict(
+            streaming=streaming != 0,
+            frames=frames,
+            dropped=dropped,
+            cycles=cycles,
+            max_cycles=max_cycles,
+            max_slice_cycles=max_slice_cycles,
+        )
 
     def set_auto_lights(self, enabled) -> None:
         """Allow lights to be controlled by the pad in response to input.
@@ -400,5 +1075,12 @@ class Communicator:
 
     def persist(self) -> None:
         """Save all configuration to EEPROM.
+
+        Raises:
+            ValueError: The configuration doesn't fit in the EEPROM and
+                wasn't saved.
         """
         self.__send_command(self.COMMAND_PERSIST)
+        self.__check_response(
+            self.__get_line(),
+            'Configuration is too large for the EEPROM and was not saved')
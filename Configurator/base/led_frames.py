@@ -0,0 +1,138 @@
+"""Encode per-LED frames for streaming to the firmware.
+
+A frame sets the color of every LED of every strand. Frames are sent as ops
+that skip LEDs that didn't change since the last frame, set runs of LEDs to one
+color, or set LEDs to their own colors, so most frames are much smaller than
+the raw colors. Every `keyframe_interval` frames, a keyframe is sent that
+starts from black instead of the last frame, so the device recovers from a
+frame that was lost or corrupted.
+
+Frame layout, see LedFrame.h in the firmware:
+
+    `~`, flags (u8), length of the ops (u16 little-endian), ops,
+    Fletcher-16 checksum of the ops (u16 little-endian)
+
+LEDs are numbered strand by strand, each strand as long as the longest one, as
+reported by `Communicator.get_led_topology()`.
+"""
+
+import struct
+from typing import Sequence, Tuple
+
+START = b'~'
+FLAG_KEY = 0x01
+
+OP_SKIP = 0x00
+OP_RUN = 0x40
+OP_LITERAL = 0x80
+MAX_COUNT = 64
+
+BLACK = (0, 0, 0)
+
+Color = Tuple[int, int, int]
+
+
+def checksum(data: bytes) -> int:
+    """Fletcher-16 checksum, as used by the firmware."""
+    sum1 = sum2 = 0
+    for byte in data:
+        sum1 = (sum1 + byte) % 255
+        sum2 = (sum2 + sum1) % 255
+    return (sum2 << 8) | sum1
+
+
+def encode_ops(colors: Sequence[Color], base: Sequence[Color]) -> bytes:
+    """Encode the ops that turn the colors of `base` into `colors`.
+
+    Args:
+        colors: Color of each LED as `(r, g, b)`.
+        base: Colors the LEDs have before the ops are applied.
+
+    Returns:
+        The ops.
+    """
+    ops = bytearray()
+    count = len(colors)
+    index = 0
+    while index < count:
+        end = index + 1
+        limit = min(count, index + MAX_COUNT)
+        if colors[index] == base[index]:
+            while end < limit and colors[end] == base[end]:
+                end += 1
+            ops.append(OP_SKIP | (end - index - 1))
+        elif end < count and colors[end] == colors[index]:
+            while end < limit and colors[end] == colors[index]:
+                end += 1
+            ops.append(OP_RUN | (end - index - 1))
+            ops.extend(colors[index])
+        else:
+            # Until the next LED that can be skipped or starts a run
+            while (end < limit and colors[end] != base[end]
+                   and (end + 1 == count or colors[end + 1] != colors[end])):
+                end += 1
+            ops.append(OP_LITERAL | (end - index - 1))
+            for color in colors[index:end]:
+                ops.extend(color)
+        index = end
+    return bytes(ops)
+
+
+def encode_frame(ops: bytes, key: bool) -> bytes:
+    """Wrap ops in a frame.
+
+    Args:
+        ops: Ops from `encode_ops()`.
+        key: Whether the ops start from black rather than the last frame.
+    """
+    return (START + struct.pack('<BH', FLAG_KEY if key else 0, len(ops))
+            + ops + struct.pack('<H', checksum(ops)))
+
+
+class LedFrameEncoder:
+    """Encode a stream of frames as deltas of the frames before them.
+    """
+
+    DEFAULT_KEYFRAME_INTERVAL = 60
+
+    def __init__(
+        self,
+        num_leds: int,
+        keyframe_interval: int = DEFAULT_KEYFRAME_INTERVAL,
+    ) -> None:
+        """Encode frames of `num_leds` LEDs.
+
+        Args:
+            num_leds: Number of strands times the LEDs per strand.
+            keyframe_interval: Frames from one keyframe to the next. The first
+                frame is always a keyframe.
+        """
+        self._num_leds = num_leds
+        self._keyframe_interval = keyframe_interval
+        self._last = None
+        self._frames = 0
+
+    def encode(self, colors: Sequence[Color]) -> bytes:
+        """Encode the next frame.
+
+        Args:
+            colors: Color of each LED as `(r, g, b)`.
+
+        Returns:
+            The frame to send.
+        """
+        if len(colors) != self._num_leds:
+            raise ValueError(f'Frames must have {self._num_leds} LEDs')
+        colors = [tuple(color) for color in colors]
+
+        key = self._frames % self._keyframe_interval == 0
+        base = [BLACK] * self._num_leds if key else self._last
+        frame = encode_frame(encode_ops(colors, base), key)
+
+        self._last = colors
+        self._frames += 1
+        return frame
+
+    def reset(self) -> None:
+        """Make the next frame a keyframe."""
+        self._frames = 0
@@ -0,0 +1,113 @@
+"""Expand log records fetched from the firmware into text.
+
+The firmware doesn't format log messages. Each record holds the index of a
+message in LogMessages.h and its integer arguments, fetched with
+`Communicator.get_log()`. The format strings are read from the same header the
+firmware was built with, so the decoder must use the header of the firmware's
+version.
+
+Follow the log of a pad with:
+
+    python -m base.log_decoder /dev/ttyACM0
+"""
+
+import argparse
+import re
+import time
+from pathlib import Path
+from typing import Mapping, Sequence
+
+DEFAULT_MESSAGES_PATH = (Path(__file__).resolve().parents[2] / 'Firmware' /
+                         'lib' / 'firmware' / 'src' / 'LogMessages.h')
+
+LEVELS = ('NONE', 'ERROR', 'WARN', 'INFO', 'DEBUG')
+
+_ENTRY = re.compile(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)')
+_CONVERSION = re.compile(r'%[-+ #0]*\d*(?:\.\d+)?([a-zA-Z%])')
+
+
+def load_messages(path: Path = DEFAULT_MESSAGES_PATH) -> Sequence[tuple]:
+    """Read the messages from LogMessages.h.
+
+    Returns:
+        `(name, format)` of each message, in the order of their indices.
+    """
+    # Comments show the entries' syntax too
+    text = re.sub(r'^\s*//.*$', '', Path(path).read_text(), flags=re.MULTILINE)
+    return [(name, bytes(fmt, 'ascii').decode('unicode_escape'))
+            for name, fmt in _ENTRY.findall(text)]
+
+
+def format_message(fmt: str, args: Sequence[int]) -> str:
+    """Expand a format string with the arguments of a record.
+
+    Arguments are sent as unsigned 32-bit integers, so those of `%d` and `%i`
+    are converted back to signed ones.
+    """
+    values = []
+    for match, arg in zip(
+            (m for m in _CONVERSION.finditer(fmt) if m.group(1) != '%'), args):
+        if match.group(1) in 'di' and arg >= 1 << 31:
+            arg -= 1 << 32
+        values.append(arg)
+    try:
+        return fmt % tuple(values)
+    except (TypeError, ValueError):
+        # Arguments don't match the format, e.g. from other firmware
+        return f'{fmt} {list(args)}'
+
+
+class LogDecoder:
+    """Expand log records into text.
+    """
+
+    def __init__(self, path: Path = DEFAULT_MESSAGES_PATH) -> None:
+        """Use the messages in a LogMessages.h.
+
+        Args:
+            path: LogMessages.h of the firmware the records come from.
+        """
+        self._messages = load_messages(path)
+
+    def decode(self, record: Mapping) -> str:
+        """Expand a record from `Communicator.get_log()` into a line with its
+        time in seconds, level, and message.
+        """
+        level = record['level']
+        level = LEVELS[level] if level < len(LEVELS) else str(level)
+        message = record['message']
+        if message < len(self._messages):
+            text = format_message(self._messages[message][1], record['args'])
+        else:
+            text = f'Unknown message {message} {record["args"]}'
+        return f'{record["time_us"] / 1e6:12.6f} {level:5} {text}'
+
+
+def main() -> None:
+    # pylint: disable=import-outside-toplevel
+    from base.communicator import Communicator
+
+    parser = argparse.ArgumentParser(
+        description='Print the log of a pad as it grows.')
+    parser.add_argument('port', help='Serial port of the pad')
+    parser.add_argument('--messages', type=Path, default=DEFAULT_MESSAGES_PATH,
+                        help='LogMessages.h of the firmware')
+    parser.add_argument('--interval', type=float, default=0.5,
+                        help='Seconds between polls')
+    args = parser.parse_args()
+
+    decoder = LogDecoder(args.messages)
+    communicator = Communicator(args.port)
+    cursor = 0
+    while True:
+        cursor, lost, records = communicator.get_log(cursor)
+        if lost:
+            print(f'... {lost} records lost')
+        for record in records:
+            print(decoder.decode(record))
+        if not records:
+            time.sleep(args.interval)
+
+
+if __name__ == '__main__':
+    main()
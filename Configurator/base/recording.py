@@ -0,0 +1,439 @@
+"""Record sensor telemetry to disk and read back time windows of it.
+
+Recordings are split into chunks of a fixed number of samples. Each chunk
+stores its columns (timestamps, sensor values, thresholds, and press states)
+separately, delta-encoded and compressed with zlib, so a reader can decompress
+only the columns it needs. Chunks also hold the press and release events
+fetched from the pad's event journal along with their samples. Events keep
+the time the pad detected them, so presses shorter than the sampling period
+aren't lost. An index of the chunks' time ranges is written at
+the end, which lets a reader load any time window by seeking straight to the
+chunks that overlap it. The recorder holds one chunk in memory, so its memory
+use doesn't grow with the length of a session.
+
+If a recording isn't closed, e.g. because the application crashed, the index
+is missing and is rebuilt by scanning the chunk headers. Only the samples of
+the unfinished chunk are lost.
+
+File layout, all little-endian:
+
+    header:  MAGIC, version (u16), sensors (u16), chunk samples (u32)
+    chunk:   CHUNK_MAGIC, samples and events (u32, u32), first and last
+             time (u64, u64), then for each column in COLUMNS and
+             EVENT_COLUMNS its compressed size (u32), followed by the
+             compressed columns
+    index:   INDEX_MAGIC, chunks (u32), then for each chunk its offset,
+             first and last time (u64, u64, u64), samples and events
+             (u32, u32)
+    footer:  index offset (u64), FOOTER_MAGIC
+"""
+
+import struct
+import zlib
+from typing import Iterable, List, Mapping, NamedTuple, Sequence, Tuple
+
+import numpy as np
+
+
+MAGIC = b'FSRREC\0\0'
+CHUNK_MAGIC = b'CHNK'
+INDEX_MAGIC = b'INDX'
+FOOTER_MAGIC = b'RECEND\0\0'
+VERSION = 2
+
+NUM_SENSORS = 16
+DEFAULT_CHUNK_SAMPLES = 4096
+
+# Columns in the order they're stored in each chunk. Sensor columns hold a
+# row per sensor so each sensor's samples are contiguous.
+COLUMNS = ('time_us', 'value', 'trigger', 'release', 'pressed')
+
+# Columns of the events in each chunk: the pad's time of the event, which
+# wraps around like its clock, the time of the sample it was fetched with,
+# the sensor index, whether it's a press, and the peak pressure
+EVENT_COLUMNS = ('time_us', 'received_us', 'sensor', 'pressed', 'peak')
+_EVENT_TYPES = dict(
+    time_us=np.uint32, received_us=np.int64, sensor=np.uint8,
+    pressed=np.uint8, peak=np.int16)
+
+_HEADER = struct.Struct('<8sHHI')
+_CHUNK_HEADER = struct.Struct('<4sIIQQ')
+_COLUMN_SIZES = struct.Struct('<' + 'I' * (len(COLUMNS) + len(EVENT_COLUMNS)))
+_INDEX_HEADER = struct.Struct('<4sI')
+_INDEX_ENTRY = struct.Struct('<QQQII')
+_FOOTER = struct.Struct('<Q8s')
+
+
+class ChunkInfo(NamedTuple):
+    """Location and time range of a chunk."""
+    offset: int
+    first_us: int
+    last_us: int
+    samples: int
+    events: int
+
+
+def _encode(column: np.ndarray) -> bytes:
+    """Delta-encode a column along time and compress it."""
+    # Deltas wrap around in the column's type and cumsum() wraps them back
+    deltas = np.diff(column, axis=-1, prepend=0).astype(column.dtype)
+    return zlib.compress(deltas.tobytes(), 6)
+
+
+def _decode(data: bytes, dtype, shape) -> np.ndarray:
+    """Inverse of `_encode()`."""
+    deltas = np.frombuffer(zlib.decompress(data), dtype=dtype).reshape(shape)
+    return np.cumsum(deltas, axis=-1, dtype=dtype)
+
+
+def align_events(time_us: np.ndarray, received_us: np.ndarray) -> np.ndarray:
+    """Estimate when events happened on the recording's clock.
+
+    The pad's clock isn't synchronized with the recording's, so the offset
+    between them is estimated from the event that was fetched soonest after
+    it happened. Align events over windows of minutes rather than the whole
+    recording, as the clocks drift apart.
+
+    Args:
+        time_us: Pad's time of each event.
+        received_us: Time of the sample each event was fetched with.
+
+    Returns:
+        Time of each event in the recording.
+    """
+    if len(time_us) == 0:
+        return np.zeros(0, dtype=np.int64)
+    # Differences between the clocks, relative to the first event's so the
+    # pad's clock wrapping around doesn't matter
+    offsets = (received_us - time_us.astype(np.int64)) & 0xFFFFFFFF
+    offsets = (offsets - offsets[0] + (1 << 31)) % (1 << 32) - (1 << 31)
+    return received_us - (offsets - offsets.min())
+
+
+class Recorder:
+    """Stream samples of every sensor to a recording.
+    """
+
+    def __init__(self, path: str, chunk_samples: int = DEFAULT_CHUNK_SAMPLES):
+        """Create a recording, replacing any file at `path`.
+
+        Args:
+            path: Path of the recording.
+            chunk_samples: Samples buffered in memory before they're written.
+        """
+        self._file = open(path, 'wb')
+        self._file.write(
+            _HEADER.pack(MAGIC, VERSION, NUM_SENSORS, chunk_samples))
+        self._chunk_samples = chunk_samples
+        self._index: List[ChunkInfo] = []
+
+        self._time_us = np.zeros(chunk_samples, dtype=np.int64)
+        self._value = np.zeros((NUM_SENSORS, chunk_samples), dtype=np.int16)
+        self._trigger = np.zeros_like(self._value)
+        self._release = np.zeros_like(self._value)
+        self._pressed = np.zeros(chunk_samples, dtype=np.uint16)
+        self._count = 0
+        self._events: List[Tuple[int, int, int, bool, int]] = []
+
+    def add(
+        self,
+        time_us: int,
+        values: Sequence[int],
+        triggers: Sequence[int],
+        releases: Sequence[int],
+        pressed: Sequence[bool],
+        events: Iterable[Tuple[int, int, bool, int]] = (),
+    ) -> None:
+        """Add a sample of every sensor.
+
+        Args:
+            time_us: Time of the sample. Must not go backwards.
+            values: Value of each sensor in panel order.
+            triggers: Trigger threshold of each sensor.
+            releases: Release threshold of each sensor.
+            pressed: Whether each sensor is pressed.
+            events: Events fetched since the previous sample, each a tuple of
+                the pad's time, sensor index, whether it's a press, and peak
+                pressure.
+        """
+        index = self._count
+        self._time_us[index] = time_us
+        self._value[:, index] = values
+        self._trigger[:, index] = triggers
+        self._release[:, index] = releases
+        self._pressed[index] = sum(
+            1 << sensor for sensor, state in enumerate(pressed) if state)
+        self._count += 1
+        for event_us, sensor, event_pressed, peak in events:
+            self._events.append(
+                (event_us, time_us, sensor, event_pressed, peak))
+
+        if self._count == self._chunk_samples:
+            self._write_chunk()
+
+    def close(self) -> None:
+        """Write the remaining samples and the index."""
+        if self._file.closed:
+            return
+
+        self._write_chunk()
+        index_offset = self._file.tell()
+        self._file.write(_INDEX_HEADER.pack(INDEX_MAGIC, len(self._index)))
+        for info in self._index:
+            self._file.write(_INDEX_ENTRY.pack(*info))
+        self._file.write(_FOOTER.pack(index_offset, FOOTER_MAGIC))
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def _write_chunk(self) -> None:
+        count = self._count
+        if count == 0:
+            return
+
+        columns = [
+            _encode(self._time_us[:count]),
+            _encode(self._value[:, :count]),
+            _encode(self._trigger[:, :count]),
+            _encode(self._release[:, :count]),
+            _encode(self._pressed[:count]),
+        ]
+        events = list(zip(*self._events)) or [()] * len(EVENT_COLUMNS)
+        for name, column in zip(EVENT_COLUMNS, events):
+            columns.append(_encode(np.array(column, dtype=_EVENT_TYPES[name])))
+        info = ChunkInfo(
+            self._file.tell(),
+            int(self._time_us[0]),
+            int(self._time_us[count - 1]),
+            count,
+            len(self._events))
+
+        self._file.write(_CHUNK_HEADER.pack(
+            CHUNK_MAGIC, count, info.events, info.first_us, info.last_us))
+        self._file.write(_COLUMN_SIZES.pack(*(len(data) for data in columns)))
+        for data in columns:
+            self._file.write(data)
+        self._file.flush()
+
+        self._index.append(info)
+        self._count = 0
+        self._events = []
+
+
+class Recording:
+    """Read time windows from a recording.
+    """
+
+    def __init__(self, path: str):
+        """Open a recording and load its index.
+
+        Args:
+            path: Path of the recording.
+        """
+        self._file = open(path, 'rb')
+        header = self._file.read(_HEADER.size)
+        magic, version, sensors, _ = (
+            _HEADER.unpack(header) if len(header) == _HEADER.size
+            else (None, None, None, None))
+        if magic != MAGIC or version != VERSION or sensors != NUM_SENSORS:
+            self._file.close()
+            raise ValueError(f'Not a supported recording: {path}')
+
+        self.chunks = self._read_index() or self._scan_chunks()
+
+    @property
+    def start_us(self) -> int:
+        """Time of the first sample or 0 if there are none."""
+        return self.chunks[0].first_us if self.chunks else 0
+
+    @property
+    def end_us(self) -> int:
+        """Time of the last sample or 0 if there are none."""
+        return self.chunks[-1].last_us if self.chunks else 0
+
+    @property
+    def samples(self) -> int:
+        return sum(info.samples for info in self.chunks)
+
+    @property
+    def events(self) -> int:
+        return sum(info.events for info in self.chunks)
+
+    def read(
+        self,
+        start_us: int,
+        end_us: int,
+        columns: Iterable[str] = COLUMNS,
+    ) -> Mapping[str, np.ndarray]:
+        """Read the samples in a time window.
+
+        Only the chunks overlapping the window are read, and only the
+        requested columns are decompressed.
+
+        Args:
+            start_us: Start of the window.
+            end_us: End of the window, inclusive.
+            columns: Columns to read from COLUMNS.
+
+        Returns:
+            Dictionary of the requested columns and `time_us`. Sensor columns
+            have a row per sample and a column per sensor. `pressed` holds
+            booleans.
+        """
+        columns = set(columns) | {'time_us'}
+        unknown = columns - set(COLUMNS)
+        if unknown:
+            raise ValueError(f'Unknown columns: {", ".join(sorted(unknown))}')
+
+        parts = {name: [] for name in columns}
+        for info in self.chunks:
+            if info.last_us < start_us or info.first_us > end_us:
+                continue
+            chunk = self._read_chunk(info, columns)
+            keep = (chunk['time_us'] >= start_us) & (chunk['time_us'] <= end_us)
+            for name in columns:
+                parts[name].append(chunk[name][keep])
+
+        result = {}
+        for name in columns:
+            if parts[name]:
+                result[name] = np.concatenate(parts[name])
+            else:
+                result[name] = self._empty(name)
+        return result
+
+    def read_events(self, start_us: int, end_us: int) -> Mapping[str, np.ndarray]:
+        """Read the events fetched with the samples in a time window.
+
+        Args:
+            start_us: Start of the window.
+            end_us: End of the window, inclusive.
+
+        Returns:
+            Dictionary of EVENT_COLUMNS, with an entry per event in the order
+            they were fetched. `pressed` holds booleans. See
+            `align_events()` to place them among the samples.
+        """
+        parts = {name: [] for name in EVENT_COLUMNS}
+        for info in self.chunks:
+            if info.last_us < start_us or info.first_us > end_us:
+                continue
+            chunk = self._read_events(info)
+            keep = ((chunk['received_us'] >= start_us) &
+                    (chunk['received_us'] <= end_us))
+            for name in EVENT_COLUMNS:
+                parts[name].append(chunk[name][keep])
+
+        result = {}
+        for name in EVENT_COLUMNS:
+            dtype = bool if name == 'pressed' else _EVENT_TYPES[name]
+            result[name] = (np.concatenate(parts[name]) if parts[name]
+                            else np.zeros(0, dtype=dtype))
+        return result
+
+    def close(self) -> None:
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    @staticmethod
+    def _empty(name: str) -> np.ndarray:
+        if name == 'time_us':
+            return np.zeros(0, dtype=np.int64)
+        if name == 'pressed':
+            return np.zeros((0, NUM_SENSORS), dtype=bool)
+        return np.zeros((0, NUM_SENSORS), dtype=np.int16)
+
+    def _read_index(self) -> List[ChunkInfo]:
+        """Load the index from the end of the file. Returns an empty list if
+        the recording wasn't closed.
+        """
+        self._file.seek(0, 2)
+        size = self._file.tell()
+        if size < _HEADER.size + _FOOTER.size:
+            return []
+
+        self._file.seek(size - _FOOTER.size)
+        index_offset, magic = _FOOTER.unpack(self._file.read(_FOOTER.size))
+        if magic != FOOTER_MAGIC:
+            return []
+
+        self._file.seek(index_offset)
+        magic, count = _INDEX_HEADER.unpack(
+            self._file.read(_INDEX_HEADER.size))
+        if magic != INDEX_MAGIC:
+            return []
+        return [
+            ChunkInfo(*_INDEX_ENTRY.unpack(self._file.read(_INDEX_ENTRY.size)))
+            for _ in range(count)
+        ]
+
+    def _scan_chunks(self) -> List[ChunkInfo]:
+        """Rebuild the index from the chunk headers, stopping at the first
+        incomplete chunk.
+        """
+        chunks = []
+        offset = _HEADER.size
+        self._file.seek(0, 2)
+        size = self._file.tell()
+        while offset + _CHUNK_HEADER.size + _COLUMN_SIZES.size <= size:
+            self._file.seek(offset)
+            magic, count, events, first_us, last_us = _CHUNK_HEADER.unpack(
+                self._file.read(_CHUNK_HEADER.size))
+            if magic != CHUNK_MAGIC:
+                break
+            sizes = _COLUMN_SIZES.unpack(self._file.read(_COLUMN_SIZES.size))
+            end = offset + _CHUNK_HEADER.size + _COLUMN_SIZES.size + sum(sizes)
+            if end > size:
+                break
+            chunks.append(ChunkInfo(offset, first_us, last_us, count, events))
+            offset = end
+        return chunks
+
+    def _read_chunk(
+        self,
+        info: ChunkInfo,
+        columns: Iterable[str],
+    ) -> Mapping[str, np.ndarray]:
+        self._file.seek(info.offset + _CHUNK_HEADER.size)
+        sizes = _COLUMN_SIZES.unpack(self._file.read(_COLUMN_SIZES.size))
+        data_offset = self._file.tell()
+
+        count = info.samples
+        result = {}
+        for name, size in zip(COLUMNS, sizes[:len(COLUMNS)]):
+            if name in columns:
+                self._file.seek(data_offset)
+                data = self._file.read(size)
+                if name == 'time_us':
+                    result[name] = _decode(data, np.int64, (count,))
+                elif name == 'pressed':
+                    bits = _decode(data, np.uint16, (count,))
+                    result[name] = (
+                        bits[:, None] >> np.arange(NUM_SENSORS) & 1
+                    ).astype(bool)
+                else:
+                    result[name] = _decode(
+                        data, np.int16, (NUM_SENSORS, count)).T
+            data_offset += size
+        return result
+
+    def _read_events(self, info: ChunkInfo) -> Mapping[str, np.ndarray]:
+        self._file.seek(info.offset + _CHUNK_HEADER.size)
+        sizes = _COLUMN_SIZES.unpack(self._file.read(_COLUMN_SIZES.size))
+        self._file.seek(sum(sizes[:len(COLUMNS)]), 1)
+
+        result = {}
+        for name, size in zip(EVENT_COLUMNS, sizes[len(COLUMNS):]):
+            column = _decode(
+                self._file.read(size), _EVENT_TYPES[name], (info.events,))
+            result[name] = column.astype(bool) if name == 'pressed' else column
+        return result
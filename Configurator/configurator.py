@@ -8,7 +8,9 @@ import re
 
 from PyQt6 import uic
 from PyQt6.QtCore import Qt, QTimer
-from PyQt6.QtWidgets import QApplication, QDialog, QTableWidgetItem, QColorDialog
+from PyQt6.QtWidgets import (
+    QApplication, QDialog, QTableWidgetItem, QColorDialog, QFileDialog,
+    QMessageBox)
 from PyQt6.QtGui import QColor
 import numpy as np
 import pyqtgraph as pg
@@ -16,6 +18,7 @@ from serial.tools import list_ports
 from serial import Serial
 
 from base.communicator import Communicator
+from base.recording import Recorder
 
 
 class Dialog(QDialog):
@@ -44,6 +47,13 @@ class Dialog(QDialog):
 
         self.pushButton_reset.clicked.connect(self.on_reset_clicked)
         self.pushButton_save.clicked.connect(self.on_save_clicked)
+        self.pushButton_record.toggled.connect(self.on_record_toggled)
+
+        # Session recording. Press states are tracked from the firmware's
+        # event journal while recording.
+        self.recorder = None
+        self.events_cursor = 0
+        self.pressed = [False] * 16
 
         # Setup lighting controls
         self.pushButton_colorUp.clicked.connect(self.on_up_color_clicked)
@@ -137,6 +147,11 @@ class Dialog(QDialog):
         timer.timeout.connect(self.update_plots)
         timer.start(0)
 
+        # Check sensor health less often
+        health_timer = QTimer(self)
+        health_timer.timeout.connect(self.update_health)
+        health_timer.start(1000)
+
     def update_plots(self):
         """Plot the current sensor values."""
 
@@ -170,6 +185,9 @@ class Dialog(QDialog):
         self.data_sensors[14][-1] = values['right']['south']['value']
         self.data_sensors[15][-1] = values['right']['west']['value']
 
+        if self.recorder is not None:
+            self.record_sample(values)
+
         # Update curves
         y = 0
         for direction in [self.curves_up, self.curves_down, self.curves_left, self.curves_right]:
@@ -181,6 +199,61 @@ class Dialog(QDialog):
 
         self.x += 1
 
+    def record_sample(self, values):
+        """Add the latest sensor values to the recording, with the events
+        the pad detected since the previous sample.
+        """
+
+        fetched = []
+        while True:
+            self.events_cursor, _, events = self.comm.get_events(
+                self.events_cursor)
+            if not events:
+                break
+            for event in events:
+                sensor = Communicator.PANEL_ORDER.index(event['panel']) * 4 + \
+                    Communicator.SENSOR_ORDER.index(event['sensor'])
+                self.pressed[sensor] = event['pressed']
+                fetched.append((
+                    event['time_us'], sensor, event['pressed'], event['peak']))
+
+        sensors = [
+            values[panel][sensor]
+            for panel in Communicator.PANEL_ORDER
+            for sensor in Communicator.SENSOR_ORDER
+        ]
+        self.recorder.add(
+            time.monotonic_ns() // 1000,
+            [sensor['value'] for sensor in sensors],
+            [sensor['trigger_threshold'] for sensor in sensors],
+            [sensor['release_threshold'] for sensor in sensors],
+            self.pressed,
+            fetched)
+
+    def update_health(self):
+        """Highlight sensors the firmware is ignoring due to a fault."""
+
+        if self.comm is None:
+            return
+
+        health = self.comm.get_sensor_health()
+
+        row = 0
+        for panel in Communicator.PANEL_ORDER:
+            for sensor in Communicator.SENSOR_ORDER:
+                item = self.tableThresholds.item(row, 1)
+                state = health[panel][sensor]
+                if state['faulty']:
+                    item.setBackground(QColor('darkred'))
+                    item.setToolTip(f"Ignored: {state['status'].name}")
+                elif state['strikes'] > 0:
+                    item.setBackground(QColor('darkorange'))
+                    item.setToolTip(f"Suspect: {state['status'].name}")
+                else:
+                    item.setBackground(QColor(0, 0, 0, 0))
+                    item.setToolTip('')
+                row += 1
+
     def on_device_changed(self, index: int):
         if index == 0:
             return
@@ -198,6 +271,16 @@ class Dialog(QDialog):
 
         self.labelDeviceInfo.setText(self.comm.get_version())
 
+        # Sensor values are reported at the resolution of the ADC profile
+        max_value = self.comm.get_adc_info()['max_value']
+        for plot in [
+            self.plot_up,
+            self.plot_down,
+            self.plot_left,
+            self.plot_right,
+        ]:
+            plot.setYRange(0, max_value, padding=0)
+
         config = self.comm.get_config()
 
         # Update table
@@ -207,9 +290,9 @@ class Dialog(QDialog):
                 self.tableThresholds.item(idx, 0).setText(
                     str(config[panel][f'{direction}_pin']))
                 self.tableThresholds.item(idx, 2).setText(
-                    config[panel][f'{direction}_trigger'])
+                    str(config[panel][f'{direction}_trigger']))
                 self.tableThresholds.item(idx, 3).setText(
-                    config[panel][f'{direction}_release'])
+                    str(config[panel][f'{direction}_release']))
                 idx += 1
 
         self.tableThresholds.itemChanged.connect(self.on_table_item_changed)
@@ -240,7 +323,33 @@ class Dialog(QDialog):
         self.comm.calibrate()
 
     def on_save_clicked(self):
-        self.comm.persist()
+        try:
+            self.comm.persist()
+        except ValueError as e:
+            QMessageBox.warning(self, 'Save', str(e))
+
+    def on_record_toggled(self, enabled):
+        if not enabled:
+            if self.recorder is not None:
+                self.recorder.close()
+                self.recorder = None
+            return
+
+        path = QFileDialog.getSaveFileName(
+            self, 'Record Session', 'session.rec', 'Recordings (*.rec)')[0]
+        if self.comm is None or not path:
+            self.pushButton_record.setChecked(False)
+            return
+
+        # Only events from now on matter
+        self.events_cursor, _, _ = self.comm.get_events(0xFFFFFFFF)
+        while True:
+            self.events_cursor, _, events = self.comm.get_events(
+                self.events_cursor)
+            if not events:
+                break
+        self.pressed = [False] * 16
+        self.recorder = Recorder(path)
 
     @staticmethod
     def __get_color_from_stylesheet(stylesheet):
@@ -3,7 +3,22 @@
 from random import sample
 
 
-GET_CONFIG_RESPONSE = b'0,1,2,3,4,270,5,6,7,8,180,9,10,11,12,90,13,14,15,16\n'
+LAYOUT_RESPONSE = b'up=0:1:2:3:4,down=270:5:6:7:8,left=180:9:10:11:12,right=90:13:14:15:16\n'
+SCHEMA_RESPONSE = '{entries}\n'.format(
+    entries=','.join(
+        ['auto_lights:u16:0:1', 'brightness:u16:0:255'] +
+        [f'color_{panel}:u32:0:16777215' for panel in ('up', 'down', 'left', 'right')] +
+        [f'sensor{pin}{opt}:u16:1:1023' for pin in range(1, 17) for opt in ('trigger', 'release')]
+    )
+).encode('ascii')
+CHANGES_RESPONSE = '57,*,{entries}\n'.format(
+    entries=','.join(
+        ['auto_lights=1', 'brightness=100'] +
+        [f'color_{panel}=255' for panel in ('up', 'down', 'left', 'right')] +
+        [f'sensor{pin}{opt}=150' for pin in range(1, 17) for opt in ('trigger', 'release')]
+    )
+).encode('ascii')
+CHANGES_SINCE_RESPONSE = b'58,brightness=20\n'
 SENSOR_VALUES_RESPONSE = '{values}\n'.format(
     values=','.join(map(str, sample(range(1024), 16)))
 ).encode('ascii')
@@ -14,4 +29,9 @@ SENSOR_VALUES_RESPONSE = '{values}\n'.format(
         map(str, sample(range(500, 600), 16)), # trigger threshold
         map(str, sample(range(300, 400), 16)), # release threshold
     )] for a in t])
-).encode('ascii')
\ No newline at end of file
+).encode('ascii')
+SENSOR_HEALTH_RESPONSE = '{values}\n'.format(
+    values=','.join(['0,0,0'] * 15 + ['1,1,3'])
+).encode('ascii')
+
+ADC_RESPONSE = b'3,5,12,16,4095,6100,98,120\n'
@@ -0,0 +1,210 @@
+"""Tests for the pipelined communicator
+"""
+
+import asyncio
+import queue
+import threading
+import pytest
+import serial
+
+from base.async_communicator import AsyncCommunicator
+from base.communicator import Communicator
+from .stubs import SENSOR_VALUES_RESPONSE
+
+
+class FakeSerial:
+    """Serial port of a device that answers tagged commands with `respond`.
+
+    Responses are held until `release` of them are pending and then sent in
+    reverse order, to check they are matched by ID and not by order.
+    """
+
+    def __init__(self, respond, release=1):
+        self.timeout = None
+        self.writes = []
+        self.max_pending = 0
+        self._respond = respond
+        self._release = release
+        self._held = []
+        self._lines = queue.Queue()
+        self._lock = threading.Lock()
+        self.failed = threading.Event()
+
+    def write(self, data):
+        self.writes.append(data)
+        lines = data.decode('ascii').split('\n')
+        request_id, command = lines[0][1:].split(' -')
+        with self._lock:
+            self._held.append((request_id, self._respond(command, lines[1:-1])))
+            self.max_pending = max(self.max_pending, len(self._held))
+            if len(self._held) >= self._release:
+                for request_id, response in reversed(self._held):
+                    if response is not None:
+                        self.send(f'#{request_id} {response}')
+                self._held.clear()
+
+    def send(self, line):
+        self._lines.put(f'{line}\n'.encode('ascii'))
+
+    def send_bytes(self, data):
+        self._lines.put(data)
+
+    def fail(self):
+        """Make reads fail as if the device was unplugged."""
+        self.failed.set()
+
+    def readline(self):
+        if self.failed.is_set():
+            raise serial.SerialException('device disconnected')
+        try:
+            return self._lines.get(timeout=self.timeout)
+        except queue.Empty:
+            return b''
+
+
+def run(coroutine):
+    return asyncio.run(asyncio.wait_for(coroutine, 5))
+
+
+class TestAsyncCommunicator:
+
+    def test_matches_responses_by_id(self):
+        ser = FakeSerial(lambda command, lines: command.upper(), release=3)
+
+        async def main():
+            async with AsyncCommunicator(ser) as pad:
+                return await asyncio.gather(
+                    pad.request('a'), pad.request('b'), pad.request('c'))
+
+        assert run(main()) == ['A', 'B', 'C']
+        assert ser.writes == [b'#1 -a\n', b'#2 -b\n', b'#3 -c\n']
+
+    def test_sends_additional_lines_in_one_write(self):
+        ser = FakeSerial(lambda command, lines: Communicator.RESPONSE_SUCCESS)
+
+        async def main():
+            async with AsyncCommunicator(ser) as pad:
+                await pad.set_config_u16('brightness', 100)
+
+        run(main())
+        assert ser.writes == [b'#1 -set\nu16 brightness=100\n']
+
+    def test_raises_on_failure(self):
+        ser = FakeSerial(lambda command, lines: Communicator.RESPONSE_FAILURE)
+
+        async def main():
+            async with AsyncCommunicator(ser) as pad:
+                await pad.set_config_u16('brightness', 1000)
+
+        with pytest.raises(ValueError):
+            run(main())
+
+    def test_persist_raises_if_not_saved(self):
+        ser = FakeSerial(lambda command, lines: Communicator.RESPONSE_FAILURE)
+
+        async def main():
+            async with AsyncCommunicator(ser) as pad:
+                await pad.persist()
+
+        with pytest.raises(ValueError):
+            run(main())
+
+    def test_parses_responses(self):
+        values = SENSOR_VALUES_RESPONSE.decode('ascii').strip()
+        ser = FakeSerial(lambda command, lines: values)
+
+        async def main():
+            async with AsyncCommunicator(ser) as pad:
+                return await pad.get_sensor_values()
+
+        assert run(main()) == Communicator.parse_sensor_values(values)
+
+    def test_limits_commands_in_flight(self):
+        ser = FakeSerial(lambda command, lines: '', release=2)
+
+        async def main():
+            async with AsyncCommunicator(ser, max_in_flight=2) as pad:
+                await asyncio.gather(*(pad.calibrate() for _ in range(10)))
+
+        run(main())
+        assert len(ser.writes) == 10
+        assert ser.max_pending == 2
+
+    def test_separates_telemetry(self):
+        ser = FakeSerial(lambda command, lines: 'version')
+        ser.send('1,2,3')
+
+        async def main():
+            async with AsyncCommunicator(ser) as pad:
+                version = await pad.get_version()
+                ser.send('4,5,6')
+                return version, await pad.telemetry(), await pad.telemetry()
+
+        assert run(main()) == ('version', '1,2,3', '4,5,6')
+
+    def test_drops_oldest_telemetry_when_full(self):
+        ser = FakeSerial(lambda command, lines: '')
+        for line in range(5):
+            ser.send(str(line))
+
+        async def main():
+            async with AsyncCommunicator(ser, telemetry_size=2) as pad:
+                await pad.calibrate()
+                return await pad.telemetry(), pad.lost_telemetry
+
+        assert run(main()) == ('3', 3)
+
+    def test_times_out(self):
+        ser = FakeSerial(lambda command, lines: None)
+
+        async def main():
+            async with AsyncCommunicator(ser) as pad:
+                with pytest.raises(asyncio.TimeoutError):
+                    await pad.request('v', timeout=0.05)
+
+                # A late response is dropped
+                ser.send('#1 late')
+                await asyncio.sleep(0.2)
+                return pad.unmatched_responses, pad._pending
+
+        assert run(main()) == (1, {})
+
+    def test_replaces_undecodable_bytes(self):
+        ser = FakeSerial(lambda command, lines: 'version')
+        ser.send_bytes(b'1,\xff,3\n')
+
+        async def main():
+            async with AsyncCommunicator(ser) as pad:
+                return await pad.telemetry(), await pad.get_version()
+
+        assert run(main()) == ('1,\ufffd,3', 'version')
+
+    def test_fails_requests_when_port_fails(self):
+        ser = FakeSerial(lambda command, lines: None)
+
+        async def main():
+            async with AsyncCommunicator(ser) as pad:
+                pending = asyncio.ensure_future(pad.request('v', timeout=2))
+                await asyncio.sleep(0.05)
+                ser.fail()
+                with pytest.raises(ConnectionError):
+                    await pending
+
+                # Nothing can be read, so later commands fail right away
+                with pytest.raises(ConnectionError):
+                    await pad.get_version()
+                return pad._pending
+
+        assert run(main()) == {}
+
+    def test_fails_requests_after_close(self):
+        ser = FakeSerial(lambda command, lines: 'version')
+
+        async def main():
+            pad = AsyncCommunicator(ser)
+            await pad.open()
+            await pad.close()
+            with pytest.raises(ConnectionError):
+                await pad.get_version()
+
+        run(main())
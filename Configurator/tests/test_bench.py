@@ -0,0 +1,39 @@
+"""Tests for the serial protocol benchmark
+"""
+
+from unittest.mock import Mock
+import pytest
+
+from base.bench import run, summarize
+
+
+def test_summarize():
+    summary = summarize([0.001 * (index + 1) for index in range(100)])
+
+    assert summary['count'] == 100
+    assert summary['min_ms'] == pytest.approx(1)
+    assert summary['mean_ms'] == pytest.approx(50.5)
+    assert summary['p50_ms'] == pytest.approx(50)
+    assert summary['p90_ms'] == pytest.approx(90)
+    assert summary['p99_ms'] == pytest.approx(99)
+    assert summary['max_ms'] == pytest.approx(100)
+
+
+def test_run_sextet():
+    communicator = Mock()
+    communicator.get_version.return_value = 'Dance Pad Firmware'
+
+    results = run(communicator, ['sextet'], count=8)
+
+    assert results['version'] == 'Dance Pad Firmware'
+    assert results['workloads']['sextet']['packets'] == 8
+    panels = [call.args[0] for call in
+              communicator.set_panel_lights.call_args_list]
+    assert panels[:4] == [['up'], ['down'], ['left'], ['right']]
+    # Lights are turned off at the end
+    assert list(panels[-1]) == []
+
+
+def test_run_unknown_workload():
+    with pytest.raises(ValueError):
+        run(Mock(), ['values', 'nothing'])
@@ -5,9 +5,22 @@ from unittest.mock import Mock
 import pytest
 from serial import Serial
 
-from base.communicator import Communicator, PanelOrientation
+from base.communicator import (
+    BaselineCheck,
+    Communicator,
+    PanelOrientation,
+    SensorHealth,
+)
 
-from .stubs import GET_CONFIG_RESPONSE, SENSOR_VALUES_RESPONSE
+from .stubs import (
+    ADC_RESPONSE,
+    CHANGES_RESPONSE,
+    CHANGES_SINCE_RESPONSE,
+    LAYOUT_RESPONSE,
+    SCHEMA_RESPONSE,
+    SENSOR_HEALTH_RESPONSE,
+    SENSOR_VALUES_RESPONSE,
+)
 
 class TestPanelConfiguration:
 
@@ -46,12 +59,104 @@ class TestCommunicator:
         self.mock_serial.readline.assert_not_called()
 
     def test_get_config(self, setup):
-        self.mock_serial.readline.return_value = GET_CONFIG_RESPONSE
+        self.mock_serial.readline.side_effect = [
+            LAYOUT_RESPONSE, CHANGES_RESPONSE, SCHEMA_RESPONSE]
 
-        self.communicator.get_config()
+        config = self.communicator.get_config()
 
-        self.mock_serial.write.assert_called_once()
-        self.mock_serial.readline.assert_called_once()
+        assert self.mock_serial.readline.call_count == 3
+        assert config['down']['orientation'] == PanelOrientation.Rotated270Degrees
+        assert config['down']['north_pin'] == 5
+        assert config['down']['north_trigger'] == 150
+        assert config['up']['color'] == (255, 0, 0)
+        assert config['brightness'] == 100
+        assert config['auto_lights']
+
+    def test_get_config_changes(self, setup):
+        self.mock_serial.readline.return_value = CHANGES_SINCE_RESPONSE
+
+        generation, epoch, items, reset = self.communicator.get_config_changes(57)
+
+        assert self.mock_serial.write.call_count == 2
+        assert generation == 58
+        assert epoch is None
+        assert items == {'brightness': '20'}
+        assert not reset
+
+    def test_get_config_changes_with_epoch(self, setup):
+        self.mock_serial.readline.return_value = b'58:1234,brightness=20\n'
+
+        generation, epoch, items, reset = self.communicator.get_config_changes(
+            57, 1234)
+
+        self.mock_serial.write.assert_called_with(b'57:1234\n')
+        assert generation == 58
+        assert epoch == 1234
+        assert items == {'brightness': '20'}
+        assert not reset
+
+    def test_get_schema(self, setup):
+        self.mock_serial.readline.return_value = b'lut:str,brightness:u16:0:255\n'
+
+        schema = self.communicator.get_schema()
+
+        assert schema['lut'] == {'type': 'str'}
+        assert schema['brightness'] == {'type': 'u16', 'min': 0, 'max': 255}
+
+    def test_sync_config_fetches_only_changes(self, setup):
+        self.mock_serial.readline.side_effect = [
+            CHANGES_RESPONSE, SCHEMA_RESPONSE, CHANGES_SINCE_RESPONSE]
+
+        self.communicator.sync_config()
+        config = self.communicator.sync_config()
+
+        # Schema is only fetched once
+        assert self.mock_serial.readline.call_count == 3
+        self.mock_serial.write.assert_called_with(b'57\n')
+        assert config['brightness'] == 20
+        assert config['sensor1trigger'] == 150
+
+    def test_sync_config_after_reboot(self, setup):
+        # The device rebooted and its generations restarted below the cached
+        # one, so all items are fetched again
+        self.mock_serial.readline.side_effect = [
+            CHANGES_RESPONSE, SCHEMA_RESPONSE, b'12,*,brightness=30\n']
+        self.communicator.sync_config()
+
+        config = self.communicator.sync_config()
+
+        self.mock_serial.write.assert_called_with(b'57\n')
+        assert config == {'brightness': 30}
+
+    def test_sync_config_sends_epoch(self, setup):
+        # After a reboot, generations can catch up with the cached one, so
+        # only the epoch tells them apart
+        self.mock_serial.readline.side_effect = [
+            b'57:1234,*,brightness=20,auto_lights=1\n', SCHEMA_RESPONSE,
+            b'60:5678,*,brightness=30\n']
+        self.communicator.sync_config()
+
+        config = self.communicator.sync_config()
+
+        self.mock_serial.write.assert_called_with(b'57:1234\n')
+        assert config == {'brightness': 30}
+
+        self.mock_serial.readline.side_effect = [b'60:5678\n']
+        self.communicator.sync_config()
+        self.mock_serial.write.assert_called_with(b'60:5678\n')
+
+    def test_sync_config_after_reboot_without_reset(self, setup):
+        # Older firmware didn't report a generation from before a reboot as a
+        # reset
+        self.mock_serial.readline.side_effect = [
+            CHANGES_RESPONSE, SCHEMA_RESPONSE, b'12,brightness=30\n',
+            b'12,*,brightness=30,auto_lights=0\n']
+        self.communicator.sync_config()
+
+        config = self.communicator.sync_config()
+
+        self.mock_serial.write.assert_called_with(b'0\n')
+        assert config == {'brightness': 30, 'auto_lights': 0}
 
     def test_set_thresholds(self, setup):
         self.mock_serial.readline.return_value = Communicator.RESPONSE_SUCCESS.encode('ascii')
@@ -77,10 +182,298 @@ class TestCommunicator:
         self.mock_serial.write.assert_called_once()
         self.mock_serial.readline.assert_called_once()
 
+    def test_get_sensor_health(self, setup):
+        self.mock_serial.readline.return_value = SENSOR_HEALTH_RESPONSE
+
+        health = self.communicator.get_sensor_health()
+
+        self.mock_serial.write.assert_called_once()
+        self.mock_serial.readline.assert_called_once()
+        assert not health['up']['north']['faulty']
+        assert health['right']['west']['faulty']
+        assert health['right']['west']['status'] == SensorHealth.Stuck
+        assert health['right']['west']['strikes'] == 3
+
+    def test_get_adc_info(self, setup):
+        self.mock_serial.readline.return_value = ADC_RESPONSE
+
+        info = self.communicator.get_adc_info()
+
+        self.mock_serial.write.assert_called_once()
+        assert info['resolution'] == 12
+        assert info['max_value'] == 4095
+        assert info['max_scan_time_us'] == 120
+
+    def test_persist(self, setup):
+        self.mock_serial.readline.return_value = b'!\n'
+
+        self.communicator.persist()
+
+        self.mock_serial.write.assert_called_with(b'-persist\n')
+
+    def test_persist_raises_if_not_saved(self, setup):
+        self.mock_serial.readline.return_value = b'?\n'
+
+        with pytest.raises(ValueError):
+            self.communicator.persist()
+
+    def test_get_task_stats(self, setup):
+        self.mock_serial.readline.return_value = (
+            b'scan:1000:2:0:95:40,report:1000:0:0:12:8\n')
+
+        stats = self.communicator.get_task_stats()
+
+        self.mock_serial.write.assert_called_with(b'-tasks\n')
+        assert stats['scan'] == dict(
+            runs=1000, overruns=2, skipped=0, max_run_us=95,
+            max_latency_us=40)
+        assert stats['report']['max_run_us'] == 12
+
+    def test_set_panel_lights(self, setup):
+        self.communicator.set_panel_lights(['up', 'left'])
+        self.mock_serial.write.assert_called_with(b'@@@E@@@@@@@@@\n')
+
+        self.communicator.set_arrow_lights(True)
+        self.mock_serial.write.assert_called_with(b'@@@O@@@@@@@@@\n')
+
+        self.communicator.set_arrow_lights(False)
+        self.mock_serial.write.assert_called_with(b'@@@@@@@@@@@@@\n')
+
+    def test_set_linearization(self, setup):
+        self.mock_serial.readline.return_value = Communicator.RESPONSE_SUCCESS.encode('ascii')
+
+        self.communicator.set_linearization(20, [(0, 0), (300, 100), (1023, 1023)])
+
+        self.mock_serial.write.assert_called_with(b'str sensor20lut=0:0;300:100;1023:1023\n')
+
+    def test_set_linearization_with_wrong_values(self, setup):
+        with pytest.raises(ValueError):
+            self.communicator.set_linearization(20, [(0, 0)])
+        with pytest.raises(ValueError):
+            self.communicator.set_linearization(20, [(10, 0), (5, 10)])
+        with pytest.raises(ValueError):
+            self.communicator.set_linearization(20, [(0, 0), (1024, 10)])
+
     def test_set_color(self, setup):
         self.mock_serial.readline.return_value = Communicator.RESPONSE_SUCCESS.encode('ascii')
 
         self.communicator.set_color('up', 255, 255, 255)
 
         assert self.mock_serial.write.call_count == 2
-        assert self.mock_serial.readline.call_count == 1
\ No newline at end of file
+        assert self.mock_serial.readline.call_count == 1
+
+    def test_get_boot_timing(self, setup):
+        self.mock_serial.readline.return_value = b'850,21000,21400\n'
+
+        timing = self.communicator.get_boot_timing()
+
+        assert timing == dict(
+            config_read_us=850, setup_done_us=21000, first_report_us=21400)
+
+    def test_get_profiles(self, setup):
+        self.mock_serial.readline.return_value = b'1,,Alice,,\n'
+
+        active, names = self.communicator.get_profiles()
+
+        assert active == 1
+        assert names == ['', 'Alice', '', '']
+
+    def test_get_profiles_without_active_profile(self, setup):
+        self.mock_serial.readline.return_value = b'255,,,,\n'
+
+        active, _ = self.communicator.get_profiles()
+
+        assert active is None
+
+    def test_select_profile(self, setup):
+        self.mock_serial.readline.return_value = Communicator.RESPONSE_SUCCESS.encode('ascii')
+
+        self.communicator.select_profile(2)
+
+        self.mock_serial.write.assert_called_with(b'2\n')
+
+    def test_select_empty_profile(self, setup):
+        self.mock_serial.readline.return_value = Communicator.RESPONSE_FAILURE.encode('ascii')
+
+        with pytest.raises(ValueError):
+            self.communicator.select_profile(3)
+
+    def test_save_profile(self, setup):
+        self.mock_serial.readline.return_value = Communicator.RESPONSE_SUCCESS.encode('ascii')
+
+        self.communicator.save_profile(1, 'Alice')
+
+        self.mock_serial.write.assert_called_with(b'1 Alice\n')
+
+    def test_save_profile_with_bad_name(self, setup):
+        with pytest.raises(ValueError):
+            self.communicator.save_profile(1, 'a,b')
+        with pytest.raises(ValueError):
+            self.communicator.save_profile(1, 'x' * 12)
+        self.mock_serial.write.assert_not_called()
+
+    def test_get_crosstalk_state(self, setup):
+        self.mock_serial.readline.return_value = b'1,2,1500,410,455\n'
+
+        state = self.communicator.get_crosstalk_state()
+
+        assert state == dict(
+            enabled=True,
+            learning_panel='left',
+            samples=1500,
+            cycles=410,
+            max_cycles=455)
+
+    def test_get_crosstalk_matrix(self, setup):
+        values = ['0'] * 256
+        values[4 * 16 + 0] = '4096'
+        values[15 * 16 + 11] = '-1638'
+        self.mock_serial.readline.return_value = \
+            (','.join(values) + '\n').encode('ascii')
+
+        matrix = self.communicator.get_crosstalk_matrix()
+
+        assert len(matrix) == 16
+        assert all(len(row) == 16 for row in matrix)
+        assert matrix[4][0] == 0.25
+        assert matrix[15][11] == pytest.approx(-0.1, abs=1e-4)
+        assert matrix[0][4] == 0
+
+    def test_learn_crosstalk(self, setup):
+        self.mock_serial.readline.return_value = Communicator.RESPONSE_SUCCESS.encode('ascii')
+
+        self.communicator.learn_crosstalk('down')
+
+        self.mock_serial.write.assert_called_with(b'1\n')
+
+    def test_learn_crosstalk_with_bad_panel(self, setup):
+        with pytest.raises(ValueError):
+            self.communicator.learn_crosstalk('center')
+        self.mock_serial.write.assert_not_called()
+
+    def test_finish_crosstalk_with_too_few_samples(self, setup):
+        self.mock_serial.readline.return_value = Communicator.RESPONSE_FAILURE.encode('ascii')
+
+        with pytest.raises(ValueError):
+            self.communicator.finish_crosstalk()
+
+    def test_get_events(self, setup):
+        self.mock_serial.readline.return_value = \
+            b'42,3,1000000:0:0:1:500,1020000:2:3:0:612\n'
+
+        cursor, lost, events = self.communicator.get_events(37)
+
+        self.mock_serial.write.assert_called_with(b'37\n')
+        assert cursor == 42
+        assert lost == 3
+        assert events == [
+            dict(time_us=1000000, panel='up', sensor='north', pressed=True,
+                 peak=500),
+            dict(time_us=1020000, panel='left', sensor='west', pressed=False,
+                 peak=612),
+        ]
+
+    def test_get_events_without_new_events(self, setup):
+        self.mock_serial.readline.return_value = b'42,0\n'
+
+        cursor, lost, events = self.communicator.get_events(42)
+
+        assert (cursor, lost, events) == (42, 0, [])
+
+    def test_get_log(self, setup):
+        self.mock_serial.readline.return_value = \
+            b'9,2,150:3:1:4:25,2000:2:6:4294967295\n'
+
+        cursor, lost, records = self.communicator.get_log(7)
+
+        self.mock_serial.write.assert_called_with(b'7\n')
+        assert cursor == 9
+        assert lost == 2
+        assert records == [
+            dict(time_us=150, level=3, message=1, args=[4, 25]),
+            dict(time_us=2000, level=2, message=6, args=[4294967295]),
+        ]
+
+    def test_get_scan_state(self, setup):
+        self.mock_serial.readline.return_value = \
+            b'1,0,5,4000,3003,1001,3003,1000\n'
+
+        state = self.communicator.get_scan_state()
+
+        self.mock_serial.write.assert_called_with(b'-scan\n')
+        assert state == dict(
+            adaptive=True,
+            sleeping=False,
+            active=['up', 'left'],
+            max_latency_us=4000,
+            rates=dict(up=3003, down=1001, left=3003, right=1000),
+        )
+
+    def test_get_baselines(self, setup):
+        self.mock_serial.readline.return_value = (
+            b'1,15,2,' + b','.join([b'1:100:2'] * 4 + [b'2:90:3'] +
+                                   [b'0:101:1'] * 11) + b'\n')
+
+        baselines = self.communicator.get_baselines()
+
+        self.mock_serial.write.assert_called_with(b'-baselines\n')
+        assert (baselines['saved'], baselines['seeded'], baselines['writes']) \
+            == (True, 15, 2)
+        assert baselines['sensors']['up']['west'] == dict(
+            check=BaselineCheck.Loaded, baseline=100, noise=2)
+        assert baselines['sensors']['down']['north'] == dict(
+            check=BaselineCheck.Stale, baseline=90, noise=3)
+        assert baselines['sensors']['right']['west'] == dict(
+            check=BaselineCheck.Kept, baseline=101, noise=1)
+
+    def test_get_sensor_stats(self, setup):
+        idle_bins = ':'.join(['0'] * 16)
+        pressed_bins = ':'.join(['0', '0', '2'] + ['0'] * 13)
+        self.mock_serial.readline.return_value = (
+            f'2,5000,4:0:8:-8:4,2:1200:720032:596:604,1:600:360000:600:600,'
+            f'-32:4:{idle_bins},0:256:{pressed_bins}\n').encode()
+
+        stats = self.communicator.get_sensor_stats('down', 'east')
+
+        self.mock_serial.write.assert_called_with(b'5\n')
+        assert stats['elapsed_s'] == 5
+        assert stats['idle'] == dict(
+            count=4, mean=0, variance=0.125, min=-2, max=1)
+        assert stats['pressed'] == dict(
+            count=2, mean=150, variance=1, min=149, max=151)
+        assert stats['peaks']['count'] == 1
+        assert stats['idle_bins']['low'] == -8
+        assert stats['idle_bins']['width'] == 1
+        assert stats['pressed_bins']['width'] == 64
+        assert stats['pressed_bins']['counts'][2] == 2
+        assert len(stats['pressed_bins']['counts']) == 16
+
+    def test_get_sensor_stats_rejects_unknown_sensor(self, setup):
+        with pytest.raises(ValueError):
+            self.communicator.get_sensor_stats('up', 'center')
+
+    def test_get_led_topology(self, setup):
+        self.mock_serial.readline.return_value = \
+            b'2,25,10,90,0:0:0:25:384:128:0:0,4:1:5:10:0:0:25:-25\n'
+
+        topology = self.communicator.get_led_topology()
+
+        self.mock_serial.write.assert_called_with(b'-leds\n')
+        assert topology == dict(
+            strands=2, leds_per_strand=25, frames_sent=10, frames_skipped=90,
+            segments=[
+                dict(group=0, strand=0, offset=0, count=25, x=384, y=128,
+                     step_x=0, step_y=0),
+                dict(group=4, strand=1, offset=5, count=10, x=0, y=0,
+                     step_x=25, step_y=-25),
+            ])
+
+    def test_get_led_stream_state(self, setup):
+        self.mock_serial.readline.return_value = b'1,120,2,5400,9000,3100\n'
+
+        state = self.communicator.get_led_stream_state()
+
+        self.mock_serial.write.assert_called_with(b'-stream\n')
+        assert state == dict(
+            streaming=True, frames=120, dropped=2, cycles=5400,
+            max_cycles=9000, max_slice_cycles=3100)
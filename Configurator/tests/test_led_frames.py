@@ -0,0 +1,79 @@
+"""Tests for encoding streamed LED frames
+"""
+
+import random
+import struct
+
+import pytest
+
+from base.led_frames import (
+    BLACK, FLAG_KEY, MAX_COUNT, OP_LITERAL, OP_RUN, LedFrameEncoder, checksum)
+
+
+def decode(frame, leds):
+    """Apply a frame to a list of colors, like the firmware does."""
+    assert frame[:1] == b'~'
+    flags, length = struct.unpack('<BH', frame[1:4])
+    ops = frame[4:4 + length]
+    assert struct.unpack('<H', frame[4 + length:]) == (checksum(ops),)
+
+    if flags & FLAG_KEY:
+        leds[:] = [BLACK] * len(leds)
+    index = position = 0
+    while position < len(ops):
+        op = ops[position]
+        count = (op & (MAX_COUNT - 1)) + 1
+        position += 1
+        if op & OP_LITERAL:
+            for offset in range(count):
+                leds[index + offset] = tuple(ops[position:position + 3])
+                position += 3
+        elif op & OP_RUN:
+            leds[index:index + count] = [tuple(ops[position:position + 3])] * count
+            position += 3
+        index += count
+    assert index <= len(leds)
+
+
+class TestLedFrames:
+
+    def test_round_trip(self):
+        rng = random.Random(1234)
+        encoder = LedFrameEncoder(200, keyframe_interval=10)
+        leds = [(1, 2, 3)] * 200
+        colors = [BLACK] * 200
+        for _ in range(30):
+            # Change some LEDs, some of them to a shared color
+            for _ in range(rng.randrange(40)):
+                index = rng.randrange(200)
+                colors[index] = (rng.randrange(256), 0, rng.randrange(2))
+            start = rng.randrange(150)
+            colors[start:start + 50] = [(255, 0, 0)] * 50
+
+            decode(encoder.encode(colors), leds)
+            assert leds == colors
+
+    def test_compresses(self):
+        encoder = LedFrameEncoder(512)
+        colors = [(255, 0, 0)] * 256 + [(0, 0, 255)] * 256
+        key = encoder.encode(colors)
+        assert key[1] & FLAG_KEY
+        assert len(key) < 50
+
+        # Unchanged LEDs are skipped
+        colors[100] = (1, 2, 3)
+        delta = encoder.encode(colors)
+        assert not delta[1] & FLAG_KEY
+        assert len(delta) < 20
+
+    def test_keyframe_interval(self):
+        encoder = LedFrameEncoder(4, keyframe_interval=3)
+        keys = [encoder.encode([BLACK] * 4)[1] & FLAG_KEY for _ in range(7)]
+        assert keys == [1, 0, 0, 1, 0, 0, 1]
+
+        encoder.reset()
+        assert encoder.encode([BLACK] * 4)[1] & FLAG_KEY
+
+    def test_rejects_wrong_size(self):
+        with pytest.raises(ValueError):
+            LedFrameEncoder(4).encode([BLACK] * 3)
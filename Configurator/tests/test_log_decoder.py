@@ -0,0 +1,46 @@
+"""Tests for expanding log records from the firmware
+"""
+
+from base.log_decoder import LogDecoder, format_message, load_messages
+
+
+def test_load_messages_from_firmware():
+    messages = load_messages()
+
+    assert messages[0] == (
+        'kLogBoot', 'Setup took %u us, reading the configuration %u us')
+    assert all(name.startswith('kLog') for name, _ in messages)
+
+
+def test_load_messages(tmp_path):
+    path = tmp_path / 'LogMessages.h'
+    path.write_text(
+        '#define LOG_MESSAGES(X) \\\n'
+        '  X(kLogA, "Quoted \\"%u\\"") \\\n'
+        '  X(kLogB, "No arguments")\n')
+
+    assert load_messages(path) == [
+        ('kLogA', 'Quoted "%u"'), ('kLogB', 'No arguments')]
+
+
+def test_format_message():
+    assert format_message('%u and %d', [7, 0xFFFFFFFE]) == '7 and -2'
+    assert format_message('%i%% %x', [0xFFFFFFFF, 255]) == '-1% ff'
+    assert format_message('%4u|', [5]) == '   5|'
+
+
+def test_format_message_with_wrong_arguments():
+    assert format_message('%u and %u', [1]) == '%u and %u [1]'
+
+
+def test_decode(tmp_path):
+    path = tmp_path / 'LogMessages.h'
+    path.write_text('  X(kLogA, "Sensor %u at %d")\n')
+    decoder = LogDecoder(path)
+
+    assert decoder.decode(
+        dict(time_us=1500000, level=2, message=0, args=[3, 0xFFFFFFF6])) == \
+        '    1.500000 WARN  Sensor 3 at -10'
+    assert decoder.decode(
+        dict(time_us=0, level=3, message=4, args=[1])) == \
+        '    0.000000 INFO  Unknown message 4 [1]'
@@ -0,0 +1,192 @@
+"""Tests for session recordings
+"""
+
+import numpy as np
+import pytest
+
+from base.recording import NUM_SENSORS, Recorder, Recording, align_events
+
+
+def make_samples(count, start_us=1000000, period_us=1000):
+    rng = np.random.default_rng(1234)
+    time_us = start_us + np.arange(count, dtype=np.int64) * period_us
+    values = rng.integers(0, 1024, size=(count, NUM_SENSORS), dtype=np.int16)
+    triggers = np.full((count, NUM_SENSORS), 150, dtype=np.int16)
+    releases = np.full((count, NUM_SENSORS), 110, dtype=np.int16)
+    pressed = values > triggers
+    return time_us, values, triggers, releases, pressed
+
+
+def record(path, samples, chunk_samples=100, close=True, events=None):
+    recorder = Recorder(path, chunk_samples=chunk_samples)
+    for index, sample in enumerate(zip(*samples)):
+        recorder.add(*sample, events=events.get(index, ()) if events else ())
+    if close:
+        recorder.close()
+
+
+class TestRecording:
+
+    def test_round_trip(self, tmp_path):
+        path = tmp_path / 'session.rec'
+        samples = make_samples(1050)
+        record(path, samples)
+
+        with Recording(path) as recording:
+            assert len(recording.chunks) == 11
+            assert recording.samples == 1050
+            assert recording.start_us == samples[0][0]
+            assert recording.end_us == samples[0][-1]
+
+            data = recording.read(recording.start_us, recording.end_us)
+
+        for name, expected in zip(
+                ('time_us', 'value', 'trigger', 'release', 'pressed'),
+                samples):
+            np.testing.assert_array_equal(data[name], expected)
+
+    def test_read_window(self, tmp_path):
+        path = tmp_path / 'session.rec'
+        samples = make_samples(1000)
+        record(path, samples)
+
+        with Recording(path) as recording:
+            data = recording.read(
+                samples[0][250], samples[0][349], columns=['value'])
+
+        assert set(data) == {'time_us', 'value'}
+        np.testing.assert_array_equal(data['time_us'], samples[0][250:350])
+        np.testing.assert_array_equal(data['value'], samples[1][250:350])
+
+    def test_read_window_only_reads_overlapping_chunks(self, tmp_path):
+        path = tmp_path / 'session.rec'
+        samples = make_samples(1000)
+        record(path, samples)
+
+        with Recording(path) as recording:
+            read = []
+            read_chunk = recording._read_chunk
+            recording._read_chunk = lambda info, columns: (
+                read.append(info.first_us) or read_chunk(info, columns))
+
+            recording.read(samples[0][450], samples[0][520])
+
+        assert read == [samples[0][400], samples[0][500]]
+
+    def test_read_empty_window(self, tmp_path):
+        path = tmp_path / 'session.rec'
+        samples = make_samples(100)
+        record(path, samples)
+
+        with Recording(path) as recording:
+            data = recording.read(0, samples[0][0] - 1)
+
+        assert data['time_us'].shape == (0,)
+        assert data['value'].shape == (0, NUM_SENSORS)
+        assert data['pressed'].shape == (0, NUM_SENSORS)
+
+    def test_recover_unclosed_recording(self, tmp_path):
+        path = tmp_path / 'session.rec'
+        samples = make_samples(250)
+        record(path, samples, close=False)
+
+        with Recording(path) as recording:
+            # The unfinished chunk is lost
+            assert recording.samples == 200
+            data = recording.read(recording.start_us, recording.end_us)
+
+        np.testing.assert_array_equal(data['value'], samples[1][:200])
+
+    def test_memory_is_bounded(self, tmp_path):
+        recorder = Recorder(tmp_path / 'session.rec', chunk_samples=100)
+        for sample in zip(*make_samples(1000)):
+            recorder.add(*sample)
+
+        assert recorder._value.shape == (NUM_SENSORS, 100)
+        assert recorder._count == 0
+        recorder.close()
+
+    def test_compresses_steady_signals(self, tmp_path):
+        path = tmp_path / 'session.rec'
+        time_us, values, triggers, releases, pressed = make_samples(4096)
+        values[:] = 100
+        pressed[:] = False
+        record(path, (time_us, values, triggers, releases, pressed),
+               chunk_samples=4096)
+
+        raw_size = values.nbytes * 3 + time_us.nbytes
+        assert path.stat().st_size < raw_size / 100
+
+    def test_rejects_other_files(self, tmp_path):
+        path = tmp_path / 'other.rec'
+        path.write_bytes(b'not a recording at all')
+
+        with pytest.raises(ValueError):
+            Recording(path)
+
+    def test_rejects_short_files(self, tmp_path):
+        path = tmp_path / 'short.rec'
+        path.write_bytes(b'FSR')
+
+        with pytest.raises(ValueError):
+            Recording(path)
+
+    def test_events_round_trip(self, tmp_path):
+        path = tmp_path / 'session.rec'
+        samples = make_samples(300)
+        # A tap shorter than a sample and events of a chunk's last sample
+        events = {
+            10: [(5000100, 3, True, 400), (5000600, 3, False, 420)],
+            99: [(5090000, 15, True, 300)],
+        }
+        record(path, samples, events=events)
+
+        with Recording(path) as recording:
+            assert recording.events == 3
+            data = recording.read_events(
+                recording.start_us, recording.end_us)
+
+        np.testing.assert_array_equal(
+            data['time_us'], [5000100, 5000600, 5090000])
+        np.testing.assert_array_equal(
+            data['received_us'], samples[0][[10, 10, 99]])
+        np.testing.assert_array_equal(data['sensor'], [3, 3, 15])
+        np.testing.assert_array_equal(data['pressed'], [True, False, True])
+        np.testing.assert_array_equal(data['peak'], [400, 420, 300])
+
+    def test_read_events_window(self, tmp_path):
+        path = tmp_path / 'session.rec'
+        samples = make_samples(300)
+        events = {index: [(index, 0, True, 200)] for index in (50, 150, 250)}
+        record(path, samples, events=events)
+
+        with Recording(path) as recording:
+            data = recording.read_events(samples[0][100], samples[0][199])
+            empty = recording.read_events(0, samples[0][0] - 1)
+
+        np.testing.assert_array_equal(data['time_us'], [150])
+        assert empty['time_us'].shape == (0,)
+        assert empty['pressed'].dtype == bool
+
+    def test_recover_unclosed_recording_events(self, tmp_path):
+        path = tmp_path / 'session.rec'
+        samples = make_samples(250)
+        events = {index: [(index, 1, True, 200)] for index in (50, 220)}
+        record(path, samples, close=False, events=events)
+
+        with Recording(path) as recording:
+            data = recording.read_events(recording.start_us, recording.end_us)
+
+        np.testing.assert_array_equal(data['time_us'], [50])
+
+    def test_align_events(self):
+        # The pad's clock is 1000 us behind and wraps around in between.
+        # Events are fetched 0 to 8000 us after they happen.
+        happened_us = np.array([2 ** 32 - 5000, 2 ** 32 + 1000, 2 ** 32 + 3000])
+        received_us = happened_us + 1000 + np.array([8000, 0, 2000])
+        time_us = (happened_us & 0xFFFFFFFF).astype(np.uint32)
+
+        aligned = align_events(time_us, received_us + 10 ** 9)
+
+        np.testing.assert_array_equal(aligned, happened_us + 1000 + 10 ** 9)
+        assert align_events(time_us[:0], received_us[:0]).shape == (0,)
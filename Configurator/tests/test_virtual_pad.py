@@ -0,0 +1,223 @@
+"""Integration tests against the firmware running as a virtual pad.
+
+The virtual pad is built from `Firmware` with `pio run -e virtualpad`. Set
+`VIRTUAL_PAD` to use a different binary. The tests are skipped if it hasn't
+been built.
+"""
+
+import asyncio
+import contextlib
+import os
+import subprocess
+import time
+import pytest
+from serial import Serial
+
+from base import bench
+from base.async_communicator import AsyncCommunicator
+from base.communicator import Communicator
+from base.led_frames import LedFrameEncoder
+from base.log_decoder import LogDecoder
+
+
+DEFAULT_VIRTUAL_PAD = os.path.join(
+    os.path.dirname(__file__), '..', '..', 'Firmware', '.pio', 'build',
+    'virtualpad', 'program')
+
+# Generous bounds, so the tests only fail on a broken protocol and not on a
+# busy machine. Measured values are printed with `pytest -s`.
+MAX_ROUND_TRIP_P95_MS = 50
+MIN_TELEMETRY_PER_SECOND = 100
+MIN_FRAMES_PER_SECOND = 60
+
+
+def percentile(values, percent):
+    values = sorted(values)
+    return values[int(percent / 100 * (len(values) - 1))]
+
+
+@contextlib.contextmanager
+def run_virtual_pad(*args):
+    """Run a virtual pad with `args` and get the path of its pty."""
+    path = os.environ.get('VIRTUAL_PAD', DEFAULT_VIRTUAL_PAD)
+    if not os.path.exists(path):
+        pytest.skip(f'Virtual pad not built: {path}')
+
+    process = subprocess.Popen(
+        [path, *args], stdout=subprocess.PIPE, text=True)
+    try:
+        yield process.stdout.readline().strip()
+    finally:
+        process.terminate()
+        process.wait(timeout=5)
+
+
+@pytest.fixture(scope='module')
+def virtual_pad():
+    with run_virtual_pad('--presses') as pty:
+        yield pty
+
+
+@pytest.fixture
+def communicator(virtual_pad):
+    ser = Serial(virtual_pad, timeout=2)
+    ser.reset_input_buffer()
+    yield Communicator(ser)
+    ser.close()
+
+
+class TestVirtualPad:
+
+    def test_get_version(self, communicator):
+        assert communicator.get_version().startswith('Dance Pad Firmware')
+
+    def test_set_color(self, communicator):
+        communicator.set_color('left', 12, 34, 56)
+
+        assert communicator.get_config()['left']['color'] == (12, 34, 56)
+
+    def test_persist(self, communicator):
+        communicator.set_brightness(120)
+
+        communicator.persist()
+
+    def test_commands_after_light_stream(self, communicator):
+        communicator.set_arrow_lights(True)
+        communicator.set_arrow_lights(False)
+
+        assert communicator.get_version().startswith('Dance Pad Firmware')
+
+    def test_led_frame_stream(self, communicator):
+        # A dot moving along every strand over a fading background
+        topology = communicator.get_led_topology()
+        num_leds = topology['strands'] * topology['leds_per_strand']
+        encoder = LedFrameEncoder(num_leds)
+        start = time.perf_counter()
+        for frame in range(120):
+            colors = [(frame % 256, 0, 32)] * num_leds
+            for strand in range(topology['strands']):
+                position = frame % topology['leds_per_strand']
+                colors[strand * topology['leds_per_strand'] + position] = (
+                    255, 255, 255)
+            communicator.send_led_frame(encoder.encode(colors))
+            time.sleep(1 / 120)
+        state = communicator.get_led_stream_state()
+        rate = state['frames'] / (time.perf_counter() - start)
+
+        print(f'\nstreamed: {rate:.0f} frames per second, '
+              f'{state["cycles"]} cycles per frame, '
+              f'max slice {state["max_slice_cycles"]} cycles')
+        assert state['streaming']
+        assert state['frames'] == 120
+        assert state['dropped'] == 0
+        assert rate > MIN_FRAMES_PER_SECOND
+
+    def test_events_from_presses(self, communicator):
+        # Every panel is pressed once a second after the first second
+        cursor = 0
+        pressed = set()
+        deadline = time.monotonic() + 3
+        while pressed != set(Communicator.PANEL_ORDER) and \
+                time.monotonic() < deadline:
+            cursor, _, events = communicator.get_events(cursor)
+            pressed.update(
+                event['panel'] for event in events if event['pressed'])
+            time.sleep(0.05)
+
+        assert pressed == set(Communicator.PANEL_ORDER)
+
+    def test_boot_log(self, communicator):
+        _, _, records = communicator.get_log(0)
+
+        lines = [LogDecoder().decode(record) for record in records]
+        assert any('LED controller started' in line for line in lines)
+        assert any('Setup took' in line for line in lines)
+
+    def test_command_round_trip_time(self, communicator):
+        times_ms = []
+        for _ in range(200):
+            start = time.perf_counter()
+            communicator.get_version()
+            times_ms.append((time.perf_counter() - start) * 1000)
+
+        print(f'\nround trip (ms): median {percentile(times_ms, 50):.3f}, '
+              f'p95 {percentile(times_ms, 95):.3f}, '
+              f'max {max(times_ms):.3f}')
+        assert percentile(times_ms, 95) < MAX_ROUND_TRIP_P95_MS
+
+    def test_telemetry_throughput(self, communicator):
+        count = 0
+        start = time.perf_counter()
+        while time.perf_counter() - start < 1:
+            communicator.get_sensor_values()
+            count += 1
+        rate = count / (time.perf_counter() - start)
+
+        print(f'\ntelemetry: {rate:.0f} sensor value responses per second')
+        assert rate > MIN_TELEMETRY_PER_SECOND
+
+    def test_pipelined_commands(self, virtual_pad):
+        # Monitoring and configuration overlap instead of taking turns
+        async def main():
+            async with AsyncCommunicator(Serial(virtual_pad)) as pad:
+                async def monitor():
+                    count = 0
+                    start = time.perf_counter()
+                    while time.perf_counter() - start < 1:
+                        await pad.get_sensor_values()
+                        count += 1
+                    return count / (time.perf_counter() - start)
+
+                async def configure():
+                    for brightness in range(50, 100):
+                        await pad.set_config_u16('brightness', brightness)
+
+                rate, _, _ = await asyncio.gather(
+                    monitor(), monitor(), configure())
+                return rate * 2
+
+        rate = asyncio.run(main())
+        print(f'\npipelined: {rate:.0f} sensor value responses per second '
+              'while configuring')
+        assert rate > MIN_TELEMETRY_PER_SECOND
+
+    def test_sync_config_after_reboot(self, tmp_path):
+        # Items changed before a reboot are lost, even once the generations
+        # after it catch up with the one the host has
+        link = str(tmp_path / 'pad')
+        ser = Serial(timeout=2)
+        ser.port = link
+        communicator = Communicator(ser)
+        with run_virtual_pad('--link', link):
+            ser.open()
+            pin = communicator.get_layout()['up']['north_pin']
+            key = f'sensor{pin}trigger'
+            default = communicator.sync_config()[key]
+            communicator.set_thresholds(pin, default + 10, default)
+            communicator.sync_config()
+            generation = communicator.get_generation()
+            ser.close()
+
+        with run_virtual_pad('--link', link):
+            ser.open()
+            enabled = True
+            while communicator.get_generation() < generation + 1:
+                communicator.set_adaptive_scan(enabled)
+                enabled = not enabled
+
+            config = communicator.sync_config()
+            ser.close()
+
+        assert config[key] == default
+        assert config['adaptive_scan'] == (0 if enabled else 1)
+
+    def test_bench(self, communicator):
+        results = bench.run(communicator, count=50, duration=0.5)
+
+        workloads = results['workloads']
+        assert set(workloads) == set(bench.WORKLOADS)
+        assert workloads['values']['p99_ms'] < MAX_ROUND_TRIP_P95_MS * 2
+        assert workloads['sextet']['packets_per_second'] > 0
+        assert workloads['scanning']['scan']['runs'] > 0
+        # The commands and packets didn't leave the pad out of step
+        assert communicator.get_version().startswith('Dance Pad Firmware')
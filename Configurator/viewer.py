@@ -0,0 +1,159 @@
+"""Viewer for recorded sessions.
+
+Shows a window of a recording at a time, reading only the chunks that overlap
+it, so hour-long recordings open instantly. Events from the pad's journal are
+drawn as triangles above the values, pointing up for presses and down for
+releases, so presses shorter than the sampling period show up too.
+
+Usage: python viewer.py [RECORDING]
+"""
+
+import sys
+
+from PyQt6.QtCore import Qt
+from PyQt6.QtWidgets import (
+    QApplication,
+    QDialog,
+    QDoubleSpinBox,
+    QFileDialog,
+    QGridLayout,
+    QHBoxLayout,
+    QLabel,
+    QSlider,
+    QVBoxLayout,
+)
+import numpy as np
+import pyqtgraph as pg
+
+from base.communicator import Communicator
+from base.recording import Recording, align_events
+
+
+class Viewer(QDialog):
+    """Plots of each panel's sensors over a window of a recording.
+    """
+
+    SENSOR_PENS = ('r', 'g', 'w', 'y')
+    DEFAULT_WINDOW_S = 10.0
+
+    # Events are fetched after they happen, and aligned using the events
+    # around the window
+    EVENT_LATE_US = 1000000
+    EVENT_ALIGN_US = 60000000
+
+    def __init__(self, path: str):
+        super(Viewer, self).__init__()
+        self.recording = Recording(path)
+        self.setWindowTitle(path)
+        self.resize(1000, 700)
+
+        grid = QGridLayout()
+        self.plots = {}
+        self.value_curves = {}
+        self.trigger_curves = {}
+        self.pressed_curves = {}
+        self.event_scatters = {}
+        positions = dict(up=(0, 1), left=(1, 0), right=(1, 2), down=(2, 1))
+        for panel in Communicator.PANEL_ORDER:
+            plot = pg.PlotWidget(title=panel)
+            plot.setDownsampling(auto=True, mode='peak')
+            plot.setClipToView(True)
+            grid.addWidget(plot, *positions[panel])
+            self.plots[panel] = plot
+            for sensor, pen in zip(Communicator.SENSOR_ORDER, self.SENSOR_PENS):
+                key = (panel, sensor)
+                self.value_curves[key] = plot.plot(pen=pg.mkPen(pen, width=2))
+                self.trigger_curves[key] = plot.plot(pen=pg.mkPen(
+                    pen, width=1, style=Qt.PenStyle.DashLine))
+                self.pressed_curves[key] = plot.plot(
+                    pen=pg.mkPen(pen, width=4), connect='finite')
+                self.event_scatters[key] = pg.ScatterPlotItem(
+                    pen=pg.mkPen(pen), brush=pg.mkBrush(pen), size=8)
+                plot.addItem(self.event_scatters[key])
+
+        self.slider = QSlider(Qt.Orientation.Horizontal)
+        self.slider.valueChanged.connect(self.update_window)
+        self.window = QDoubleSpinBox()
+        self.window.setRange(0.1, 3600)
+        self.window.setSuffix(' s')
+        self.window.setValue(self.DEFAULT_WINDOW_S)
+        self.window.valueChanged.connect(self.on_window_changed)
+        self.label = QLabel()
+
+        controls = QHBoxLayout()
+        controls.addWidget(self.slider, stretch=1)
+        controls.addWidget(self.window)
+        controls.addWidget(self.label)
+
+        layout = QVBoxLayout(self)
+        layout.addLayout(grid, stretch=1)
+        layout.addLayout(controls)
+
+        self.on_window_changed()
+
+    def on_window_changed(self):
+        """Let the slider cover the recording in steps of a tenth of the
+        window.
+        """
+        duration_ms = (self.recording.end_us - self.recording.start_us) // 1000
+        window_ms = int(self.window.value() * 1000)
+        self.slider.setRange(0, max(0, duration_ms - window_ms))
+        self.slider.setPageStep(window_ms)
+        self.slider.setSingleStep(max(1, window_ms // 10))
+        self.update_window()
+
+    def update_window(self):
+        start_us = self.recording.start_us + self.slider.value() * 1000
+        end_us = start_us + int(self.window.value() * 1e6)
+        data = self.recording.read(start_us, end_us)
+        seconds = (data['time_us'] - self.recording.start_us) / 1e6
+        self.label.setText(
+            f'{(start_us - self.recording.start_us) / 1e6:.1f} s, '
+            f'{len(seconds)} samples')
+
+        events = self.recording.read_events(
+            start_us - self.EVENT_ALIGN_US, end_us + self.EVENT_LATE_US)
+        event_us = align_events(events['time_us'], events['received_us'])
+        in_window = (event_us >= start_us) & (event_us <= end_us)
+        self.label.setText(
+            f'{self.label.text()}, {np.count_nonzero(in_window)} events')
+
+        top = max(1, int(data['value'].max(initial=0)))
+        sensor = 0
+        for panel in Communicator.PANEL_ORDER:
+            for name in Communicator.SENSOR_ORDER:
+                key = (panel, name)
+                values = data['value'][:, sensor]
+                self.value_curves[key].setData(seconds, values)
+                self.trigger_curves[key].setData(
+                    seconds, data['trigger'][:, sensor])
+
+                # Press states are drawn as bars above the values
+                pressed = data['pressed'][:, sensor]
+                level = top * (1.05 + 0.03 * (sensor % 4))
+                self.pressed_curves[key].setData(
+                    seconds, np.where(pressed, level, np.nan))
+
+                mine = in_window & (events['sensor'] == sensor)
+                self.event_scatters[key].setData(
+                    (event_us[mine] - self.recording.start_us) / 1e6,
+                    np.full(np.count_nonzero(mine), level),
+                    symbol=list(np.where(events['pressed'][mine], 't1', 't')))
+                sensor += 1
+
+
+def main():
+    """Entrypoint"""
+
+    app = QApplication(sys.argv)
+    path = sys.argv[1] if len(sys.argv) > 1 else QFileDialog.getOpenFileName(
+        None, 'Open Recording', '', 'Recordings (*.rec)')[0]
+    if not path:
+        return
+    viewer = Viewer(path)
+    viewer.show()
+    sys.exit(app.exec())
+
+
+if __name__ == '__main__':
+    main()
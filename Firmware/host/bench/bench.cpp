@@ -0,0 +1,474 @@
+//
+// Microbenchmarks of the firmware's hot paths, built against the host stubs.
+//
+// Each benchmark calls a function in batches sized to take a few milliseconds
+// and reports the fastest batch's time per call, which is the least disturbed
+// by other work on the machine. Where the kernel allows it, user-space
+// instructions per call are counted as well, which is much more stable than
+// time across machines. Results can be saved as a baseline and compared
+// against it to catch regressions. Only instruction counts fail a comparison,
+// as times vary too much between runs. Slower times are reported as warnings.
+//
+// Usage: program [--filter TEXT] [--save FILE] [--compare FILE]
+//                [--threshold PERCENT]
+//
+#include <Arduino.h>
+#include <chrono>
+#include <map>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "Config.h"
+#include "Crosstalk.h"
+#include "Lighting.h"
+#include "Linearization.h"
+#include "Panel.h"
+#include "Scheduler.h"
+#include "SensorPipeline.h"
+
+// From main.cpp
+void setup();
+void updateSerial();
+
+// Batches per benchmark
+static const int kBatches = 21;
+
+// Minimum time taken by a batch
+static const double kMinBatchNS = 2e6;
+
+// Default allowed increase before a result is flagged
+static const double kDefaultThresholdPercent = 10.0;
+
+// Results feed into this so calls can't be optimized away
+static volatile uint32_t s_nSink = 0;
+
+struct Result {
+  double dNanoseconds;  // Time per call
+  double dInstructions; // Instructions per call or < 0 if unavailable
+};
+
+// Counts user-space instructions retired by this thread
+class InstructionCounter {
+public:
+  InstructionCounter() : m_nFD(-1) {
+#ifdef __linux__
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    m_nFD = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+
+  ~InstructionCounter() {
+#ifdef __linux__
+    if (m_nFD >= 0) {
+      close(m_nFD);
+    }
+#endif
+  }
+
+  bool isAvailable() const { return m_nFD >= 0; }
+
+  void start() {
+#ifdef __linux__
+    if (m_nFD >= 0) {
+      ioctl(m_nFD, PERF_EVENT_IOC_RESET, 0);
+      ioctl(m_nFD, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  uint64_t stop() {
+    uint64_t nCount = 0;
+#ifdef __linux__
+    if (m_nFD >= 0) {
+      ioctl(m_nFD, PERF_EVENT_IOC_DISABLE, 0);
+      if (::read(m_nFD, &nCount, sizeof(nCount)) != sizeof(nCount)) {
+        nCount = 0;
+      }
+    }
+#endif
+    return nCount;
+  }
+
+private:
+  int m_nFD;
+};
+
+static InstructionCounter s_counter;
+
+static double minimum(const std::vector<double>& values) {
+  return *std::min_element(values.begin(), values.end());
+}
+
+template <typename FN>
+static Result measure(FN fn) {
+  using namespace std::chrono;
+
+  // Size batches so timer resolution doesn't matter
+  uint64_t nIterations = 1;
+  while (true) {
+    steady_clock::time_point start = steady_clock::now();
+    for (uint64_t n = 0; n < nIterations; n++) {
+      fn();
+    }
+    double dNS = duration<double, std::nano>(steady_clock::now() - start)
+                   .count();
+    if (dNS >= kMinBatchNS) {
+      break;
+    }
+    nIterations *= 2;
+  }
+
+  std::vector<double> vTimes, vInstructions;
+  for (int nBatch = 0; nBatch < kBatches; nBatch++) {
+    s_counter.start();
+    steady_clock::time_point start = steady_clock::now();
+    for (uint64_t n = 0; n < nIterations; n++) {
+      fn();
+    }
+    double dNS = duration<double, std::nano>(steady_clock::now() - start)
+                   .count();
+    uint64_t nInstructions = s_counter.stop();
+
+    vTimes.push_back(dNS / nIterations);
+    vInstructions.push_back(static_cast<double>(nInstructions) / nIterations);
+  }
+
+  Result result;
+  result.dNanoseconds = minimum(vTimes);
+  result.dInstructions = s_counter.isAvailable() ? minimum(vInstructions) : -1;
+  return result;
+}
+
+// Sensor readings that cross the thresholds every few calls
+static uint16_t s_nReading = 0;
+static uint16_t benchAnalogRead(uint8_t nPin) {
+  s_nReading = (s_nReading + 37) % 400;
+  return s_nReading;
+}
+
+// Source of the same readings for pipelines built from other stages
+class BenchSource {
+public:
+  uint16_t read() { return benchAnalogRead(0); }
+};
+
+// Time a pipeline's update, from reading a sample to detecting a press
+template <typename PIPELINE>
+static auto makePipelineBenchmark(PIPELINE& pipeline) {
+  pipeline.getDetector().setOffsets(150, 110);
+  pipeline.read();
+  pipeline.calibrate();
+  return [&pipeline]() {
+    static uint32_t s_nTimeMS = 0;
+    pipeline.update(s_nTimeMS++);
+    s_nSink += pipeline.isPressed();
+  };
+}
+
+typedef std::map<std::string, Result> Results;
+
+static void runBenchmarks(const std::string& strFilter, Results& results) {
+  auto run = [&](const char* pszName, auto fn) {
+    if (strFilter.empty() || strstr(pszName, strFilter.c_str())) {
+      results[pszName] = measure(fn);
+      printf(".");
+      fflush(stdout);
+    }
+  };
+
+  Panel panel(enumPanelUp, enumPanelOrientation270, A0, A1, A2, A3);
+  panel.calibrate();
+
+  Sensor& sensor = panel.getSensor(0);
+  run("Sensor::update", [&]() {
+    sensor.update();
+    s_nSink += sensor.isPressed();
+  });
+
+  run("Panel::update", [&]() { panel.update(); });
+
+  // Pipelines with other stages, to compare against the firmware's
+  SensorPipeline<BenchSource, Linearization> defaultPipeline;
+  run("SensorPipeline/default", makePipelineBenchmark(defaultPipeline));
+
+  SensorPipeline<BenchSource> plainPipeline;
+  run("SensorPipeline/plain", makePipelineBenchmark(plainPipeline));
+
+  SensorPipeline<BenchSource, MovingAverageFilter<4>> averagePipeline;
+  run("SensorPipeline/average4", makePipelineBenchmark(averagePipeline));
+
+  SensorPipeline<BenchSource, PassThroughFilter, TrackingBaseline<8>>
+    trackingPipeline;
+  run("SensorPipeline/tracking", makePipelineBenchmark(trackingPipeline));
+
+  run("Panel::isPressed", [&]() { s_nSink += panel.isPressed(); });
+
+  run("Panel::getLoad", [&]() { s_nSink += panel.getLoad(); });
+
+  run("Panel::getNorthSensor", [&]() {
+    s_nSink += panel.getNorthSensor().getPin();
+  });
+
+  // Full matrix, since the cost doesn't depend on the coefficients
+  Crosstalk* pCrosstalk = Crosstalk::getInstance();
+  uint16_t anLoad[kCrosstalkSensors];
+  uint16_t anCoupling[kCrosstalkSensors];
+  for (uint8_t n = 0; n < kCrosstalkSensors; n++) {
+    anLoad[n] = benchAnalogRead(n);
+  }
+  run("Crosstalk::compensate", [&]() {
+    pCrosstalk->compensate(anLoad, anCoupling);
+    s_nSink += anCoupling[0];
+  });
+
+  static const String kKey("brightness");
+  Configuration* pConfig = Configuration::getInstance();
+  run("Configuration::getUInt16", [&]() {
+    s_nSink += pConfig->getUInt16(kKey, 0);
+  });
+
+  Linearization linearization;
+  linearization.parse("0:0;100:60;300:400;600:800;1023:1023", 0);
+  uint16_t nRaw = 0;
+  run("Linearization::apply", [&]() {
+    nRaw = (nRaw + 97) & 1023;
+    s_nSink += linearization.apply(nRaw);
+  });
+
+  Lights* pLights = Lights::getInstance();
+  pLights->setStatus(enumLightsUpArrow, true);
+  pLights->setStatus(enumLightsLeftArrow, true);
+  run("Lights::update", [&]() { pLights->update(); });
+
+  // Tasks are never ready, so this is the cost of finding that out
+  static Scheduler<8> scheduler(micros);
+  for (int nTask = 0; nTask < 4; nTask++) {
+    scheduler.addPeriodic("idle", []() {}, nTask, 1000000);
+  }
+  hostAdvanceMicros(1);
+  scheduler.runOnce();
+  run("Scheduler::runOnce", [&]() { s_nSink += scheduler.runOnce(); });
+
+  // Command dispatch, including the stub serial buffers
+  run("SerialProcessor/version", []() {
+    Serial.hostWrite("-version\n");
+    updateSerial();
+    s_nSink += Serial.hostRead().size();
+  });
+  run("SerialProcessor/v", []() {
+    Serial.hostWrite("-v\n");
+    updateSerial();
+    s_nSink += Serial.hostRead().size();
+  });
+
+  printf("\n");
+}
+
+// Baseline files have a line per benchmark: `NAME NS INSTRUCTIONS`, where
+// INSTRUCTIONS is -1 if they weren't counted. Lines starting with `#` are
+// ignored.
+static bool loadBaseline(const char* pszPath, Results& results) {
+  FILE* pFile = fopen(pszPath, "r");
+  if (!pFile) {
+    return false;
+  }
+
+  char szLine[256];
+  while (fgets(szLine, sizeof(szLine), pFile)) {
+    char szName[128];
+    Result result;
+    if (
+      szLine[0] != '#' &&
+      sscanf(
+        szLine,
+        "%127s %lf %lf",
+        szName,
+        &result.dNanoseconds,
+        &result.dInstructions) == 3) {
+      results[szName] = result;
+    }
+  }
+
+  fclose(pFile);
+  return true;
+}
+
+static bool saveBaseline(const char* pszPath, const Results& results) {
+  FILE* pFile = fopen(pszPath, "w");
+  if (!pFile) {
+    return false;
+  }
+
+  fprintf(pFile, "# Built with " __VERSION__ "\n");
+  fprintf(
+    pFile,
+    "# Regenerate with `program --save FILE` on a Linux host that allows\n"
+    "# perf_event_open (kernel.perf_event_paranoid at 2 or less), or\n"
+    "# instruction counts are -1 and comparisons can only warn on time.\n");
+  fprintf(pFile, "# NAME NS_PER_CALL INSTRUCTIONS_PER_CALL\n");
+  for (auto const& element : results) {
+    fprintf(
+      pFile,
+      "%s %.2f %.1f\n",
+      element.first.c_str(),
+      element.second.dNanoseconds,
+      element.second.dInstructions);
+  }
+
+  fclose(pFile);
+  return true;
+}
+
+// Percent change from the baseline
+static double change(double dValue, double dBaseline) {
+  return dBaseline > 0 ? (dValue - dBaseline) * 100.0 / dBaseline : 0;
+}
+
+// Print the results and return the number of regressions. Instruction counts
+// regress when they increase by more than dThresholdPercent. Times that do are
+// only counted in nWarnings.
+static int report(
+  const Results& results,
+  const Results& baseline,
+  double dThresholdPercent,
+  int& nWarnings) {
+  int nRegressions = 0;
+  nWarnings = 0;
+
+  printf(
+    "%-28s %12s %8s %14s %8s\n",
+    "NAME",
+    "NS/CALL",
+    "CHANGE",
+    "INSTR/CALL",
+    "CHANGE");
+  for (auto const& element : results) {
+    const Result& result = element.second;
+    printf("%-28s %12.2f ", element.first.c_str(), result.dNanoseconds);
+
+    auto it = baseline.find(element.first);
+    bool bSlower = false;
+    if (it != baseline.end()) {
+      double dTimeChange =
+        change(result.dNanoseconds, it->second.dNanoseconds);
+      printf("%+7.1f%% ", dTimeChange);
+      bSlower = dTimeChange > dThresholdPercent;
+    } else {
+      printf("%8s ", "");
+    }
+
+    bool bRegression = false;
+    if (result.dInstructions >= 0) {
+      printf("%14.1f ", result.dInstructions);
+      if (it != baseline.end() && it->second.dInstructions >= 0) {
+        double dInstrChange =
+          change(result.dInstructions, it->second.dInstructions);
+        printf("%+7.1f%%", dInstrChange);
+        bRegression = dInstrChange > dThresholdPercent;
+      }
+    } else {
+      printf("%14s ", "n/a");
+    }
+
+    if (bRegression) {
+      printf("  REGRESSION");
+      nRegressions++;
+    } else if (bSlower) {
+      printf("  slower");
+      nWarnings++;
+    }
+    printf("\n");
+  }
+
+  return nRegressions;
+}
+
+int main(int argc, char** argv) {
+  std::string strFilter;
+  const char* pszSave = NULL;
+  const char* pszCompare = NULL;
+  double dThresholdPercent = kDefaultThresholdPercent;
+
+  for (int nArg = 1; nArg < argc; nArg++) {
+    std::string strArg(argv[nArg]);
+    bool bHasValue = nArg + 1 < argc;
+    if (strArg == "--filter" && bHasValue) {
+      strFilter = argv[++nArg];
+    } else if (strArg == "--save" && bHasValue) {
+      pszSave = argv[++nArg];
+    } else if (strArg == "--compare" && bHasValue) {
+      pszCompare = argv[++nArg];
+    } else if (strArg == "--threshold" && bHasValue) {
+      dThresholdPercent = atof(argv[++nArg]);
+    } else {
+      fprintf(
+        stderr,
+        "Usage: %s [--filter TEXT] [--save FILE] [--compare FILE] "
+        "[--threshold PERCENT]\n",
+        argv[0]);
+      return 2;
+    }
+  }
+
+  Results baseline;
+  if (pszCompare && !loadBaseline(pszCompare, baseline)) {
+    fprintf(stderr, "Can't read baseline %s\n", pszCompare);
+    return 2;
+  }
+
+#ifdef __linux__
+  // Stay on one CPU so caches and clock speed don't change between batches
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(sched_getcpu(), &cpus);
+  sched_setaffinity(0, sizeof(cpus), &cpus);
+#endif
+
+  hostSetAnalogRead(benchAnalogRead);
+  setup();
+  Serial.hostRead();
+
+  if (!s_counter.isAvailable()) {
+    printf("Instruction counts are unavailable (perf_event_open failed)\n");
+  }
+
+  Results results;
+  runBenchmarks(strFilter, results);
+  int nWarnings;
+  int nRegressions = report(results, baseline, dThresholdPercent, nWarnings);
+
+  if (pszSave && !saveBaseline(pszSave, results)) {
+    fprintf(stderr, "Can't write baseline %s\n", pszSave);
+    return 2;
+  }
+
+  if (nWarnings > 0) {
+    printf(
+      "Warning: %d benchmark(s) took more than %.1f%% longer, which may be "
+      "noise\n",
+      nWarnings,
+      dThresholdPercent);
+  }
+  if (nRegressions > 0) {
+    printf(
+      "%d benchmark(s) ran more than %.1f%% more instructions\n",
+      nRegressions,
+      dThresholdPercent);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,266 @@
+//
+// Measures press-to-photon latency of auto lights on a simulated clock.
+//
+// The real setup() and loop() run against the stubs in host/lib with sensors
+// that take as long to read as on the device. Panels are pressed one at a time
+// at random times, so presses land at every phase of the scan and lights
+// tasks. Each press is timed from when the load is applied to when the first
+// LED of its arrow has been sent to the strand lit, once with only the
+// periodic lights update and once with `instant_lights`.
+//
+// Then two profiles are stored, with and without auto lights, and the pad is
+// switched between them with the `profile` command. It exits with 1 if an
+// arrow stays lit or lights up without auto lights, or if presses don't use
+// instant lights after switching back.
+//
+// Usage: program [--presses N] [--seed N]
+//
+#include <Arduino.h>
+#include <OctoWS2811.h>
+#include <random>
+#include <vector>
+
+#include "Config.h"
+#include "Lighting.h"
+#include "PanelPins.h"
+
+// From main.cpp
+void setup();
+void loop();
+
+static const uint16_t kBaseline = 100;
+static const uint16_t kPressedLoad = 400;
+
+// Time per analogRead() on the device with the default ADC profile
+static const uint32_t kAnalogReadUS = 17;
+
+// Time taken by one pass of the loop when no task is ready
+static const uint32_t kIdleLoopUS = 2;
+
+// Time before the first press, while the sensors are calibrated
+static const uint32_t kSettleUS = 1000000;
+
+// Presses are held for this long, then the pad is idle for a random time so
+// the arrow fades out before the next press
+static const uint32_t kHoldUS = 100000;
+static const uint32_t kMinGapUS = 150000;
+static const uint32_t kMaxGapUS = 400000;
+
+// An LED is lit once any of its channels is sent at least this bright
+static const uint8_t kLitLevel = 128;
+
+static std::mt19937 s_rng;
+static int s_nPressedPanel = -1;
+
+static uint16_t simulatedAnalogRead(uint8_t nPin) {
+  std::uniform_int_distribution<int> noise(-2, 2);
+  int nValue = kBaseline + noise(s_rng);
+  if (s_nPressedPanel >= 0) {
+    for (uint8_t nPin2 : kPanelPins[s_nPressedPanel]) {
+      if (nPin2 == nPin) {
+        nValue += kPressedLoad;
+      }
+    }
+  }
+  return nValue;
+}
+
+// Run the firmware until the virtual clock reaches nEndUS
+static void runUntil(uint64_t nEndUS) {
+  while (hostMicros64() < nEndUS) {
+    loop();
+    hostAdvanceMicros(kIdleLoopUS);
+  }
+}
+
+// Index of the first LED of an arrow among the LEDs sent to the strands
+static uint16_t getFirstLed(uint8_t nArrow, uint8_t& nOffset) {
+  const Lights* pLights = Lights::getInstance();
+  for (uint8_t nSegment = 0; nSegment < pLights->getNumSegments();
+       nSegment++) {
+    const LightSegment& segment = pLights->getSegment(nSegment);
+    if (segment.nGroup == nArrow) {
+      nOffset = segment.nOffset;
+      return segment.nStrand * pLights->getLedsPerStrand() + segment.nOffset;
+    }
+  }
+  nOffset = 0;
+  return 0;
+}
+
+static bool isLit(uint16_t nLed) {
+  const uint8_t* pFrame = OctoWS2811::hostLastFrame();
+  if (!pFrame) {
+    return false;
+  }
+  for (uint8_t nChannel = 0; nChannel < 3; nChannel++) {
+    if (pFrame[nLed * 3 + nChannel] >= kLitLevel) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Press random panels and return the press-to-photon latency of each, or -1
+// for presses whose arrow didn't light up while pressed
+static std::vector<double> measure(int nPresses) {
+  std::uniform_int_distribution<int> panel(0, 3);
+  std::uniform_int_distribution<uint32_t> gap(kMinGapUS, kMaxGapUS);
+
+  std::vector<double> vLatencyUS;
+  for (int nPress = 0; nPress < nPresses; nPress++) {
+    runUntil(hostMicros64() + gap(s_rng));
+
+    s_nPressedPanel = panel(s_rng);
+    uint8_t nOffset;
+    uint16_t nLed = getFirstLed(s_nPressedPanel, nOffset);
+    uint64_t nStartUS = hostMicros64();
+    uint64_t nEndUS = nStartUS + kHoldUS;
+    uint32_t nFrames = OctoWS2811::hostFrameCount();
+    double dLatencyUS = -1;
+    while (hostMicros64() < nEndUS) {
+      loop();
+      hostAdvanceMicros(kIdleLoopUS);
+      if (
+        dLatencyUS < 0 && OctoWS2811::hostFrameCount() != nFrames &&
+        isLit(nLed)) {
+        // The LED is lit once its data has been shifted out
+        dLatencyUS = OctoWS2811::hostLastFrameMicros() - nStartUS +
+                     (nOffset + 1) * kLedSendUS;
+      }
+      nFrames = OctoWS2811::hostFrameCount();
+    }
+    s_nPressedPanel = -1;
+    vLatencyUS.push_back(dLatencyUS);
+  }
+  return vLatencyUS;
+}
+
+static double percentile(std::vector<double> values, double dPercent) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t nIndex = static_cast<size_t>(dPercent / 100 * (values.size() - 1));
+  return values[nIndex];
+}
+
+static void report(const char* pszName, const std::vector<double>& vAll) {
+  std::vector<double> vLatencyUS;
+  for (double dLatencyUS : vAll) {
+    if (dLatencyUS >= 0) {
+      vLatencyUS.push_back(dLatencyUS);
+    }
+  }
+
+  double dMeanUS = 0;
+  for (double dLatencyUS : vLatencyUS) {
+    dMeanUS += dLatencyUS / vLatencyUS.size();
+  }
+  printf(
+    "%-15s presses %zu, missed %zu, latency (ms): mean %.2f, median %.2f, "
+    "p95 %.2f, max %.2f\n",
+    pszName,
+    vAll.size(),
+    vAll.size() - vLatencyUS.size(),
+    dMeanUS / 1000,
+    percentile(vLatencyUS, 50) / 1000,
+    percentile(vLatencyUS, 95) / 1000,
+    percentile(vLatencyUS, 100) / 1000);
+}
+
+// Send a command with its argument line and run the firmware until it's been
+// processed. Returns false if it failed.
+static bool command(const char* pszCommand, const char* pszArg) {
+  Serial.hostRead();
+  Serial.hostWrite(std::string("-") + pszCommand + "\n" + pszArg + "\n");
+  runUntil(hostMicros64() + kMinGapUS);
+  return Serial.hostRead().find('!') != std::string::npos;
+}
+
+// Press panels with profiles that turn auto lights off and back on, with
+// instant lights. Returns false if the lights don't follow the profile.
+static bool checkProfiles(int nPresses) {
+  Configuration* pConfig = Configuration::getInstance();
+  pConfig->setUInt16("auto_lights", 1);
+  bool bSaved = command("saveprofile", "0 lit");
+  pConfig->setUInt16("auto_lights", 0);
+  bSaved = command("saveprofile", "1 dark") && bSaved;
+  if (!bSaved || !command("profile", "0")) {
+    fprintf(stderr, "Can't store and select profiles\n");
+    return false;
+  }
+
+  // Switch while a panel is held and its arrow is lit
+  uint8_t nOffset;
+  uint16_t nLed = getFirstLed(0, nOffset);
+  s_nPressedPanel = 0;
+  runUntil(hostMicros64() + kHoldUS);
+  command("profile", "1");
+  s_nPressedPanel = -1;
+  runUntil(hostMicros64() + kMaxGapUS);
+  bool bOk = true;
+  if (isLit(nLed)) {
+    fprintf(stderr, "Arrow stayed lit after switching to a dark profile\n");
+    bOk = false;
+  }
+
+  const Lights* pLights = Lights::getInstance();
+  uint32_t nFlashes = pLights->getFlashes();
+  for (double dLatencyUS : measure(nPresses)) {
+    if (dLatencyUS >= 0) {
+      fprintf(stderr, "Arrow lit by a press with a dark profile\n");
+      bOk = false;
+      break;
+    }
+  }
+  if (pLights->getFlashes() != nFlashes) {
+    fprintf(stderr, "Instant lights used with a dark profile\n");
+    bOk = false;
+  }
+
+  command("profile", "0");
+  nFlashes = pLights->getFlashes();
+  std::vector<double> vLatencyUS = measure(nPresses);
+  report("profile switch", vLatencyUS);
+  if (pLights->getFlashes() - nFlashes < static_cast<uint32_t>(nPresses)) {
+    fprintf(stderr, "Instant lights not used after switching back\n");
+    bOk = false;
+  }
+  return bOk;
+}
+
+int main(int argc, char** argv) {
+  int nPresses = 500;
+  uint32_t nSeed = 1;
+
+  for (int nArg = 1; nArg < argc; nArg++) {
+    std::string strArg(argv[nArg]);
+    bool bHasValue = nArg + 1 < argc;
+    if (strArg == "--presses" && bHasValue) {
+      nPresses = atoi(argv[++nArg]);
+    } else if (strArg == "--seed" && bHasValue) {
+      nSeed = strtoul(argv[++nArg], NULL, 10);
+    } else {
+      fprintf(stderr, "Usage: %s [--presses N] [--seed N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  s_rng.seed(nSeed);
+  hostSetAnalogRead(simulatedAnalogRead);
+  hostSetAnalogReadMicros(kAnalogReadUS);
+
+  setup();
+  Configuration* pConfig = Configuration::getInstance();
+  pConfig->setUInt16("auto_lights", 1);
+  runUntil(kSettleUS);
+
+  pConfig->setUInt16("instant_lights", 0);
+  report("periodic", measure(nPresses));
+
+  pConfig->setUInt16("instant_lights", 1);
+  report("instant_lights", measure(nPresses));
+
+  return checkProfiles(nPresses) ? 0 : 1;
+}
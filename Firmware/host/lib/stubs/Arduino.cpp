@@ -0,0 +1,123 @@
+#include "Arduino.h"
+
+#include <chrono>
+
+HostSerial Serial;
+HostJoystick Joystick;
+
+static uint64_t s_nMicros = 0;
+static bool s_bRealClock = false;
+static pFnHostAnalogRead s_fnAnalogRead = NULL;
+static uint32_t s_nAnalogReadMicros = 0;
+
+static uint64_t realMicros() {
+  using namespace std::chrono;
+  static const steady_clock::time_point s_start = steady_clock::now();
+  return duration_cast<microseconds>(steady_clock::now() - s_start).count();
+}
+
+void hostSetMicros(uint64_t nMicros) { s_nMicros = nMicros; }
+
+void hostAdvanceMicros(uint64_t nMicros) { s_nMicros += nMicros; }
+
+void hostUseRealClock(bool bEnabled) { s_bRealClock = bEnabled; }
+
+uint64_t hostMicros64() { return s_bRealClock ? realMicros() : s_nMicros; }
+
+uint32_t hostCycleCount() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())
+    .count();
+}
+
+uint32_t micros() { return static_cast<uint32_t>(hostMicros64()); }
+
+uint32_t millis() { return static_cast<uint32_t>(hostMicros64() / 1000); }
+
+void delay(uint32_t nMS) { delayMicroseconds(nMS * 1000); }
+
+void delayMicroseconds(uint32_t nUS) {
+  if (s_bRealClock) {
+    uint64_t nEnd = realMicros() + nUS;
+    while (realMicros() < nEnd) {
+    }
+  } else {
+    s_nMicros += nUS;
+  }
+}
+
+void yield() {}
+
+void hostSetAnalogRead(pFnHostAnalogRead fn) { s_fnAnalogRead = fn; }
+
+void hostSetAnalogReadMicros(uint32_t nMicros) {
+  s_nAnalogReadMicros = nMicros;
+}
+
+int analogRead(uint8_t nPin) {
+  if (!s_bRealClock) {
+    s_nMicros += s_nAnalogReadMicros;
+  }
+  return s_fnAnalogRead ? s_fnAnalogRead(nPin) : 0;
+}
+
+void analogReadResolution(unsigned int) {}
+
+void analogReadAveraging(unsigned int) {}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t, uint8_t) {}
+
+int HostSerial::read() {
+  if (m_input.empty()) {
+    return -1;
+  }
+  char c = m_input.front();
+  m_input.pop_front();
+  return static_cast<uint8_t>(c);
+}
+
+bool HostSerial::waitForInput() {
+  return !m_input.empty() || (m_fnWait && m_fnWait(m_nTimeoutMS));
+}
+
+size_t HostSerial::readBytes(char* pBuffer, size_t nLength) {
+  size_t nRead = 0;
+  while (nRead < nLength && waitForInput()) {
+    pBuffer[nRead++] = static_cast<char>(read());
+  }
+  return nRead;
+}
+
+String HostSerial::readStringUntil(char cTerminator) {
+  std::string str;
+  while (waitForInput()) {
+    char c = static_cast<char>(read());
+    if (c == cTerminator) {
+      break;
+    }
+    str += c;
+  }
+  return String(str);
+}
+
+size_t HostSerial::write(uint8_t c) {
+  m_output += static_cast<char>(c);
+  return 1;
+}
+
+size_t HostSerial::write(const uint8_t* pData, size_t nLength) {
+  m_output.append(reinterpret_cast<const char*>(pData), nLength);
+  return nLength;
+}
+
+void HostSerial::hostWrite(const std::string& str) {
+  m_input.insert(m_input.end(), str.begin(), str.end());
+}
+
+std::string HostSerial::hostRead() {
+  std::string str;
+  str.swap(m_output);
+  return str;
+}
@@ -0,0 +1,173 @@
+//
+// Host stand-in for the parts of the Teensy Arduino core used by the firmware.
+//
+// Time is virtual by default and only moves when a host program advances it,
+// so runs are repeatable. Analog inputs are provided by a callback.
+//
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+
+#include "WString.h"
+#include "usb_joystick.h"
+
+typedef uint8_t byte;
+
+#define DMAMEM
+#define FASTRUN
+#define HIGH        1
+#define LOW         0
+#define OUTPUT      1
+#define INPUT       0
+#define LED_BUILTIN 13
+
+#define A0  14
+#define A1  15
+#define A2  16
+#define A3  17
+#define A4  18
+#define A5  19
+#define A6  20
+#define A7  21
+#define A8  22
+#define A9  23
+#define A10 24
+#define A11 25
+#define A12 26
+#define A13 27
+#define A14 38
+#define A15 39
+#define A16 40
+#define A17 41
+
+// Clock
+void hostSetMicros(uint64_t nMicros);
+void hostAdvanceMicros(uint64_t nMicros);
+void hostUseRealClock(bool bEnabled);
+uint64_t hostMicros64();
+
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t nMS);
+void delayMicroseconds(uint32_t nUS);
+void yield();
+
+// Cycle counter, which counts nanoseconds of real time on the host
+uint32_t hostCycleCount();
+#define ARM_DWT_CYCCNT hostCycleCount()
+
+// Analog inputs
+typedef uint16_t (*pFnHostAnalogRead)(uint8_t nPin);
+void hostSetAnalogRead(pFnHostAnalogRead fn);
+// Virtual time consumed by each analogRead() call
+void hostSetAnalogReadMicros(uint32_t nMicros);
+
+int analogRead(uint8_t nPin);
+void analogReadResolution(unsigned int nBits);
+void analogReadAveraging(unsigned int nSamples);
+
+void pinMode(uint8_t nPin, uint8_t nMode);
+void digitalWrite(uint8_t nPin, uint8_t nValue);
+
+template <typename T>
+const T& constrain(const T& x, const T& a, const T& b) {
+  return x < a ? a : (x > b ? b : x);
+}
+
+class elapsedMicros {
+public:
+  elapsedMicros() : m_nStart(micros()) {}
+  operator uint32_t() const { return micros() - m_nStart; }
+  elapsedMicros& operator=(uint32_t n) {
+    m_nStart = micros() - n;
+    return *this;
+  }
+  elapsedMicros& operator-=(uint32_t n) {
+    m_nStart += n;
+    return *this;
+  }
+
+private:
+  uint32_t m_nStart;
+};
+
+class elapsedMillis {
+public:
+  elapsedMillis() : m_nStart(millis()) {}
+  operator uint32_t() const { return millis() - m_nStart; }
+  elapsedMillis& operator=(uint32_t n) {
+    m_nStart = millis() - n;
+    return *this;
+  }
+
+private:
+  uint32_t m_nStart;
+};
+
+// Serial port backed by in-memory buffers. Host programs feed input with
+// hostWrite() and collect output with hostRead(). Reads that wait for input on
+// the device return what's buffered unless a wait function is set.
+class HostSerial {
+public:
+  // Waits up to nTimeoutMS for more input and adds it with hostWrite().
+  // Returns false if none arrived.
+  typedef bool (*pFnWait)(uint32_t nTimeoutMS);
+
+  void begin(uint32_t) {}
+  operator bool() const { return true; }
+
+  int available() const { return static_cast<int>(m_input.size()); }
+  int peek() const { return m_input.empty() ? -1 : m_input.front(); }
+  int read();
+  size_t readBytes(char* pBuffer, size_t nLength);
+  String readStringUntil(char cTerminator);
+  void setTimeout(uint32_t nTimeoutMS) { m_nTimeoutMS = nTimeoutMS; }
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* pData, size_t nLength);
+  size_t write(const char* psz) {
+    return write(reinterpret_cast<const uint8_t*>(psz), strlen(psz));
+  }
+  void flush() {}
+
+  size_t print(const String& str) { return write(str.c_str()); }
+  size_t print(const char* psz) { return write(psz); }
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  template <typename T>
+  size_t print(T value, int nBase = 10) {
+    return print(String(value, nBase));
+  }
+  size_t print(float value) { return print(String(value)); }
+  size_t print(double value) { return print(String(value)); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) {
+    return print(value) + println();
+  }
+  template <typename T>
+  size_t println(T value, int nBase) {
+    return print(value, nBase) + println();
+  }
+
+  void hostWrite(const std::string& str);
+  std::string hostRead();
+  void hostSetWait(pFnWait fn) { m_fnWait = fn; }
+
+private:
+  // Make sure there's input to read, waiting for it if possible
+  bool waitForInput();
+
+  std::deque<char> m_input;
+  std::string m_output;
+  uint32_t m_nTimeoutMS = 1000;
+  pFnWait m_fnWait = NULL;
+};
+
+extern HostSerial Serial;
@@ -0,0 +1,2 @@
+#include "EEPROM.h"
+EEPROMClass EEPROM;
@@ -0,0 +1,41 @@
+//
+// Host stand-in for the Teensy EEPROM emulation.
+//
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#ifndef E2END
+#define E2END 0x10BB // Teensy 4.1
+#endif
+
+class EEPROMClass {
+public:
+  uint8_t read(int nOffset) const { return m_data[nOffset]; }
+  void write(int nOffset, uint8_t nValue) { m_data[nOffset] = nValue; }
+  void update(int nOffset, uint8_t nValue) { m_data[nOffset] = nValue; }
+  uint16_t length() const { return E2END + 1; }
+
+  template <typename T>
+  T& get(int nOffset, T& value) const {
+    memcpy(&value, m_data + nOffset, sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  const T& put(int nOffset, const T& value) {
+    memcpy(m_data + nOffset, &value, sizeof(T));
+    return value;
+  }
+
+  uint8_t m_data[E2END + 1];
+};
+
+extern EEPROMClass EEPROM;
+
+inline void eeprom_read_block(void* pDest, const void* pSrc, uint32_t nSize) {
+  memcpy(
+    pDest,
+    EEPROM.m_data + reinterpret_cast<uintptr_t>(pSrc),
+    nSize);
+}
@@ -0,0 +1,149 @@
+//
+// Host stand-in for the subset of FastLED used by the firmware.
+//
+#pragma once
+#include <cstdint>
+
+#include "Arduino.h"
+
+struct CRGB {
+  union {
+    struct {
+      uint8_t r;
+      uint8_t g;
+      uint8_t b;
+    };
+    uint8_t raw[3];
+  };
+
+  CRGB() : r(0), g(0), b(0) {}
+  CRGB(uint8_t nR, uint8_t nG, uint8_t nB) : r(nR), g(nG), b(nB) {}
+  CRGB(uint32_t nColor)
+      : r((nColor >> 16) & 0xFF), g((nColor >> 8) & 0xFF), b(nColor & 0xFF) {}
+
+  CRGB& setRGB(uint8_t nR, uint8_t nG, uint8_t nB) {
+    r = nR;
+    g = nG;
+    b = nB;
+    return *this;
+  }
+
+  CRGB& nscale8(uint8_t nScale) {
+    r = (static_cast<uint16_t>(r) * (nScale + 1)) >> 8;
+    g = (static_cast<uint16_t>(g) * (nScale + 1)) >> 8;
+    b = (static_cast<uint16_t>(b) * (nScale + 1)) >> 8;
+    return *this;
+  }
+
+  bool operator==(const CRGB& rhs) const {
+    return r == rhs.r && g == rhs.g && b == rhs.b;
+  }
+  bool operator!=(const CRGB& rhs) const { return !(*this == rhs); }
+
+  enum { Black = 0x000000 };
+};
+
+typedef enum { RGB = 0012, GRB = 0102 } EOrder;
+
+enum LEDColorCorrection { TypicalLEDStrip = 0xFFB0F0 };
+
+#define DISABLE_DITHER 0x00
+#define BINARY_DITHER  0x01
+
+template <EOrder RGB_ORDER>
+class PixelController {
+public:
+  PixelController(const CRGB* pData, int nLeds, uint8_t nBrightness)
+      : m_pData(pData), m_nLeds(nLeds), m_nBrightness(nBrightness) {}
+
+  int size() const { return m_nLeds; }
+  bool has(int n) const { return m_nLeds >= n; }
+  uint8_t loadAndScale0() const { return scale(channel(0)); }
+  uint8_t loadAndScale1() const { return scale(channel(1)); }
+  uint8_t loadAndScale2() const { return scale(channel(2)); }
+  void stepDithering() {}
+  void advanceData() {
+    m_pData++;
+    m_nLeds--;
+  }
+
+private:
+  uint8_t channel(int n) const {
+    static const int kOrder[3] = {
+      (RGB_ORDER >> 6) & 3, (RGB_ORDER >> 3) & 3, RGB_ORDER & 3};
+    return m_pData->raw[kOrder[n]];
+  }
+  uint8_t scale(uint8_t n) const {
+    return (static_cast<uint16_t>(n) * (m_nBrightness + 1)) >> 8;
+  }
+
+  const CRGB* m_pData;
+  int m_nLeds;
+  uint8_t m_nBrightness;
+};
+
+class CLEDController {
+public:
+  virtual ~CLEDController() {}
+  virtual void init() = 0;
+  virtual void show(const CRGB* pData, int nLeds, uint8_t nBrightness) = 0;
+  CLEDController& setCorrection(LEDColorCorrection) { return *this; }
+};
+
+template <EOrder RGB_ORDER>
+class CPixelLEDController : public CLEDController {
+public:
+  virtual void showPixels(PixelController<RGB_ORDER>& pixels) = 0;
+  virtual void show(const CRGB* pData, int nLeds, uint8_t nBrightness) {
+    PixelController<RGB_ORDER> pixels(pData, nLeds, nBrightness);
+    showPixels(pixels);
+  }
+};
+
+class CFastLED {
+public:
+  CFastLED()
+      : m_pController(NULL), m_pData(NULL), m_nLeds(0), m_nBrightness(255),
+        m_nShows(0) {}
+
+  CLEDController& addLeds(CLEDController* pController, CRGB* pData, int nLeds) {
+    m_pController = pController;
+    m_pData = pData;
+    m_nLeds = nLeds;
+    pController->init();
+    return *pController;
+  }
+
+  void show() {
+    m_nShows++;
+    if (m_pController) {
+      m_pController->show(m_pData, m_nLeds, m_nBrightness);
+    }
+  }
+  void delay(uint32_t nMS) {
+    show();
+    ::delay(nMS);
+  }
+  void setBrightness(uint8_t n) { m_nBrightness = n; }
+  uint8_t getBrightness() const { return m_nBrightness; }
+  void setMaxRefreshRate(uint16_t) {}
+  void setDither(uint8_t) {}
+
+  // Number of frames shown since start
+  uint32_t hostShowCount() const { return m_nShows; }
+
+private:
+  CLEDController* m_pController;
+  CRGB* m_pData;
+  int m_nLeds;
+  uint8_t m_nBrightness;
+  uint32_t m_nShows;
+};
+
+extern CFastLED FastLED;
+
+inline void fadeToBlackBy(CRGB* pLeds, uint16_t nLeds, uint8_t nFade) {
+  for (uint16_t n = 0; n < nLeds; n++) {
+    pLeds[n].nscale8(255 - nFade);
+  }
+}
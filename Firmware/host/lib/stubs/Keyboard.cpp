@@ -0,0 +1,2 @@
+#include "Keyboard.h"
+HostKeyboard Keyboard;
@@ -0,0 +1,47 @@
+//
+// Host stand-in for the Teensy USB keyboard. Like the real one, a report is
+// sent whenever a key changes, and the keys of the last report and when it
+// was sent are kept so host programs can inspect them.
+//
+#pragma once
+#include <cstdint>
+
+#include "Arduino.h"
+
+class HostKeyboard {
+public:
+  static const uint16_t kNumKeys = 256;
+
+  HostKeyboard() : m_abPressed(), m_nSends(0), m_nChangeMicros(0) {}
+
+  void press(uint16_t nKey) { set(nKey, true); }
+  void release(uint16_t nKey) { set(nKey, false); }
+  void releaseAll() {
+    for (uint16_t nKey = 0; nKey < kNumKeys; nKey++) {
+      set(nKey, false);
+    }
+  }
+  void send_now() { m_nSends++; }
+
+  bool hostIsPressed(uint16_t nKey) const {
+    return nKey < kNumKeys && m_abPressed[nKey];
+  }
+  uint32_t hostSendCount() const { return m_nSends; }
+  uint64_t hostLastChangeMicros() const { return m_nChangeMicros; }
+
+private:
+  void set(uint16_t nKey, bool bPressed) {
+    if (nKey >= kNumKeys || m_abPressed[nKey] == bPressed) {
+      return;
+    }
+    m_abPressed[nKey] = bPressed;
+    m_nSends++;
+    m_nChangeMicros = hostMicros64();
+  }
+
+  bool m_abPressed[kNumKeys];
+  uint32_t m_nSends;
+  uint64_t m_nChangeMicros;
+};
+
+extern HostKeyboard Keyboard;
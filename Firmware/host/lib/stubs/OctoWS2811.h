@@ -0,0 +1,54 @@
+//
+// Host stand-in for OctoWS2811. Frames are copied to the frame buffer like the
+// real library does before sending them, and the most recent one can be
+// inspected by host programs.
+//
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#include "Arduino.h"
+
+#define WS2811_RGB    0
+#define WS2811_GRB    1
+#define WS2811_800kHz 0x00
+
+class OctoWS2811 {
+public:
+  OctoWS2811(
+    uint32_t nLedsPerStrip,
+    void* pFrameBuffer,
+    void* pDrawBuffer,
+    uint8_t nConfig,
+    uint8_t nPins,
+    const uint8_t* pPinList)
+      : m_nLedsPerStrip(nLedsPerStrip), m_nPins(nPins),
+        m_pFrameBuffer(static_cast<uint8_t*>(pFrameBuffer)),
+        m_pDrawBuffer(static_cast<uint8_t*>(pDrawBuffer)) {}
+
+  void begin() {}
+  void show() {
+    memcpy(m_pFrameBuffer, m_pDrawBuffer, numPixels() * 3);
+    s_pLastFrame = m_pFrameBuffer;
+    s_nLastFrameUS = hostMicros64();
+    s_nFrames++;
+  }
+  int busy() { return 0; }
+  int numPixels() const { return m_nLedsPerStrip * m_nPins; }
+
+  // The most recent frame sent by any instance, 3 bytes per LED strand by
+  // strand in the order they're sent, when it was sent, and the number sent
+  static const uint8_t* hostLastFrame() { return s_pLastFrame; }
+  static uint64_t hostLastFrameMicros() { return s_nLastFrameUS; }
+  static uint32_t hostFrameCount() { return s_nFrames; }
+
+private:
+  uint32_t m_nLedsPerStrip;
+  uint8_t m_nPins;
+  uint8_t* m_pFrameBuffer;
+  uint8_t* m_pDrawBuffer;
+
+  static inline const uint8_t* s_pLastFrame = NULL;
+  static inline uint64_t s_nLastFrameUS = 0;
+  static inline uint32_t s_nFrames = 0;
+};
@@ -0,0 +1,168 @@
+//
+// Host stand-in for the Arduino String class, backed by std::string.
+//
+#pragma once
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+class String {
+public:
+  String() {}
+  String(const char* psz) : m_str(psz ? psz : "") {}
+  String(const std::string& str) : m_str(str) {}
+  explicit String(char c) : m_str(1, c) {}
+  String(int n, unsigned char nBase = 10) { m_str = toBase(n, nBase); }
+  String(unsigned int n, unsigned char nBase = 10) { m_str = toBase(n, nBase); }
+  String(long n, unsigned char nBase = 10) { m_str = toBase(n, nBase); }
+  String(unsigned long n, unsigned char nBase = 10) {
+    m_str = toBase(n, nBase);
+  }
+  String(unsigned char n, unsigned char nBase = 10) {
+    m_str = toBase(n, nBase);
+  }
+  String(float f) : m_str(std::to_string(f)) {}
+  String(double f) : m_str(std::to_string(f)) {}
+
+  const char* c_str() const { return m_str.c_str(); }
+  unsigned int length() const { return m_str.length(); }
+  void reserve(unsigned int n) { m_str.reserve(n); }
+
+  char operator[](unsigned int n) const { return m_str[n]; }
+  char& operator[](unsigned int n) { return m_str[n]; }
+  char charAt(unsigned int n) const { return m_str[n]; }
+
+  template <typename T>
+  String& concat(const T& value) {
+    m_str += String(value).m_str;
+    return *this;
+  }
+  String& concat(const String& str) {
+    m_str += str.m_str;
+    return *this;
+  }
+  String& concat(const char* psz) {
+    m_str += psz;
+    return *this;
+  }
+  String& concat(char c) {
+    m_str += c;
+    return *this;
+  }
+  template <typename T>
+  String& append(const T& value) {
+    return concat(value);
+  }
+  template <typename T>
+  String& operator+=(const T& value) {
+    return concat(value);
+  }
+
+  bool equals(const String& str) const { return m_str == str.m_str; }
+  bool equalsIgnoreCase(const String& str) const {
+    if (m_str.size() != str.m_str.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < m_str.size(); i++) {
+      if (tolower(m_str[i]) != tolower(str.m_str[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+  bool startsWith(const String& str) const {
+    return m_str.compare(0, str.m_str.size(), str.m_str) == 0;
+  }
+  bool endsWith(const String& str) const {
+    return m_str.size() >= str.m_str.size() &&
+           m_str.compare(
+             m_str.size() - str.m_str.size(), str.m_str.size(), str.m_str) ==
+             0;
+  }
+  bool endsWith(char c) const { return !m_str.empty() && m_str.back() == c; }
+
+  int indexOf(char c, unsigned int nFrom = 0) const {
+    size_t n = m_str.find(c, nFrom);
+    return n == std::string::npos ? -1 : static_cast<int>(n);
+  }
+  int indexOf(const String& str, unsigned int nFrom = 0) const {
+    size_t n = m_str.find(str.m_str, nFrom);
+    return n == std::string::npos ? -1 : static_cast<int>(n);
+  }
+  String substring(unsigned int nBegin) const {
+    return nBegin >= m_str.size() ? String() : String(m_str.substr(nBegin));
+  }
+  String substring(unsigned int nBegin, unsigned int nEnd) const {
+    if (nBegin >= m_str.size() || nEnd <= nBegin) {
+      return String();
+    }
+    return String(m_str.substr(nBegin, nEnd - nBegin));
+  }
+  long toInt() const { return strtol(m_str.c_str(), NULL, 10); }
+
+  void remove(unsigned int nIndex) {
+    if (nIndex < m_str.size()) {
+      m_str.erase(nIndex);
+    }
+  }
+  void remove(unsigned int nIndex, unsigned int nCount) {
+    if (nIndex < m_str.size()) {
+      m_str.erase(nIndex, nCount);
+    }
+  }
+  void trim() {
+    size_t nBegin = m_str.find_first_not_of(" \t\r\n");
+    if (nBegin == std::string::npos) {
+      m_str.clear();
+      return;
+    }
+    size_t nEnd = m_str.find_last_not_of(" \t\r\n");
+    m_str = m_str.substr(nBegin, nEnd - nBegin + 1);
+  }
+  void toLowerCase() {
+    for (auto& c : m_str) {
+      c = tolower(c);
+    }
+  }
+
+  bool operator==(const String& str) const { return m_str == str.m_str; }
+  bool operator==(const char* psz) const { return m_str == psz; }
+  bool operator!=(const String& str) const { return m_str != str.m_str; }
+  bool operator<(const String& str) const { return m_str < str.m_str; }
+
+  friend String operator+(const String& lhs, const String& rhs) {
+    return String(lhs.m_str + rhs.m_str);
+  }
+  friend String operator+(const String& lhs, const char* rhs) {
+    return String(lhs.m_str + rhs);
+  }
+  friend String operator+(const char* lhs, const String& rhs) {
+    return String(lhs + rhs.m_str);
+  }
+  friend String operator+(const String& lhs, char rhs) {
+    return String(lhs.m_str + rhs);
+  }
+  template <typename T>
+  friend String operator+(const String& lhs, T rhs) {
+    return lhs + String(rhs);
+  }
+
+private:
+  template <typename T>
+  static std::string toBase(T n, unsigned char nBase) {
+    if (nBase == 10) {
+      return std::to_string(n);
+    }
+    std::string str;
+    unsigned long long u = static_cast<unsigned long long>(n);
+    do {
+      str.insert(str.begin(), "0123456789abcdef"[u % nBase]);
+      u /= nBase;
+    } while (u);
+    return str;
+  }
+
+  std::string m_str;
+};
@@ -0,0 +1,49 @@
+//
+// Host stand-in for the Teensy USB joystick with the standard 12 byte report.
+// The most recent values are kept so host programs can inspect them.
+//
+#pragma once
+#include <cstdint>
+
+#define JOYSTICK_SIZE 12
+
+class HostJoystick {
+public:
+  static const uint8_t kNumButtons = 32;
+  static const uint8_t kNumAxes = 6;
+
+  HostJoystick() : m_nButtons(0), m_anAxes(), m_nHat(-1), m_nSends(0) {}
+
+  void button(uint8_t nButton, bool bPressed) {
+    if (nButton < 1 || nButton > kNumButtons) {
+      return;
+    }
+    uint32_t nMask = 1UL << (nButton - 1);
+    m_nButtons = bPressed ? m_nButtons | nMask : m_nButtons & ~nMask;
+  }
+  void X(unsigned int nValue) { axis(0, nValue); }
+  void Y(unsigned int nValue) { axis(1, nValue); }
+  void Z(unsigned int nValue) { axis(2, nValue); }
+  void Zrotate(unsigned int nValue) { axis(3, nValue); }
+  void sliderLeft(unsigned int nValue) { axis(4, nValue); }
+  void sliderRight(unsigned int nValue) { axis(5, nValue); }
+  void hat(int nAngle) { m_nHat = nAngle; }
+  void useManualSend(bool) {}
+  void send_now() { m_nSends++; }
+
+  uint32_t hostButtons() const { return m_nButtons; }
+  uint16_t hostAxis(uint8_t nAxis) const { return m_anAxes[nAxis]; }
+  uint32_t hostSendCount() const { return m_nSends; }
+
+private:
+  void axis(uint8_t nAxis, unsigned int nValue) {
+    m_anAxes[nAxis] = nValue > 1023 ? 1023 : nValue;
+  }
+
+  uint32_t m_nButtons;
+  uint16_t m_anAxes[kNumAxes];
+  int m_nHat;
+  uint32_t m_nSends;
+};
+
+extern HostJoystick Joystick;
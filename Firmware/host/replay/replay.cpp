@@ -0,0 +1,261 @@
+//
+// Replays sensor traces through the press detectors and compares early press
+// detection against the plain threshold detector.
+//
+// Each trace is run through two sensors: one with only the trigger threshold
+// and one that also triggers early on a fast rise (`slope_trigger`). Every
+// threshold press should be matched by an early press that started at the same
+// time or before it. The difference is the latency gained. Early presses that
+// don't overlap any threshold press are false positives.
+//
+// Trace files have a line per sample: `TIME_US,READING`, where READING is a
+// 10-bit reading from one sensor. Lines starting with `#` are ignored. Without
+// files, synthetic traces of steps with a range of loading speeds and light
+// brushes that don't reach the trigger threshold are used.
+//
+// Usage: program [--slope RISE] [--seed N] [--steps N] [FILE...]
+//
+#include <Arduino.h>
+#include <random>
+#include <vector>
+
+#include "Config.h"
+#include "Sensor.h"
+
+// Default rise over kSlopeWindow samples that triggers an early press
+static const uint16_t kDefaultSlopeRise = 24;
+
+// Sampling interval, matching the firmware's scan frequency
+static const uint32_t kSampleUS = 333;
+
+// Time before the first step, so the sensors settle on the baseline
+static const uint32_t kSettleUS = 100000;
+
+struct Sample {
+  uint32_t nTimeUS;
+  uint16_t nReading;
+};
+typedef std::vector<Sample> Trace;
+
+// Time a detector was pressed for
+struct Press {
+  uint32_t nStartUS;
+  uint32_t nEndUS;
+};
+typedef std::vector<Press> Presses;
+
+static uint16_t s_nReading = 0;
+static uint16_t replayAnalogRead(uint8_t) { return s_nReading; }
+
+static bool loadTrace(const char* pszPath, Trace& trace) {
+  FILE* pFile = fopen(pszPath, "r");
+  if (!pFile) {
+    return false;
+  }
+
+  char szLine[128];
+  while (fgets(szLine, sizeof(szLine), pFile)) {
+    unsigned long nTimeUS, nReading;
+    if (
+      szLine[0] != '#' &&
+      sscanf(szLine, "%lu,%lu", &nTimeUS, &nReading) == 2) {
+      trace.push_back(
+        {static_cast<uint32_t>(nTimeUS), static_cast<uint16_t>(nReading)});
+    }
+  }
+
+  fclose(pFile);
+  return true;
+}
+
+// Steps ramp up over 2-25 ms, hold, and ramp down, with noise on top. Brushes
+// rise quickly but peak below the trigger threshold.
+static void makeTrace(uint32_t nSeed, int nSteps, Trace& trace) {
+  std::mt19937 rng(nSeed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  std::normal_distribution<double> noise(0, 2);
+
+  const double dBaseline = 100;
+  std::vector<std::pair<uint32_t, double>> vPoints; // Piecewise linear load
+  uint32_t nTimeUS = kSettleUS;
+  vPoints.push_back({0, 0});
+  for (int nStep = 0; nStep < nSteps; nStep++) {
+    nTimeUS += 50000 + uniform(rng) * 250000;
+    vPoints.push_back({nTimeUS, 0});
+
+    bool bBrush = uniform(rng) < 0.2;
+    double dPeak = bBrush ? 60 + uniform(rng) * 85 : 250 + uniform(rng) * 350;
+    uint32_t nRiseUS = bBrush ? 2000 + uniform(rng) * 4000
+                              : 2000 + uniform(rng) * 23000;
+    uint32_t nHoldUS = bBrush ? uniform(rng) * 20000
+                              : 40000 + uniform(rng) * 110000;
+    uint32_t nFallUS = 5000 + uniform(rng) * 10000;
+
+    nTimeUS += nRiseUS;
+    vPoints.push_back({nTimeUS, dPeak});
+    nTimeUS += nHoldUS;
+    vPoints.push_back({nTimeUS, dPeak});
+    nTimeUS += nFallUS;
+    vPoints.push_back({nTimeUS, 0});
+  }
+  nTimeUS += 100000;
+  vPoints.push_back({nTimeUS, 0});
+
+  size_t nPoint = 0;
+  for (uint32_t nSampleUS = 0; nSampleUS < nTimeUS; nSampleUS += kSampleUS) {
+    while (vPoints[nPoint + 1].first <= nSampleUS) {
+      nPoint++;
+    }
+    const auto& from = vPoints[nPoint];
+    const auto& to = vPoints[nPoint + 1];
+    double dFraction =
+      static_cast<double>(nSampleUS - from.first) / (to.first - from.first);
+    double dValue = dBaseline + from.second +
+                    (to.second - from.second) * dFraction + noise(rng);
+    dValue = constrain(dValue, 0.0, 1023.0);
+    trace.push_back({nSampleUS, static_cast<uint16_t>(dValue)});
+  }
+}
+
+// Run a trace through a sensor with the given early press setting
+static Presses detect(const Trace& trace, uint16_t nSlopeRise) {
+  Configuration::getInstance()->setUInt16("slope_trigger", nSlopeRise);
+  Sensor sensor(A0);
+
+  Presses presses;
+  hostSetMicros(trace.empty() ? 0 : trace[0].nTimeUS);
+  s_nReading = trace.empty() ? 0 : trace[0].nReading;
+  sensor.readSensor();
+  sensor.calibrate();
+
+  for (const Sample& sample : trace) {
+    hostSetMicros(sample.nTimeUS);
+    s_nReading = sample.nReading;
+    bool bWasPressed = sensor.isPressed();
+    sensor.update();
+    if (sensor.isPressed() && !bWasPressed) {
+      presses.push_back({sample.nTimeUS, UINT32_MAX});
+    } else if (!sensor.isPressed() && bWasPressed) {
+      presses.back().nEndUS = sample.nTimeUS;
+    }
+  }
+  return presses;
+}
+
+struct Summary {
+  int nPresses;        // Threshold presses
+  int nEarlyPresses;   // Presses with early detection enabled
+  int nMatched;        // Threshold presses covered by an early press
+  int nFalsePositives; // Early presses without a threshold press
+  std::vector<double> vGainMS;
+};
+
+static void compare(const Trace& trace, uint16_t nSlopeRise, Summary& summary) {
+  Presses reference = detect(trace, 0);
+  Presses early = detect(trace, nSlopeRise);
+
+  summary.nPresses += reference.size();
+  summary.nEarlyPresses += early.size();
+
+  for (const Press& press : reference) {
+    for (const Press& candidate : early) {
+      if (
+        candidate.nStartUS <= press.nStartUS &&
+        candidate.nEndUS > press.nStartUS) {
+        summary.nMatched++;
+        summary.vGainMS.push_back(
+          (press.nStartUS - candidate.nStartUS) / 1000.0);
+        break;
+      }
+    }
+  }
+
+  for (const Press& candidate : early) {
+    bool bOverlaps = false;
+    for (const Press& press : reference) {
+      if (
+        candidate.nStartUS < press.nEndUS &&
+        press.nStartUS < candidate.nEndUS) {
+        bOverlaps = true;
+        break;
+      }
+    }
+    summary.nFalsePositives += !bOverlaps;
+  }
+}
+
+static double percentile(std::vector<double> values, double dPercent) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t nIndex = static_cast<size_t>(dPercent / 100 * (values.size() - 1));
+  return values[nIndex];
+}
+
+int main(int argc, char** argv) {
+  uint16_t nSlopeRise = kDefaultSlopeRise;
+  uint32_t nSeed = 1;
+  int nSteps = 500;
+  std::vector<const char*> vFiles;
+
+  for (int nArg = 1; nArg < argc; nArg++) {
+    std::string strArg(argv[nArg]);
+    bool bHasValue = nArg + 1 < argc;
+    if (strArg == "--slope" && bHasValue) {
+      nSlopeRise = atoi(argv[++nArg]);
+    } else if (strArg == "--seed" && bHasValue) {
+      nSeed = strtoul(argv[++nArg], NULL, 10);
+    } else if (strArg == "--steps" && bHasValue) {
+      nSteps = atoi(argv[++nArg]);
+    } else if (strArg[0] != '-') {
+      vFiles.push_back(argv[nArg]);
+    } else {
+      fprintf(
+        stderr,
+        "Usage: %s [--slope RISE] [--seed N] [--steps N] [FILE...]\n",
+        argv[0]);
+      return 2;
+    }
+  }
+
+  hostSetAnalogRead(replayAnalogRead);
+
+  Summary summary = {};
+  if (vFiles.empty()) {
+    Trace trace;
+    makeTrace(nSeed, nSteps, trace);
+    compare(trace, nSlopeRise, summary);
+  }
+  for (const char* pszFile : vFiles) {
+    Trace trace;
+    if (!loadTrace(pszFile, trace)) {
+      fprintf(stderr, "Can't read trace %s\n", pszFile);
+      return 2;
+    }
+    compare(trace, nSlopeRise, summary);
+  }
+
+  double dMeanMS = 0;
+  for (double dGainMS : summary.vGainMS) {
+    dMeanMS += dGainMS / summary.vGainMS.size();
+  }
+
+  printf("slope_trigger=%u\n", nSlopeRise);
+  printf("threshold presses:   %d\n", summary.nPresses);
+  printf("early presses:       %d\n", summary.nEarlyPresses);
+  printf("matched:             %d\n", summary.nMatched);
+  printf(
+    "latency gained (ms): mean %.2f, median %.2f, p95 %.2f, max %.2f\n",
+    dMeanMS,
+    percentile(summary.vGainMS, 50),
+    percentile(summary.vGainMS, 95),
+    percentile(summary.vGainMS, 100));
+  printf(
+    "false positives:     %d (%.1f%% of early presses)\n",
+    summary.nFalsePositives,
+    summary.nEarlyPresses
+      ? summary.nFalsePositives * 100.0 / summary.nEarlyPresses
+      : 0.0);
+  return 0;
+}
@@ -0,0 +1,522 @@
+//
+// Plays charts on a simulated pad and measures how accurately the firmware
+// reports each step.
+//
+// Each step of a chart becomes the load of a foot on its panel: the load rises
+// over a few milliseconds with a small impact overshoot, is held, and falls
+// as the foot lifts. The center of pressure rolls from heel to toe or the
+// other way during the step, so each of the panel's 4 sensors sees a
+// different share of the load. Load on one panel leaks into the sensors of
+// the others through the frame. Sensors respond to load like FSRs, with a
+// baseline, sensitivity, and slow drift of their own, and noise on top.
+//
+// The real setup() and loop() run on a simulated clock against the stubs in
+// host/lib and read these sensors as they're scanned. Keys reported by the
+// keyboard are matched to the steps of their panel. A report from shortly
+// before a step to --window ms after it matches the step, and its timing
+// error is the time from the step to the report. Steps without a report are
+// missed, and reports without a step are extra.
+//
+// Chart files have a line per step: `TIME_MS PANELS`, where PANELS has a
+// letter from `udlr` for each panel stepped on, e.g. `1250 lr` for a jump.
+// Lines starting with `#` are ignored. Without a file, a random stream of
+// 16th notes is used.
+//
+// Usage: program [--seed N] [--steps N] [--bpm N] [--noise COUNTS]
+//                [--crosstalk FRACTION] [--window MS] [--set KEY=VALUE]
+//                [FILE]
+//
+#include <Arduino.h>
+#include <Keyboard.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Config.h"
+#include "PanelPins.h"
+
+// From main.cpp
+void setup();
+void loop();
+
+// Keys reported for each panel in keyboard mode
+static const char kPanelKeys[4] = {'w', 's', 'a', 'd'};
+static const char kPanelLetters[] = "udlr";
+
+// Position of each sensor on its panel, which spans -1 to 1
+static const double kSensorX[4] = {0, 1, 0, -1};
+static const double kSensorY[4] = {1, 0, -1, 0};
+
+// Time per analogRead() on the device with the default ADC profile
+static const uint32_t kAnalogReadUS = 17;
+
+// Time taken by one pass of the loop when no task is ready
+static const uint32_t kIdleLoopUS = 2;
+
+// Time before the first step, while the sensors are calibrated
+static const double kSettleMS = 1000;
+
+// Time after the last step, so it can be released and reported
+static const double kTailMS = 500;
+
+// Reports up to this long before a step still match it
+static const double kEarlyMS = 10;
+
+// A foot is lifted for at least this long between steps on one panel
+static const double kMinLiftMS = 15;
+
+// Impact overshoot at the end of the rise, as a fraction of the load, and how
+// quickly it decays
+static const double kOvershoot = 0.15;
+static const double kOvershootMS = 20;
+
+// Load of a foot on a panel over time
+struct Contact {
+  double dStartMS;
+  double dRiseMS;
+  double dHoldMS;
+  double dFallMS;
+  double dPeak; // Load at the end of the rise
+  double dFromX, dFromY; // Center of pressure when landing
+  double dToX, dToY;     // Center of pressure when lifting
+};
+
+// Response of a sensor, in 10-bit readings
+struct SensorModel {
+  double dBaseline;
+  double dHalfLoad; // Load at which the reading is halfway to full scale
+  double dDriftPeriodMS;
+  double dDriftPhase;
+  double adCrosstalk[4]; // Fraction of the load on each panel picked up
+};
+
+struct Chart {
+  std::vector<double> avStepsMS[4]; // Step times of each panel
+};
+
+struct Options {
+  uint32_t nSeed = 1;
+  int nSteps = 1000;
+  double dBpm = 150;
+  double dNoise = 2;
+  double dCrosstalk = 0.04;
+  double dWindowMS = 50;
+};
+
+static std::mt19937 s_rng;
+static double s_dNoise = 0;
+static std::vector<Contact> s_avContacts[4];
+static size_t s_anContact[4];        // First contact of each panel not lifted
+static SensorModel s_aSensors[4][4]; // By panel, then sensor
+static uint8_t s_anPinPanel[64];
+static uint8_t s_anPinSensor[64];
+
+static double uniform(double dMin, double dMax) {
+  return std::uniform_real_distribution<double>(dMin, dMax)(s_rng);
+}
+
+static double smoothStep(double dFraction) {
+  return dFraction * dFraction * (3 - 2 * dFraction);
+}
+
+static bool loadChart(const char* pszPath, Chart& chart) {
+  FILE* pFile = fopen(pszPath, "r");
+  if (!pFile) {
+    return false;
+  }
+
+  char szLine[128];
+  while (fgets(szLine, sizeof(szLine), pFile)) {
+    double dTimeMS;
+    char szPanels[8];
+    if (
+      szLine[0] == '#' ||
+      sscanf(szLine, "%lf %7s", &dTimeMS, szPanels) != 2) {
+      continue;
+    }
+    for (const char* pc = szPanels; *pc; pc++) {
+      const char* pcPanel = strchr(kPanelLetters, tolower(*pc));
+      if (pcPanel && *pcPanel) {
+        chart.avStepsMS[pcPanel - kPanelLetters].push_back(dTimeMS);
+      }
+    }
+  }
+
+  fclose(pFile);
+  for (std::vector<double>& vStepsMS : chart.avStepsMS) {
+    std::sort(vStepsMS.begin(), vStepsMS.end());
+  }
+  return true;
+}
+
+// 16th notes with rests, jumps, and the odd jack
+static void makeChart(const Options& options, Chart& chart) {
+  double dNoteMS = 60000 / options.dBpm / 4;
+  int nLastPanel = -1;
+  int nSteps = 0;
+  for (int nNote = 0; nSteps < options.nSteps; nNote++) {
+    double dRoll = uniform(0, 1);
+    if (dRoll < 0.25) {
+      continue;
+    }
+
+    int nPanel = nLastPanel;
+    if (nPanel < 0 || uniform(0, 1) < 0.9) {
+      while (nPanel == nLastPanel) {
+        nPanel = std::uniform_int_distribution<int>(0, 3)(s_rng);
+      }
+    }
+    chart.avStepsMS[nPanel].push_back(nNote * dNoteMS);
+    nSteps++;
+
+    if (dRoll > 0.9) {
+      int nOther =
+        (nPanel + std::uniform_int_distribution<int>(1, 3)(s_rng)) % 4;
+      chart.avStepsMS[nOther].push_back(nNote * dNoteMS);
+      nSteps++;
+    }
+    nLastPanel = nPanel;
+  }
+}
+
+// Turn the steps of a panel into contacts that don't overlap
+static void makeContacts(
+  const std::vector<double>& vStepsMS,
+  std::vector<Contact>& vContacts) {
+  for (size_t nStep = 0; nStep < vStepsMS.size(); nStep++) {
+    Contact contact;
+    contact.dStartMS = kSettleMS + vStepsMS[nStep];
+    contact.dRiseMS = uniform(4, 25);
+    contact.dHoldMS = uniform(40, 160);
+    contact.dFallMS = uniform(8, 30);
+    contact.dPeak = uniform(250, 700);
+
+    if (nStep + 1 < vStepsMS.size()) {
+      double dAvailableMS =
+        vStepsMS[nStep + 1] - vStepsMS[nStep] - kMinLiftMS;
+      double dMovingMS = contact.dRiseMS + contact.dFallMS;
+      contact.dHoldMS = std::min(
+        contact.dHoldMS, std::max(0.0, dAvailableMS - dMovingMS));
+      if (dMovingMS > dAvailableMS) {
+        // Fast jacks: the foot barely lands before it's lifted again
+        double dScale = std::max(dAvailableMS, 2.0) / dMovingMS;
+        contact.dRiseMS *= dScale;
+        contact.dFallMS *= dScale;
+      }
+    }
+
+    // Most steps land on the heel and roll onto the toes
+    double dX = std::max(
+      -0.8, std::min(0.8, std::normal_distribution<double>(0, 0.25)(s_rng)));
+    if (uniform(0, 1) < 0.6) {
+      contact.dFromX = dX;
+      contact.dFromY = uniform(-0.7, -0.3);
+      contact.dToX = dX + uniform(-0.2, 0.2);
+      contact.dToY = uniform(0.1, 0.5);
+    } else {
+      contact.dFromX = dX;
+      contact.dFromY = uniform(0.3, 0.7);
+      contact.dToX = dX;
+      contact.dToY = uniform(-0.2, 0.2);
+    }
+    vContacts.push_back(contact);
+  }
+}
+
+static void makeSensors(const Options& options) {
+  for (uint8_t nPanel = 0; nPanel < 4; nPanel++) {
+    for (uint8_t nSensor = 0; nSensor < 4; nSensor++) {
+      SensorModel& sensor = s_aSensors[nPanel][nSensor];
+      sensor.dBaseline = uniform(60, 160);
+      sensor.dHalfLoad = uniform(300, 600);
+      sensor.dDriftPeriodMS = uniform(20000, 60000);
+      sensor.dDriftPhase = uniform(0, 2 * M_PI);
+      for (uint8_t nOther = 0; nOther < 4; nOther++) {
+        sensor.adCrosstalk[nOther] =
+          nOther == nPanel ? 0 : uniform(0, options.dCrosstalk);
+      }
+
+      uint8_t nPin = kPanelPins[nPanel][nSensor];
+      s_anPinPanel[nPin] = nPanel;
+      s_anPinSensor[nPin] = nSensor;
+    }
+  }
+}
+
+// Load on a panel and its center of pressure
+static double getLoad(uint8_t nPanel, double dTimeMS, double& dX, double& dY) {
+  std::vector<Contact>& vContacts = s_avContacts[nPanel];
+  size_t& nContact = s_anContact[nPanel];
+  while (nContact < vContacts.size()) {
+    const Contact& contact = vContacts[nContact];
+    double dEndMS = contact.dStartMS + contact.dRiseMS + contact.dHoldMS +
+                    contact.dFallMS;
+    if (dTimeMS < dEndMS) {
+      break;
+    }
+    nContact++;
+  }
+  if (nContact == vContacts.size()) {
+    return 0;
+  }
+
+  const Contact& contact = vContacts[nContact];
+  double dMS = dTimeMS - contact.dStartMS;
+  if (dMS < 0) {
+    return 0;
+  }
+
+  double dTotalMS = contact.dRiseMS + contact.dHoldMS + contact.dFallMS;
+  double dRoll = dMS / dTotalMS;
+  dX = contact.dFromX + (contact.dToX - contact.dFromX) * dRoll;
+  dY = contact.dFromY + (contact.dToY - contact.dFromY) * dRoll;
+
+  if (dMS < contact.dRiseMS) {
+    return contact.dPeak * smoothStep(dMS / contact.dRiseMS);
+  }
+  dMS -= contact.dRiseMS;
+  double dHeld = contact.dPeak *
+                 (1 + kOvershoot * exp(-std::min(dMS, contact.dHoldMS) /
+                                       kOvershootMS));
+  if (dMS < contact.dHoldMS) {
+    return dHeld;
+  }
+  dMS -= contact.dHoldMS;
+  return dHeld * (1 - smoothStep(dMS / contact.dFallMS));
+}
+
+static uint16_t simulatedAnalogRead(uint8_t nPin) {
+  double dTimeMS = hostMicros64() / 1000.0;
+  uint8_t nPanel = s_anPinPanel[nPin];
+  uint8_t nSensor = s_anPinSensor[nPin];
+  const SensorModel& sensor = s_aSensors[nPanel][nSensor];
+
+  double dLoad = 0;
+  for (uint8_t nOther = 0; nOther < 4; nOther++) {
+    double dX = 0;
+    double dY = 0;
+    double dPanelLoad = getLoad(nOther, dTimeMS, dX, dY);
+    if (nOther != nPanel) {
+      dLoad += dPanelLoad * sensor.adCrosstalk[nOther];
+      continue;
+    }
+    // Sensors nearer the center of pressure take more of the load
+    double dDistance =
+      hypot(dX - kSensorX[nSensor], dY - kSensorY[nSensor]);
+    dLoad += dPanelLoad * std::max(0.0, 1 - dDistance / 2);
+  }
+
+  double dValue =
+    sensor.dBaseline +
+    3 * sin(2 * M_PI * dTimeMS / sensor.dDriftPeriodMS + sensor.dDriftPhase) +
+    (1023 - sensor.dBaseline) * dLoad / (dLoad + sensor.dHalfLoad) +
+    std::normal_distribution<double>(0, s_dNoise)(s_rng);
+  return std::max(0.0, std::min(1023.0, round(dValue)));
+}
+
+// Run the firmware until nEndMS and record when each panel's key was pressed
+static void run(double dEndMS, std::vector<double> avPressesMS[4]) {
+  bool abPressed[4] = {};
+  while (hostMicros64() < dEndMS * 1000) {
+    loop();
+    hostAdvanceMicros(kIdleLoopUS);
+    for (uint8_t nPanel = 0; nPanel < 4; nPanel++) {
+      bool bPressed = Keyboard.hostIsPressed(kPanelKeys[nPanel]);
+      if (bPressed && !abPressed[nPanel]) {
+        avPressesMS[nPanel].push_back(
+          Keyboard.hostLastChangeMicros() / 1000.0 - kSettleMS);
+      }
+      abPressed[nPanel] = bPressed;
+    }
+  }
+}
+
+struct Summary {
+  int nSteps = 0;
+  int nPresses = 0;
+  int nMissed = 0;
+  int nExtra = 0;
+  std::vector<double> vErrorsMS;
+};
+
+// Match each press to the step it was for
+static void match(
+  const std::vector<double>& vStepsMS,
+  const std::vector<double>& vPressesMS,
+  double dWindowMS,
+  Summary& summary) {
+  std::vector<bool> vMatched(vStepsMS.size(), false);
+  size_t nStep = 0;
+  for (double dPressMS : vPressesMS) {
+    while (nStep + 1 < vStepsMS.size() &&
+           vStepsMS[nStep + 1] - kEarlyMS <= dPressMS) {
+      nStep++;
+    }
+    double dErrorMS = vStepsMS.empty() ? 0 : dPressMS - vStepsMS[nStep];
+    if (
+      !vStepsMS.empty() && !vMatched[nStep] && dErrorMS >= -kEarlyMS &&
+      dErrorMS <= dWindowMS) {
+      vMatched[nStep] = true;
+      summary.vErrorsMS.push_back(dErrorMS);
+    } else {
+      summary.nExtra++;
+    }
+  }
+
+  summary.nSteps += vStepsMS.size();
+  summary.nPresses += vPressesMS.size();
+  summary.nMissed += std::count(vMatched.begin(), vMatched.end(), false);
+}
+
+static double percentile(std::vector<double> values, double dPercent) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t nIndex = static_cast<size_t>(dPercent / 100 * (values.size() - 1));
+  return values[nIndex];
+}
+
+static void report(const Summary& summary) {
+  const std::vector<double>& vErrorsMS = summary.vErrorsMS;
+  double dMeanMS = 0;
+  for (double dErrorMS : vErrorsMS) {
+    dMeanMS += dErrorMS / vErrorsMS.size();
+  }
+  double dVariance = 0;
+  for (double dErrorMS : vErrorsMS) {
+    dVariance += (dErrorMS - dMeanMS) * (dErrorMS - dMeanMS) / vErrorsMS.size();
+  }
+
+  printf("steps:     %d\n", summary.nSteps);
+  printf("presses:   %d\n", summary.nPresses);
+  printf(
+    "missed:    %d (%.2f%%)\n",
+    summary.nMissed,
+    summary.nSteps ? summary.nMissed * 100.0 / summary.nSteps : 0.0);
+  printf(
+    "extra:     %d (%.2f%%)\n",
+    summary.nExtra,
+    summary.nPresses ? summary.nExtra * 100.0 / summary.nPresses : 0.0);
+  printf(
+    "error (ms): mean %.2f, sd %.2f, min %.2f, p5 %.2f, median %.2f, "
+    "p95 %.2f, p99 %.2f, max %.2f\n",
+    dMeanMS,
+    sqrt(dVariance),
+    percentile(vErrorsMS, 0),
+    percentile(vErrorsMS, 5),
+    percentile(vErrorsMS, 50),
+    percentile(vErrorsMS, 95),
+    percentile(vErrorsMS, 99),
+    percentile(vErrorsMS, 100));
+
+  // Histogram in 2 ms bins
+  if (vErrorsMS.empty()) {
+    return;
+  }
+  const double kBinMS = 2;
+  const int kBarWidth = 50;
+  int nFirst = floor(percentile(vErrorsMS, 0) / kBinMS);
+  int nLast = floor(percentile(vErrorsMS, 100) / kBinMS);
+  std::vector<int> vBins(nLast - nFirst + 1, 0);
+  for (double dErrorMS : vErrorsMS) {
+    vBins[static_cast<int>(floor(dErrorMS / kBinMS)) - nFirst]++;
+  }
+  int nMax = *std::max_element(vBins.begin(), vBins.end());
+  for (size_t nBin = 0; nBin < vBins.size(); nBin++) {
+    double dFromMS = (nFirst + static_cast<int>(nBin)) * kBinMS;
+    printf(
+      "%6.0f to %3.0f ms %6d %s\n",
+      dFromMS,
+      dFromMS + kBinMS,
+      vBins[nBin],
+      std::string(vBins[nBin] * kBarWidth / nMax, '#').c_str());
+  }
+}
+
+static void usage(const char* pszProgram) {
+  fprintf(
+    stderr,
+    "Usage: %s [--seed N] [--steps N] [--bpm N] [--noise COUNTS]\n"
+    "       [--crosstalk FRACTION] [--window MS] [--set KEY=VALUE] [FILE]\n",
+    pszProgram);
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  const char* pszFile = NULL;
+  std::vector<std::string> vSettings;
+
+  for (int nArg = 1; nArg < argc; nArg++) {
+    std::string strArg(argv[nArg]);
+    bool bHasValue = nArg + 1 < argc;
+    if (strArg == "--seed" && bHasValue) {
+      options.nSeed = strtoul(argv[++nArg], NULL, 10);
+    } else if (strArg == "--steps" && bHasValue) {
+      options.nSteps = atoi(argv[++nArg]);
+    } else if (strArg == "--bpm" && bHasValue) {
+      options.dBpm = atof(argv[++nArg]);
+    } else if (strArg == "--noise" && bHasValue) {
+      options.dNoise = atof(argv[++nArg]);
+    } else if (strArg == "--crosstalk" && bHasValue) {
+      options.dCrosstalk = atof(argv[++nArg]);
+    } else if (strArg == "--window" && bHasValue) {
+      options.dWindowMS = atof(argv[++nArg]);
+    } else if (strArg == "--set" && bHasValue) {
+      vSettings.push_back(argv[++nArg]);
+    } else if (strArg[0] != '-' && !pszFile) {
+      pszFile = argv[nArg];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  s_rng.seed(options.nSeed);
+  s_dNoise = options.dNoise;
+
+  Chart chart;
+  if (pszFile && !loadChart(pszFile, chart)) {
+    fprintf(stderr, "Can't read chart %s\n", pszFile);
+    return 2;
+  } else if (!pszFile) {
+    makeChart(options, chart);
+  }
+
+  double dEndMS = kSettleMS;
+  for (uint8_t nPanel = 0; nPanel < 4; nPanel++) {
+    makeContacts(chart.avStepsMS[nPanel], s_avContacts[nPanel]);
+    if (!chart.avStepsMS[nPanel].empty()) {
+      dEndMS = std::max(dEndMS, kSettleMS + chart.avStepsMS[nPanel].back());
+    }
+  }
+  makeSensors(options);
+
+  hostSetAnalogRead(simulatedAnalogRead);
+  hostSetAnalogReadMicros(kAnalogReadUS);
+  setup();
+
+  Configuration* pConfig = Configuration::getInstance();
+  for (const std::string& strSetting : vSettings) {
+    size_t nEquals = strSetting.find('=');
+    if (nEquals == std::string::npos) {
+      usage(argv[0]);
+      return 2;
+    }
+    pConfig->setUInt16(
+      strSetting.substr(0, nEquals).c_str(),
+      atoi(strSetting.c_str() + nEquals + 1));
+  }
+
+  std::vector<double> avPressesMS[4];
+  run(dEndMS + kTailMS, avPressesMS);
+
+  Summary summary;
+  for (uint8_t nPanel = 0; nPanel < 4; nPanel++) {
+    match(
+      chart.avStepsMS[nPanel], avPressesMS[nPanel], options.dWindowMS, summary);
+  }
+  report(summary);
+  return 0;
+}
@@ -0,0 +1,220 @@
+//
+// Runs the firmware on the host as a virtual pad behind a pseudo-terminal.
+//
+// The real setup() and loop() run against the stubs in host/lib on the real
+// clock, so the Configurator, lights_bridge.py, and tests can open the pty
+// like a serial port and talk to the actual command processor. Sensors read a
+// noisy baseline. With --presses, each panel is pressed in turn for 150 ms
+// every second after the first, which is left for calibration, so telemetry
+// and events change.
+//
+// The path of the pty is printed on the first line of output. With --link,
+// a symbolic link to it is created as well, for a stable name. With --eeprom,
+// the EEPROM is loaded from a file at start and saved to it on exit, so
+// persisted settings survive restarts. Stop with SIGINT or SIGTERM.
+//
+// Usage: program [--link PATH] [--eeprom FILE] [--presses] [--seed N]
+//
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <random>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "PanelPins.h"
+
+// From main.cpp
+void setup();
+void loop();
+
+static const uint16_t kBaseline = 100;
+static const uint16_t kPressedLoad = 400;
+
+// Time without presses after boot, while the sensors are calibrated
+static const uint32_t kSettleMS = 1000;
+
+// Time to sleep between loops when there's no input
+static const long kIdleNS = 50000;
+
+// Output that hasn't been read is dropped past this size, like the device
+// does when no host is reading
+static const size_t kMaxPendingOutput = 64 * 1024;
+
+static int s_nMaster = -1;
+static std::string s_strPending;
+static bool s_bPresses = false;
+static std::mt19937 s_rng;
+static volatile sig_atomic_t s_bStop = 0;
+
+static uint16_t virtualAnalogRead(uint8_t nPin) {
+  std::uniform_int_distribution<int> noise(-2, 2);
+  int nValue = kBaseline + noise(s_rng);
+
+  if (s_bPresses && millis() >= kSettleMS) {
+    uint32_t nPhaseMS = millis() % 1000;
+    uint8_t nPanel = nPhaseMS / 250;
+    bool bPressed = nPhaseMS % 250 < 150;
+    for (uint8_t nSensor = 0; bPressed && nSensor < 4; nSensor++) {
+      if (kPanelPins[nPanel][nSensor] == nPin) {
+        nValue += kPressedLoad;
+      }
+    }
+  }
+  return nValue;
+}
+
+// Move whatever the host wrote to the pty into the serial input. Waits up to
+// nTimeoutNS for it to arrive. Returns false if there was none.
+static bool readPty(long nTimeoutNS) {
+  pollfd pfd = {s_nMaster, POLLIN, 0};
+  timespec timeout = {nTimeoutNS / 1000000000, nTimeoutNS % 1000000000};
+  if (ppoll(&pfd, 1, &timeout, NULL) <= 0 || !(pfd.revents & POLLIN)) {
+    return false;
+  }
+
+  char buffer[4096];
+  ssize_t nRead = read(s_nMaster, buffer, sizeof(buffer));
+  if (nRead <= 0) {
+    return false;
+  }
+  Serial.hostWrite(std::string(buffer, nRead));
+  return true;
+}
+
+static void writePty() {
+  s_strPending += Serial.hostRead();
+  if (s_strPending.empty()) {
+    return;
+  }
+
+  ssize_t nWritten = write(s_nMaster, s_strPending.data(), s_strPending.size());
+  if (nWritten > 0) {
+    s_strPending.erase(0, nWritten);
+  }
+  if (s_strPending.size() > kMaxPendingOutput) {
+    s_strPending.clear();
+  }
+}
+
+// Called by the firmware's blocking serial reads, e.g. for the second line of
+// a command. Output is flushed first since the host may be waiting for it.
+static bool waitForSerial(uint32_t nTimeoutMS) {
+  writePty();
+  return readPty(static_cast<long>(nTimeoutMS) * 1000000);
+}
+
+// Open a pty in raw mode. The slave is kept open so the master stays usable
+// while no host has it open. Returns the slave's path or an empty string.
+static std::string openPty(int& nSlave) {
+  s_nMaster = posix_openpt(O_RDWR | O_NOCTTY);
+  if (s_nMaster < 0 || grantpt(s_nMaster) != 0 || unlockpt(s_nMaster) != 0) {
+    return "";
+  }
+  std::string strPath = ptsname(s_nMaster);
+
+  nSlave = open(strPath.c_str(), O_RDWR | O_NOCTTY);
+  termios attr;
+  if (nSlave < 0 || tcgetattr(nSlave, &attr) != 0) {
+    return "";
+  }
+  cfmakeraw(&attr);
+  tcsetattr(nSlave, TCSANOW, &attr);
+
+  fcntl(s_nMaster, F_SETFL, fcntl(s_nMaster, F_GETFL) | O_NONBLOCK);
+  return strPath;
+}
+
+static void loadEeprom(const char* pszPath) {
+  FILE* pFile = fopen(pszPath, "rb");
+  if (pFile) {
+    fread(EEPROM.m_data, 1, sizeof(EEPROM.m_data), pFile);
+    fclose(pFile);
+  }
+}
+
+static void saveEeprom(const char* pszPath) {
+  FILE* pFile = fopen(pszPath, "wb");
+  if (pFile) {
+    fwrite(EEPROM.m_data, 1, sizeof(EEPROM.m_data), pFile);
+    fclose(pFile);
+  }
+}
+
+static void onSignal(int) { s_bStop = 1; }
+
+int main(int argc, char** argv) {
+  const char* pszLink = NULL;
+  const char* pszEeprom = NULL;
+  uint32_t nSeed = 1;
+
+  for (int nArg = 1; nArg < argc; nArg++) {
+    std::string strArg(argv[nArg]);
+    bool bHasValue = nArg + 1 < argc;
+    if (strArg == "--link" && bHasValue) {
+      pszLink = argv[++nArg];
+    } else if (strArg == "--eeprom" && bHasValue) {
+      pszEeprom = argv[++nArg];
+    } else if (strArg == "--seed" && bHasValue) {
+      nSeed = strtoul(argv[++nArg], NULL, 10);
+    } else if (strArg == "--presses") {
+      s_bPresses = true;
+    } else {
+      fprintf(
+        stderr,
+        "Usage: %s [--link PATH] [--eeprom FILE] [--presses] [--seed N]\n",
+        argv[0]);
+      return 2;
+    }
+  }
+
+  int nSlave = -1;
+  std::string strPath = openPty(nSlave);
+  if (strPath.empty()) {
+    perror("Can't open a pty");
+    return 1;
+  }
+  if (pszLink) {
+    unlink(pszLink);
+    if (symlink(strPath.c_str(), pszLink) != 0) {
+      perror("Can't create link");
+      return 1;
+    }
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  s_rng.seed(nSeed);
+  hostSetAnalogRead(virtualAnalogRead);
+  hostUseRealClock(true);
+  Serial.hostSetWait(waitForSerial);
+  if (pszEeprom) {
+    loadEeprom(pszEeprom);
+  }
+
+  // Boot messages are sent before the path is printed, so hosts that clear
+  // their input after opening the pty don't see them
+  setup();
+  writePty();
+  printf("%s\n", strPath.c_str());
+  fflush(stdout);
+
+  while (!s_bStop) {
+    loop();
+    writePty();
+    readPty(Serial.available() ? 0 : kIdleNS);
+  }
+
+  if (pszEeprom) {
+    saveEeprom(pszEeprom);
+  }
+  if (pszLink) {
+    unlink(pszLink);
+  }
+  close(nSlave);
+  close(s_nMaster);
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include "Adc.h"
+#include "Config.h"
+
+// Selectable profiles. Profile 0 matches the default analogRead() setup.
+// Conversion speed isn't exposed by the core's analogRead(), so oversampling is
+// done with the hardware averaging instead.
+static const AdcProfile s_profiles[] = {
+  {10, 4},  // Default
+  {10, 1},  // Fastest
+  {12, 4},  // 12-bit
+  {12, 16}, // 12-bit oversampled
+  {12, 32}, // 12-bit heavily oversampled
+};
+
+static const uint16_t kNumProfiles = sizeof(s_profiles) / sizeof(s_profiles[0]);
+
+// Number of conversions timed by measure()
+static const uint32_t kMeasureSamples = 64;
+
+static const char* const kProfileSetting = "adc_profile";
+
+Adc* Adc::m_pInst = NULL;
+
+Adc* Adc::getInstance() {
+  if (!m_pInst) {
+    m_pInst = new Adc();
+  }
+  return m_pInst;
+}
+
+uint16_t Adc::getNumProfiles() { return kNumProfiles; }
+
+Adc::Adc() : m_nProfile(0), m_bConfigured(false), m_nSampleTimeNS(0) {
+  Configuration::getInstance()->setRange(kProfileSetting, 0, kNumProfiles - 1);
+}
+
+bool Adc::configure() {
+  uint16_t nProfile =
+    Configuration::getInstance()->getUInt16(kProfileSetting, 0);
+  if (nProfile >= kNumProfiles) {
+    nProfile = 0;
+  }
+
+  if (m_bConfigured && nProfile == m_nProfile) {
+    return false;
+  }
+
+  m_nProfile = nProfile;
+  m_bConfigured = true;
+  analogReadResolution(s_profiles[m_nProfile].nResolution);
+  analogReadAveraging(s_profiles[m_nProfile].nAveraging);
+  return true;
+}
+
+void Adc::measure(uint8_t nPin) {
+  uint32_t nStartUS = micros();
+  for (uint32_t nSample = 0; nSample < kMeasureSamples; nSample++) {
+    analogRead(nPin);
+  }
+  m_nSampleTimeNS = (micros() - nStartUS) * 1000 / kMeasureSamples;
+}
+
+uint16_t Adc::getProfile() const { return m_nProfile; }
+
+const AdcProfile& Adc::getProfileSettings() const {
+  return s_profiles[m_nProfile];
+}
+
+uint16_t Adc::getMaxValue() const {
+  return (1 << s_profiles[m_nProfile].nResolution) - 1;
+}
+
+uint8_t Adc::getShift() const {
+  return s_profiles[m_nProfile].nResolution - 10;
+}
+
+uint32_t Adc::getSampleTimeNS() const { return m_nSampleTimeNS; }
@@ -0,0 +1,49 @@
+//
+// Analog input settings shared by all sensors.
+//
+#pragma once
+#include <Arduino.h>
+
+// Resolution and hardware averaging used by analogRead()
+struct AdcProfile {
+  uint8_t nResolution; // Bits per sample
+  uint8_t nAveraging;  // Conversions averaged by the hardware per sample
+};
+
+class Adc {
+public:
+  // Get singleton instance
+  static Adc* getInstance();
+
+  // Number of selectable profiles
+  static uint16_t getNumProfiles();
+
+  // Apply the profile from the `adc_profile` config item. Returns true if the
+  // profile changed, which invalidates any readings taken with the old one.
+  bool configure();
+
+  // Time a burst of conversions on nPin with the current profile
+  void measure(uint8_t nPin);
+
+  uint16_t getProfile() const;
+  const AdcProfile& getProfileSettings() const;
+
+  // Largest value analogRead() can return
+  uint16_t getMaxValue() const;
+
+  // Bits of resolution above 10. Config values are given for 10-bit readings
+  // and are shifted left by this amount.
+  uint8_t getShift() const;
+
+  // Measured time for one analogRead() in nanoseconds
+  uint32_t getSampleTimeNS() const;
+
+private:
+  static Adc* m_pInst;
+
+  Adc();
+
+  uint16_t m_nProfile;
+  bool m_bConfigured;
+  uint32_t m_nSampleTimeNS;
+};
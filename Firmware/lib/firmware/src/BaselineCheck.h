@@ -0,0 +1,140 @@
+//
+// Plausibility check of stored baselines against live readings at boot.
+//
+// A reading can only be pushed above a sensor's baseline, so a live reading
+// well below the stored baseline means the stored one is stale and the live
+// reading is used instead. A reading well above it is assumed to be someone
+// standing on the panel and the stored baseline is kept, so the press is seen
+// on the first scan. Feet can't load every sensor at once, so if all of them
+// read well above their stored baselines the whole record is rejected as a
+// shift of the readings, e.g. from different hardware or ADC settings.
+//
+// A stored baseline that is too low for its sensor looks just like a press
+// and would keep it pressed forever, as baselines only recalibrate while idle.
+// So sensors taken to be loaded are watched, and if one stays pressed with a
+// reading that doesn't move by more than its noise for kLoadedBaselineMS, the
+// load is taken to be the sensor's idle level after all.
+//
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SensorPipeline.h"
+
+typedef enum {
+  enumBaselineKept,    // Live reading agrees with the stored baseline
+  enumBaselineLoaded,  // Live reading above it, assumed to be a press
+  enumBaselineStale,   // Live reading below it, so the live reading is used
+  enumBaselineMissing, // No plausible record, so the live reading is used
+  enumBaselineExpired, // Loaded but never released, so the live reading is used
+} enumBaselineCheck;
+
+// Time a loaded sensor's reading has to stay flat while pressed before its
+// stored baseline is abandoned
+const uint32_t kLoadedBaselineMS = kIdleRecalibrationMS;
+
+// Multiple of a sensor's noise a live reading may differ from its stored
+// baseline by and still agree with it
+const uint8_t kBaselineNoiseFactor = 4;
+
+// How far a live reading may differ from a stored baseline with the given
+// noise. Never less than nMinTolerance.
+inline uint16_t baselineTolerance(uint16_t nNoise, uint16_t nMinTolerance) {
+  uint32_t nTolerance = static_cast<uint32_t>(nNoise) * kBaselineNoiseFactor;
+  if (nTolerance < nMinTolerance) {
+    return nMinTolerance;
+  }
+  return nTolerance > UINT16_MAX ? UINT16_MAX : nTolerance;
+}
+
+// Choose the baseline of each of nSensors sensors from its stored baseline,
+// noise, and live reading. anStored and anNoise may be NULL if there is no
+// stored record. Returns the number of sensors seeded from the record.
+inline uint8_t checkBaselines(
+  uint8_t nSensors,
+  const uint16_t* anStored,
+  const uint16_t* anNoise,
+  const uint16_t* anLive,
+  uint16_t nMinTolerance,
+  uint16_t* anBaseline,
+  enumBaselineCheck* aResult) {
+  bool bAllLoaded = anStored != NULL;
+  for (uint8_t n = 0; anStored && n < nSensors; n++) {
+    uint16_t nTolerance = baselineTolerance(anNoise[n], nMinTolerance);
+    if (anLive[n] + nTolerance < anStored[n]) {
+      aResult[n] = enumBaselineStale;
+    } else if (anLive[n] > anStored[n] + nTolerance) {
+      aResult[n] = enumBaselineLoaded;
+    } else {
+      aResult[n] = enumBaselineKept;
+    }
+    bAllLoaded = bAllLoaded && aResult[n] == enumBaselineLoaded;
+  }
+
+  uint8_t nSeeded = 0;
+  for (uint8_t n = 0; n < nSensors; n++) {
+    if (!anStored || bAllLoaded) {
+      aResult[n] = enumBaselineMissing;
+    }
+    if (aResult[n] == enumBaselineKept || aResult[n] == enumBaselineLoaded) {
+      anBaseline[n] = anStored[n];
+      nSeeded++;
+    } else {
+      anBaseline[n] = anLive[n];
+    }
+  }
+  return nSeeded;
+}
+
+// Watch of a sensor whose stored baseline was taken to be under load at boot
+class LoadedBaselineWatch {
+public:
+  LoadedBaselineWatch()
+      : m_nReference(0),
+        m_nTolerance(0),
+        m_nFlatSinceMS(0),
+        m_bWatching(false) {}
+
+  // Start watching with readings that agree with each other within nTolerance
+  void start(uint16_t nPressure, uint16_t nTolerance, uint32_t nTimeMS) {
+    m_nReference = nPressure;
+    m_nTolerance = nTolerance;
+    m_nFlatSinceMS = nTimeMS;
+    m_bWatching = true;
+  }
+
+  bool isWatching() const { return m_bWatching; }
+
+  // Returns true once the sensor stayed pressed with a flat reading for
+  // kLoadedBaselineMS, after which the stored baseline should be replaced.
+  // Watching stops then or once the sensor is released, which confirms the
+  // stored baseline.
+  bool update(uint16_t nPressure, bool bPressed, uint32_t nTimeMS) {
+    if (!m_bWatching) {
+      return false;
+    }
+    if (!bPressed) {
+      m_bWatching = false;
+      return false;
+    }
+    if (
+      nPressure + m_nTolerance < m_nReference ||
+      nPressure > m_nReference + m_nTolerance) {
+      // Feet shift their weight, so the reading moving means it's a press
+      m_nReference = nPressure;
+      m_nFlatSinceMS = nTimeMS;
+      return false;
+    }
+    if (nTimeMS - m_nFlatSinceMS < kLoadedBaselineMS) {
+      return false;
+    }
+    m_bWatching = false;
+    return true;
+  }
+
+private:
+  uint16_t m_nReference; // Reading when it last moved
+  uint16_t m_nTolerance;
+  uint32_t m_nFlatSinceMS;
+  bool m_bWatching;
+};
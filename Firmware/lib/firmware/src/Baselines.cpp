@@ -0,0 +1,97 @@
+#include "Baselines.h"
+#include "EepromLayout.h"
+
+#include <stddef.h>
+
+static_assert(
+  sizeof(BaselineRecord) <= kEepromBaselinesSize,
+  "Baseline record doesn't fit in its EEPROM region");
+
+// Marks a record that has been written. Unwritten EEPROM reads 0xFF or 0.
+static const uint16_t kBaselineMagic = 0x4C42;
+
+Baselines* Baselines::m_pInst = NULL;
+
+Baselines* Baselines::getInstance() {
+  if (!m_pInst) {
+    m_pInst = new Baselines();
+  }
+  return m_pInst;
+}
+
+Baselines::Baselines() : m_bValid(false), m_nWrites(0) {
+  memset(&m_record, 0, sizeof(m_record));
+}
+
+static uint16_t recordChecksum(const BaselineRecord& record) {
+  return eepromChecksum(
+    &record.nShift, sizeof(record) - offsetof(BaselineRecord, nShift));
+}
+
+void Baselines::read() {
+  EEPROM.get(kEepromBaselinesOffset, m_record);
+  m_bValid = m_record.nMagic == kBaselineMagic &&
+             m_record.nChecksum == recordChecksum(m_record);
+}
+
+void Baselines::write(
+  const uint16_t* anBaseline,
+  const uint16_t* anNoise,
+  uint8_t nShift) {
+  m_record.nMagic = kBaselineMagic;
+  m_record.nShift = nShift;
+  m_record.nReserved = 0;
+  memcpy(m_record.anBaseline, anBaseline, sizeof(m_record.anBaseline));
+  memcpy(m_record.anNoise, anNoise, sizeof(m_record.anNoise));
+  m_record.nChecksum = recordChecksum(m_record);
+
+  // EEPROM.put() only writes bytes that changed
+  EEPROM.put(kEepromBaselinesOffset, m_record);
+  m_bValid = true;
+  m_nWrites++;
+}
+
+bool Baselines::isValid() const { return m_bValid; }
+
+void Baselines::invalidate() {
+  m_record.nMagic = 0;
+  EEPROM.put(
+    kEepromBaselinesOffset + offsetof(BaselineRecord, nMagic), m_record.nMagic);
+  m_bValid = false;
+}
+
+// Rescales from the record's resolution
+static inline uint16_t rescale(uint16_t nValue, uint8_t nFrom, uint8_t nTo) {
+  return nTo >= nFrom ? nValue << (nTo - nFrom) : nValue >> (nFrom - nTo);
+}
+
+bool Baselines::hasMoved(
+  const uint16_t* anBaseline,
+  uint8_t nShift,
+  uint16_t nMargin) const {
+  if (!m_bValid) {
+    return true;
+  }
+  uint16_t nScaledMargin = nMargin << nShift;
+  for (uint8_t n = 0; n < kBaselineSensors; n++) {
+    uint16_t nStored = rescale(m_record.anBaseline[n], m_record.nShift, nShift);
+    uint16_t nDifference = nStored > anBaseline[n] ? nStored - anBaseline[n]
+                                                   : anBaseline[n] - nStored;
+    if (nDifference > nScaledMargin) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Baselines::get(
+  uint16_t* anBaseline,
+  uint16_t* anNoise,
+  uint8_t nShift) const {
+  for (uint8_t n = 0; n < kBaselineSensors; n++) {
+    anBaseline[n] = rescale(m_record.anBaseline[n], m_record.nShift, nShift);
+    anNoise[n] = rescale(m_record.anNoise[n], m_record.nShift, nShift);
+  }
+}
+
+uint32_t Baselines::getWrites() const { return m_nWrites; }
@@ -0,0 +1,69 @@
+//
+// Baselines and noise of the sensors saved across resets.
+//
+// Baselines found while the pad is idle are saved now and then, so at boot
+// the thresholds can be set before the first scan instead of from readings
+// taken while someone may be standing on the pad. See BaselineCheck.h for
+// how the saved record is checked against live readings.
+//
+#pragma once
+#include <Arduino.h>
+
+const uint8_t kBaselineSensors = 16;
+
+// Record stored as-is in the EEPROM. Sensors are in panel order, each with
+// its north, east, south, and west sensors before correcting for orientation.
+struct BaselineRecord {
+  uint16_t nMagic;
+  uint16_t nChecksum; // Of everything after this field
+  uint8_t nShift;     // Bits of ADC resolution above 10 of the values
+  uint8_t nReserved;
+  uint16_t anBaseline[kBaselineSensors];
+  uint16_t anNoise[kBaselineSensors];
+};
+
+class Baselines {
+public:
+  // Get singleton instance
+  static Baselines* getInstance();
+
+  // Load the record from the EEPROM
+  void read();
+
+  // Save baselines and noise with nShift bits of resolution above 10. Only
+  // the bytes that changed are written.
+  void write(
+    const uint16_t* anBaseline,
+    const uint16_t* anNoise,
+    uint8_t nShift);
+
+  // Was a record read or written?
+  bool isValid() const;
+
+  // Mark the record as unusable, so it's neither used at the next boot nor
+  // compared against until a new one is written
+  void invalidate();
+
+  // Has any baseline moved by more than nMargin 10-bit steps from the record?
+  // True if there is no record.
+  bool hasMoved(
+    const uint16_t* anBaseline,
+    uint8_t nShift,
+    uint16_t nMargin) const;
+
+  // Get the stored values scaled to nShift bits of resolution above 10. Only
+  // meaningful if isValid().
+  void get(uint16_t* anBaseline, uint16_t* anNoise, uint8_t nShift) const;
+
+  // Number of records written since boot
+  uint32_t getWrites() const;
+
+private:
+  static Baselines* m_pInst;
+
+  Baselines();
+
+  BaselineRecord m_record;
+  bool m_bValid;
+  uint32_t m_nWrites;
+};
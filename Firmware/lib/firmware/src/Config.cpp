@@ -1,9 +1,15 @@
 #include "Config.h"
+#include "EepromLayout.h"
+#include "Log.h"
 #include <EEPROM.h>
 
 Configuration* Configuration::m_inst = NULL;
 
-static const uint32_t kSentinelValue = 0x5AFEC0DE;
+// Marks an image with its size after the sentinel
+static const uint32_t kSentinelValue = 0x5AFEC0DF;
+
+// Marks an image from older firmware, which has no size
+static const uint32_t kLegacySentinelValue = 0x5AFEC0DE;
 
 Configuration* Configuration::getInstance() {
   if (!m_inst) {
@@ -18,16 +24,26 @@ Configuration::getString(const String& strKey, const String& strDefault) {
   if (it == m_mapStr.end()) {
     m_mapStr[strKey] = strDefault;
     m_bDirty = true;
+    touch(strKey);
     return strDefault;
   }
 
   return it->second;
 }
 
-void Configuration::setString(const String& strKey, const String& strValue) {
-  m_mapStr[strKey] = strValue;
-  m_bDirty = true;
-  notifyCallbacks();
+void Configuration::setString(
+  const String& strKey,
+  const String& strValue,
+  bool bNotify) {
+  auto it = m_mapStr.find(strKey);
+  if (it == m_mapStr.end() || it->second != strValue) {
+    m_mapStr[strKey] = strValue;
+    m_bDirty = true;
+    touch(strKey);
+  }
+  if (bNotify) {
+    notifyCallbacks();
+  }
 }
 
 const uint16_t&
@@ -36,16 +52,26 @@ Configuration::getUInt16(const String& strKey, const uint16_t& nDefault) {
   if (it == m_mapUInt16.end()) {
     m_mapUInt16[strKey] = nDefault;
     m_bDirty = true;
+    touch(strKey);
     return nDefault;
   }
 
   return it->second;
 }
 
-void Configuration::setUInt16(const String& strKey, uint16_t nValue) {
-  m_mapUInt16[strKey] = nValue;
-  m_bDirty = true;
-  notifyCallbacks();
+void Configuration::setUInt16(
+  const String& strKey,
+  uint16_t nValue,
+  bool bNotify) {
+  auto it = m_mapUInt16.find(strKey);
+  if (it == m_mapUInt16.end() || it->second != nValue) {
+    m_mapUInt16[strKey] = nValue;
+    m_bDirty = true;
+    touch(strKey);
+  }
+  if (bNotify) {
+    notifyCallbacks();
+  }
 }
 
 const uint32_t&
@@ -54,16 +80,26 @@ Configuration::getUInt32(const String& strKey, const uint32_t& nDefault) {
   if (it == m_mapUInt32.end()) {
     m_mapUInt32[strKey] = nDefault;
     m_bDirty = true;
+    touch(strKey);
     return nDefault;
   }
 
   return it->second;
 }
 
-void Configuration::setUInt32(const String& strKey, uint32_t nValue) {
-  m_mapUInt32[strKey] = nValue;
-  m_bDirty = true;
-  notifyCallbacks();
+void Configuration::setUInt32(
+  const String& strKey,
+  uint32_t nValue,
+  bool bNotify) {
+  auto it = m_mapUInt32.find(strKey);
+  if (it == m_mapUInt32.end() || it->second != nValue) {
+    m_mapUInt32[strKey] = nValue;
+    m_bDirty = true;
+    touch(strKey);
+  }
+  if (bNotify) {
+    notifyCallbacks();
+  }
 }
 
 int Configuration::put(int nOffset, const String& str) const {
@@ -75,102 +111,184 @@ int Configuration::put(int nOffset, const String& str) const {
   return nOffset;
 }
 
-int Configuration::get(int nOffset, String& str) const {
-  char c;
-  while (EEPROM.get(nOffset++, c)) {
-    str += c;
+int Configuration::get(
+  const uint8_t* pImage,
+  int nSize,
+  int nOffset,
+  String& str) {
+  if (nOffset < 0 || nOffset >= nSize) {
+    return -1;
   }
 
-  Serial.print("get[str]: ");
-  Serial.print(str);
-  Serial.println();
+  const char* pszValue = reinterpret_cast<const char*>(pImage + nOffset);
+  const void* pTerminator = memchr(pszValue, '\0', nSize - nOffset);
+  if (!pTerminator) {
+    return -1;
+  }
 
-  return nOffset;
+  str = pszValue;
+  return static_cast<const uint8_t*>(pTerminator) - pImage + 1;
 }
 
 void Configuration::read() {
-  // Get sentinel value
-  int nOffset(0);
+  // Get sentinel value and size of the image
   uint32_t nSentinel;
-  nOffset = get(nOffset, nSentinel);
-
-  if (nSentinel != kSentinelValue) {
+  uint16_t nSize;
+  EEPROM.get(0, nSentinel);
+  EEPROM.get(sizeof(nSentinel), nSize);
+
+  int nOffset;
+  if (nSentinel == kSentinelValue) {
+    nOffset = sizeof(nSentinel) + sizeof(nSize);
+  } else if (nSentinel == kLegacySentinelValue) {
+    // Written without a size, so the image may fill the whole region
+    nOffset = sizeof(nSentinel);
+    nSize = kEepromConfigEnd;
+  } else {
     return; // Uninitialized or bad data
   }
 
+  if (nSize > kEepromConfigEnd) {
+    return;
+  }
+
+  uint8_t* pImage = new uint8_t[nSize];
+  eeprom_read_block(pImage, reinterpret_cast<const void*>(0), nSize);
+  if (!parse(pImage + nOffset, nSize - nOffset)) {
+    // Fall back to defaults rather than keeping part of the image
+    m_mapStr.clear();
+    m_mapUInt16.clear();
+    m_mapUInt32.clear();
+    m_mapGeneration.clear();
+  }
+  delete[] pImage;
+
+  m_bDirty = false;
+}
+
+bool Configuration::parse(const uint8_t* pImage, int nSize) {
+  int nOffset(0);
+
   // Get strings
   int nNumStrings;
-  nOffset = get(nOffset, nNumStrings);
-  for (int nString = 0; nString < nNumStrings; nString++) {
+  nOffset = get(pImage, nSize, nOffset, nNumStrings);
+  for (int nString = 0; nOffset >= 0 && nString < nNumStrings; nString++) {
     String strKey, strValue;
-    nOffset = get(nOffset, strKey);
-    nOffset = get(nOffset, strValue);
-    m_mapStr[strKey] = strValue;
+    nOffset = get(pImage, nSize, nOffset, strKey);
+    nOffset = get(pImage, nSize, nOffset, strValue);
+    if (nOffset >= 0) {
+      m_mapStr[strKey] = strValue;
+      touch(strKey);
+    }
   }
 
   // Get 16-bit unsigned integers
   int nNumUInt16;
-  nOffset = get(nOffset, nNumUInt16);
-  for (int nElement = 0; nElement < nNumUInt16; nElement++) {
+  nOffset = get(pImage, nSize, nOffset, nNumUInt16);
+  for (int nElement = 0; nOffset >= 0 && nElement < nNumUInt16; nElement++) {
     String strKey;
     uint16_t nValue;
-    nOffset = get(nOffset, strKey);
-    nOffset = get(nOffset, nValue);
-    m_mapUInt16[strKey] = nValue;
+    nOffset = get(pImage, nSize, nOffset, strKey);
+    nOffset = get(pImage, nSize, nOffset, nValue);
+    if (nOffset >= 0) {
+      m_mapUInt16[strKey] = nValue;
+      touch(strKey);
+    }
   }
 
   // Get 32-bit unsigned integers
   int nNumUInt32;
-  nOffset = get(nOffset, nNumUInt32);
-  for (int nElement = 0; nElement < nNumUInt32; nElement++) {
+  nOffset = get(pImage, nSize, nOffset, nNumUInt32);
+  for (int nElement = 0; nOffset >= 0 && nElement < nNumUInt32; nElement++) {
     String strKey;
     uint32_t nValue;
-    nOffset = get(nOffset, strKey);
-    nOffset = get(nOffset, nValue);
-    m_mapUInt32[strKey] = nValue;
+    nOffset = get(pImage, nSize, nOffset, strKey);
+    nOffset = get(pImage, nSize, nOffset, nValue);
+    if (nOffset >= 0) {
+      m_mapUInt32[strKey] = nValue;
+      touch(strKey);
+    }
   }
 
-  m_bDirty = false;
+  return nOffset >= 0;
 }
 
-void Configuration::write() {
+bool Configuration::write() {
   if (!m_bDirty) {
-    return;
+    return true;
+  }
+  if (getSize() > kEepromConfigEnd) {
+    LOG_ERROR(kLogConfigTooLarge, getSize(), kEepromConfigEnd);
+    return false;
   }
 
-  // Write sentinel value
+  // Write sentinel value and size of the image
   int nOffset(0);
   nOffset = put(nOffset, kSentinelValue);
+  nOffset = put(nOffset, static_cast<uint16_t>(getSize()));
 
   // Write strings
-  nOffset = put(nOffset, m_mapStr.size());
+  int nNumStrings(0);
   for (auto const& element : m_mapStr) {
+    nNumStrings += m_setExcluded.count(element.first) ? 0 : 1;
+  }
+  nOffset = put(nOffset, nNumStrings);
+  for (auto const& element : m_mapStr) {
+    if (m_setExcluded.count(element.first)) {
+      continue;
+    }
     nOffset = put(nOffset, element.first);
     nOffset = put(nOffset, element.second);
   }
 
   // Write 16-bit unsigned integers
-  nOffset = put(nOffset, m_mapUInt16.size());
+  nOffset = put(nOffset, static_cast<int>(m_mapUInt16.size()));
   for (auto const& element : m_mapUInt16) {
     nOffset = put(nOffset, element.first);
     nOffset = put(nOffset, element.second);
   }
 
   // Write 32-bit unsigned integers
-  nOffset = put(nOffset, m_mapUInt32.size());
+  nOffset = put(nOffset, static_cast<int>(m_mapUInt32.size()));
   for (auto const& element : m_mapUInt32) {
     nOffset = put(nOffset, element.first);
     nOffset = put(nOffset, element.second);
   }
 
   m_bDirty = false;
+  return true;
+}
+
+int Configuration::getSize() const {
+  // Sentinel value, size, and the number of items of each type
+  int nSize = sizeof(kSentinelValue) + sizeof(uint16_t) + 3 * sizeof(int);
+
+  for (auto const& element : m_mapStr) {
+    if (!m_setExcluded.count(element.first)) {
+      nSize += element.first.length() + element.second.length() + 2;
+    }
+  }
+  for (auto const& element : m_mapUInt16) {
+    nSize += element.first.length() + 1 + sizeof(element.second);
+  }
+  for (auto const& element : m_mapUInt32) {
+    nSize += element.first.length() + 1 + sizeof(element.second);
+  }
+
+  return nSize;
+}
+
+void Configuration::excludeFromImage(const String& strKey) {
+  m_setExcluded.insert(strKey);
 }
 
 void Configuration::reset() {
   m_mapStr.clear();
   m_mapUInt16.clear();
   m_mapUInt32.clear();
+  m_mapGeneration.clear();
   m_bDirty = true;
+  m_nResetGeneration = ++m_nGeneration;
   notifyCallbacks();
 }
 
@@ -195,6 +313,63 @@ String Configuration::toString() const {
   return strResponse;
 }
 
+uint32_t Configuration::getGeneration() const { return m_nGeneration; }
+
+uint32_t Configuration::getResetGeneration() const {
+  return m_nResetGeneration;
+}
+
+uint32_t Configuration::getEpoch() const { return m_nEpoch; }
+
+void Configuration::setEpoch(uint32_t nEpoch) { m_nEpoch = nEpoch; }
+
+String Configuration::changesToString(uint32_t nGeneration) const {
+  String strResponse;
+
+  appendChanges(strResponse, m_mapStr, nGeneration);
+  appendChanges(strResponse, m_mapUInt16, nGeneration);
+  appendChanges(strResponse, m_mapUInt32, nGeneration);
+
+  // Remove trailing comma
+  if (strResponse.endsWith(',')) {
+    strResponse.remove(strResponse.length() - 1);
+  }
+
+  return strResponse;
+}
+
+void Configuration::setRange(
+  const String& strKey,
+  uint32_t nMin,
+  uint32_t nMax) {
+  m_mapRange[strKey] = {nMin, nMax};
+}
+
+bool Configuration::isInRange(const String& strKey, uint32_t nValue) const {
+  auto it = m_mapRange.find(strKey);
+  return it == m_mapRange.end() ||
+         (nValue >= it->second.nMin && nValue <= it->second.nMax);
+}
+
+String Configuration::schemaToString() const {
+  String strResponse;
+
+  appendSchema(strResponse, m_mapStr, "str");
+  appendSchema(strResponse, m_mapUInt16, "u16");
+  appendSchema(strResponse, m_mapUInt32, "u32");
+
+  // Remove trailing comma
+  if (strResponse.endsWith(',')) {
+    strResponse.remove(strResponse.length() - 1);
+  }
+
+  return strResponse;
+}
+
+void Configuration::touch(const String& strKey) {
+  m_mapGeneration[strKey] = ++m_nGeneration;
+}
+
 void Configuration::registerCallback(pFnConfigCallback cb) {
   m_vCallbacks.push_back(cb);
 }
@@ -5,6 +5,7 @@
 #include <Arduino.h>
 #include <EEPROM.h>
 #include <map>
+#include <set>
 #include <vector>
 
 class Configuration {
@@ -14,21 +15,30 @@ public:
 
   // Strings
   const String& getString(const String& strKey, const String& strDefault);
-  void setString(const String& strKey, const String& strValue);
+  void
+  setString(const String& strKey, const String& strValue, bool bNotify = true);
 
-  // 16-bit unsigned integers
+  // 16-bit unsigned integers. Set bNotify to false when the new value has
+  // already been applied, so callbacks aren't called.
   const uint16_t& getUInt16(const String& strKey, const uint16_t& nDefault);
-  void setUInt16(const String& strKey, uint16_t nValue);
+  void setUInt16(const String& strKey, uint16_t nValue, bool bNotify = true);
 
   // 32-bit unsigned integers
   const uint32_t& getUInt32(const String& strKey, const uint32_t& nDefault);
-  void setUInt32(const String& strKey, uint32_t nValue);
+  void setUInt32(const String& strKey, uint32_t nValue, bool bNotify = true);
 
-  // Read configuration from EEPROM
+  // Read configuration from EEPROM. The image is copied into RAM with a
+  // single block read and parsed from there.
   void read();
 
-  // Write configuration to EEPROM if data is dirty
-  void write();
+  // Write configuration to EEPROM if data is dirty. Nothing is written if the
+  // items don't fit before the regions in EepromLayout.h, and false is
+  // returned.
+  bool write();
+
+  // Keep a string item out of the image written to the EEPROM, for items
+  // stored in a region of their own. It can still be read and set.
+  void excludeFromImage(const String& strKey);
 
   // Reset all configuration items in memory
   void reset();
@@ -37,6 +47,35 @@ public:
   // `KEY1=VALUE1,KEY2=VALUE2,...,KEYN=VALUEN`.
   String toString() const;
 
+  // Generation of the configuration. Incremented whenever an item is added,
+  // changed, or removed.
+  uint32_t getGeneration() const;
+
+  // Generation of the most recent reset. Items changed before it no longer
+  // exist.
+  uint32_t getResetGeneration() const;
+
+  // Epoch of the generations. Generations restart at every boot, so the epoch
+  // is set to a different value each time to tell them apart.
+  uint32_t getEpoch() const;
+  void setEpoch(uint32_t nEpoch);
+
+  // Get string representation of configuration items changed after
+  // nGeneration in the same form as toString().
+  String changesToString(uint32_t nGeneration) const;
+
+  // Set the range of valid values for an integer item
+  void setRange(const String& strKey, uint32_t nMin, uint32_t nMax);
+
+  // Is nValue within the range of the item? Items without a range accept any
+  // value.
+  bool isInRange(const String& strKey, uint32_t nValue) const;
+
+  // Get a description of each configuration item in the form
+  // `KEY1:TYPE1[:MIN1:MAX1],...,KEYN:TYPEN[:MINN:MAXN]`, where `TYPE` is `str`,
+  // `u16`, or `u32`. Ranges are only included for integers that have one.
+  String schemaToString() const;
+
   typedef void (*pFnConfigCallback)();
 
   // Set a function to be called when the configuration is updated by the set*()
@@ -46,7 +85,42 @@ public:
 private:
   static Configuration* m_inst;
 
-  Configuration() : m_bDirty(false) {};
+  Configuration()
+      : m_bDirty(false), m_nGeneration(0), m_nResetGeneration(0),
+        m_nEpoch(0) {};
+
+  // Record that strKey was added or changed
+  void touch(const String& strKey);
+
+  // Append `KEY=VALUE,` for each item in mapItems changed after nGeneration
+  template <typename MAP>
+  void appendChanges(
+    String& str,
+    const MAP& mapItems,
+    uint32_t nGeneration) const {
+    for (auto const& element : mapItems) {
+      auto it = m_mapGeneration.find(element.first);
+      if (it != m_mapGeneration.end() && it->second > nGeneration) {
+        str.append(element.first + "=" + element.second + ",");
+      }
+    }
+  }
+
+  // Append `KEY:TYPE[:MIN:MAX],` for each item in mapItems
+  template <typename MAP>
+  void appendSchema(
+    String& str,
+    const MAP& mapItems,
+    const char* pszType) const {
+    for (auto const& element : mapItems) {
+      str.append(element.first + ":" + pszType);
+      auto it = m_mapRange.find(element.first);
+      if (it != m_mapRange.end()) {
+        str.append(String(":") + it->second.nMin + ":" + it->second.nMax);
+      }
+      str.append(',');
+    }
+  }
 
   // Write a null-terminated string to the EEPROM at nOffset.
   // Returns offset immediately after the null-terminator.
@@ -60,27 +134,48 @@ private:
     return nOffset + sizeof(nValue);
   }
 
-  // Get a null-terminated string from the EEPROM at nOffset.
-  // Returns offset immediately after the null-terminator.
-  int get(int nOffset, String& str) const;
+  // Get a null-terminated string from a configuration image at nOffset.
+  // Returns offset immediately after the null-terminator or -1 if the string
+  // doesn't end before nSize.
+  static int get(const uint8_t* pImage, int nSize, int nOffset, String& str);
 
-  // Get a POD value from the EEPROM at nOffset.
-  // Returns offset immediately after the value.
+  // Get a POD value from a configuration image at nOffset.
+  // Returns offset immediately after the value or -1 if the value doesn't end
+  // before nSize.
   template <typename TYPE>
-  int get(int nOffset, TYPE& nValue) const {
-    EEPROM.get(nOffset, nValue);
-    Serial.print("get: ");
-    Serial.print(static_cast<unsigned int>(nValue), 16);
-    Serial.println();
+  static int
+  get(const uint8_t* pImage, int nSize, int nOffset, TYPE& nValue) {
+    if (nOffset < 0 || nOffset + static_cast<int>(sizeof(nValue)) > nSize) {
+      return -1;
+    }
+    memcpy(&nValue, pImage + nOffset, sizeof(nValue));
     return nOffset + sizeof(nValue);
   }
 
+  // Add the items in a configuration image read from the EEPROM. Returns
+  // false if the image is truncated.
+  bool parse(const uint8_t* pImage, int nSize);
+
+  // Number of bytes written to the EEPROM by write()
+  int getSize() const;
+
   // Call registered callbacks to indicate the configuration has been updated
   void notifyCallbacks() const;
 
+  struct Range {
+    uint32_t nMin;
+    uint32_t nMax;
+  };
+
   bool m_bDirty;
+  uint32_t m_nGeneration;
+  uint32_t m_nResetGeneration;
+  uint32_t m_nEpoch;
+  std::map<String, uint32_t> m_mapGeneration; // Generation each item changed
+  std::map<String, Range> m_mapRange;
   std::map<String, String> m_mapStr;
   std::map<String, uint16_t> m_mapUInt16;
   std::map<String, uint32_t> m_mapUInt32;
+  std::set<String> m_setExcluded; // Strings left out of the image
   std::vector<pFnConfigCallback> m_vCallbacks;
 };
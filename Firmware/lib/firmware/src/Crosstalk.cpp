@@ -0,0 +1,250 @@
+#include "Crosstalk.h"
+#include "EepromLayout.h"
+
+static_assert(
+  sizeof(CrosstalkRecord) <= kEepromCrosstalkSize,
+  "Crosstalk record doesn't fit in its EEPROM region");
+
+// Marks a record that has been written. Unwritten EEPROM reads 0xFF or 0.
+static const uint16_t kCrosstalkMagic = 0x5854;
+
+// Regularization added to the fit relative to the mean squared load, so a
+// sensor that barely moved during learning can't get a huge coefficient
+static const float kRidgeFactor = 1e-3f;
+
+Crosstalk* Crosstalk::m_pInst = NULL;
+
+Crosstalk* Crosstalk::getInstance() {
+  if (!m_pInst) {
+    m_pInst = new Crosstalk();
+  }
+  return m_pInst;
+}
+
+Crosstalk::Crosstalk() {
+  clear();
+  cancelLearning();
+}
+
+// Index of a sensor in a record's row, which skips the victim's own panel
+static inline uint8_t recordColumn(uint8_t nVictim, uint8_t nSource) {
+  uint8_t nVictimPanel = nVictim / kCrosstalkSensorsPerPanel;
+  uint8_t nSourcePanel = nSource / kCrosstalkSensorsPerPanel;
+  return nSourcePanel > nVictimPanel ? nSource - kCrosstalkSensorsPerPanel
+                                     : nSource;
+}
+
+static inline bool isSamePanel(uint8_t nSensor1, uint8_t nSensor2) {
+  return nSensor1 / kCrosstalkSensorsPerPanel ==
+         nSensor2 / kCrosstalkSensorsPerPanel;
+}
+
+void Crosstalk::read() {
+  CrosstalkRecord record;
+  EEPROM.get(kEepromCrosstalkOffset, record);
+  uint16_t nChecksum =
+    eepromChecksum(&record.anCoefficient, sizeof(record.anCoefficient));
+  if (record.nMagic != kCrosstalkMagic || record.nChecksum != nChecksum) {
+    clear();
+    return;
+  }
+
+  for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+    for (uint8_t nSource = 0; nSource < kCrosstalkSensors; nSource++) {
+      m_anCoefficient[nVictim][nSource] =
+        isSamePanel(nVictim, nSource)
+          ? 0
+          : record.anCoefficient[nVictim][recordColumn(nVictim, nSource)];
+    }
+  }
+}
+
+void Crosstalk::write() const {
+  CrosstalkRecord record;
+  for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+    for (uint8_t nSource = 0; nSource < kCrosstalkSensors; nSource++) {
+      if (!isSamePanel(nVictim, nSource)) {
+        record.anCoefficient[nVictim][recordColumn(nVictim, nSource)] =
+          m_anCoefficient[nVictim][nSource];
+      }
+    }
+  }
+  record.nMagic = kCrosstalkMagic;
+  record.nChecksum = eepromChecksum(
+    &record.anCoefficient, sizeof(record.anCoefficient));
+
+  // EEPROM.put() only writes bytes that changed
+  EEPROM.put(kEepromCrosstalkOffset, record);
+}
+
+void Crosstalk::clear() {
+  memset(m_anCoefficient, 0, sizeof(m_anCoefficient));
+}
+
+// Runs on every scan, so the whole matrix is used without branches. The
+// coefficients between sensors on the same panel are 0. With 12-bit loads and
+// coefficients below 2, the sum of 16 products fits in 32 bits.
+void Crosstalk::compensate(
+  const uint16_t* anLoad,
+  uint16_t* anCoupling) const {
+  for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+    const int16_t* anRow = m_anCoefficient[nVictim];
+    int32_t nSum = 0;
+    for (uint8_t nSource = 0; nSource < kCrosstalkSensors; nSource++) {
+      nSum += anRow[nSource] * static_cast<int32_t>(anLoad[nSource]);
+    }
+
+    int32_t nCoupling = nSum >> kCrosstalkShift;
+    if (nCoupling < 0) {
+      nCoupling = 0;
+    } else if (nCoupling > anLoad[nVictim]) {
+      nCoupling = anLoad[nVictim];
+    }
+    anCoupling[nVictim] = nCoupling;
+  }
+}
+
+void Crosstalk::startLearning(uint8_t nPanel, uint16_t nMinLoad) {
+  cancelLearning();
+  if (nPanel < kCrosstalkPanels) {
+    m_nLearningPanel = nPanel;
+    m_nMinLoad = nMinLoad;
+  }
+}
+
+void Crosstalk::learn(const uint16_t* anLoad) {
+  if (!isLearning()) {
+    return;
+  }
+
+  const uint16_t* anSource =
+    anLoad + m_nLearningPanel * kCrosstalkSensorsPerPanel;
+  uint32_t nTotal = 0;
+  for (uint8_t n = 0; n < kCrosstalkSensorsPerPanel; n++) {
+    nTotal += anSource[n];
+  }
+  if (nTotal < m_nMinLoad) {
+    return;
+  }
+
+  for (uint8_t nRow = 0; nRow < kCrosstalkSensorsPerPanel; nRow++) {
+    for (uint8_t nCol = 0; nCol < kCrosstalkSensorsPerPanel; nCol++) {
+      m_anSourceSums[nRow][nCol] +=
+        static_cast<uint32_t>(anSource[nRow]) * anSource[nCol];
+    }
+  }
+  for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+    for (uint8_t nCol = 0; nCol < kCrosstalkSensorsPerPanel; nCol++) {
+      m_anVictimSums[nVictim][nCol] +=
+        static_cast<uint32_t>(anLoad[nVictim]) * anSource[nCol];
+    }
+  }
+  m_nSamples++;
+}
+
+// Fits each victim's load as a linear combination of the learned panel's
+// sensor loads by ridge regression. The 4x4 system is shared by all victims,
+// so it's inverted once.
+bool Crosstalk::finishLearning() {
+  if (!isLearning() || m_nSamples < kCrosstalkMinSamples) {
+    cancelLearning();
+    return false;
+  }
+
+  const uint8_t kSize = kCrosstalkSensorsPerPanel;
+  float aMatrix[kSize][kSize];
+  float aInverse[kSize][kSize];
+  float fTrace = 0;
+  for (uint8_t nRow = 0; nRow < kSize; nRow++) {
+    for (uint8_t nCol = 0; nCol < kSize; nCol++) {
+      aMatrix[nRow][nCol] =
+        static_cast<float>(m_anSourceSums[nRow][nCol]) / m_nSamples;
+      aInverse[nRow][nCol] = nRow == nCol ? 1 : 0;
+    }
+    fTrace += aMatrix[nRow][nRow];
+  }
+  float fRidge = kRidgeFactor * fTrace / kSize + 1;
+  for (uint8_t n = 0; n < kSize; n++) {
+    aMatrix[n][n] += fRidge;
+  }
+
+  // Gauss-Jordan elimination with partial pivoting. The ridge keeps the
+  // matrix positive definite, so a pivot is always found.
+  for (uint8_t nCol = 0; nCol < kSize; nCol++) {
+    uint8_t nPivot = nCol;
+    for (uint8_t nRow = nCol + 1; nRow < kSize; nRow++) {
+      if (fabsf(aMatrix[nRow][nCol]) > fabsf(aMatrix[nPivot][nCol])) {
+        nPivot = nRow;
+      }
+    }
+    for (uint8_t n = 0; nPivot != nCol && n < kSize; n++) {
+      float fTemp = aMatrix[nCol][n];
+      aMatrix[nCol][n] = aMatrix[nPivot][n];
+      aMatrix[nPivot][n] = fTemp;
+      fTemp = aInverse[nCol][n];
+      aInverse[nCol][n] = aInverse[nPivot][n];
+      aInverse[nPivot][n] = fTemp;
+    }
+
+    float fScale = 1 / aMatrix[nCol][nCol];
+    for (uint8_t n = 0; n < kSize; n++) {
+      aMatrix[nCol][n] *= fScale;
+      aInverse[nCol][n] *= fScale;
+    }
+    for (uint8_t nRow = 0; nRow < kSize; nRow++) {
+      float fFactor = aMatrix[nRow][nCol];
+      if (nRow == nCol || fFactor == 0) {
+        continue;
+      }
+      for (uint8_t n = 0; n < kSize; n++) {
+        aMatrix[nRow][n] -= fFactor * aMatrix[nCol][n];
+        aInverse[nRow][n] -= fFactor * aInverse[nCol][n];
+      }
+    }
+  }
+
+  uint8_t nFirstSource = m_nLearningPanel * kCrosstalkSensorsPerPanel;
+  for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+    if (isSamePanel(nVictim, nFirstSource)) {
+      continue;
+    }
+    for (uint8_t nRow = 0; nRow < kSize; nRow++) {
+      float fCoefficient = 0;
+      for (uint8_t nCol = 0; nCol < kSize; nCol++) {
+        fCoefficient += aInverse[nRow][nCol] *
+                        static_cast<float>(m_anVictimSums[nVictim][nCol]) /
+                        m_nSamples;
+      }
+      long nFixed = lroundf(fCoefficient * (1 << kCrosstalkShift));
+      if (nFixed < INT16_MIN) {
+        nFixed = INT16_MIN;
+      } else if (nFixed > INT16_MAX) {
+        nFixed = INT16_MAX;
+      }
+      m_anCoefficient[nVictim][nFirstSource + nRow] = nFixed;
+    }
+  }
+
+  cancelLearning();
+  return true;
+}
+
+void Crosstalk::cancelLearning() {
+  m_nLearningPanel = kCrosstalkNone;
+  m_nMinLoad = 0;
+  m_nSamples = 0;
+  memset(m_anSourceSums, 0, sizeof(m_anSourceSums));
+  memset(m_anVictimSums, 0, sizeof(m_anVictimSums));
+}
+
+bool Crosstalk::isLearning() const {
+  return m_nLearningPanel != kCrosstalkNone;
+}
+
+uint8_t Crosstalk::getLearningPanel() const { return m_nLearningPanel; }
+
+uint32_t Crosstalk::getNumSamples() const { return m_nSamples; }
+
+int16_t Crosstalk::get(uint8_t nVictim, uint8_t nSource) const {
+  return m_anCoefficient[nVictim][nSource];
+}
@@ -0,0 +1,92 @@
+//
+// Compensation for mechanical and electrical crosstalk between panels.
+//
+// Pressing one panel also loads sensors on its neighbors through the frame.
+// The coupling is modeled as a matrix of coefficients, where the load seen by
+// a sensor is its own load plus the sum of each sensor on another panel's load
+// times its coefficient. Coefficients are learned from guided presses of one
+// panel at a time and the estimated coupling is subtracted on every scan.
+//
+#pragma once
+#include <Arduino.h>
+
+const uint8_t kCrosstalkPanels = 4;
+const uint8_t kCrosstalkSensorsPerPanel = 4;
+const uint8_t kCrosstalkSensors = kCrosstalkPanels * kCrosstalkSensorsPerPanel;
+const uint8_t kCrosstalkNone = 0xFF;
+
+// Coefficients are fixed-point with this many fractional bits
+const uint8_t kCrosstalkShift = 14;
+
+// Samples needed before learning a panel's coefficients
+const uint32_t kCrosstalkMinSamples = 1000;
+
+// Record stored as-is in the EEPROM. Only coefficients between sensors on
+// different panels are stored, since those on the same panel are always 0.
+struct CrosstalkRecord {
+  uint16_t nMagic;
+  uint16_t nChecksum; // Of everything after this field
+  int16_t anCoefficient[kCrosstalkSensors]
+                       [kCrosstalkSensors - kCrosstalkSensorsPerPanel];
+};
+
+// Loads passed to and returned from the methods are in panel order, each with
+// its north, east, south, and west sensors before correcting for orientation.
+class Crosstalk {
+public:
+  // Get singleton instance
+  static Crosstalk* getInstance();
+
+  // Load the coefficients from the EEPROM. They are all 0 if none were saved.
+  void read();
+
+  // Write the coefficients to the EEPROM
+  void write() const;
+
+  // Set all coefficients to 0
+  void clear();
+
+  // Estimate the coupling in each sensor from the loads on the sensors of the
+  // other panels. A sensor's coupling never exceeds its load.
+  void compensate(const uint16_t* anLoad, uint16_t* anCoupling) const;
+
+  // Start learning the coupling from a panel. The user should then press
+  // only that panel, moving their weight around it. Scans where the panel's
+  // total load is below nMinLoad are ignored.
+  void startLearning(uint8_t nPanel, uint16_t nMinLoad);
+
+  // Add a scan's loads to the samples of the panel being learned
+  void learn(const uint16_t* anLoad);
+
+  // Solve for the coefficients from the learned panel to every other sensor
+  // and stop learning. Returns false and keeps the previous coefficients if
+  // there are too few samples.
+  bool finishLearning();
+
+  void cancelLearning();
+
+  bool isLearning() const;
+
+  // Panel being learned or kCrosstalkNone
+  uint8_t getLearningPanel() const;
+
+  uint32_t getNumSamples() const;
+
+  // Coefficient of the coupling from sensor nSource into sensor nVictim
+  int16_t get(uint8_t nVictim, uint8_t nSource) const;
+
+private:
+  static Crosstalk* m_pInst;
+
+  Crosstalk();
+
+  int16_t m_anCoefficient[kCrosstalkSensors][kCrosstalkSensors];
+
+  // Sums of products of the loads for a least squares fit
+  uint8_t m_nLearningPanel;
+  uint16_t m_nMinLoad;
+  uint32_t m_nSamples;
+  uint64_t m_anSourceSums[kCrosstalkSensorsPerPanel]
+                         [kCrosstalkSensorsPerPanel];
+  uint64_t m_anVictimSums[kCrosstalkSensors][kCrosstalkSensorsPerPanel];
+};
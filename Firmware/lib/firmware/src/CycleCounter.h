@@ -0,0 +1,16 @@
+//
+// CPU cycle counter for measuring the cost of short pieces of code.
+//
+#pragma once
+#include <Arduino.h>
+
+// Start the counter. Some cores leave it disabled after reset.
+inline void enableCycleCounter() {
+#ifdef ARM_DWT_CTRL_CYCCNTENA
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+}
+
+// Cycles since the counter was started. Wraps around.
+inline uint32_t getCycleCount() { return ARM_DWT_CYCCNT; }
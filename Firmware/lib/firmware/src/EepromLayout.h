@@ -0,0 +1,47 @@
+//
+// Regions of the EEPROM.
+//
+// Configuration items are written from the start of the EEPROM. Fixed-size
+// records are kept in regions at the end so they can be read and written on
+// their own without rewriting the configuration.
+//
+#pragma once
+#include <EEPROM.h>
+
+const int kEepromSize = E2END + 1;
+
+// Stored profiles. See Profiles.h. Boards with 2 KB of EEPROM (Teensy 3.x)
+// only have room for the records, the others leave some for them to grow.
+const int kEepromProfilesSize = kEepromSize > 2048 ? 512 : 400;
+const int kEepromProfilesOffset = kEepromSize - kEepromProfilesSize;
+
+// Crosstalk compensation matrix. See Crosstalk.h.
+const int kEepromCrosstalkSize = 392;
+const int kEepromCrosstalkOffset =
+  kEepromProfilesOffset - kEepromCrosstalkSize;
+
+// Saved sensor baselines. See Baselines.h.
+const int kEepromBaselinesSize = 72;
+const int kEepromBaselinesOffset =
+  kEepromCrosstalkOffset - kEepromBaselinesSize;
+
+// Linearization tables of the sensors. See LinearizationTables.h.
+const int kEepromLinearizationSize = 340;
+const int kEepromLinearizationOffset =
+  kEepromBaselinesOffset - kEepromLinearizationSize;
+
+// Configuration items must end before the first region. That leaves 844 bytes
+// on boards with 2 KB of EEPROM, of which the defaults take about 750.
+const int kEepromConfigEnd = kEepromLinearizationOffset;
+
+// Fletcher-16 checksum for records stored in the regions
+inline uint16_t eepromChecksum(const void* pData, size_t nLength) {
+  const uint8_t* pByte = static_cast<const uint8_t*>(pData);
+  uint16_t nSum1 = 0;
+  uint16_t nSum2 = 0;
+  while (nLength--) {
+    nSum1 = (nSum1 + *pByte++) % 255;
+    nSum2 = (nSum2 + nSum1) % 255;
+  }
+  return (nSum2 << 8) | nSum1;
+}
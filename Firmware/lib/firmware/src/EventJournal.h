@@ -0,0 +1,107 @@
+//
+// Journal of press and release events, also used for other records that hosts
+// fetch incrementally.
+//
+// Events are kept in a fixed-size ring and get a sequence number, which hosts
+// use as a cursor to fetch only what happened since their last request. When
+// the ring is full, the oldest events are overwritten and reported as lost to
+// readers that hadn't fetched them yet. There is a single writer and any
+// number of readers. The writer never waits, so it may be called from an
+// interrupt while a reader is copying.
+//
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+// Event flags
+const uint8_t kEventPressed = 0x01; // Press if set, otherwise release
+
+struct PressEvent {
+  uint32_t nTimeUS;
+  uint16_t nPeak; // Pressure when pressed or highest pressure when released
+  uint8_t nSensor;
+  uint8_t nFlags;
+};
+
+template <uint16_t CAPACITY, typename EVENT = PressEvent>
+class EventJournal {
+public:
+  static_assert(
+    CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+    "Capacity must be a power of 2");
+
+  EventJournal() : m_nHead(0) {}
+
+  // Add an event. Only one caller may add events.
+  void push(const EVENT& event) {
+    uint32_t nHead = m_nHead.load(std::memory_order_relaxed);
+    // The slot holds the oldest event, which stopped being readable when the
+    // head was last advanced. The fence keeps that store from being seen
+    // after the event is overwritten.
+    std::atomic_thread_fence(std::memory_order_release);
+    m_events[nHead & kMask] = event;
+    m_nHead.store(nHead + 1, std::memory_order_release);
+  }
+
+  // Cursor of the next event to be added
+  uint32_t getHead() const { return m_nHead.load(std::memory_order_acquire); }
+
+  // Copy up to nMax events starting at nCursor and advance nCursor past them.
+  // nLost is set to the number of events that were overwritten before they
+  // could be read. A cursor ahead of the journal, e.g. from before a reset,
+  // starts over at the oldest event. Returns the number of events copied.
+  uint16_t read(
+    uint32_t& nCursor,
+    EVENT* aEvents,
+    uint16_t nMax,
+    uint32_t& nLost) const {
+    uint32_t nHead = m_nHead.load(std::memory_order_acquire);
+    nLost = 0;
+    if (nCursor > nHead) {
+      nCursor = oldest(nHead);
+    } else if (nCursor < oldest(nHead)) {
+      nLost = oldest(nHead) - nCursor;
+      nCursor = oldest(nHead);
+    }
+
+    uint16_t nCount = 0;
+    while (nCount < nMax && nCursor + nCount != nHead) {
+      aEvents[nCount] = m_events[(nCursor + nCount) & kMask];
+      nCount++;
+    }
+
+    // Drop events the writer overwrote while they were being copied. As in a
+    // seqlock, the fence keeps the copies above from being reordered after
+    // the load of the head, which an acquire load alone doesn't.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint32_t nOldest = oldest(m_nHead.load(std::memory_order_relaxed));
+    if (nOldest > nCursor) {
+      uint32_t nOverwritten = nOldest - nCursor;
+      if (nOverwritten > nCount) {
+        nOverwritten = nCount;
+      }
+      for (uint16_t n = nOverwritten; n < nCount; n++) {
+        aEvents[n - nOverwritten] = aEvents[n];
+      }
+      nLost += nOverwritten;
+      nCursor += nOverwritten;
+      nCount -= nOverwritten;
+    }
+
+    nCursor += nCount;
+    return nCount;
+  }
+
+private:
+  static const uint32_t kMask = CAPACITY - 1;
+
+  // Oldest event that can be read. The slot of the next event isn't readable
+  // since the writer may be in the middle of filling it in, so the journal
+  // holds CAPACITY - 1 events.
+  static uint32_t oldest(uint32_t nHead) {
+    return nHead >= CAPACITY ? nHead - CAPACITY + 1 : 0;
+  }
+
+  EVENT m_events[CAPACITY];
+  std::atomic<uint32_t> m_nHead; // Sequence number of the next event
+};
@@ -0,0 +1,185 @@
+//
+// Decoder of LED frames streamed by a host.
+//
+// A frame is `~`, a flags byte, the length of the ops as two bytes (low byte
+// first), the ops, and their Fletcher-16 checksum as two bytes (low byte
+// first). Ops walk the LEDs in the order they're stored, strand by strand,
+// each with a count of 1 to 64 LEDs in its low 6 bits:
+//
+//   00nnnnnn            Skip LEDs, which keep their color from the last frame
+//   01nnnnnn R G B      Set LEDs to one color
+//   10nnnnnn R G B ...  Set each LED to its own color
+//
+// Skips make a frame a delta of the last one and runs compress areas of one
+// color, so typical frames are a fraction of the size of the raw colors. A
+// keyframe (kLedFrameKey) starts from black instead, so it doesn't depend on
+// earlier frames having arrived.
+//
+// Colors are written straight into the LED buffer as they're decoded, a byte
+// at a time, so a frame can be fed in slices as it arrives without buffering
+// it. An invalid frame leaves the LEDs partly written.
+//
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+const uint8_t kLedFrameStart = '~';
+
+// Flags
+const uint8_t kLedFrameKey = 0x01;
+
+const uint8_t kLedFrameOpSkip = 0x00;
+const uint8_t kLedFrameOpRun = 0x40;
+const uint8_t kLedFrameOpLiteral = 0x80;
+const uint8_t kLedFrameOpMask = 0xC0;
+const uint8_t kLedFrameMaxCount = 64;
+
+class LedFrameDecoder {
+public:
+  typedef enum {
+    enumFrameIncomplete,
+    enumFrameDone,
+    enumFrameInvalid,
+  } Result;
+
+  LedFrameDecoder() : m_pLeds(NULL), m_nLeds(0), m_nState(kStateIdle) {}
+
+  // Start decoding a frame into nLeds LEDs of 3 bytes each, after its start
+  // byte was read
+  void begin(uint8_t* pLeds, uint16_t nLeds) {
+    m_pLeds = pLeds;
+    m_nLeds = nLeds;
+    m_nState = kStateFlags;
+    m_nFlags = 0;
+    m_nLength = 0;
+    m_nSum1 = 0;
+    m_nSum2 = 0;
+    m_nLed = 0;
+    m_nByte = 0;
+    m_nEnd = 0;
+  }
+
+  // Decode the next byte of the frame
+  Result feed(uint8_t nByte) {
+    switch (m_nState) {
+    case kStateFlags:
+      m_nFlags = nByte;
+      if (m_nFlags & kLedFrameKey) {
+        memset(m_pLeds, 0, m_nLeds * 3);
+      }
+      m_nState = kStateLengthLow;
+      return enumFrameIncomplete;
+
+    case kStateLengthLow:
+      m_nLength = nByte;
+      m_nState = kStateLengthHigh;
+      return enumFrameIncomplete;
+
+    case kStateLengthHigh:
+      m_nLength |= static_cast<uint16_t>(nByte) << 8;
+      m_nState = m_nLength ? kStateOp : kStateCheckLow;
+      return enumFrameIncomplete;
+
+    case kStateCheckLow:
+      if (nByte != m_nSum1) {
+        return fail();
+      }
+      m_nState = kStateCheckHigh;
+      return enumFrameIncomplete;
+
+    case kStateCheckHigh:
+      m_nState = kStateIdle;
+      return nByte == m_nSum2 ? enumFrameDone : enumFrameInvalid;
+
+    case kStateIdle:
+      return enumFrameInvalid;
+
+    default:
+      break;
+    }
+
+    // Everything else is part of the ops
+    m_nSum1 = (m_nSum1 + nByte) % 255;
+    m_nSum2 = (m_nSum2 + m_nSum1) % 255;
+    m_nLength--;
+
+    if (m_nState == kStateOp) {
+      uint16_t nCount = (nByte & (kLedFrameMaxCount - 1)) + 1;
+      if (m_nLed + nCount > m_nLeds) {
+        return fail();
+      }
+      m_nEnd = (m_nLed + nCount) * 3;
+      m_nByte = m_nLed * 3;
+      m_nLed += nCount;
+      switch (nByte & kLedFrameOpMask) {
+      case kLedFrameOpSkip:
+        m_nState = kStateOp;
+        break;
+      case kLedFrameOpRun:
+        m_nState = kStateRun;
+        break;
+      case kLedFrameOpLiteral:
+        m_nState = kStateLiteral;
+        break;
+      default:
+        return fail();
+      }
+    } else if (m_nState == kStateLiteral) {
+      m_pLeds[m_nByte++] = nByte;
+      if (m_nByte == m_nEnd) {
+        m_nState = kStateOp;
+      }
+    } else {
+      // The first LED of a run gets the color, which is then repeated
+      m_pLeds[m_nByte++] = nByte;
+      if (m_nByte % 3 == 0) {
+        for (uint16_t n = m_nByte; n < m_nEnd; n++) {
+          m_pLeds[n] = m_pLeds[n - 3];
+        }
+        m_nState = kStateOp;
+      }
+    }
+
+    if (!m_nLength) {
+      // Ops must not end in the middle of one
+      if (m_nState != kStateOp) {
+        return fail();
+      }
+      m_nState = kStateCheckLow;
+    }
+    return enumFrameIncomplete;
+  }
+
+  // Whether the frame being decoded, or the last one, is a keyframe
+  bool isKey() const { return m_nFlags & kLedFrameKey; }
+
+  bool isDecoding() const { return m_nState != kStateIdle; }
+
+private:
+  enum {
+    kStateIdle,
+    kStateFlags,
+    kStateLengthLow,
+    kStateLengthHigh,
+    kStateOp,
+    kStateRun,
+    kStateLiteral,
+    kStateCheckLow,
+    kStateCheckHigh,
+  };
+
+  Result fail() {
+    m_nState = kStateIdle;
+    return enumFrameInvalid;
+  }
+
+  uint8_t* m_pLeds;
+  uint16_t m_nLeds;
+  uint8_t m_nState;
+  uint8_t m_nFlags;
+  uint16_t m_nLength; // Bytes of ops left
+  uint16_t m_nSum1, m_nSum2;
+  uint16_t m_nLed;  // First LED after the current op
+  uint16_t m_nByte; // Next byte of the LEDs to write
+  uint16_t m_nEnd;  // Byte after the LEDs of the current op
+};
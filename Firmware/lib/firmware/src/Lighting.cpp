@@ -3,52 +3,73 @@
 
 #include "Config.h"
 #include "Lighting.h"
+#include "Log.h"
 
-#define NUM_LEDS_PER_STRIP 25
-#define NUM_STRIPS         4
-#define NUM_LEDS           NUM_LEDS_PER_STRIP* NUM_STRIPS
-#define COLOR_ORDER        GRB
+#define COLOR_ORDER GRB
 
-static CRGB s_ledsRaw[NUM_LEDS];
-static CRGB s_ledsCorrected[NUM_LEDS];
+// Streamed frames are decoded straight into the LEDs as bytes
+static_assert(
+  sizeof(CRGB) == 3, "LEDs must be stored as packed red, green, and blue");
 
-// Any group of digital pins may be used by OctoWS2811 on the Teensy 4.1
-#define PIN_UP_LED    2
-#define PIN_DOWN_LED  3
-#define PIN_LEFT_LED  4
-#define PIN_RIGHT_LED 5
+static CRGB s_ledsRaw[kMaxLeds];
+static CRGB s_ledsCorrected[kMaxLeds];
 
-const byte pinList[NUM_STRIPS] = {
-  PIN_UP_LED, PIN_DOWN_LED, PIN_LEFT_LED, PIN_RIGHT_LED};
+// Topology used by the controller. See Lights::readTopology().
+static uint8_t s_anPins[kMaxStrands];
+static uint8_t s_nStrands = 0;
+static uint8_t s_nLedsPerStrand = 0;
+
+// Bit per strand with LEDs that changed since they were last sent
+static uint8_t s_nDirtyStrands = 0;
+
+// Bit per strand with LEDs that changed since their colors were corrected
+static uint8_t s_nChangedStrands = 0;
+
+// Bit per strand that may have LEDs lit other than those of enabled groups.
+// Only these strands are faded by Lights::update(), so strands that are black
+// or only show held arrows aren't touched.
+static uint8_t s_nFadingStrands = 0;
+
+// Any group of digital pins may be used by OctoWS2811 on the Teensy 4.1. By
+// default each arrow is on its own strand.
+static const char* const kDefaultPins = "2;3;4;5";
+static const char* const kDefaultLayout = "0:0:0:25;1:1:0:25;2:2:0:25;3:3:0:25";
 
 // These buffers need to be large enough for all the pixels. The total number of
 // pixels is "ledsPerStrip * numPins". Each pixel needs 3 bytes, so multiply
 // by 3. An "int" is 4 bytes, so divide by 4. The array is created using "int"
 // so the compiler will align it to 32 bit memory.
 
-static DMAMEM int displayMemory[NUM_LEDS * 3 / 4];
-static int drawingMemory[NUM_LEDS * 3 / 4];
+static DMAMEM int displayMemory[kMaxLeds * 3 / 4];
+static int drawingMemory[kMaxLeds * 3 / 4];
 
 template <EOrder RGB_ORDER>
 class MyController : public CPixelLEDController<RGB_ORDER> {
 public:
-  MyController() : m_pOcto(NULL) {
-    Serial.println("Octo2811B Controller for Teensy 4.1");
-  }
+  MyController() : m_pOcto(NULL) {}
 
   virtual void init() { /* do nothing yet */ }
 
+  // Only strands that changed are copied into the drawing buffer. The others
+  // still hold what was sent last time.
   virtual void showPixels(PixelController<RGB_ORDER>& pixels) {
     _init(pixels.size());
 
     uint8_t* p = m_pDrawbuffer;
 
-    while (pixels.has(1)) {
-      *p++ = pixels.loadAndScale0();
-      *p++ = pixels.loadAndScale1();
-      *p++ = pixels.loadAndScale2();
-      pixels.stepDithering();
-      pixels.advanceData();
+    for (uint8_t nStrand = 0; nStrand < s_nStrands; nStrand++) {
+      bool bDirty = s_nDirtyStrands & (1 << nStrand);
+      for (uint8_t nLED = 0; nLED < s_nLedsPerStrand && pixels.has(1);
+           nLED++) {
+        if (bDirty) {
+          p[0] = pixels.loadAndScale0();
+          p[1] = pixels.loadAndScale1();
+          p[2] = pixels.loadAndScale2();
+        }
+        p += 3;
+        pixels.stepDithering();
+        pixels.advanceData();
+      }
     }
 
     m_pOcto->show();
@@ -67,13 +88,14 @@ private:
     // nLeds is the total number of LEDs, but we want the number used by
     // each strip.
     m_pOcto = new OctoWS2811(
-      NUM_LEDS_PER_STRIP,
+      nLeds / s_nStrands,
       m_pFramebuffer,
       m_pDrawbuffer,
       config,
-      NUM_STRIPS,
-      pinList);
+      s_nStrands,
+      s_anPins);
     m_pOcto->begin();
+    LOG_INFO(kLogLedController, s_nStrands, nLeds / s_nStrands);
   }
 
   OctoWS2811* m_pOcto;
@@ -82,13 +104,40 @@ private:
 
 static MyController<GRB> s_controller;
 
-static const String s_strColorUp("color_up");
-static const String s_strColorDown("color_down");
-static const String s_strColorLeft("color_left");
-static const String s_strColorRight("color_right");
+// Config names
+static const String s_astrColor[kNumLightGroups] = {
+  "color_up",
+  "color_down",
+  "color_left",
+  "color_right",
+  "color_upper_left",
+  "color_upper_right",
+  "color_center",
+  "color_lower_left",
+  "color_lower_right",
+};
 static const String s_strBrightness("brightness");
+static const char* const kPinsSetting = "led_pins";
+static const char* const kLayoutSetting = "led_layout";
+
 static const Lights::Color s_colorBlue(0x18, 0, 0xff);
 static const Lights::Color s_colorMag(0xeb, 0, 0x9b);
+static const Lights::Color s_colorWhite(0xff, 0xff, 0xff);
+
+// Default color and cell in the 3x3 grid of panels of each light group
+static const Lights::Color s_aDefaultColor[kNumLightGroups] = {
+  s_colorMag,
+  s_colorMag,
+  s_colorBlue,
+  s_colorBlue,
+  s_colorWhite,
+  s_colorWhite,
+  s_colorWhite,
+  s_colorWhite,
+  s_colorWhite,
+};
+static const uint8_t s_anGroupCell[kNumLightGroups] = {
+  1, 7, 3, 5, 0, 2, 4, 6, 8};
 
 static const uint8_t s_gamma8[] = {
   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
@@ -111,6 +160,30 @@ static const uint8_t s_gamma8[] = {
   255,
 };
 
+// Whether an LED shows anything once its color is corrected
+static inline bool isVisible(const CRGB& led) {
+  return s_gamma8[led.r] || s_gamma8[led.g] || s_gamma8[led.b];
+}
+
+// Amount out of 256 that LEDs of released groups fade by on each update
+static const uint8_t kFadeBy = 20;
+
+// Fade the LEDs of a strand. Returns true if their corrected colors changed,
+// as the low end of the gamma curve maps several raw levels to one.
+static bool fadeStrand(uint8_t nStrand) {
+  CRGB* pLED = s_ledsRaw + nStrand * s_nLedsPerStrand;
+  bool bChanged = false;
+  for (uint8_t nLED = 0; nLED < s_nLedsPerStrand; nLED++) {
+    CRGB faded = pLED[nLED];
+    faded.nscale8(255 - kFadeBy);
+    bChanged |= s_gamma8[faded.r] != s_gamma8[pLED[nLED].r] ||
+                s_gamma8[faded.g] != s_gamma8[pLED[nLED].g] ||
+                s_gamma8[faded.b] != s_gamma8[pLED[nLED].b];
+    pLED[nLED] = faded;
+  }
+  return bChanged;
+}
+
 Lights* Lights::m_pInst = NULL;
 
 Lights* Lights::getInstance() {
@@ -124,72 +197,389 @@ Lights* Lights::getInstance() {
 static void OnConfigUpdated() { Lights::getInstance()->updateColors(); }
 
 Lights::Lights()
-    : m_bUp(false), m_bDown(false), m_bLeft(false), m_bRight(false) {
+    : m_nSegments(0), m_nShownBrightness(0), m_bShown(false),
+      m_nFramesSent(0), m_nFramesSkipped(0), m_nFlashes(0), m_nShownUS(0),
+      m_nFlashStrands(0), m_bStreamSynced(false),
+      m_nStreamedMS(0), m_nStreamedFrames(0), m_nDroppedFrames(0) {
+  memset(m_abEnabled, 0, sizeof(m_abEnabled));
+
+  Configuration* pConfig = Configuration::getInstance();
+  for (uint8_t nGroup = 0; nGroup < kNumLightGroups; nGroup++) {
+    pConfig->setRange(s_astrColor[nGroup], 0, 0xFFFFFF);
+  }
+  pConfig->setRange(s_strBrightness, 0, 255);
+
+  readTopology();
   updateColors();
 
-  FastLED.addLeds(&s_controller, s_ledsCorrected, NUM_LEDS)
+  FastLED
+    .addLeds(&s_controller, s_ledsCorrected, s_nStrands * s_nLedsPerStrand)
     .setCorrection(TypicalLEDStrip);
   FastLED.setMaxRefreshRate(0); // We will constrain this ourselves
 
+  // Frames are only sent when they change, so dithering would freeze
+  FastLED.setDither(DISABLE_DITHER);
+
   Configuration::getInstance()->registerCallback(OnConfigUpdated);
 }
 
+void Lights::readTopology() {
+  Configuration* pConfig = Configuration::getInstance();
+  if (
+    !parsePins(pConfig->getString(kPinsSetting, kDefaultPins)) ||
+    !parseLayout(pConfig->getString(kLayoutSetting, kDefaultLayout))) {
+    parsePins(kDefaultPins);
+    parseLayout(kDefaultLayout);
+  }
+}
+
+// Pins are separated by `;`
+bool Lights::parsePins(const String& str) {
+  s_nStrands = 0;
+  int nStart = 0;
+  while (nStart < static_cast<int>(str.length())) {
+    int nEnd = str.indexOf(';', nStart);
+    if (nEnd < 0) {
+      nEnd = str.length();
+    }
+    if (s_nStrands == kMaxStrands) {
+      return false;
+    }
+
+    long nPin = str.substring(nStart, nEnd).toInt();
+    if (nPin < 0 || nPin > 255) {
+      return false;
+    }
+    s_anPins[s_nStrands++] = nPin;
+    nStart = nEnd + 1;
+  }
+  return s_nStrands > 0;
+}
+
+// Segments are separated by `;`, each `GROUP:STRAND:OFFSET:COUNT[:X:Y:DX:DY]`.
+// Without a position, all LEDs are at the center of the group's panel.
+bool Lights::parseLayout(const String& str) {
+  m_nSegments = 0;
+  s_nLedsPerStrand = 0;
+  int nStart = 0;
+  while (nStart < static_cast<int>(str.length())) {
+    int nEnd = str.indexOf(';', nStart);
+    if (nEnd < 0) {
+      nEnd = str.length();
+    }
+    if (m_nSegments == kMaxLightSegments) {
+      return false;
+    }
+
+    long anField[8];
+    uint8_t nFields = 0;
+    while (nStart <= nEnd && nFields < 8) {
+      int nSeparator = str.indexOf(':', nStart);
+      if (nSeparator < 0 || nSeparator > nEnd) {
+        nSeparator = nEnd;
+      }
+      anField[nFields++] = str.substring(nStart, nSeparator).toInt();
+      nStart = nSeparator + 1;
+    }
+    if (nStart <= nEnd || (nFields != 4 && nFields != 8)) {
+      return false;
+    }
+
+    LightSegment& segment = m_aSegments[m_nSegments];
+    if (
+      anField[0] < 0 || anField[0] >= kNumLightGroups || anField[1] < 0 ||
+      anField[1] >= s_nStrands || anField[2] < 0 || anField[3] < 1 ||
+      anField[2] + anField[3] > kMaxLedsPerStrand) {
+      return false;
+    }
+    segment.nGroup = anField[0];
+    segment.nStrand = anField[1];
+    segment.nOffset = anField[2];
+    segment.nCount = anField[3];
+    if (nFields == 8) {
+      segment.nX = anField[4];
+      segment.nY = anField[5];
+      segment.nStepX = anField[6];
+      segment.nStepY = anField[7];
+    } else {
+      uint8_t nCell = s_anGroupCell[segment.nGroup];
+      segment.nX = (nCell % 3) * kPanelSize + kPanelSize / 2;
+      segment.nY = (nCell / 3) * kPanelSize + kPanelSize / 2;
+      segment.nStepX = 0;
+      segment.nStepY = 0;
+    }
+
+    if (segment.nOffset + segment.nCount > s_nLedsPerStrand) {
+      s_nLedsPerStrand = segment.nOffset + segment.nCount;
+    }
+    m_nSegments++;
+  }
+  return m_nSegments > 0;
+}
+
 void Lights::updateColors() {
-  s_colorUp.fromUInt32(Configuration::getInstance()->getUInt32(
-    s_strColorUp, s_colorMag.toUInt32()));
-  s_colorDown.fromUInt32(Configuration::getInstance()->getUInt32(
-    s_strColorDown, s_colorMag.toUInt32()));
-  s_colorLeft.fromUInt32(Configuration::getInstance()->getUInt32(
-    s_strColorLeft, s_colorBlue.toUInt32()));
-  s_colorRight.fromUInt32(Configuration::getInstance()->getUInt32(
-    s_strColorRight, s_colorBlue.toUInt32()));
-  FastLED.setBrightness(static_cast<uint8_t>(
-    Configuration::getInstance()->getUInt16(s_strBrightness, 200)));
+  Configuration* pConfig = Configuration::getInstance();
+  for (uint8_t nGroup = 0; nGroup < kNumLightGroups; nGroup++) {
+    m_aColor[nGroup].fromUInt32(pConfig->getUInt32(
+      s_astrColor[nGroup], s_aDefaultColor[nGroup].toUInt32()));
+  }
+  FastLED.setBrightness(
+    static_cast<uint8_t>(pConfig->getUInt16(s_strBrightness, 200)));
+}
+
+void Lights::setColors(const uint32_t* anColor, uint8_t nBrightness) {
+  for (uint8_t nArrow = 0; nArrow < kNumArrows; nArrow++) {
+    m_aColor[nArrow].fromUInt32(anColor[nArrow]);
+  }
+  FastLED.setBrightness(nBrightness);
+}
+
+void Lights::storeColors() const {
+  Configuration* pConfig = Configuration::getInstance();
+  for (uint8_t nArrow = 0; nArrow < kNumArrows; nArrow++) {
+    pConfig->setUInt32(
+      s_astrColor[nArrow], m_aColor[nArrow].toUInt32(), false);
+  }
+  pConfig->setUInt16(s_strBrightness, FastLED.getBrightness(), false);
+}
+
+uint32_t Lights::getColor(lightIdentifier_t id) const {
+  return id < kNumLightGroups ? m_aColor[id].toUInt32() : 0;
 }
 
 void Lights::illuminateStrip(lightIdentifier_t id, const CRGB& color) {
-  for (int nLED = 0; nLED < NUM_LEDS_PER_STRIP; nLED++) {
-    s_ledsRaw[(int)id * NUM_LEDS_PER_STRIP + nLED] = color;
+  // The group may not be enabled, so its LEDs fade on the next update()
+  s_nFadingStrands |= fillGroup(id, color);
+}
+
+uint8_t Lights::fillGroup(lightIdentifier_t id, const CRGB& color) {
+  uint8_t nChanged = 0;
+  for (uint8_t nSegment = 0; nSegment < m_nSegments; nSegment++) {
+    const LightSegment& segment = m_aSegments[nSegment];
+    if (segment.nGroup != id) {
+      continue;
+    }
+    CRGB* pLED =
+      s_ledsRaw + segment.nStrand * s_nLedsPerStrand + segment.nOffset;
+    for (uint8_t nLED = 0; nLED < segment.nCount; nLED++) {
+      if (pLED[nLED] != color) {
+        pLED[nLED] = color;
+        nChanged |= 1 << segment.nStrand;
+      }
+    }
+  }
+  s_nChangedStrands |= nChanged;
+  return nChanged;
+}
+
+uint8_t Lights::getGroupStrands(lightIdentifier_t id) const {
+  uint8_t nStrands = 0;
+  for (uint8_t nSegment = 0; nSegment < m_nSegments; nSegment++) {
+    if (m_aSegments[nSegment].nGroup == id) {
+      nStrands |= 1 << m_aSegments[nSegment].nStrand;
+    }
   }
+  return nStrands;
 }
 
 void Lights::setStatus(lightIdentifier_t id, bool bEnabled) {
-  if (id == enumLightsUpArrow) {
-    m_bUp = bEnabled;
-  } else if (id == enumLightsDownArrow) {
-    m_bDown = bEnabled;
-  } else if (id == enumLightsLeftArrow) {
-    m_bLeft = bEnabled;
-  } else if (id == enumLightsRightArrow) {
-    m_bRight = bEnabled;
+  if (id >= kNumLightGroups) {
+    return;
   }
+  if (m_abEnabled[id] && !bEnabled) {
+    s_nFadingStrands |= getGroupStrands(id);
+  }
+  m_abEnabled[id] = bEnabled;
 }
 
-void Lights::colorCorrect() const {
-  for (int nLED = 0; nLED < NUM_LEDS; nLED++) {
-    const CRGB& src = s_ledsRaw[nLED];
-    CRGB& dst = s_ledsCorrected[nLED];
-    dst.r = s_gamma8[src.r];
-    dst.g = s_gamma8[src.g];
-    dst.b = s_gamma8[src.b];
+void Lights::colorCorrect(uint8_t nStrands) const {
+  for (uint8_t nStrand = 0; nStrand < s_nStrands; nStrand++) {
+    if (!(nStrands & (1 << nStrand))) {
+      continue;
+    }
+    const CRGB* pRaw = s_ledsRaw + nStrand * s_nLedsPerStrand;
+    CRGB* pCorrected = s_ledsCorrected + nStrand * s_nLedsPerStrand;
+    for (uint8_t nLED = 0; nLED < s_nLedsPerStrand; nLED++) {
+      pCorrected[nLED].setRGB(
+        s_gamma8[pRaw[nLED].r], s_gamma8[pRaw[nLED].g], s_gamma8[pRaw[nLED].b]);
+    }
   }
+  s_nDirtyStrands |= nStrands;
+  s_nChangedStrands &= ~nStrands;
 }
 
 void Lights::update() {
-  fadeToBlackBy(s_ledsRaw, NUM_LEDS, 20);
+  if (isStreaming()) {
+    return;
+  }
+
+  for (uint8_t nStrand = 0; nStrand < s_nStrands; nStrand++) {
+    if ((s_nFadingStrands & (1 << nStrand)) && fadeStrand(nStrand)) {
+      s_nChangedStrands |= 1 << nStrand;
+    }
+  }
+
+  // Enabled groups hold their LEDs lit
+  uint8_t anHeld[kMaxStrands] = {};
+  for (uint8_t nGroup = 0; nGroup < kNumLightGroups; nGroup++) {
+    if (m_abEnabled[nGroup]) {
+      fillGroup(static_cast<lightIdentifier_t>(nGroup), m_aColor[nGroup]);
+    }
+  }
+  for (uint8_t nSegment = 0; nSegment < m_nSegments; nSegment++) {
+    const LightSegment& segment = m_aSegments[nSegment];
+    if (m_abEnabled[segment.nGroup] && isVisible(m_aColor[segment.nGroup])) {
+      anHeld[segment.nStrand] += segment.nCount;
+    }
+  }
+
+  // A strand stops fading once the only LEDs it shows are those held. LEDs
+  // too dim to show keep their level until the strand fades again.
+  for (uint8_t nStrand = 0; nStrand < s_nStrands; nStrand++) {
+    if (!(s_nFadingStrands & (1 << nStrand))) {
+      continue;
+    }
+    const CRGB* pLED = s_ledsRaw + nStrand * s_nLedsPerStrand;
+    uint8_t nVisible = 0;
+    for (uint8_t nLED = 0; nLED < s_nLedsPerStrand; nLED++) {
+      if (isVisible(pLED[nLED])) {
+        nVisible++;
+      }
+    }
+    if (nVisible == anHeld[nStrand]) {
+      s_nFadingStrands &= ~(1 << nStrand);
+    }
+  }
+
+  colorCorrect(s_nChangedStrands);
+}
+
+bool Lights::show() {
+  if (
+    !s_nDirtyStrands && m_bShown &&
+    FastLED.getBrightness() == m_nShownBrightness) {
+    m_nFramesSkipped++;
+    return false;
+  }
+  if (!isReady()) {
+    return false;
+  }
+
+  send();
+  m_nFramesSent++;
+  return true;
+}
+
+void Lights::illuminateNow(lightIdentifier_t id) {
+  if (id >= kNumLightGroups || isStreaming()) {
+    return;
+  }
+  m_abEnabled[id] = true;
+  uint8_t nChanged = fillGroup(id, m_aColor[id]);
+  colorCorrect(nChanged);
+  m_nFlashStrands |= nChanged;
+}
+
+bool Lights::isFlashPending() const { return m_nFlashStrands != 0; }
 
-  if (m_bUp) {
-    illuminateStrip(enumLightsUpArrow, s_colorUp);
+bool Lights::flash() {
+  if (!m_nFlashStrands || !isReady()) {
+    return false;
   }
-  if (m_bDown) {
-    illuminateStrip(enumLightsDownArrow, s_colorDown);
+
+  // Other strands that changed since the last frame go out with it as well
+  send();
+  m_nFlashes++;
+  return true;
+}
+
+uint32_t Lights::getFrameTimeUS() const {
+  return static_cast<uint32_t>(s_nLedsPerStrand) * kLedSendUS + kLedResetUS;
+}
+
+bool Lights::isReady() const {
+  return !m_bShown || micros() - m_nShownUS >= getFrameTimeUS();
+}
+
+void Lights::send() {
+  // Brightness is applied while sending, so a change affects every strand
+  if (!m_bShown || FastLED.getBrightness() != m_nShownBrightness) {
+    s_nDirtyStrands = (1 << s_nStrands) - 1;
   }
-  if (m_bLeft) {
-    illuminateStrip(enumLightsLeftArrow, s_colorLeft);
+
+  FastLED.show();
+  s_nDirtyStrands = 0;
+  m_nFlashStrands = 0;
+  m_nShownBrightness = FastLED.getBrightness();
+  m_nShownUS = micros();
+  m_bShown = true;
+}
+
+LedFrameDecoder& Lights::beginFrame() {
+  m_frameDecoder.begin(
+    reinterpret_cast<uint8_t*>(s_ledsRaw), s_nStrands * s_nLedsPerStrand);
+  return m_frameDecoder;
+}
+
+void Lights::endFrame(LedFrameDecoder::Result result) {
+  if (result != LedFrameDecoder::enumFrameDone) {
+    m_bStreamSynced = false;
+  } else if (m_frameDecoder.isKey()) {
+    m_bStreamSynced = true;
   }
-  if (m_bRight) {
-    illuminateStrip(enumLightsRightArrow, s_colorRight);
+
+  if (result != LedFrameDecoder::enumFrameDone || !m_bStreamSynced) {
+    m_nDroppedFrames++;
+    LOG_WARN(kLogFrameDropped, m_nDroppedFrames, m_nStreamedFrames);
+    return;
   }
+  uint8_t nAllStrands = (1 << s_nStrands) - 1;
+  colorCorrect(nAllStrands);
+  // Fade whatever the stream left lit once it stops
+  s_nFadingStrands = nAllStrands;
+  m_nStreamedMS = millis();
+  m_nStreamedFrames++;
+}
 
-  colorCorrect();
+bool Lights::isStreaming() const {
+  return m_nStreamedFrames > 0 && millis() - m_nStreamedMS < kStreamTimeoutMS;
 }
+
+uint32_t Lights::getStreamedFrames() const { return m_nStreamedFrames; }
+
+uint32_t Lights::getDroppedFrames() const { return m_nDroppedFrames; }
+
+uint8_t Lights::getNumStrands() const { return s_nStrands; }
+
+uint8_t Lights::getLedsPerStrand() const { return s_nLedsPerStrand; }
+
+uint8_t Lights::getNumSegments() const { return m_nSegments; }
+
+const LightSegment& Lights::getSegment(uint8_t nSegment) const {
+  return m_aSegments[nSegment];
+}
+
+bool Lights::getLedPosition(
+  uint8_t nStrand,
+  uint8_t nLed,
+  int16_t& nX,
+  int16_t& nY) const {
+  for (uint8_t nSegment = 0; nSegment < m_nSegments; nSegment++) {
+    const LightSegment& segment = m_aSegments[nSegment];
+    if (
+      segment.nStrand == nStrand && nLed >= segment.nOffset &&
+      nLed < segment.nOffset + segment.nCount) {
+      uint8_t nIndex = nLed - segment.nOffset;
+      nX = segment.nX + segment.nStepX * nIndex;
+      nY = segment.nY + segment.nStepY * nIndex;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t Lights::getFramesSent() const { return m_nFramesSent; }
+
+uint32_t Lights::getFramesSkipped() const { return m_nFramesSkipped; }
+
+uint32_t Lights::getFlashes() const { return m_nFlashes; }
@@ -1,23 +1,70 @@
 //
 // Code to control lights.
 //
+// LEDs are driven on up to kMaxStrands strands in parallel. Light groups, such
+// as the LEDs of an arrow panel, are mapped to runs of LEDs on the strands by
+// the `led_pins` and `led_layout` configuration items, which are read at boot.
+// Buffers are sized at compile time for the largest topology.
+//
 #pragma once
 #include <FastLED.h>
 #include <cstdint>
 
+#include "LedFrame.h"
+
+// Groups of lights controlled together. Arrows come first, in the same order
+// as the panels of a profile.
 typedef enum lightIdentifier {
   enumLightsUpArrow,
   enumLightsDownArrow,
   enumLightsLeftArrow,
   enumLightsRightArrow,
+  enumLightsUpperLeft,
+  enumLightsUpperRight,
+  enumLightsCenter,
+  enumLightsLowerLeft,
+  enumLightsLowerRight,
 } lightIdentifier_t;
 
+const uint8_t kNumLightGroups = enumLightsLowerRight + 1;
+const uint8_t kNumArrows = enumLightsRightArrow + 1;
+
+// Largest LED topology
+const uint8_t kMaxStrands = 8;
+const uint8_t kMaxLedsPerStrand = 64;
+const uint16_t kMaxLeds = kMaxStrands * kMaxLedsPerStrand;
+const uint8_t kMaxLightSegments = 16;
+
+// Size of a panel in the units of LED positions. Positions are in the pad's
+// frame, with x to the right and y towards the front, starting at the back
+// left corner of the upper left panel.
+const int16_t kPanelSize = 256;
+
+// Time to send one LED of a strand at 800 kHz and the idle time the LEDs need
+// to latch a frame before the next one can start
+const uint16_t kLedSendUS = 30;
+const uint16_t kLedResetUS = 300;
+
+// Frames streamed by the host replace the lights until none has been shown for
+// this long
+const uint16_t kStreamTimeoutMS = 1000;
+
+// Run of consecutive LEDs on a strand belonging to a light group
+struct LightSegment {
+  uint8_t nGroup;
+  uint8_t nStrand;
+  uint8_t nOffset; // Index of the first LED on the strand
+  uint8_t nCount;
+  int16_t nX, nY;         // Position of the first LED
+  int16_t nStepX, nStepY; // Distance from each LED to the next
+};
+
 class Lights {
 public:
   // Get singleton instance
   static Lights* getInstance();
 
-  // Set all LEDs in a strip to a color
+  // Set all LEDs in a group to a color
   void illuminateStrip(lightIdentifier_t id, const CRGB& color);
 
   // Set lights as enabled or disabled
@@ -26,9 +73,77 @@ public:
   // Get color values from config
   void updateColors();
 
+  // Set the color of each arrow and the brightness without going through the
+  // configuration
+  void setColors(const uint32_t* anColor, uint8_t nBrightness);
+
+  // Copy the colors of the arrows and the brightness into the configuration
+  // without calling its callbacks
+  void storeColors() const;
+
+  uint32_t getColor(lightIdentifier_t id) const;
+
   // Illuminate and fade the current LEDs in all strips
   void update();
 
+  // Send the LEDs to the strands if any of them changed since they were last
+  // sent. Returns false if nothing was sent, including when the previous frame
+  // is still being sent, in which case the changes are sent next time.
+  bool show();
+
+  // Turn on a group and its LEDs right away instead of on the next update(),
+  // correcting the colors of only the strands it's on. Call flash() to send
+  // them. Does nothing while streaming.
+  void illuminateNow(lightIdentifier_t id);
+
+  // Whether strands changed by illuminateNow() are waiting to be sent
+  bool isFlashPending() const;
+
+  // Send the strands changed by illuminateNow() as soon as the previous frame
+  // has been sent and latched. Returns false if it hasn't been yet.
+  bool flash();
+
+  // Time to send a frame to the strands and for the LEDs to latch it
+  uint32_t getFrameTimeUS() const;
+
+  uint8_t getNumStrands() const;
+
+  // Length of the longest strand. All strands are sent with this many LEDs.
+  uint8_t getLedsPerStrand() const;
+
+  uint8_t getNumSegments() const;
+  const LightSegment& getSegment(uint8_t nSegment) const;
+
+  // Get the position of an LED by its index on a strand. Returns false if the
+  // LED isn't part of any light group.
+  bool getLedPosition(
+    uint8_t nStrand,
+    uint8_t nLed,
+    int16_t& nX,
+    int16_t& nY) const;
+
+  // Number of calls to show() that sent or skipped a frame
+  uint32_t getFramesSent() const;
+  uint32_t getFramesSkipped() const;
+  uint32_t getFlashes() const; // Frames sent by flash()
+
+  // Start decoding a frame streamed by the host straight into the LEDs. See
+  // LedFrame.h. Feed the frame's bytes after its start byte to the decoder,
+  // then pass the result to endFrame().
+  LedFrameDecoder& beginFrame();
+
+  // Correct the colors of a decoded frame so the next show() sends it. Frames
+  // after an invalid one are dropped until the next keyframe, since they may
+  // be deltas of LEDs that were left partly written.
+  void endFrame(LedFrameDecoder::Result result);
+
+  // Whether a streamed frame was shown in the last kStreamTimeoutMS. While
+  // streaming, update() leaves the LEDs alone.
+  bool isStreaming() const;
+
+  uint32_t getStreamedFrames() const;
+  uint32_t getDroppedFrames() const; // Invalid, or waiting for a keyframe
+
   struct Color : CRGB {
     using CRGB::CRGB;
 
@@ -44,12 +159,43 @@ private:
 
   Lights();
 
-  Color s_colorUp;
-  Color s_colorDown;
-  Color s_colorLeft;
-  Color s_colorRight;
+  // Read the strand pins and segments from the configuration, falling back to
+  // an arrow per strand if they aren't valid
+  void readTopology();
+  bool parsePins(const String& str);
+  bool parseLayout(const String& str);
+
+  Color m_aColor[kNumLightGroups];
+  bool m_abEnabled[kNumLightGroups];
+
+  LightSegment m_aSegments[kMaxLightSegments];
+  uint8_t m_nSegments;
+
+  uint8_t m_nShownBrightness;
+  bool m_bShown; // Has a frame been sent?
+  uint32_t m_nFramesSent;
+  uint32_t m_nFramesSkipped;
+  uint32_t m_nFlashes;
+  uint32_t m_nShownUS; // When the last frame started being sent
+  uint8_t m_nFlashStrands; // Bit per strand changed by illuminateNow()
+
+  LedFrameDecoder m_frameDecoder;
+  bool m_bStreamSynced; // Has a keyframe been decoded since the last error?
+  uint32_t m_nStreamedMS;
+  uint32_t m_nStreamedFrames;
+  uint32_t m_nDroppedFrames;
+
+  // Set the LEDs of a group to a color. Returns a bit per strand that changed.
+  uint8_t fillGroup(lightIdentifier_t id, const CRGB& color);
+
+  // Bit per strand with LEDs of a group
+  uint8_t getGroupStrands(lightIdentifier_t id) const;
+
+  // Correct the colors of the strands in a mask and mark them to be sent
+  void colorCorrect(uint8_t nStrands) const;
 
-  bool m_bUp, m_bDown, m_bLeft, m_bRight;
+  // Whether the previous frame has been sent and latched
+  bool isReady() const;
 
-  void colorCorrect() const;
+  void send();
 };
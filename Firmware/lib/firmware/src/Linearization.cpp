@@ -0,0 +1,80 @@
+#include "Linearization.h"
+
+// Largest value of a point, which is given for a 10-bit reading
+static const long kMaxValue = 1023;
+
+Linearization::Linearization() : m_nPoints(0) {}
+
+bool Linearization::parse(const String& str, uint8_t nShift) {
+  clear();
+
+  uint8_t nPoints = parsePoints(str, m_pX, m_pY);
+  if (nPoints == 0) {
+    return false;
+  }
+
+  for (uint8_t nPoint = 0; nPoint < nPoints; nPoint++) {
+    m_pX[nPoint] <<= nShift;
+    m_pY[nPoint] <<= nShift;
+  }
+  for (uint8_t nPoint = 0; nPoint + 1 < nPoints; nPoint++) {
+    m_pSlope[nPoint] = static_cast<int32_t>(
+      (static_cast<int64_t>(m_pY[nPoint + 1]) - m_pY[nPoint]) * 65536 /
+      (m_pX[nPoint + 1] - m_pX[nPoint]));
+  }
+  m_nPoints = nPoints;
+
+  return true;
+}
+
+uint8_t
+Linearization::parsePoints(const String& str, uint16_t* pX, uint16_t* pY) {
+  uint8_t nPoints = 0;
+  int nStart = 0;
+  while (nStart < static_cast<int>(str.length())) {
+    int nEnd = str.indexOf(';', nStart);
+    if (nEnd < 0) {
+      nEnd = str.length();
+    }
+
+    int nSeparator = str.indexOf(':', nStart);
+    if (nSeparator < 0 || nSeparator > nEnd || nPoints == kMaxPoints) {
+      return 0;
+    }
+
+    long nX = str.substring(nStart, nSeparator).toInt();
+    long nY = str.substring(nSeparator + 1, nEnd).toInt();
+    if (
+      nX < 0 || nX > kMaxValue || nY < 0 || nY > kMaxValue ||
+      (nPoints > 0 && nX <= pX[nPoints - 1])) {
+      return 0;
+    }
+
+    pX[nPoints] = nX;
+    pY[nPoints] = nY;
+    nPoints++;
+    nStart = nEnd + 1;
+  }
+
+  return nPoints < 2 ? 0 : nPoints;
+}
+
+String Linearization::formatPoints(
+  uint8_t nPoints,
+  const uint16_t* pX,
+  const uint16_t* pY) {
+  String str;
+  for (uint8_t nPoint = 0; nPoint < nPoints; nPoint++) {
+    if (nPoint > 0) {
+      str.append(';');
+    }
+    str.append(pX[nPoint]);
+    str.append(':');
+    str.append(pY[nPoint]);
+  }
+  return str;
+}
+
+void Linearization::clear() { m_nPoints = 0; }
+
+bool Linearization::isEnabled() const { return m_nPoints > 0; }
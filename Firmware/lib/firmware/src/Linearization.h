@@ -0,0 +1,60 @@
+//
+// Piecewise-linear mapping of raw sensor readings to a linear force scale.
+//
+#pragma once
+#include <Arduino.h>
+
+class Linearization {
+public:
+  static const uint8_t kMaxPoints = 8;
+
+  Linearization();
+
+  // Set the points from a string in the form `X1:Y1;X2:Y2;...;XN:YN` with
+  // values given for 10-bit readings. Values are shifted left by nShift bits to
+  // match the ADC resolution. X values must be increasing and there must be at
+  // least two points. Returns false and disables the mapping if the string is
+  // empty or invalid.
+  bool parse(const String& str, uint8_t nShift);
+
+  // Disable the mapping
+  void clear();
+
+  // Get the points of a string in the form parse() takes into arrays of
+  // kMaxPoints, without shifting them. Returns the number of points, or 0 if
+  // the string is empty or invalid.
+  static uint8_t
+  parsePoints(const String& str, uint16_t* pX, uint16_t* pY);
+
+  // Inverse of parsePoints()
+  static String
+  formatPoints(uint8_t nPoints, const uint16_t* pX, const uint16_t* pY);
+
+  bool isEnabled() const;
+
+  // Map a raw reading. Readings outside of the table are extrapolated from
+  // the nearest segment.
+  inline uint16_t apply(uint16_t nRaw) const {
+    if (m_nPoints == 0) {
+      return nRaw;
+    }
+
+    uint8_t nSegment = 0;
+    while (nSegment + 1 < m_nPoints - 1 && nRaw >= m_pX[nSegment + 1]) {
+      nSegment++;
+    }
+
+    int32_t nValue =
+      m_pY[nSegment] +
+      static_cast<int32_t>(
+        (static_cast<int64_t>(nRaw) - m_pX[nSegment]) * m_pSlope[nSegment] >>
+        16);
+    return nValue < 0 ? 0 : (nValue > UINT16_MAX ? UINT16_MAX : nValue);
+  }
+
+private:
+  uint8_t m_nPoints;
+  uint16_t m_pX[kMaxPoints];
+  uint16_t m_pY[kMaxPoints];
+  int32_t m_pSlope[kMaxPoints]; // Slope of each segment as 16.16 fixed point
+};
@@ -0,0 +1,117 @@
+#include "LinearizationTables.h"
+#include "EepromLayout.h"
+
+#include <stddef.h>
+
+static_assert(
+  sizeof(LinearizationRecord) <= kEepromLinearizationSize,
+  "Linearization record doesn't fit in its EEPROM region");
+
+// Marks a record that has been written. Unwritten EEPROM reads 0xFF or 0.
+static const uint16_t kLinearizationMagic = 0x544C;
+
+// Bits of each packed value
+static const uint8_t kValueBits = 10;
+
+LinearizationTables* LinearizationTables::m_pInst = NULL;
+
+LinearizationTables* LinearizationTables::getInstance() {
+  if (!m_pInst) {
+    m_pInst = new LinearizationTables();
+  }
+  return m_pInst;
+}
+
+LinearizationTables::LinearizationTables() : m_bValid(false), m_bDirty(false) {
+  memset(&m_record, 0, sizeof(m_record));
+}
+
+static uint16_t recordChecksum(const LinearizationRecord& record) {
+  return eepromChecksum(
+    record.anPoints,
+    sizeof(record) - offsetof(LinearizationRecord, anPoints));
+}
+
+// Values are packed least significant bit first, X before Y of each point
+static uint16_t unpackValue(const uint8_t* pPacked, uint8_t nIndex) {
+  uint16_t nValue = 0;
+  uint16_t nBit = nIndex * kValueBits;
+  for (uint8_t n = 0; n < kValueBits; n++, nBit++) {
+    if (pPacked[nBit / 8] & (1 << (nBit % 8))) {
+      nValue |= 1 << n;
+    }
+  }
+  return nValue;
+}
+
+static void packValue(uint8_t* pPacked, uint8_t nIndex, uint16_t nValue) {
+  uint16_t nBit = nIndex * kValueBits;
+  for (uint8_t n = 0; n < kValueBits; n++, nBit++) {
+    if (nValue & (1 << n)) {
+      pPacked[nBit / 8] |= 1 << (nBit % 8);
+    } else {
+      pPacked[nBit / 8] &= ~(1 << (nBit % 8));
+    }
+  }
+}
+
+void LinearizationTables::read() {
+  EEPROM.get(kEepromLinearizationOffset, m_record);
+  m_bValid = m_record.nMagic == kLinearizationMagic &&
+             m_record.nChecksum == recordChecksum(m_record);
+  for (uint8_t n = 0; m_bValid && n < kLinearizationSensors; n++) {
+    m_bValid = m_record.anPoints[n] <= Linearization::kMaxPoints;
+  }
+  if (!m_bValid) {
+    memset(&m_record, 0, sizeof(m_record));
+  }
+  m_bDirty = false;
+}
+
+void LinearizationTables::write() {
+  if (m_bValid && !m_bDirty) {
+    return;
+  }
+  m_record.nMagic = kLinearizationMagic;
+  m_record.nChecksum = recordChecksum(m_record);
+
+  // EEPROM.put() only writes bytes that changed
+  EEPROM.put(kEepromLinearizationOffset, m_record);
+  m_bValid = true;
+  m_bDirty = false;
+}
+
+bool LinearizationTables::isValid() const { return m_bValid; }
+
+String LinearizationTables::get(uint8_t nSensor) const {
+  uint16_t anX[Linearization::kMaxPoints];
+  uint16_t anY[Linearization::kMaxPoints];
+  uint8_t nPoints = m_record.anPoints[nSensor];
+  const uint8_t* pPacked = m_record.aanPacked[nSensor];
+  for (uint8_t nPoint = 0; nPoint < nPoints; nPoint++) {
+    anX[nPoint] = unpackValue(pPacked, nPoint * 2);
+    anY[nPoint] = unpackValue(pPacked, nPoint * 2 + 1);
+  }
+  return Linearization::formatPoints(nPoints, anX, anY);
+}
+
+void LinearizationTables::set(uint8_t nSensor, const String& str) {
+  uint16_t anX[Linearization::kMaxPoints];
+  uint16_t anY[Linearization::kMaxPoints];
+  uint8_t nPoints = Linearization::parsePoints(str, anX, anY);
+
+  uint8_t anPacked[kLinearizationPackedSize] = {};
+  for (uint8_t nPoint = 0; nPoint < nPoints; nPoint++) {
+    packValue(anPacked, nPoint * 2, anX[nPoint]);
+    packValue(anPacked, nPoint * 2 + 1, anY[nPoint]);
+  }
+
+  uint8_t* pPacked = m_record.aanPacked[nSensor];
+  if (
+    m_record.anPoints[nSensor] != nPoints ||
+    memcmp(pPacked, anPacked, sizeof(anPacked)) != 0) {
+    m_record.anPoints[nSensor] = nPoints;
+    memcpy(pPacked, anPacked, sizeof(anPacked));
+    m_bDirty = true;
+  }
+}
@@ -0,0 +1,58 @@
+//
+// Linearization tables of the sensors saved across resets.
+//
+// Tables are set as `sensorNlut` string items, but stored as packed binary
+// points in a region of their own rather than with the configuration, which
+// would take several times the space on boards with 2 KB of EEPROM.
+//
+#pragma once
+#include <Arduino.h>
+
+#include "Linearization.h"
+
+const uint8_t kLinearizationSensors = 16;
+
+// Points are 10-bit X and Y values, so two of them pack into 5 bytes
+const uint8_t kLinearizationPackedSize = Linearization::kMaxPoints * 5 / 2;
+
+// Record stored as-is in the EEPROM. Sensors are in panel order, each with
+// its north, east, south, and west sensors before correcting for orientation.
+struct LinearizationRecord {
+  uint16_t nMagic;
+  uint16_t nChecksum; // Of everything after this field
+  uint8_t anPoints[kLinearizationSensors]; // 0 if a sensor has no table
+  uint8_t aanPacked[kLinearizationSensors][kLinearizationPackedSize];
+};
+
+class LinearizationTables {
+public:
+  // Get singleton instance
+  static LinearizationTables* getInstance();
+
+  // Load the record from the EEPROM
+  void read();
+
+  // Write the record to the EEPROM if a table changed since it was read or
+  // written. Only the bytes that changed are written.
+  void write();
+
+  // Was a record read or written?
+  bool isValid() const;
+
+  // Get the table of a sensor in the form Linearization::parse() takes, or an
+  // empty string if it has none
+  String get(uint8_t nSensor) const;
+
+  // Set the table of a sensor from the form Linearization::parse() takes. An
+  // empty or invalid string removes it.
+  void set(uint8_t nSensor, const String& str);
+
+private:
+  static LinearizationTables* m_pInst;
+
+  LinearizationTables();
+
+  LinearizationRecord m_record;
+  bool m_bValid;
+  bool m_bDirty;
+};
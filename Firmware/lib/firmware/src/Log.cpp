@@ -0,0 +1,12 @@
+#include <Arduino.h>
+
+#include "Log.h"
+
+// Created on first use, so records logged while other statics are constructed
+// aren't lost
+LogJournal& getLog() {
+  static LogJournal s_log;
+  return s_log;
+}
+
+uint32_t getLogTimeUS() { return micros(); }
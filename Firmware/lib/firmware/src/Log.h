@@ -0,0 +1,106 @@
+//
+// Deferred binary logging.
+//
+// A call site records the time, a message ID, and up to kLogMaxArgs integer
+// arguments in a ring, which takes a few stores, instead of formatting text.
+// Nothing is printed, so logging can't get mixed into command responses.
+// Hosts fetch the records with the `log` command and expand them with the
+// format strings in LogMessages.h, which aren't compiled into the firmware.
+//
+// Levels above LOG_LEVEL are removed at compile time along with the evaluation
+// of their arguments, so debug logging in the scan costs nothing unless it's
+// built with e.g. `-D LOG_LEVEL=LOG_LEVEL_DEBUG`.
+//
+#pragma once
+#include <stdint.h>
+
+#include "EventJournal.h"
+#include "LogMessages.h"
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_MESSAGE_ID(name, format) name,
+enum LogMessage : uint8_t { LOG_MESSAGES(LOG_MESSAGE_ID) kNumLogMessages };
+#undef LOG_MESSAGE_ID
+
+const uint8_t kLogMaxArgs = 3;
+const uint16_t kLogCapacity = 128;
+
+struct LogRecord {
+  uint32_t nTimeUS;
+  uint8_t nLevel;
+  uint8_t nMessage;
+  uint8_t nArgs;
+  uint8_t nReserved;
+  uint32_t anArg[kLogMaxArgs];
+};
+
+typedef EventJournal<kLogCapacity, LogRecord> LogJournal;
+
+// Fill in a record. Signed arguments are stored as their two's complement.
+template <typename... ARGS>
+inline void makeLogRecord(
+  LogRecord& record,
+  uint32_t nTimeUS,
+  uint8_t nLevel,
+  uint8_t nMessage,
+  ARGS... args) {
+  static_assert(sizeof...(ARGS) <= kLogMaxArgs, "Too many log arguments");
+  record.nTimeUS = nTimeUS;
+  record.nLevel = nLevel;
+  record.nMessage = nMessage;
+  record.nArgs = sizeof...(ARGS);
+  record.nReserved = 0;
+  // Leading 0 so the array isn't empty without arguments
+  const uint32_t anArgs[] = {0, static_cast<uint32_t>(args)...};
+  for (uint8_t nArg = 0; nArg < sizeof...(ARGS); nArg++) {
+    record.anArg[nArg] = anArgs[nArg + 1];
+  }
+}
+
+// The firmware's log and its clock, defined in Log.cpp
+LogJournal& getLog();
+uint32_t getLogTimeUS();
+
+template <typename... ARGS>
+inline void logWrite(uint8_t nLevel, uint8_t nMessage, ARGS... args) {
+  LogRecord record;
+  makeLogRecord(record, getLogTimeUS(), nLevel, nMessage, args...);
+  getLog().push(record);
+}
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(message, ...) \
+  logWrite(LOG_LEVEL_ERROR, message, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(message, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(message, ...)  \
+  logWrite(LOG_LEVEL_WARN, message, ##__VA_ARGS__)
+#else
+#define LOG_WARN(message, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(message, ...)  \
+  logWrite(LOG_LEVEL_INFO, message, ##__VA_ARGS__)
+#else
+#define LOG_INFO(message, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(message, ...) \
+  logWrite(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(message, ...) ((void)0)
+#endif
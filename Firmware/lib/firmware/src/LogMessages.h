@@ -0,0 +1,20 @@
+//
+// Messages that can be logged, with the format strings the host expands them
+// with. Only the IDs are compiled into the firmware. The host decoder reads
+// the format strings from this file, so each entry must stay on one line as
+// `X(NAME, "FORMAT")`. Arguments are 32-bit integers: use %u, %d, or %x.
+// Append new messages at the end so logs from older firmware still decode.
+//
+#pragma once
+
+#define LOG_MESSAGES(X)                                                        \
+  X(kLogBoot, "Setup took %u us, reading the configuration %u us")             \
+  X(kLogLedController, "LED controller started on %u strands of %u LEDs")      \
+  X(kLogAdcProfile, "ADC profile %u takes %u ns per sample")                   \
+  X(kLogBaselinesSeeded, "Seeded %u of %u baselines from EEPROM")              \
+  X(kLogBaselinesSaved, "Saved baselines, write %u")                           \
+  X(kLogProfileSelected, "Selected profile %u")                                \
+  X(kLogFrameDropped, "Dropped LED frame %u after %u frames shown")            \
+  X(kLogSensorEdge, "Sensor %u pressed %u, peak %u")                          \
+  X(kLogConfigTooLarge, "Configuration of %u bytes doesn't fit in %u")         \
+  X(kLogBaselineExpired, "Sensor %u stayed loaded, dropped saved baselines")
@@ -1,10 +1,52 @@
 #include "Panel.h"
 
+// Faulty sensors are left out so a broken wire can't hold the panel pressed
+static inline bool isSensorPressed(const Sensor& sensor) {
+  return sensor.isPressed() && sensor.isHealthy();
+}
+
 void Panel::update() {
-  m_sensorN.update();
-  m_sensorE.update();
-  m_sensorS.update();
-  m_sensorW.update();
+  readSensors();
+  evaluate();
+}
+
+void Panel::readSensors() {
+  m_sensorN.readSensor();
+  m_sensorE.readSensor();
+  m_sensorS.readSensor();
+  m_sensorW.readSensor();
+}
+
+void Panel::evaluate() {
+  m_sensorN.evaluate();
+  m_sensorE.evaluate();
+  m_sensorS.evaluate();
+  m_sensorW.evaluate();
+
+  bool bPressedN = isSensorPressed(m_sensorN);
+  bool bPressedE = isSensorPressed(m_sensorE);
+  bool bPressedS = isSensorPressed(m_sensorS);
+  bool bPressedW = isSensorPressed(m_sensorW);
+  m_sensorN.setNeighborsPressed(bPressedE || bPressedS || bPressedW);
+  m_sensorE.setNeighborsPressed(bPressedN || bPressedS || bPressedW);
+  m_sensorS.setNeighborsPressed(bPressedN || bPressedE || bPressedW);
+  m_sensorW.setNeighborsPressed(bPressedN || bPressedE || bPressedS);
+
+  bool bPressed = bPressedN || bPressedE || bPressedS || bPressedW;
+  if (bPressed != m_bPressed) {
+    m_bPressed = bPressed;
+    m_sensorN.onPanelStateChanged(bPressed);
+    m_sensorE.onPanelStateChanged(bPressed);
+    m_sensorS.onPanelStateChanged(bPressed);
+    m_sensorW.onPanelStateChanged(bPressed);
+  }
+}
+
+void Panel::configure() {
+  m_sensorN.configure();
+  m_sensorE.configure();
+  m_sensorS.configure();
+  m_sensorW.configure();
 }
 
 void Panel::calibrate() {
@@ -19,8 +61,34 @@ void Panel::calibrate() {
 }
 
 bool Panel::isPressed() const {
-  return m_sensorN.isPressed() || m_sensorE.isPressed() ||
-         m_sensorS.isPressed() || m_sensorW.isPressed();
+  return isSensorPressed(m_sensorN) || isSensorPressed(m_sensorE) ||
+         isSensorPressed(m_sensorS) || isSensorPressed(m_sensorW);
+}
+
+Sensor& Panel::getSensor(uint8_t nSensor) {
+  switch (nSensor) {
+  default:
+  case 0:
+    return m_sensorN;
+  case 1:
+    return m_sensorE;
+  case 2:
+    return m_sensorS;
+  case 3:
+    return m_sensorW;
+  }
+}
+
+uint16_t Panel::getLoad() const {
+  uint16_t nLoad = 0;
+  for (const Sensor* pSensor :
+       {&m_sensorN, &m_sensorE, &m_sensorS, &m_sensorW}) {
+    // Faulty sensors are left out so a broken wire can't report a load
+    if (pSensor->isHealthy() && pSensor->getLoad() > nLoad) {
+      nLoad = pSensor->getLoad();
+    }
+  }
+  return nLoad;
 }
 
 // Get the north sensor corrected for the Arrow Panel PCB's orientation
@@ -41,17 +41,33 @@ public:
     int nPinS,
     int nPinW)
       : m_orientation(orientation), m_sensorN(nPinN), m_sensorE(nPinE),
-        m_sensorS(nPinS), m_sensorW(nPinW) {}
+        m_sensorS(nPinS), m_sensorW(nPinW), m_bPressed(false) {}
 
-  // Update state of the panel
+  // Read and update state of the panel
   void update();
 
+  // Read all sensors without updating their state
+  void readSensors();
+
+  // Update state of the panel from the most recent readings
+  void evaluate();
+
+  // Get settings for all sensors from the configuration
+  void configure();
+
   // Force calibration of all sensors
   void calibrate();
 
-  // Are any of the sensors currently pressed?
+  // Are any of the healthy sensors currently pressed?
   bool isPressed() const;
 
+  // Highest load on any of the healthy sensors
+  uint16_t getLoad() const;
+
+  // Get a sensor by its index in north, east, south, west order without
+  // correcting for the Arrow Panel PCB's orientation
+  Sensor& getSensor(uint8_t nSensor);
+
   // Get the north sensor corrected for the Arrow Panel PCB's orientation
   const Sensor& getNorthSensor() const;
 
@@ -70,4 +86,7 @@ public:
   Sensor m_sensorE;
   Sensor m_sensorS;
   Sensor m_sensorW;
+
+private:
+  bool m_bPressed; // State during the most recent update
 };
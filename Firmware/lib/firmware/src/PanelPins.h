@@ -0,0 +1,34 @@
+//
+// Sensor pins of each panel, based on the layout of the Dance Pad PCB.
+//
+// The host tools that simulate sensors find the panels' pins here as well, so
+// they can't drift from the firmware's.
+//
+#pragma once
+#include <Arduino.h>
+
+#define PIN_UP_N    A6
+#define PIN_UP_E    A7
+#define PIN_UP_S    A8
+#define PIN_UP_W    A9
+#define PIN_DOWN_N  A2
+#define PIN_DOWN_E  A3
+#define PIN_DOWN_S  A4
+#define PIN_DOWN_W  A5
+#define PIN_LEFT_N  A16
+#define PIN_LEFT_E  A17
+#define PIN_LEFT_S  A0
+#define PIN_LEFT_W  A1
+#define PIN_RIGHT_N A13
+#define PIN_RIGHT_E A12
+#define PIN_RIGHT_S A14
+#define PIN_RIGHT_W A15
+
+// Pins of the panels in the order used by profiles, each in north, east,
+// south, west order before correcting for orientation
+const uint8_t kPanelPins[4][4] = {
+  {PIN_UP_N, PIN_UP_E, PIN_UP_S, PIN_UP_W},
+  {PIN_DOWN_N, PIN_DOWN_E, PIN_DOWN_S, PIN_DOWN_W},
+  {PIN_LEFT_N, PIN_LEFT_E, PIN_LEFT_S, PIN_LEFT_W},
+  {PIN_RIGHT_N, PIN_RIGHT_E, PIN_RIGHT_S, PIN_RIGHT_W},
+};
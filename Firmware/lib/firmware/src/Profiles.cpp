@@ -0,0 +1,175 @@
+#include "Profiles.h"
+#include "Config.h"
+#include "EepromLayout.h"
+#include "Lighting.h"
+#include "Log.h"
+
+static_assert(
+  sizeof(ProfileRecord) * kMaxProfiles <= kEepromProfilesSize,
+  "Profiles don't fit in their EEPROM region");
+
+// Marks a record that has been written. Unwritten EEPROM reads 0xFF or 0.
+static const uint16_t kProfileMagic = 0x5052;
+
+// Time the gesture must be held to switch to the next profile
+static const uint32_t kGestureHoldMS = 2000;
+
+// Config names
+static const char* const kActiveProfileSetting = "profile";
+static const char* const kAutoLightsSetting = "auto_lights";
+
+Profiles* Profiles::m_pInst = NULL;
+
+Profiles* Profiles::getInstance() {
+  if (!m_pInst) {
+    m_pInst = new Profiles();
+  }
+  return m_pInst;
+}
+
+Profiles::Profiles()
+    : m_nActive(kProfileNone), m_bPending(false), m_nHeldMS(0),
+      m_bHeld(false), m_bGestureDone(false) {
+  memset(m_records, 0, sizeof(m_records));
+}
+
+void Profiles::read() {
+  for (uint8_t nProfile = 0; nProfile < kMaxProfiles; nProfile++) {
+    ProfileRecord& record = m_records[nProfile];
+    EEPROM.get(kEepromProfilesOffset + nProfile * sizeof(record), record);
+    if (
+      record.nMagic != kProfileMagic || record.nChecksum != checksum(record)) {
+      memset(&record, 0, sizeof(record));
+    }
+    record.szName[kProfileNameLength - 1] = '\0';
+  }
+
+  m_nActive = Configuration::getInstance()->getUInt16(
+    kActiveProfileSetting, kProfileNone);
+}
+
+bool Profiles::save(
+  uint8_t nProfile,
+  const char* pszName,
+  Panel* const* apPanels) {
+  if (nProfile >= kMaxProfiles) {
+    return false;
+  }
+
+  ProfileRecord record;
+  memset(&record, 0, sizeof(record));
+  strncpy(record.szName, pszName, kProfileNameLength - 1);
+
+  for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+    for (uint8_t nSensor = 0; nSensor < 4; nSensor++) {
+      const Sensor& sensor = apPanels[nPanel]->getSensor(nSensor);
+      record.anTriggerOffset[nPanel * 4 + nSensor] = sensor.getTriggerOffset();
+      record.anReleaseOffset[nPanel * 4 + nSensor] = sensor.getReleaseOffset();
+    }
+    record.anColor[nPanel] =
+      Lights::getInstance()->getColor(static_cast<lightIdentifier_t>(nPanel));
+  }
+  record.nBrightness = FastLED.getBrightness();
+  record.nAutoLights =
+    Configuration::getInstance()->getUInt16(kAutoLightsSetting, 0) > 0;
+
+  record.nMagic = kProfileMagic;
+  record.nChecksum = checksum(record);
+
+  // EEPROM.put() only writes bytes that changed
+  EEPROM.put(kEepromProfilesOffset + nProfile * sizeof(record), record);
+  m_records[nProfile] = record;
+
+  m_nActive = nProfile;
+  Configuration::getInstance()->setUInt16(
+    kActiveProfileSetting, m_nActive, false);
+  return true;
+}
+
+bool Profiles::apply(uint8_t nProfile, Panel* const* apPanels) {
+  if (!isValid(nProfile)) {
+    return false;
+  }
+
+  const ProfileRecord& record = m_records[nProfile];
+  for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+    for (uint8_t nSensor = 0; nSensor < 4; nSensor++) {
+      apPanels[nPanel]->getSensor(nSensor).setOffsets(
+        record.anTriggerOffset[nPanel * 4 + nSensor],
+        record.anReleaseOffset[nPanel * 4 + nSensor]);
+    }
+  }
+  Lights::getInstance()->setColors(record.anColor, record.nBrightness);
+
+  m_nActive = nProfile;
+  m_bPending = true;
+  LOG_INFO(kLogProfileSelected, nProfile);
+  return true;
+}
+
+void Profiles::commit(Panel* const* apPanels) {
+  if (!m_bPending) {
+    return;
+  }
+  m_bPending = false;
+
+  for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+    for (uint8_t nSensor = 0; nSensor < 4; nSensor++) {
+      apPanels[nPanel]->getSensor(nSensor).storeOffsets();
+    }
+  }
+  Lights::getInstance()->storeColors();
+
+  // Auto lights are only applied by the configuration callbacks, which also
+  // turn off arrows lit by presses when they're disabled
+  Configuration* pConfig = Configuration::getInstance();
+  pConfig->setUInt16(kActiveProfileSetting, m_nActive, false);
+  pConfig->setUInt16(kAutoLightsSetting, m_records[m_nActive].nAutoLights);
+}
+
+void Profiles::updateGesture(
+  bool bHeld,
+  uint32_t nTimeMS,
+  Panel* const* apPanels) {
+  if (!bHeld) {
+    m_bHeld = false;
+    m_bGestureDone = false;
+    return;
+  }
+
+  if (!m_bHeld) {
+    m_bHeld = true;
+    m_nHeldMS = nTimeMS;
+  }
+
+  if (m_bGestureDone || nTimeMS - m_nHeldMS < kGestureHoldMS) {
+    return;
+  }
+  m_bGestureDone = true;
+
+  // Switch to the next stored profile, wrapping around
+  uint8_t nFirst = m_nActive == kProfileNone ? 0 : m_nActive + 1;
+  for (uint8_t nOffset = 0; nOffset < kMaxProfiles; nOffset++) {
+    if (apply((nFirst + nOffset) % kMaxProfiles, apPanels)) {
+      return;
+    }
+  }
+}
+
+bool Profiles::isValid(uint8_t nProfile) const {
+  return nProfile < kMaxProfiles &&
+         m_records[nProfile].nMagic == kProfileMagic;
+}
+
+const char* Profiles::getName(uint8_t nProfile) const {
+  return isValid(nProfile) ? m_records[nProfile].szName : "";
+}
+
+uint8_t Profiles::getActive() const { return m_nActive; }
+
+// Checksum of the record after the checksum field
+uint16_t Profiles::checksum(const ProfileRecord& record) {
+  const uint8_t* pData = reinterpret_cast<const uint8_t*>(&record.szName);
+  const uint8_t* pEnd = reinterpret_cast<const uint8_t*>(&record + 1);
+  return eepromChecksum(pData, pEnd - pData);
+}
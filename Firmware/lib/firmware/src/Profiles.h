@@ -0,0 +1,81 @@
+//
+// Stored sets of thresholds and lighting settings that can be switched
+// between instantly.
+//
+#pragma once
+#include <Arduino.h>
+
+#include "Panel.h"
+
+const uint8_t kMaxProfiles = 4;
+const uint8_t kProfileNameLength = 12; // Including the null-terminator
+const uint8_t kProfilePanels = 4;
+const uint8_t kProfileSensors = kProfilePanels * 4;
+const uint8_t kProfileNone = 0xFF;
+
+// Flat record of the settings in a profile, stored as-is in the EEPROM.
+// Sensors are in panel order (up, down, left, right), each with its north,
+// east, south, and west sensors before correcting for orientation. Offsets
+// are for 10-bit readings.
+struct ProfileRecord {
+  uint16_t nMagic;
+  uint16_t nChecksum; // Of everything after this field
+  char szName[kProfileNameLength];
+  uint16_t anTriggerOffset[kProfileSensors];
+  uint16_t anReleaseOffset[kProfileSensors];
+  uint32_t anColor[kProfilePanels];
+  uint8_t nBrightness;
+  uint8_t nAutoLights;
+};
+
+class Profiles {
+public:
+  // Get singleton instance
+  static Profiles* getInstance();
+
+  // Load all records from the EEPROM and the active profile from the
+  // configuration
+  void read();
+
+  // Store the current settings of the panels and lights in a profile and
+  // write only its record to the EEPROM. Returns false if nProfile is out of
+  // range.
+  bool save(uint8_t nProfile, const char* pszName, Panel* const* apPanels);
+
+  // Switch to a stored profile. Offsets and colors are applied directly, so
+  // the next scan uses the new thresholds. Configuration items are updated
+  // later by commit(). Returns false if the profile is empty.
+  bool apply(uint8_t nProfile, Panel* const* apPanels);
+
+  // Copy the settings of a profile applied since the last call into the
+  // configuration, so they are reported to the host and saved by the next
+  // persist. Configuration callbacks are called for the settings that aren't
+  // applied directly. Nothing is written to the EEPROM.
+  void commit(Panel* const* apPanels);
+
+  // Switch to the next stored profile when the gesture is held long enough.
+  // bHeld is true while the panels making up the gesture are pressed.
+  void updateGesture(bool bHeld, uint32_t nTimeMS, Panel* const* apPanels);
+
+  bool isValid(uint8_t nProfile) const;
+
+  // Name of a profile or an empty string if it is empty
+  const char* getName(uint8_t nProfile) const;
+
+  // Profile applied most recently or kProfileNone
+  uint8_t getActive() const;
+
+private:
+  static Profiles* m_pInst;
+
+  Profiles();
+
+  static uint16_t checksum(const ProfileRecord& record);
+
+  ProfileRecord m_records[kMaxProfiles];
+  uint8_t m_nActive;
+  bool m_bPending;     // Applied but not yet in the configuration
+  uint32_t m_nHeldMS;  // When the gesture started being held
+  bool m_bHeld;        // Is the gesture being held?
+  bool m_bGestureDone; // Has the held gesture already switched profiles?
+};
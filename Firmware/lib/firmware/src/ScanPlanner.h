@@ -0,0 +1,140 @@
+//
+// Chooses which panels to sample on each scan.
+//
+// Panels that are pressed or were recently active are sampled on every scan.
+// Idle panels are sampled every IDLE_DIVIDER scans, staggered so the work is
+// spread evenly. When no panel has been active for a while, the pad sleeps and
+// every panel is sampled every SLEEP_DIVIDER scans. Activity on any sampled
+// panel wakes the pad, and the next scan samples every panel.
+//
+// A panel is never left unsampled for more than SLEEP_DIVIDER scans, so a
+// press is detected within that many scan periods.
+//
+#pragma once
+#include <stdint.h>
+
+template <uint8_t PANELS, uint8_t IDLE_DIVIDER, uint8_t SLEEP_DIVIDER>
+class ScanPlanner {
+public:
+  static_assert(PANELS <= 8, "Panels must fit in a bit mask");
+  static_assert(
+    IDLE_DIVIDER > 0 && SLEEP_DIVIDER >= IDLE_DIVIDER,
+    "Sleeping must not sample more often than idling");
+
+  static const uint8_t kAllPanels = (1 << PANELS) - 1;
+
+  // nActiveHoldUS is how long a panel stays active after its last activity
+  // and nSleepAfterUS how long the whole pad must be idle before it sleeps
+  ScanPlanner(uint32_t nActiveHoldUS, uint32_t nSleepAfterUS)
+      : m_nActiveHoldUS(nActiveHoldUS), m_nSleepAfterUS(nSleepAfterUS) {
+    reset(0);
+  }
+
+  // Treat every panel as active, so they're all sampled on every scan until
+  // they have been quiet for long enough
+  void reset(uint32_t nNowUS) {
+    m_nScan = 0;
+    m_nActive = kAllPanels;
+    m_bSleeping = false;
+    m_bWake = false;
+    m_nLastActivityUS = nNowUS;
+    m_nRateStartUS = nNowUS;
+    for (uint8_t nPanel = 0; nPanel < PANELS; nPanel++) {
+      m_anLastActiveUS[nPanel] = nNowUS;
+      m_anSamples[nPanel] = 0;
+      m_anRate[nPanel] = 0;
+    }
+  }
+
+  // Bit mask of the panels to sample on this scan. Call once per scan, then
+  // report() each sampled panel.
+  uint8_t plan(uint32_t nNowUS) {
+    // Active panels go idle once they have been quiet for long enough
+    for (uint8_t nPanel = 0; nPanel < PANELS; nPanel++) {
+      if (nNowUS - m_anLastActiveUS[nPanel] >= m_nActiveHoldUS) {
+        m_nActive &= ~(1 << nPanel);
+      }
+    }
+    if (!m_nActive && nNowUS - m_nLastActivityUS >= m_nSleepAfterUS) {
+      m_bSleeping = true;
+    }
+
+    uint8_t nMask = m_nActive;
+    if (m_bWake) {
+      nMask = kAllPanels;
+      m_bWake = false;
+    } else {
+      uint8_t nDivider = m_bSleeping ? SLEEP_DIVIDER : IDLE_DIVIDER;
+      for (uint8_t nPanel = 0; nPanel < PANELS; nPanel++) {
+        if ((m_nScan + nPanel) % nDivider == 0) {
+          nMask |= 1 << nPanel;
+        }
+      }
+    }
+
+    m_nScan = (m_nScan + 1) % (IDLE_DIVIDER * SLEEP_DIVIDER);
+    return nMask;
+  }
+
+  // Count the panels sampled on a scan for their rates, whether or not the
+  // scan was planned
+  void count(uint8_t nMask, uint32_t nNowUS) {
+    updateRates(nNowUS);
+    for (uint8_t nPanel = 0; nPanel < PANELS; nPanel++) {
+      m_anSamples[nPanel] += (nMask >> nPanel) & 1;
+    }
+  }
+
+  // Report whether a sampled panel is pressed or has a load on it
+  void report(uint8_t nPanel, bool bActive, uint32_t nNowUS) {
+    if (!bActive) {
+      return;
+    }
+    m_nActive |= 1 << nPanel;
+    m_anLastActiveUS[nPanel] = nNowUS;
+    m_nLastActivityUS = nNowUS;
+    if (m_bSleeping) {
+      m_bSleeping = false;
+      m_bWake = true;
+    }
+  }
+
+  bool isSleeping() const { return m_bSleeping; }
+
+  // Bit mask of the panels sampled on every scan
+  uint8_t getActive() const { return m_nActive; }
+
+  // Samples of a panel per second, measured over the last whole second
+  uint16_t getRate(uint8_t nPanel) const { return m_anRate[nPanel]; }
+
+  // Most scans a panel can go without being sampled
+  static uint8_t getMaxInterval() { return SLEEP_DIVIDER; }
+
+private:
+  void updateRates(uint32_t nNowUS) {
+    uint32_t nElapsedUS = nNowUS - m_nRateStartUS;
+    if (nElapsedUS < 1000000) {
+      return;
+    }
+    for (uint8_t nPanel = 0; nPanel < PANELS; nPanel++) {
+      m_anRate[nPanel] = static_cast<uint64_t>(m_anSamples[nPanel]) *
+                         1000000 / nElapsedUS;
+      m_anSamples[nPanel] = 0;
+    }
+    m_nRateStartUS = nNowUS;
+  }
+
+  uint32_t m_nActiveHoldUS;
+  uint32_t m_nSleepAfterUS;
+
+  uint16_t m_nScan; // Position in the staggering cycle
+  uint8_t m_nActive; // Bit per panel sampled on every scan
+  bool m_bSleeping;
+  bool m_bWake; // Sample every panel on the next scan
+  uint32_t m_nLastActivityUS;
+  uint32_t m_anLastActiveUS[PANELS];
+
+  uint32_t m_nRateStartUS;
+  uint32_t m_anSamples[PANELS];
+  uint16_t m_anRate[PANELS];
+};
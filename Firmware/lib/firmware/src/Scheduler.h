@@ -0,0 +1,191 @@
+//
+// Cooperative scheduler for periodic and event-driven tasks.
+//
+// Tasks are stored in a fixed-size table and never allocate. Each call to
+// runOnce() runs the ready task with the highest priority, so a high priority
+// task waits for at most one lower priority task to finish. The clock is
+// passed in so the scheduler can be driven by a virtual clock on the host.
+//
+#pragma once
+#include <stdint.h>
+
+typedef void (*pFnTask)();
+
+// Returns the current time in microseconds
+typedef uint32_t (*pFnClock)();
+
+// Run time accounting for a task
+struct TaskStats {
+  uint32_t nRuns;
+  uint32_t nOverruns;      // Runs that finished after their deadline
+  uint32_t nSkipped;       // Periodic releases dropped because a task was late
+  uint32_t nMaxRunTimeUS;  // Longest time spent in the task
+  uint32_t nMaxLatencyUS;  // Longest time from release to start
+  uint32_t nTotalRunTimeUS;
+};
+
+template <uint8_t MAX_TASKS>
+class Scheduler {
+public:
+  static const uint8_t kInvalidTask = 0xFF;
+
+  explicit Scheduler(pFnClock fnClock) : m_fnClock(fnClock), m_nTasks(0) {}
+
+  // Add a task released every nPeriodUS, starting immediately. Lower values of
+  // nPriority run first. nDeadlineUS is relative to the release and defaults
+  // to the period. Returns the task's ID or kInvalidTask if the table is full.
+  uint8_t addPeriodic(
+    const char* pszName,
+    pFnTask fn,
+    uint8_t nPriority,
+    uint32_t nPeriodUS,
+    uint32_t nDeadlineUS = 0) {
+    uint8_t nTask =
+      add(pszName, fn, nPriority, nDeadlineUS ? nDeadlineUS : nPeriodUS);
+    if (nTask != kInvalidTask) {
+      m_tasks[nTask].nPeriodUS = nPeriodUS;
+      m_tasks[nTask].nReleaseUS = m_fnClock();
+    }
+    return nTask;
+  }
+
+  // Add a task released by signal(). Returns the task's ID or kInvalidTask if
+  // the table is full.
+  uint8_t addEvent(
+    const char* pszName,
+    pFnTask fn,
+    uint8_t nPriority,
+    uint32_t nDeadlineUS) {
+    return add(pszName, fn, nPriority, nDeadlineUS);
+  }
+
+  // Release an event task. Signalling a task that is already waiting to run
+  // has no effect, so its deadline is based on the first signal.
+  void signal(uint8_t nTask) {
+    if (nTask >= m_nTasks || m_tasks[nTask].bReady) {
+      return;
+    }
+    m_tasks[nTask].nReleaseUS = m_fnClock();
+    m_tasks[nTask].bReady = true;
+  }
+
+  // Run the ready task with the highest priority. Ties go to the task released
+  // first, then to the task added first. Returns false if no task was ready.
+  bool runOnce() {
+    uint32_t nNowUS = m_fnClock();
+
+    uint8_t nNext = kInvalidTask;
+    for (uint8_t nTask = 0; nTask < m_nTasks; nTask++) {
+      Task& task = m_tasks[nTask];
+      if (!isReleased(task, nNowUS)) {
+        continue;
+      }
+      if (
+        nNext == kInvalidTask ||
+        task.nPriority < m_tasks[nNext].nPriority ||
+        (task.nPriority == m_tasks[nNext].nPriority &&
+         static_cast<int32_t>(task.nReleaseUS - m_tasks[nNext].nReleaseUS) <
+           0)) {
+        nNext = nTask;
+      }
+    }
+
+    if (nNext == kInvalidTask) {
+      return false;
+    }
+
+    Task& task = m_tasks[nNext];
+    uint32_t nReleaseUS = task.nReleaseUS;
+    uint32_t nLatencyUS = nNowUS - nReleaseUS;
+
+    if (task.nPeriodUS) {
+      // Next release keeps the original phase. Releases that have already
+      // passed are dropped rather than run back to back.
+      task.nReleaseUS += task.nPeriodUS;
+      if (static_cast<int32_t>(nNowUS - task.nReleaseUS) >= 0) {
+        uint32_t nMissed = (nNowUS - task.nReleaseUS) / task.nPeriodUS + 1;
+        task.stats.nSkipped += nMissed;
+        task.nReleaseUS += nMissed * task.nPeriodUS;
+      }
+    } else {
+      task.bReady = false;
+    }
+
+    task.fn();
+
+    uint32_t nEndUS = m_fnClock();
+    uint32_t nRunTimeUS = nEndUS - nNowUS;
+    task.stats.nRuns++;
+    task.stats.nTotalRunTimeUS += nRunTimeUS;
+    if (nRunTimeUS > task.stats.nMaxRunTimeUS) {
+      task.stats.nMaxRunTimeUS = nRunTimeUS;
+    }
+    if (nLatencyUS > task.stats.nMaxLatencyUS) {
+      task.stats.nMaxLatencyUS = nLatencyUS;
+    }
+    if (nEndUS - nReleaseUS > task.nDeadlineUS) {
+      task.stats.nOverruns++;
+    }
+
+    return true;
+  }
+
+  // Clear the run time accounting of all tasks
+  void resetStats() {
+    for (uint8_t nTask = 0; nTask < m_nTasks; nTask++) {
+      m_tasks[nTask].stats = TaskStats();
+    }
+  }
+
+  uint8_t getNumTasks() const { return m_nTasks; }
+
+  const char* getName(uint8_t nTask) const { return m_tasks[nTask].pszName; }
+
+  const TaskStats& getStats(uint8_t nTask) const {
+    return m_tasks[nTask].stats;
+  }
+
+private:
+  struct Task {
+    const char* pszName;
+    pFnTask fn;
+    uint8_t nPriority;
+    uint32_t nPeriodUS; // 0 for event tasks
+    uint32_t nDeadlineUS;
+    uint32_t nReleaseUS; // Most recent or next release
+    bool bReady;         // Event task has been signalled
+    TaskStats stats;
+  };
+
+  uint8_t add(
+    const char* pszName,
+    pFnTask fn,
+    uint8_t nPriority,
+    uint32_t nDeadlineUS) {
+    if (m_nTasks >= MAX_TASKS) {
+      return kInvalidTask;
+    }
+
+    Task& task = m_tasks[m_nTasks];
+    task.pszName = pszName;
+    task.fn = fn;
+    task.nPriority = nPriority;
+    task.nPeriodUS = 0;
+    task.nDeadlineUS = nDeadlineUS;
+    task.nReleaseUS = 0;
+    task.bReady = false;
+    task.stats = TaskStats();
+    return m_nTasks++;
+  }
+
+  static bool isReleased(const Task& task, uint32_t nNowUS) {
+    if (task.nPeriodUS) {
+      return static_cast<int32_t>(nNowUS - task.nReleaseUS) >= 0;
+    }
+    return task.bReady;
+  }
+
+  pFnClock m_fnClock;
+  uint8_t m_nTasks;
+  Task m_tasks[MAX_TASKS];
+};
@@ -1,65 +1,171 @@
 #include "Sensor.h"
+#include "Adc.h"
 
 static const uint16_t kDefaultTriggerOffset = 150;
 static const uint16_t kDefaultReleaseOffset = 110;
 
-// Time in milliseconds of inactivity to cause a recalibration.
-static uint32_t s_calibrationPeriodMS = 10000; // 10 seconds
+// Config name for enabling health monitoring
+static const char* const kHealthMonitorSetting = "health_monitor";
 
-Sensor::Sensor(uint8_t nPin) {
+// Config name for the rise over kSlopeWindow samples that triggers an early
+// press, for 10-bit readings. 0 disables early presses.
+static const char* const kSlopeTriggerSetting = "slope_trigger";
+
+// Weight of a sample in the noise average as a shift, so it averages over
+// about 256 idle samples
+static const uint8_t kNoiseShift = 8;
+
+Sensor::Sensor(uint8_t nPin) : m_pipeline(AnalogSource(nPin)) {
   String strIdentifier("sensor");
   strIdentifier.append(nPin);
 
-  m_nPin = nPin;
-  m_nPressure = 0;
+  m_nNoise = 0;
   m_strTriggerOffsetSetting = strIdentifier + "trigger";
   m_strReleaseOffsetSetting = strIdentifier + "release";
-  m_nTriggerOffset = Configuration::getInstance()->getUInt16(
-    m_strTriggerOffsetSetting, kDefaultTriggerOffset);
-  m_nReleaseOffset = Configuration::getInstance()->getUInt16(
-    m_strReleaseOffsetSetting, kDefaultReleaseOffset);
-  m_nTriggerThreshold = 0;
-  m_nReleaseThreshold = 0;
-  m_nLastChangeTimeMS = 0;
-  m_bPressed = false;
+  m_strLinearizationSetting = strIdentifier + "lut";
+  m_nPeakPressure = 0;
+
+  Configuration* pConfig = Configuration::getInstance();
+  pConfig->setRange(m_strTriggerOffsetSetting, 1, 1023);
+  pConfig->setRange(m_strReleaseOffsetSetting, 1, 1023);
+  pConfig->setRange(kHealthMonitorSetting, 0, 1);
+  pConfig->setRange(kSlopeTriggerSetting, 0, 1023);
+  // Stored by LinearizationTables, which packs the points
+  pConfig->excludeFromImage(m_strLinearizationSetting);
+
+  configure();
+}
+
+void Sensor::configure() {
+  Configuration* pConfig = Configuration::getInstance();
+
+  // Offsets are configured for 10-bit readings
+  m_nShift = Adc::getInstance()->getShift();
+  m_pipeline.getDetector().setOffsets(
+    pConfig->getUInt16(m_strTriggerOffsetSetting, kDefaultTriggerOffset)
+      << m_nShift,
+    pConfig->getUInt16(m_strReleaseOffsetSetting, kDefaultReleaseOffset)
+      << m_nShift);
+  m_pipeline.getFilter().parse(
+    pConfig->getString(m_strLinearizationSetting, ""), m_nShift);
+  m_bHealthMonitor = pConfig->getUInt16(kHealthMonitorSetting, 1) > 0;
+  m_pipeline.getDetector().setSlopeRise(
+    pConfig->getUInt16(kSlopeTriggerSetting, 0) << m_nShift);
+}
+
+void Sensor::calibrate() { m_pipeline.calibrate(); }
+
+void Sensor::setBaseline(uint16_t nBaseline, uint16_t nNoise) {
+  m_pipeline.setBaseline(nBaseline);
+  m_nNoise = static_cast<uint32_t>(nNoise) << kNoiseShift;
+}
+
+void Sensor::setOffsets(uint16_t nTriggerOffset, uint16_t nReleaseOffset) {
+  m_pipeline.getDetector().setOffsets(
+    nTriggerOffset << m_nShift, nReleaseOffset << m_nShift);
 }
 
-void Sensor::calibrate() {
-  m_nTriggerThreshold =
-    m_nPressure + Configuration::getInstance()->getUInt16(
-                    m_strTriggerOffsetSetting, kDefaultTriggerOffset);
-  m_nReleaseThreshold =
-    m_nPressure + Configuration::getInstance()->getUInt16(
-                    m_strReleaseOffsetSetting, kDefaultReleaseOffset);
-  m_bPressed = false;
+void Sensor::storeOffsets() const {
+  Configuration* pConfig = Configuration::getInstance();
+  pConfig->setUInt16(m_strTriggerOffsetSetting, getTriggerOffset(), false);
+  pConfig->setUInt16(m_strReleaseOffsetSetting, getReleaseOffset(), false);
 }
 
-void Sensor::readSensor() { m_nPressure = analogRead(m_nPin); }
+void Sensor::readSensor() { m_pipeline.read(); }
 
 void Sensor::update() {
-  uint32_t nCurrentTimeMS = millis();
   readSensor();
+  evaluate();
+}
+
+void Sensor::subtractCoupling(uint16_t nCoupling) {
+  uint16_t nLoad = getLoad();
+  m_pipeline.setPressure(
+    getPressure() - (nCoupling < nLoad ? nCoupling : nLoad));
+}
+
+void Sensor::evaluate() {
+  uint32_t nCurrentTimeMS = millis();
+  bool bChanged = m_pipeline.evaluate(nCurrentTimeMS);
+  bool bPressed = m_pipeline.isPressed();
+  uint16_t nPressure = m_pipeline.getPressure();
+  uint16_t nBaseline = m_pipeline.getBaseline();
 
-  if (!m_bPressed) {
-    if (m_nPressure >= m_nTriggerThreshold) {
-      m_bPressed = true;
-      m_nLastChangeTimeMS = nCurrentTimeMS;
-    } else if (nCurrentTimeMS - m_nLastChangeTimeMS > s_calibrationPeriodMS) {
-      calibrate();
-      m_nLastChangeTimeMS = nCurrentTimeMS;
-    }
-  } else if (m_nPressure <= m_nReleaseThreshold) {
-    m_bPressed = false;
-    m_nLastChangeTimeMS = nCurrentTimeMS;
+  if (!bPressed && nPressure < getReleaseThreshold()) {
+    uint32_t nDistance = nPressure > nBaseline ? nPressure - nBaseline
+                                               : nBaseline - nPressure;
+    m_nNoise += nDistance - (m_nNoise >> kNoiseShift);
+  }
+
+  if (bPressed && (bChanged || nPressure > m_nPeakPressure)) {
+    m_nPeakPressure = nPressure;
+  }
+
+  if (m_bHealthMonitor) {
+    m_health.update(getRawValue() >> m_nShift, bPressed, nCurrentTimeMS);
   }
 }
 
-bool Sensor::isPressed() const { return m_bPressed; }
+void Sensor::onPanelStateChanged(bool bPressed) {
+  m_health.onPanelStateChanged(bPressed);
+}
 
-uint16_t Sensor::getPressure() const { return m_nPressure; }
+void Sensor::setNeighborsPressed(bool bPressed) {
+  m_health.setNeighborsPressed(bPressed);
+}
 
-uint16_t Sensor::getTriggerThreshold() const { return m_nTriggerThreshold; }
+bool Sensor::isPressed() const { return m_pipeline.isPressed(); }
+
+uint32_t Sensor::getFalseStarts() const {
+  return m_pipeline.getDetector().getFalseStarts();
+}
+
+bool Sensor::isHealthy() const {
+  return !m_bHealthMonitor || !m_health.isFaulty();
+}
+
+bool Sensor::isBaselineSettled() const {
+  return m_pipeline.getBaselineTracker().isSettled();
+}
+
+const SensorHealth& Sensor::getHealth() const { return m_health; }
+
+uint16_t Sensor::getRawValue() const { return m_pipeline.getRawValue(); }
+
+uint16_t Sensor::getPressure() const { return m_pipeline.getPressure(); }
+
+uint16_t Sensor::getBaseline() const { return m_pipeline.getBaseline(); }
+
+uint16_t Sensor::getNoise() const {
+  return (m_nNoise + (1 << (kNoiseShift - 1))) >> kNoiseShift;
+}
+
+uint16_t Sensor::getLoad() const {
+  uint16_t nPressure = getPressure();
+  uint16_t nBaseline = getBaseline();
+  return nPressure > nBaseline ? nPressure - nBaseline : 0;
+}
+
+uint16_t Sensor::getPeakPressure() const { return m_nPeakPressure; }
+
+uint16_t Sensor::getTriggerThreshold() const {
+  return m_pipeline.getDetector().getTriggerThreshold();
+}
+
+uint16_t Sensor::getReleaseThreshold() const {
+  return m_pipeline.getDetector().getReleaseThreshold();
+}
+
+uint16_t Sensor::getTriggerOffset() const {
+  return m_pipeline.getDetector().getTriggerOffset() >> m_nShift;
+}
+
+uint16_t Sensor::getReleaseOffset() const {
+  return m_pipeline.getDetector().getReleaseOffset() >> m_nShift;
+}
 
-uint16_t Sensor::getReleaseThreshold() const { return m_nReleaseThreshold; }
+uint8_t Sensor::getPin() const { return m_pipeline.getSource().getPin(); }
 
-uint8_t Sensor::getPin() const { return m_nPin; }
\ No newline at end of file
+const String& Sensor::getLinearizationSetting() const {
+  return m_strLinearizationSetting;
+}
\ No newline at end of file
@@ -3,35 +3,108 @@
 #include <Arduino.h>
 
 #include "Config.h"
+#include "Linearization.h"
+#include "SensorHealth.h"
+#include "SensorPipeline.h"
+
+// Reads a sensor from an analog pin
+class AnalogSource {
+public:
+  AnalogSource(uint8_t nPin) : m_nPin(nPin) {}
+
+  uint16_t read() { return analogRead(m_nPin); }
+
+  uint8_t getPin() const { return m_nPin; }
+
+private:
+  uint8_t m_nPin;
+};
+
+// The firmware's pipeline: linearized readings, a baseline recalibrated while
+// idle, and hysteresis with optional early presses
+typedef SensorPipeline<
+  AnalogSource,
+  Linearization,
+  IdleRecalibration,
+  HysteresisDetector>
+  DefaultSensorPipeline;
 
 class Sensor {
 public:
   Sensor(uint8_t nPin);
 
+  // Get settings from the configuration. Should be called after the
+  // configuration or ADC profile changes.
+  void configure();
+
   // Set the thresholds based on the most recent reading
   void calibrate();
 
+  // Set the baseline and noise without reading the sensor, e.g. to values
+  // saved before a reset
+  void setBaseline(uint16_t nBaseline, uint16_t nNoise);
+
+  // Set the offsets above the baseline for 10-bit readings without going
+  // through the configuration. Takes effect on the next update.
+  void setOffsets(uint16_t nTriggerOffset, uint16_t nReleaseOffset);
+
+  // Copy the offsets into the configuration without calling its callbacks
+  void storeOffsets() const;
+
   // Read value from pin
   void readSensor();
 
-  // Update state of the sensor
+  // Update state of the sensor from the most recent reading
+  void evaluate();
+
+  // Read value from pin and update state of the sensor
   void update();
 
+  // Remove load caused by other panels from the most recent reading. The
+  // pressure doesn't go below the baseline.
+  void subtractCoupling(uint16_t nCoupling);
+
+  // The panel containing this sensor was pressed or released
+  void onPanelStateChanged(bool bPressed);
+
+  // Whether any other sensor of the panel is pressed, see SensorHealth
+  void setNeighborsPressed(bool bPressed);
+
   bool isPressed() const;
+
+  // Early presses that were canceled because the pressure didn't reach the
+  // trigger threshold in time
+  uint32_t getFalseStarts() const;
+
+  // Is the sensor's signal plausible? Faulty sensors should be ignored.
+  bool isHealthy() const;
+
+  // Was the baseline last set by recalibrating after the sensor was idle for
+  // long enough? Only such baselines are worth saving.
+  bool isBaselineSettled() const;
+
+  const SensorHealth& getHealth() const;
+  uint16_t getRawValue() const;
   uint16_t getPressure() const;
+  uint16_t getBaseline() const;
+  uint16_t getNoise() const; // Mean distance from the baseline while idle
+  uint16_t getLoad() const;  // Pressure above the baseline
+  uint16_t getPeakPressure() const; // Highest pressure since last pressed
   uint16_t getTriggerThreshold() const;
   uint16_t getReleaseThreshold() const;
+  uint16_t getTriggerOffset() const; // For 10-bit readings
+  uint16_t getReleaseOffset() const; // For 10-bit readings
   uint8_t getPin() const;
+  const String& getLinearizationSetting() const;
 
 private:
-  uint8_t m_nPin;
-  uint16_t m_nPressure;
-  uint16_t m_nTriggerOffset; // Amount above the baseline to trigger a hit.
-  uint16_t m_nReleaseOffset; // Amount above the baseline to trigger a release.
+  DefaultSensorPipeline m_pipeline;
+  uint8_t m_nShift; // Bits of ADC resolution above 10
+  uint32_t m_nNoise; // Moving average while idle, scaled by 256
   String m_strTriggerOffsetSetting; // Config name for trigger offset
   String m_strReleaseOffsetSetting; // Config name for trigger offset setting
-  uint16_t m_nTriggerThreshold; // Absolute value to trigger a hit.
-  uint16_t m_nReleaseThreshold; // Absolute value to trigger a release.
-  uint64_t m_nLastChangeTimeMS;
-  bool m_bPressed;
+  String m_strLinearizationSetting; // Config name for linearization points
+  uint16_t m_nPeakPressure;
+  bool m_bHealthMonitor; // Is health monitoring enabled?
+  SensorHealth m_health;
 };
@@ -0,0 +1,175 @@
+#include "SensorHealth.h"
+
+// Length of an evaluation window
+static const uint32_t kWindowMS = 1000;
+
+// Readings this close to either end of the ADC range are on a rail. A broken
+// wire reads 0 through the pull down resistor and a short reads 1023.
+static const uint16_t kRailLow = 4;
+static const uint16_t kRailHigh = 1019;
+
+// Time at the upper rail, with the other sensors of the panel idle, before the
+// sensor is considered stuck.
+static const uint32_t kStuckTimeMS = 3000;
+
+// Consecutive panel presses without any response from the sensor before it is
+// considered stuck.
+static const uint8_t kMaxSilentPresses = 25;
+
+// Minimum rise in a sensor's reading while its panel is pressed
+static const uint16_t kMinResponse = 8;
+
+// Maximum change in the idle level between windows
+static const uint16_t kMaxDriftPerWindow = 60;
+
+// Amount the reading must move away from the moving average to count as a
+// crossing and the maximum number of crossings in a window. Steps on a single
+// panel don't exceed ~10 Hz, while a loose connection chatters much faster.
+static const uint16_t kOscillationBand = 24;
+static const uint16_t kMaxCrossingsPerWindow = 60;
+
+// Strikes needed for a sensor to be considered faulty
+static const uint8_t kFaultStrikes = 3;
+static const uint8_t kMaxStrikes = 10;
+
+SensorHealth::SensorHealth() { reset(); }
+
+void SensorHealth::reset() {
+  m_nWindowStartMS = 0;
+  m_bWindowStarted = false;
+  m_nRailStartMS = 0;
+  m_bOnRail = false;
+  m_bNeighborsPressed = false;
+  m_nWindowMin = UINT16_MAX;
+  m_nLastIdleMin = 0;
+  m_bHasIdleMin = false;
+  m_bPressedInWindow = false;
+  m_nAverage = 0;
+  m_bAboveAverage = false;
+  m_nCrossings = 0;
+  m_bPanelPressed = false;
+  m_nPanelPressStart = 0;
+  m_nPanelPressMax = 0;
+  m_nSilentPresses = 0;
+  m_status = enumSensorHealthOK;
+  m_nStrikes = 0;
+  m_bFaulty = false;
+}
+
+void SensorHealth::update(uint16_t nValue, bool bPressed, uint32_t nTimeMS) {
+  if (!m_bWindowStarted) {
+    m_bWindowStarted = true;
+    m_nWindowStartMS = nTimeMS;
+  }
+
+  // Stuck at the upper rail
+  if (nValue >= kRailHigh && !m_bNeighborsPressed) {
+    if (!m_bOnRail) {
+      m_bOnRail = true;
+      m_nRailStartMS = nTimeMS;
+    }
+  } else {
+    m_bOnRail = false;
+  }
+
+  // Idle level for drift
+  if (nValue < m_nWindowMin) {
+    m_nWindowMin = nValue;
+  }
+  m_bPressedInWindow |= bPressed;
+
+  // Crossings of a slow moving average for oscillation
+  uint32_t nScaled = static_cast<uint32_t>(nValue) << 4;
+  m_nAverage = m_nAverage - (m_nAverage >> 6) + (nScaled >> 6);
+  if (!m_bAboveAverage && nScaled > m_nAverage + (kOscillationBand << 4)) {
+    m_bAboveAverage = true;
+    m_nCrossings++;
+  } else if (
+    m_bAboveAverage && nScaled + (kOscillationBand << 4) < m_nAverage) {
+    m_bAboveAverage = false;
+    m_nCrossings++;
+  }
+
+  // Response to panel presses
+  if (m_bPanelPressed && nValue > m_nPanelPressMax) {
+    m_nPanelPressMax = nValue;
+  }
+
+  if (nTimeMS - m_nWindowStartMS >= kWindowMS) {
+    evaluateWindow(nTimeMS);
+  }
+}
+
+void SensorHealth::onPanelStateChanged(bool bPressed) {
+  if (bPressed) {
+    m_bPanelPressed = true;
+    m_nPanelPressStart = m_nWindowMin == UINT16_MAX ? 0 : m_nWindowMin;
+    m_nPanelPressMax = m_nPanelPressStart;
+    return;
+  }
+
+  if (!m_bPanelPressed) {
+    return;
+  }
+  m_bPanelPressed = false;
+
+  if (
+    m_nPanelPressStart <= kRailLow &&
+    m_nPanelPressMax < m_nPanelPressStart + kMinResponse) {
+    if (m_nSilentPresses < UINT8_MAX) {
+      m_nSilentPresses++;
+    }
+  } else {
+    m_nSilentPresses = 0;
+  }
+}
+
+void SensorHealth::setNeighborsPressed(bool bPressed) {
+  m_bNeighborsPressed = bPressed;
+}
+
+void SensorHealth::evaluateWindow(uint32_t nTimeMS) {
+  enumSensorHealth status = enumSensorHealthOK;
+
+  if (
+    (m_bOnRail && nTimeMS - m_nRailStartMS >= kStuckTimeMS) ||
+    m_nSilentPresses >= kMaxSilentPresses) {
+    status = enumSensorHealthStuck;
+  } else if (m_nCrossings > kMaxCrossingsPerWindow) {
+    status = enumSensorHealthOscillating;
+  } else if (!m_bPressedInWindow) {
+    if (
+      m_bHasIdleMin && (m_nWindowMin > m_nLastIdleMin + kMaxDriftPerWindow ||
+                        m_nWindowMin + kMaxDriftPerWindow < m_nLastIdleMin)) {
+      status = enumSensorHealthDrifting;
+    }
+    m_nLastIdleMin = m_nWindowMin;
+    m_bHasIdleMin = true;
+  }
+
+  m_status = status;
+  if (status != enumSensorHealthOK) {
+    if (m_nStrikes < kMaxStrikes) {
+      m_nStrikes++;
+    }
+    if (m_nStrikes >= kFaultStrikes) {
+      m_bFaulty = true;
+    }
+  } else if (m_nStrikes > 0) {
+    m_nStrikes--;
+    if (m_nStrikes == 0) {
+      m_bFaulty = false;
+    }
+  }
+
+  m_nWindowStartMS = nTimeMS;
+  m_nWindowMin = UINT16_MAX;
+  m_bPressedInWindow = false;
+  m_nCrossings = 0;
+}
+
+bool SensorHealth::isFaulty() const { return m_bFaulty; }
+
+enumSensorHealth SensorHealth::getStatus() const { return m_status; }
+
+uint8_t SensorHealth::getStrikes() const { return m_nStrikes; }
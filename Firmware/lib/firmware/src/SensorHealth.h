@@ -0,0 +1,72 @@
+//
+// Continuous health scoring of a sensor's signal to detect wiring faults.
+//
+#pragma once
+#include <stdint.h>
+
+typedef enum {
+  enumSensorHealthOK,
+  enumSensorHealthStuck,       // Pinned to a rail or not responding to steps
+  enumSensorHealthDrifting,    // Idle level moving faster than a baseline can
+  enumSensorHealthOscillating, // Toggling faster than a foot can
+} enumSensorHealth;
+
+// Tracks a sensor's samples and scores it once per evaluation window. Each
+// window with a problem adds a strike and each clean window removes one. A
+// sensor becomes faulty after a few consecutive bad windows and stays faulty
+// until all of its strikes have decayed.
+class SensorHealth {
+public:
+  SensorHealth();
+
+  // Add a sample. This is cheap enough to be called for every reading.
+  void update(uint16_t nValue, bool bPressed, uint32_t nTimeMS);
+
+  // The panel containing this sensor was pressed or released. Used to find
+  // sensors that never respond while their neighbors do.
+  void onPanelStateChanged(bool bPressed);
+
+  // Whether any other sensor of the panel is pressed. The upper rail only
+  // counts towards being stuck while none is: a foot heavy enough to saturate
+  // a sensor loads its neighbors too, while a short pins a single sensor.
+  void setNeighborsPressed(bool bPressed);
+
+  // Clear all history and strikes
+  void reset();
+
+  // Should the sensor be ignored?
+  bool isFaulty() const;
+
+  // Most recent problem seen, or enumSensorHealthOK if the last window was
+  // clean.
+  enumSensorHealth getStatus() const;
+
+  uint8_t getStrikes() const;
+
+private:
+  void evaluateWindow(uint32_t nTimeMS);
+
+  uint32_t m_nWindowStartMS;
+  bool m_bWindowStarted;
+  uint32_t m_nRailStartMS; // When the value last reached a rail
+  bool m_bOnRail;
+  bool m_bNeighborsPressed;
+
+  uint16_t m_nWindowMin;
+  uint16_t m_nLastIdleMin; // Minimum of the previous window without a press
+  bool m_bHasIdleMin;
+  bool m_bPressedInWindow;
+
+  uint32_t m_nAverage; // Slow moving average, scaled by 16
+  bool m_bAboveAverage;
+  uint16_t m_nCrossings; // Crossings of the average in the current window
+
+  bool m_bPanelPressed;
+  uint16_t m_nPanelPressStart; // Value when the panel was pressed
+  uint16_t m_nPanelPressMax;   // Highest value while the panel is pressed
+  uint8_t m_nSilentPresses;    // Panel presses in a row without a response
+
+  enumSensorHealth m_status;
+  uint8_t m_nStrikes;
+  bool m_bFaulty;
+};
@@ -0,0 +1,362 @@
+//
+// Sensor pipeline assembled from a policy for each stage.
+//
+// Each sample is read by a SOURCE, mapped by a FILTER, and evaluated by a
+// DETECTOR against thresholds above the baseline kept by a BASELINE tracker.
+// The stages are template parameters rather than virtual interfaces, so a
+// pipeline compiles down to the same code as if it were written out by hand,
+// and alternative stages can be compared on the host at no cost to the
+// firmware's. Sensor uses SensorPipeline with the firmware's stages.
+//
+// A stage is any class with these members:
+//
+//   SOURCE    uint16_t read()
+//   FILTER    uint16_t apply(uint16_t nRaw)
+//   BASELINE  uint16_t get() const
+//             bool isSettled() const
+//             void set(uint16_t nBaseline)
+//             bool update(uint16_t nPressure, bool bPressed, bool bChanged,
+//                         uint32_t nTimeMS)    Returns whether it moved
+//   DETECTOR  void rebase(uint16_t nBaseline)  Thresholds follow the baseline
+//             void reset()                     Release without counting it
+//             bool update(uint16_t nPressure, uint32_t nTimeMS)
+//                                              Returns whether it changed
+//             bool isPressed() const
+//
+#pragma once
+#include <stdint.h>
+
+// Samples over which the rise is measured for early press detection
+const uint8_t kSlopeWindow = 4;
+
+// Time an early press has to reach the trigger threshold
+const uint32_t kSlopeConfirmMS = 10;
+
+// Time without a press after which the baseline is recalibrated
+const uint32_t kIdleRecalibrationMS = 10000;
+
+// Filter that leaves readings as they are
+class PassThroughFilter {
+public:
+  uint16_t apply(uint16_t nRaw) const { return nRaw; }
+};
+
+// Mean of the last SAMPLES readings, which trades latency for noise
+template <uint8_t SAMPLES>
+class MovingAverageFilter {
+public:
+  static_assert(SAMPLES > 0, "Average at least one sample");
+
+  MovingAverageFilter() : m_nSum(0), m_nIndex(0), m_bFull(false) {
+    for (uint8_t n = 0; n < SAMPLES; n++) {
+      m_anHistory[n] = 0;
+    }
+  }
+
+  uint16_t apply(uint16_t nRaw) {
+    if (!m_bFull) {
+      // Start from the first reading rather than ramping up from 0
+      for (uint8_t n = 0; n < SAMPLES; n++) {
+        m_anHistory[n] = nRaw;
+      }
+      m_nSum = static_cast<uint32_t>(nRaw) * SAMPLES;
+      m_bFull = true;
+    }
+    m_nSum += nRaw - m_anHistory[m_nIndex];
+    m_anHistory[m_nIndex] = nRaw;
+    m_nIndex = (m_nIndex + 1) % SAMPLES;
+    return m_nSum / SAMPLES;
+  }
+
+private:
+  uint16_t m_anHistory[SAMPLES];
+  uint32_t m_nSum;
+  uint8_t m_nIndex; // Oldest reading in m_anHistory
+  bool m_bFull;
+};
+
+// Baseline that's only moved by recalibrating to the current pressure once
+// nothing was pressed for kIdleRecalibrationMS. Between recalibrations, slow
+// drift eats into the offsets.
+class IdleRecalibration {
+public:
+  IdleRecalibration() : m_nBaseline(0), m_nIdleSinceMS(0), m_bSettled(false) {}
+
+  uint16_t get() const { return m_nBaseline; }
+
+  // Was the baseline last set by recalibrating after being idle?
+  bool isSettled() const { return m_bSettled; }
+
+  void set(uint16_t nBaseline) {
+    m_nBaseline = nBaseline;
+    m_bSettled = false;
+  }
+
+  bool update(
+    uint16_t nPressure,
+    bool bPressed,
+    bool bChanged,
+    uint32_t nTimeMS) {
+    if (bPressed || bChanged) {
+      m_nIdleSinceMS = nTimeMS;
+      return false;
+    }
+    if (nTimeMS - m_nIdleSinceMS <= kIdleRecalibrationMS) {
+      return false;
+    }
+    m_nBaseline = nPressure;
+    m_bSettled = true;
+    m_nIdleSinceMS = nTimeMS;
+    return true;
+  }
+
+private:
+  uint16_t m_nBaseline;
+  uint32_t m_nIdleSinceMS;
+  bool m_bSettled;
+};
+
+// Baseline that follows the pressure while nothing is pressed, as an
+// exponential moving average with a weight of 1 / 2^SHIFT per sample. It
+// tracks drift continuously, but also creeps up under loads that stay below
+// the trigger threshold.
+template <uint8_t SHIFT>
+class TrackingBaseline {
+public:
+  TrackingBaseline() : m_nScaled(0), m_nSamples(0) {}
+
+  uint16_t get() const { return m_nScaled >> SHIFT; }
+
+  // Has it followed the pressure for long enough to have converged?
+  bool isSettled() const { return m_nSamples >= kSettleSamples; }
+
+  void set(uint16_t nBaseline) {
+    m_nScaled = static_cast<uint32_t>(nBaseline) << SHIFT;
+    m_nSamples = 0;
+  }
+
+  bool update(
+    uint16_t nPressure,
+    bool bPressed,
+    bool bChanged,
+    uint32_t nTimeMS) {
+    (void)nTimeMS;
+    if (bPressed || bChanged) {
+      return false;
+    }
+    uint16_t nOld = get();
+    m_nScaled -= m_nScaled >> SHIFT;
+    m_nScaled += nPressure;
+    if (m_nSamples < kSettleSamples) {
+      m_nSamples++;
+    }
+    return get() != nOld;
+  }
+
+private:
+  static const uint32_t kSettleSamples = 4UL << SHIFT;
+
+  uint32_t m_nScaled; // Baseline scaled by 2^SHIFT
+  uint32_t m_nSamples;
+};
+
+// Press detector with hysteresis: pressed at or above the trigger threshold
+// and released at or below the lower release threshold, both offsets above
+// the baseline.
+//
+// With a slope rise set, a press is also registered before the trigger
+// threshold when the pressure is above the release threshold and rose by at
+// least the slope rise over the last kSlopeWindow samples. It's canceled
+// unless the trigger threshold is reached within kSlopeConfirmMS.
+class HysteresisDetector {
+public:
+  HysteresisDetector()
+      : m_nBaseline(0),
+        m_nTriggerOffset(0),
+        m_nReleaseOffset(0),
+        m_nTriggerThreshold(0),
+        m_nReleaseThreshold(0),
+        m_nChangeMS(0),
+        m_bPressed(false),
+        m_nSlopeRise(0),
+        m_nHistoryIndex(0),
+        m_bRefillHistory(true),
+        m_bTentative(false),
+        m_bSlopeBlocked(false),
+        m_nFalseStarts(0) {
+    for (uint8_t n = 0; n < kSlopeWindow; n++) {
+      m_anHistory[n] = 0;
+    }
+  }
+
+  void setOffsets(uint16_t nTriggerOffset, uint16_t nReleaseOffset) {
+    m_nTriggerOffset = nTriggerOffset;
+    m_nReleaseOffset = nReleaseOffset;
+    rebase(m_nBaseline);
+  }
+
+  // 0 disables early presses
+  void setSlopeRise(uint16_t nSlopeRise) { m_nSlopeRise = nSlopeRise; }
+
+  void rebase(uint16_t nBaseline) {
+    m_nBaseline = nBaseline;
+    m_nTriggerThreshold = nBaseline + m_nTriggerOffset;
+    m_nReleaseThreshold = nBaseline + m_nReleaseOffset;
+    m_bRefillHistory = true;
+  }
+
+  void reset() {
+    m_bPressed = false;
+    m_bTentative = false;
+  }
+
+  bool update(uint16_t nPressure, uint32_t nTimeMS) {
+    bool bWasPressed = m_bPressed;
+
+    if (m_bRefillHistory) {
+      // Start from the current pressure, so a sensor that's already loaded
+      // when it's calibrated doesn't look like it just rose
+      for (uint8_t n = 0; n < kSlopeWindow; n++) {
+        m_anHistory[n] = nPressure;
+      }
+      m_bRefillHistory = false;
+    }
+    uint16_t nOldest = m_anHistory[m_nHistoryIndex];
+    m_anHistory[m_nHistoryIndex] = nPressure;
+    m_nHistoryIndex = (m_nHistoryIndex + 1) % kSlopeWindow;
+    bool bRising = m_nSlopeRise > 0 && !m_bSlopeBlocked &&
+                   nPressure > m_nReleaseThreshold &&
+                   nPressure >= nOldest + m_nSlopeRise;
+
+    if (!m_bPressed) {
+      if (nPressure >= m_nTriggerThreshold) {
+        m_bPressed = true;
+        m_nChangeMS = nTimeMS;
+      } else if (bRising) {
+        m_bPressed = true;
+        m_bTentative = true;
+        m_nChangeMS = nTimeMS;
+      }
+    } else if (nPressure <= m_nReleaseThreshold) {
+      if (m_bTentative) {
+        m_nFalseStarts++;
+      }
+      m_bPressed = false;
+      m_bTentative = false;
+      m_nChangeMS = nTimeMS;
+    } else if (m_bTentative) {
+      if (nPressure >= m_nTriggerThreshold) {
+        m_bTentative = false;
+      } else if (nTimeMS - m_nChangeMS >= kSlopeConfirmMS) {
+        // Don't trigger early again until the pressure drops
+        m_nFalseStarts++;
+        m_bPressed = false;
+        m_bTentative = false;
+        m_bSlopeBlocked = true;
+        m_nChangeMS = nTimeMS;
+      }
+    }
+
+    if (nPressure <= m_nReleaseThreshold) {
+      m_bSlopeBlocked = false;
+    }
+    return m_bPressed != bWasPressed;
+  }
+
+  bool isPressed() const { return m_bPressed; }
+
+  // Early presses that were canceled because the pressure didn't reach the
+  // trigger threshold in time
+  uint32_t getFalseStarts() const { return m_nFalseStarts; }
+
+  uint16_t getTriggerOffset() const { return m_nTriggerOffset; }
+  uint16_t getReleaseOffset() const { return m_nReleaseOffset; }
+  uint16_t getTriggerThreshold() const { return m_nTriggerThreshold; }
+  uint16_t getReleaseThreshold() const { return m_nReleaseThreshold; }
+
+private:
+  uint16_t m_nBaseline;
+  uint16_t m_nTriggerOffset;
+  uint16_t m_nReleaseOffset;
+  uint16_t m_nTriggerThreshold;
+  uint16_t m_nReleaseThreshold;
+  uint32_t m_nChangeMS; // When it was last pressed or released
+  bool m_bPressed;
+
+  uint16_t m_nSlopeRise;
+  uint16_t m_anHistory[kSlopeWindow]; // Most recent pressures
+  uint8_t m_nHistoryIndex;            // Oldest pressure in m_anHistory
+  bool m_bRefillHistory; // Fill m_anHistory with the next pressure
+  bool m_bTentative;                  // Pressed early and not yet confirmed
+  bool m_bSlopeBlocked; // Canceled and waiting for the pressure to drop
+  uint32_t m_nFalseStarts;
+};
+
+template <
+  typename SOURCE,
+  typename FILTER = PassThroughFilter,
+  typename BASELINE = IdleRecalibration,
+  typename DETECTOR = HysteresisDetector>
+class SensorPipeline {
+public:
+  SensorPipeline(const SOURCE& source = SOURCE())
+      : m_source(source), m_nRaw(0), m_nPressure(0) {}
+
+  // Read and filter a sample
+  void read() {
+    m_nRaw = m_source.read();
+    m_nPressure = m_filter.apply(m_nRaw);
+  }
+
+  // Replace the pressure of the last sample before it's evaluated, e.g. after
+  // removing load from other sensors
+  void setPressure(uint16_t nPressure) { m_nPressure = nPressure; }
+
+  // Update the press state and baseline from the last sample. Returns whether
+  // it was pressed or released.
+  bool evaluate(uint32_t nTimeMS) {
+    bool bChanged = m_detector.update(m_nPressure, nTimeMS);
+    if (m_baseline.update(
+          m_nPressure, m_detector.isPressed(), bChanged, nTimeMS)) {
+      m_detector.rebase(m_baseline.get());
+    }
+    return bChanged;
+  }
+
+  bool update(uint32_t nTimeMS) {
+    read();
+    return evaluate(nTimeMS);
+  }
+
+  // Set the baseline and release without waiting for the pressure to drop
+  void setBaseline(uint16_t nBaseline) {
+    m_baseline.set(nBaseline);
+    m_detector.rebase(nBaseline);
+    m_detector.reset();
+  }
+
+  // Set the baseline to the pressure of the last sample
+  void calibrate() { setBaseline(m_nPressure); }
+
+  bool isPressed() const { return m_detector.isPressed(); }
+  uint16_t getRawValue() const { return m_nRaw; }
+  uint16_t getPressure() const { return m_nPressure; }
+  uint16_t getBaseline() const { return m_baseline.get(); }
+
+  SOURCE& getSource() { return m_source; }
+  FILTER& getFilter() { return m_filter; }
+  BASELINE& getBaselineTracker() { return m_baseline; }
+  DETECTOR& getDetector() { return m_detector; }
+  const SOURCE& getSource() const { return m_source; }
+  const FILTER& getFilter() const { return m_filter; }
+  const BASELINE& getBaselineTracker() const { return m_baseline; }
+  const DETECTOR& getDetector() const { return m_detector; }
+
+private:
+  SOURCE m_source;
+  FILTER m_filter;
+  BASELINE m_baseline;
+  DETECTOR m_detector;
+  uint16_t m_nRaw;
+  uint16_t m_nPressure;
+};
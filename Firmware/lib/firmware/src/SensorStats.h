@@ -0,0 +1,151 @@
+//
+// Running statistics of a sensor's readings, kept on every scan so sensor
+// quality can be judged from a small snapshot instead of raw samples.
+//
+// Moments are kept as exact integer sums of the values and their squares
+// rather than with Welford's running mean, which needs a division per sample.
+// Sums never lose precision, so the mean and variance computed from them by
+// the host are exact, and they have room for days of samples at full rate.
+//
+#pragma once
+#include <stdint.h>
+
+// Count, sum, sum of squares, and range of a series of values
+class Moments {
+public:
+  Moments() { reset(); }
+
+  void reset() {
+    m_nCount = 0;
+    m_nSum = 0;
+    m_nSumSquares = 0;
+    m_nMin = INT32_MAX;
+    m_nMax = INT32_MIN;
+  }
+
+  void add(int32_t nValue) {
+    m_nCount++;
+    m_nSum += nValue;
+    m_nSumSquares += static_cast<int64_t>(nValue) * nValue;
+    if (nValue < m_nMin) {
+      m_nMin = nValue;
+    }
+    if (nValue > m_nMax) {
+      m_nMax = nValue;
+    }
+  }
+
+  uint32_t getCount() const { return m_nCount; }
+  int64_t getSum() const { return m_nSum; }
+  uint64_t getSumSquares() const { return m_nSumSquares; }
+
+  // Only meaningful if getCount() > 0
+  int32_t getMin() const { return m_nMin; }
+  int32_t getMax() const { return m_nMax; }
+
+private:
+  uint32_t m_nCount;
+  int64_t m_nSum;
+  uint64_t m_nSumSquares;
+  int32_t m_nMin;
+  int32_t m_nMax;
+};
+
+// Counts of values in BINS bins of equal width. Values outside the bins are
+// counted in the first or last bin.
+template <uint8_t BINS>
+class Histogram {
+public:
+  Histogram() : m_nLow(0), m_nWidthShift(0) { reset(); }
+
+  // The first bin starts at nLow and each is 2^nWidthShift wide, so finding a
+  // value's bin doesn't need a division
+  void configure(int32_t nLow, uint8_t nWidthShift) {
+    m_nLow = nLow;
+    m_nWidthShift = nWidthShift;
+    reset();
+  }
+
+  void reset() {
+    for (uint8_t nBin = 0; nBin < BINS; nBin++) {
+      m_anCount[nBin] = 0;
+    }
+  }
+
+  void add(int32_t nValue) {
+    int32_t nBin = nValue < m_nLow ? 0 : (nValue - m_nLow) >> m_nWidthShift;
+    m_anCount[nBin < BINS ? nBin : BINS - 1]++;
+  }
+
+  uint32_t getCount(uint8_t nBin) const { return m_anCount[nBin]; }
+  int32_t getLow() const { return m_nLow; }
+  int32_t getWidth() const { return static_cast<int32_t>(1) << m_nWidthShift; }
+
+private:
+  int32_t m_nLow;
+  uint8_t m_nWidthShift;
+  uint32_t m_anCount[BINS];
+};
+
+// Statistics of one sensor. Values are kept relative to the baseline: the
+// distance from it while idle and the load on it while pressed. The peak load
+// of each press is added when it's released.
+template <uint8_t BINS>
+class SensorStats {
+public:
+  SensorStats() : m_bPressed(false), m_nPeak(0) {}
+
+  // Set the bins and clear everything
+  void configure(
+    int32_t nIdleLow,
+    uint8_t nIdleWidthShift,
+    int32_t nPressedLow,
+    uint8_t nPressedWidthShift) {
+    m_idleBins.configure(nIdleLow, nIdleWidthShift);
+    m_pressedBins.configure(nPressedLow, nPressedWidthShift);
+    reset();
+  }
+
+  void reset() {
+    m_idle.reset();
+    m_pressed.reset();
+    m_peaks.reset();
+    m_idleBins.reset();
+    m_pressedBins.reset();
+    m_bPressed = false;
+    m_nPeak = 0;
+  }
+
+  void add(uint16_t nValue, uint16_t nBaseline, bool bPressed) {
+    int32_t nOffset = static_cast<int32_t>(nValue) - nBaseline;
+    if (bPressed) {
+      m_pressed.add(nOffset);
+      m_pressedBins.add(nOffset);
+      if (!m_bPressed || nOffset > m_nPeak) {
+        m_nPeak = nOffset;
+      }
+    } else {
+      if (m_bPressed) {
+        m_peaks.add(m_nPeak);
+      }
+      m_idle.add(nOffset);
+      m_idleBins.add(nOffset);
+    }
+    m_bPressed = bPressed;
+  }
+
+  const Moments& getIdle() const { return m_idle; }
+  const Moments& getPressed() const { return m_pressed; }
+  const Moments& getPeaks() const { return m_peaks; } // One per press
+  const Histogram<BINS>& getIdleBins() const { return m_idleBins; }
+  const Histogram<BINS>& getPressedBins() const { return m_pressedBins; }
+
+private:
+  Moments m_idle;
+  Moments m_pressed;
+  Moments m_peaks;
+  Histogram<BINS> m_idleBins;
+  Histogram<BINS> m_pressedBins;
+  bool m_bPressed;
+  int32_t m_nPeak; // Highest load during the current press
+};
@@ -9,31 +9,26 @@
 #include <Keyboard.h>
 #include <array>
 
+#include "Adc.h"
+#include "BaselineCheck.h"
+#include "Baselines.h"
 #include "Config.h"
+#include "Crosstalk.h"
+#include "CycleCounter.h"
+#include "EventJournal.h"
 #include "Lighting.h"
+#include "LinearizationTables.h"
+#include "Log.h"
 #include "Panel.h"
+#include "PanelPins.h"
+#include "Profiles.h"
+#include "ScanPlanner.h"
+#include "Scheduler.h"
+#include "SensorStats.h"
 
 static String s_strVersion;
 static char s_pSextetStream[14]; // Includes newline characteam
 
-// Pins for sensors based on layout of the Dance Pad PCB
-#define PIN_UP_N    A6
-#define PIN_UP_E    A7
-#define PIN_UP_S    A8
-#define PIN_UP_W    A9
-#define PIN_DOWN_N  A2
-#define PIN_DOWN_E  A3
-#define PIN_DOWN_S  A4
-#define PIN_DOWN_W  A5
-#define PIN_LEFT_N  A16
-#define PIN_LEFT_E  A17
-#define PIN_LEFT_S  A0
-#define PIN_LEFT_W  A1
-#define PIN_RIGHT_N A13
-#define PIN_RIGHT_E A12
-#define PIN_RIGHT_S A14
-#define PIN_RIGHT_W A15
-
 static Panel s_panelUp(
   enumPanelUp, enumPanelOrientation0, PIN_UP_N, PIN_UP_E, PIN_UP_S, PIN_UP_W);
 static Panel s_panelDown(
@@ -58,16 +53,188 @@ static Panel s_panelRight(
   PIN_RIGHT_S,
   PIN_RIGHT_W);
 
+// Panels in the order used by profiles
+static Panel* const s_apPanels[kProfilePanels] = {
+  &s_panelUp, &s_panelDown, &s_panelLeft, &s_panelRight};
+
+static_assert(
+  kCrosstalkPanels == kProfilePanels,
+  "Crosstalk compensation uses the panel order of profiles");
+
 // Joystick button mapping
 #define JOY_UP_BUTTON    1
 #define JOY_DOWN_BUTTON  2
 #define JOY_LEFT_BUTTON  3
 #define JOY_RIGHT_BUTTON 4
 
+// HID report sent to the host
+static const String kHidMode("hid_mode");
+enum {
+  kHidModeKeyboard, // W, A, S, D keys
+  kHidModeGamepad,  // Joystick buttons and a pressure axis per panel
+};
+static uint16_t s_nHidMode = kHidModeKeyboard;
+
+// Gamepad report. Axes are the highest load on each panel's healthy sensors
+// for 10-bit readings, in panel order.
+struct GamepadReport {
+  uint16_t nButtons; // Bit per panel
+  uint16_t anAxes[kProfilePanels];
+};
+static GamepadReport s_lastGamepadReport;
+static bool s_bGamepadReportSent = false;
+
+// Loads below this are reported as 0, so sensor noise on idle panels doesn't
+// cause reports
+const uint16_t kGamepadDeadband = 4;
+
 // Scheduling
+const uint32_t kMicrosPerSecond = 1000000;
+const uint32_t kScanFrequency = 3000;
 const uint32_t kJoystickUpdateFrequency = 1000;
+const uint32_t kSerialUpdateFrequency = 4000;
 const uint32_t kLEDUpdateFrequency = 100;
 
+// Task priorities. Input sampling and HID reports always run before lights and
+// serial work when they are ready.
+enum {
+  kPriorityScan,
+  kPriorityReport,
+  kPriorityFlash,
+  kPrioritySerial,
+  kPriorityLights,
+  kPriorityMaintenance,
+};
+
+static const String kAutoLights("auto_lights");
+static bool s_bAutoLights = false;
+
+// With auto lights, an arrow lights up as soon as its panel is pressed rather
+// than on the next lights update. Its strand is sent by the flash task once
+// the LEDs are ready for another frame, which is retried on every scan.
+// Releases are left to the lights update, which fades them.
+static const String kInstantLights("instant_lights");
+static bool s_bInstantLights = false;
+static uint8_t s_nPanelsLit = 0; // Bit per panel lit by a press
+static uint8_t s_nFlashTask = 0;
+const uint32_t kFlashDeadlineUS = 1000;
+
+static uint32_t schedulerClock() { return micros(); }
+
+static Scheduler<8> s_scheduler(schedulerClock);
+
+// Time taken by the most recent and slowest calls to updatePanels()
+static uint32_t s_nScanTimeUS = 0;
+static uint32_t s_nMaxScanTimeUS = 0;
+
+// Crosstalk compensation between panels
+static const String kCrosstalk("crosstalk");
+static bool s_bCrosstalk = false;
+
+// Total load on the panel being learned for a scan to be used, for 10-bit
+// readings
+const uint16_t kCrosstalkLearnMinLoad = 60;
+
+// CPU cycles taken by the most recent and slowest compensations
+static uint32_t s_nCrosstalkCycles = 0;
+static uint32_t s_nMaxCrosstalkCycles = 0;
+
+// LED frames streamed by the host are decoded in slices of at most this many
+// bytes per run of the serial task, so a large frame doesn't delay scans. A
+// frame is dropped if its bytes stop arriving for kFrameTimeoutMS.
+const uint16_t kMaxFrameBytesPerUpdate = 128;
+const uint16_t kFrameTimeoutMS = 100;
+
+// CPU cycles taken to decode the most recent and slowest streamed frames, and
+// the slowest slice of a frame
+static uint32_t s_nFrameCycles = 0;
+static uint32_t s_nMaxFrameCycles = 0;
+static uint32_t s_nMaxFrameSliceCycles = 0;
+
+// Adaptive scanning. Idle panels are sampled on every 3rd scan and, once the
+// pad has been idle for a while, every panel on every 12th scan, so a press is
+// seen within 4 ms.
+static const String kAdaptiveScan("adaptive_scan");
+static bool s_bAdaptiveScan = false;
+const uint32_t kScanActiveHoldUS = 500000;
+const uint32_t kScanSleepAfterUS = 10000000;
+static ScanPlanner<kProfilePanels, 3, 12> s_scanPlanner(
+  kScanActiveHoldUS, kScanSleepAfterUS);
+
+// Load that keeps a panel active, for 10-bit readings
+const uint16_t kScanActiveLoad = 20;
+
+// Press and release events of each sensor, in the order used by profiles
+static EventJournal<256> s_journal;
+static uint16_t s_nSensorsPressed = 0; // Bit per sensor
+
+// Events sent in response to one command
+const uint8_t kMaxEventsPerResponse = 32;
+
+// Log records per response to the log command
+const uint8_t kMaxLogRecordsPerResponse = 16;
+
+// Holding up and down switches profiles only if enabled, since charts with
+// up and down freeze arrows held together would switch them mid-song
+static const String kProfileGesture("profile_gesture");
+static bool s_bProfileGesture = false;
+
+// Running statistics of each sensor in the order used by profiles. Idle
+// readings are binned by their distance from the baseline in single 10-bit
+// steps from -8, and pressed readings by their load in steps of 64.
+static const String kSensorStats("sensor_stats");
+static bool s_bSensorStats = false;
+const uint8_t kStatsBins = 16;
+const int32_t kStatsIdleLow = -8;
+const uint8_t kStatsPressedWidthShift = 6;
+static SensorStats<kStatsBins> s_aStats[kProfileSensors];
+static uint32_t s_nStatsStartMS = 0; // When the statistics were last reset
+
+// Saved baselines. Boot readings are averaged over a few samples and may
+// differ from a saved baseline by the sensor's noise or this many 10-bit steps
+// before the baseline is rejected or taken to be under load.
+const uint8_t kBaselineBootSamples = 4;
+const uint16_t kBaselineMinTolerance = 8;
+
+// Baselines are saved when one has moved by this many 10-bit steps, at most
+// once per interval
+const uint16_t kBaselineSaveMargin = 4;
+const uint32_t kBaselineSaveIntervalMS = 600000;
+const uint32_t kBaselineUpdateFrequency = 1;
+
+static enumBaselineCheck s_aBaselineCheck[kBaselineSensors];
+static uint8_t s_nBaselinesSeeded = 0; // Sensors seeded from the record
+static LoadedBaselineWatch s_aLoadedBaselines[kBaselineSensors];
+static uint32_t s_nBaselinesSavedMS = 0;
+
+static_assert(
+  kBaselineSensors == kProfileSensors,
+  "Saved baselines use the sensor order of profiles");
+
+// Boot mode. Fast boot skips the startup delay and runs the light self-test
+// in the background.
+static const String kFastBoot("fast_boot");
+
+// Light self-test showing red, green, and blue
+const uint32_t kSelfTestStepMS = 200;
+const uint8_t kSelfTestSteps = 3;
+static bool s_bSelfTest = false;
+static uint32_t s_nSelfTestStartMS = 0;
+
+// Boot timing in microseconds since reset, including the startup code run
+// before setup()
+static uint32_t s_nConfigReadUS = 0;  // Time taken to read the configuration
+static uint32_t s_nSetupDoneUS = 0;   // When setup() returned
+static uint32_t s_nFirstReportUS = 0; // When the first HID report was sent
+
+// Get settings for sensors in each panel from the configuration
+void configurePanels() {
+  s_panelUp.configure();
+  s_panelDown.configure();
+  s_panelLeft.configure();
+  s_panelRight.configure();
+}
+
 // Force calibration of sensors in each panel
 void calibratePanels() {
   s_panelUp.calibrate();
@@ -76,44 +243,489 @@ void calibratePanels() {
   s_panelRight.calibrate();
 }
 
+// Set the baselines from the saved record instead of the first readings, so
+// the thresholds are right from the first scan even if someone is standing on
+// the pad. The record is checked against live readings first.
+static void restoreBaselines() {
+  uint32_t anSum[kBaselineSensors] = {};
+  for (uint8_t nSample = 0; nSample < kBaselineBootSamples; nSample++) {
+    for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+      s_apPanels[nPanel]->readSensors();
+      for (uint8_t nSensor = 0; nSensor < 4; nSensor++) {
+        anSum[nPanel * 4 + nSensor] +=
+          s_apPanels[nPanel]->getSensor(nSensor).getPressure();
+      }
+    }
+  }
+
+  uint8_t nShift = Adc::getInstance()->getShift();
+  uint16_t anLive[kBaselineSensors];
+  uint16_t anStored[kBaselineSensors];
+  uint16_t anNoise[kBaselineSensors];
+  uint16_t anBaseline[kBaselineSensors];
+  for (uint8_t n = 0; n < kBaselineSensors; n++) {
+    anLive[n] = anSum[n] / kBaselineBootSamples;
+  }
+  Baselines* pBaselines = Baselines::getInstance();
+  pBaselines->get(anStored, anNoise, nShift);
+  s_nBaselinesSeeded = checkBaselines(
+    kBaselineSensors,
+    pBaselines->isValid() ? anStored : NULL,
+    anNoise,
+    anLive,
+    kBaselineMinTolerance << nShift,
+    anBaseline,
+    s_aBaselineCheck);
+  LOG_INFO(kLogBaselinesSeeded, s_nBaselinesSeeded, kBaselineSensors);
+
+  for (uint8_t n = 0; n < kBaselineSensors; n++) {
+    // Noise belongs to the sensor, so it's kept even if the baseline is stale
+    bool bNoise = s_aBaselineCheck[n] != enumBaselineMissing;
+    s_apPanels[n / 4]->getSensor(n % 4).setBaseline(
+      anBaseline[n], bNoise ? anNoise[n] : 0);
+    if (s_aBaselineCheck[n] == enumBaselineLoaded) {
+      s_aLoadedBaselines[n].start(
+        anLive[n],
+        baselineTolerance(anNoise[n], kBaselineMinTolerance << nShift),
+        millis());
+    }
+  }
+}
+
+// Pick a configuration epoch that differs at every boot from the noise in the
+// sensor readings and the time taken to get here
+static uint32_t bootEpoch() {
+  uint32_t nHash = 2166136261u ^ micros(); // FNV-1a
+  for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+    s_apPanels[nPanel]->readSensors();
+    for (uint8_t nSensor = 0; nSensor < 4; nSensor++) {
+      nHash ^= s_apPanels[nPanel]->getSensor(nSensor).getRawValue();
+      nHash *= 16777619u;
+    }
+  }
+  return nHash;
+}
+
+// Linearization tables are kept out of the configuration image, so put the
+// stored ones back into their items. Items from an image written by older
+// firmware are kept if there are no stored tables yet.
+static void restoreLinearization() {
+  LinearizationTables* pTables = LinearizationTables::getInstance();
+  pTables->read();
+  if (!pTables->isValid()) {
+    return;
+  }
+  for (uint8_t n = 0; n < kLinearizationSensors; n++) {
+    const Sensor& sensor = s_apPanels[n / 4]->getSensor(n % 4);
+    Configuration::getInstance()->setString(
+      sensor.getLinearizationSetting(), pTables->get(n), false);
+  }
+}
+
+// Store the linearization items of the sensors
+static void saveLinearization() {
+  LinearizationTables* pTables = LinearizationTables::getInstance();
+  for (uint8_t n = 0; n < kLinearizationSensors; n++) {
+    const Sensor& sensor = s_apPanels[n / 4]->getSensor(n % 4);
+    pTables->set(
+      n,
+      Configuration::getInstance()->getString(
+        sensor.getLinearizationSetting(), ""));
+  }
+  pTables->write();
+}
+
+// Replace stored baselines that keep their sensors pressed with a reading that
+// doesn't move, which is the sensor's idle level rather than a foot. The whole
+// record is dropped, as it will be just as wrong at the next boot.
+static void checkLoadedBaselines() {
+  uint32_t nNowMS = millis();
+  for (uint8_t n = 0; n < kBaselineSensors; n++) {
+    Sensor& sensor = s_apPanels[n / 4]->getSensor(n % 4);
+    uint16_t nPressure = sensor.getPressure();
+    if (!s_aLoadedBaselines[n].update(nPressure, sensor.isPressed(), nNowMS)) {
+      continue;
+    }
+    sensor.setBaseline(nPressure, sensor.getNoise());
+    s_aBaselineCheck[n] = enumBaselineExpired;
+    LOG_WARN(kLogBaselineExpired, n);
+    if (Baselines::getInstance()->isValid()) {
+      Baselines::getInstance()->invalidate();
+    }
+  }
+}
+
+// Save the baselines when they have moved. Only baselines found while the pad
+// is idle are saved and, since writing the EEPROM can stall the loop, only
+// while nothing is pressed and rarely.
+static void updateBaselines() {
+  checkLoadedBaselines();
+
+  Baselines* pBaselines = Baselines::getInstance();
+  uint32_t nNowMS = millis();
+  bool bDue = !pBaselines->isValid() ||
+              nNowMS - s_nBaselinesSavedMS >= kBaselineSaveIntervalMS;
+  if (!bDue) {
+    return;
+  }
+
+  uint16_t anBaseline[kBaselineSensors];
+  uint16_t anNoise[kBaselineSensors];
+  for (uint8_t n = 0; n < kBaselineSensors; n++) {
+    const Sensor& sensor = s_apPanels[n / 4]->getSensor(n % 4);
+    if (sensor.isPressed() || !sensor.isBaselineSettled()) {
+      return;
+    }
+    anBaseline[n] = sensor.getBaseline();
+    anNoise[n] = sensor.getNoise();
+  }
+
+  uint8_t nShift = Adc::getInstance()->getShift();
+  if (pBaselines->hasMoved(anBaseline, nShift, kBaselineSaveMargin)) {
+    pBaselines->write(anBaseline, anNoise, nShift);
+    s_nBaselinesSavedMS = nNowMS;
+    LOG_INFO(kLogBaselinesSaved, pBaselines->getWrites());
+  }
+}
+
+// Read every panel before evaluating any of them, so the coupling between
+// them can be learned or removed first
+static void updatePanelsWithCrosstalk() {
+  uint16_t anLoad[kCrosstalkSensors];
+  for (uint8_t nPanel = 0; nPanel < kCrosstalkPanels; nPanel++) {
+    Panel* pPanel = s_apPanels[nPanel];
+    pPanel->readSensors();
+    for (uint8_t nSensor = 0; nSensor < kCrosstalkSensorsPerPanel; nSensor++) {
+      anLoad[nPanel * kCrosstalkSensorsPerPanel + nSensor] =
+        pPanel->getSensor(nSensor).getLoad();
+    }
+  }
+
+  Crosstalk* pCrosstalk = Crosstalk::getInstance();
+  if (pCrosstalk->isLearning()) {
+    // Compensating would hide the coupling being learned
+    pCrosstalk->learn(anLoad);
+  } else {
+    uint32_t nStartCycles = getCycleCount();
+    uint16_t anCoupling[kCrosstalkSensors];
+    pCrosstalk->compensate(anLoad, anCoupling);
+    for (uint8_t nPanel = 0; nPanel < kCrosstalkPanels; nPanel++) {
+      for (uint8_t nSensor = 0; nSensor < kCrosstalkSensorsPerPanel;
+           nSensor++) {
+        s_apPanels[nPanel]->getSensor(nSensor).subtractCoupling(
+          anCoupling[nPanel * kCrosstalkSensorsPerPanel + nSensor]);
+      }
+    }
+    s_nCrosstalkCycles = getCycleCount() - nStartCycles;
+    if (s_nCrosstalkCycles > s_nMaxCrosstalkCycles) {
+      s_nMaxCrosstalkCycles = s_nCrosstalkCycles;
+    }
+  }
+
+  for (uint8_t nPanel = 0; nPanel < kCrosstalkPanels; nPanel++) {
+    s_apPanels[nPanel]->evaluate();
+  }
+}
+
+// Sample only the panels chosen by the scan planner. Returns the panels that
+// were sampled.
+static uint8_t updatePanelsAdaptive(uint32_t nNowUS) {
+  uint8_t nMask = s_scanPlanner.plan(nNowUS);
+  uint16_t nActiveLoad = kScanActiveLoad << Adc::getInstance()->getShift();
+  for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+    if (nMask & (1 << nPanel)) {
+      Panel* pPanel = s_apPanels[nPanel];
+      pPanel->update();
+      s_scanPlanner.report(
+        nPanel,
+        pPanel->isPressed() || pPanel->getLoad() >= nActiveLoad,
+        nNowUS);
+    }
+  }
+  return nMask;
+}
+
+// Add an event to the journal for each sensor that was pressed or released
+static void recordEvents(uint32_t nTimeUS) {
+  uint8_t nShift = Adc::getInstance()->getShift();
+  for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+    for (uint8_t nSensor = 0; nSensor < 4; nSensor++) {
+      const Sensor& sensor = s_apPanels[nPanel]->getSensor(nSensor);
+      uint8_t nIndex = nPanel * 4 + nSensor;
+      uint16_t nBit = 1 << nIndex;
+      if (sensor.isPressed() == ((s_nSensorsPressed & nBit) != 0)) {
+        continue;
+      }
+      s_nSensorsPressed ^= nBit;
+
+      PressEvent event;
+      event.nTimeUS = nTimeUS;
+      event.nPeak = sensor.getPeakPressure() >> nShift;
+      event.nSensor = nIndex;
+      event.nFlags = sensor.isPressed() ? kEventPressed : 0;
+      s_journal.push(event);
+      LOG_DEBUG(kLogSensorEdge, nIndex, sensor.isPressed(), event.nPeak);
+    }
+  }
+}
+
+// Light the arrow of each panel that was just pressed and release the flash
+// task to send it
+static void updateInstantLights() {
+  Lights* pLights = Lights::getInstance();
+  for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+    uint8_t nBit = 1 << nPanel;
+    bool bPressed = s_apPanels[nPanel]->isPressed();
+    if (bPressed && !(s_nPanelsLit & nBit) && !s_bSelfTest) {
+      // Arrows are in the same order as the panels of a profile
+      pLights->illuminateNow(static_cast<lightIdentifier_t>(nPanel));
+    }
+    s_nPanelsLit = bPressed ? s_nPanelsLit | nBit : s_nPanelsLit & ~nBit;
+  }
+
+  if (pLights->isFlashPending()) {
+    s_scheduler.signal(s_nFlashTask);
+  }
+}
+
+static void flashLights() { Lights::getInstance()->flash(); }
+
+// Clear the statistics of every sensor and bin them for the ADC resolution
+static void resetStats() {
+  uint8_t nShift = Adc::getInstance()->getShift();
+  for (uint8_t n = 0; n < kProfileSensors; n++) {
+    s_aStats[n].configure(
+      kStatsIdleLow * (1 << nShift),
+      nShift,
+      0,
+      kStatsPressedWidthShift + nShift);
+  }
+  s_nStatsStartMS = millis();
+}
+
+// Add the readings of the sensors on the panels in nSampled to their
+// statistics
+static void updateStats(uint8_t nSampled) {
+  for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+    if (!(nSampled & (1 << nPanel))) {
+      continue;
+    }
+    for (uint8_t nSensor = 0; nSensor < 4; nSensor++) {
+      const Sensor& sensor = s_apPanels[nPanel]->getSensor(nSensor);
+      s_aStats[nPanel * 4 + nSensor].add(
+        sensor.getPressure(), sensor.getBaseline(), sensor.isPressed());
+    }
+  }
+}
+
 // Update sensor readings from each panel
 void updatePanels() {
-  s_panelUp.update();
-  s_panelDown.update();
-  s_panelLeft.update();
-  s_panelRight.update();
+  uint32_t nStartUS = micros();
+
+  // Crosstalk needs the loads of every panel on every scan
+  uint8_t nSampled = s_scanPlanner.kAllPanels;
+  if (s_bCrosstalk || Crosstalk::getInstance()->isLearning()) {
+    updatePanelsWithCrosstalk();
+  } else if (s_bAdaptiveScan) {
+    nSampled = updatePanelsAdaptive(nStartUS);
+  } else {
+    s_panelUp.update();
+    s_panelDown.update();
+    s_panelLeft.update();
+    s_panelRight.update();
+  }
+  s_scanPlanner.count(nSampled, nStartUS);
+
+  recordEvents(nStartUS);
+  if (s_bInstantLights) {
+    updateInstantLights();
+  }
+  if (s_bSensorStats) {
+    updateStats(nSampled);
+  }
+
+  s_nScanTimeUS = micros() - nStartUS;
+  if (s_nScanTimeUS > s_nMaxScanTimeUS) {
+    s_nMaxScanTimeUS = s_nScanTimeUS;
+  }
+
+  // Holding up and down together switches to the next profile
+  if (s_bProfileGesture) {
+    Profiles::getInstance()->updateGesture(
+      s_panelUp.isPressed() && s_panelDown.isPressed() &&
+        !s_panelLeft.isPressed() && !s_panelRight.isPressed(),
+      millis(),
+      s_apPanels);
+  }
+}
+
+void releaseHidDevice(uint16_t nHidMode);
+
+// Apply the ADC profile and sensor settings from the configuration
+void onConfigUpdated() {
+  if (Adc::getInstance()->configure()) {
+    LOG_INFO(
+      kLogAdcProfile,
+      Adc::getInstance()->getProfile(),
+      Adc::getInstance()->getSampleTimeNS());
+    // Readings from the previous profile use a different scale
+    Adc::getInstance()->measure(PIN_UP_N);
+    configurePanels();
+    calibratePanels();
+    resetStats();
+    s_nMaxScanTimeUS = 0;
+  } else {
+    configurePanels();
+  }
+
+  uint16_t nHidMode =
+    Configuration::getInstance()->getUInt16(kHidMode, kHidModeKeyboard);
+  if (nHidMode != s_nHidMode && s_nFirstReportUS) {
+    // The old device is no longer updated, so nothing may be left held on it
+    releaseHidDevice(s_nHidMode);
+  }
+  s_nHidMode = nHidMode;
+  s_bCrosstalk = Configuration::getInstance()->getUInt16(kCrosstalk, 0) > 0;
+
+  bool bAdaptiveScan =
+    Configuration::getInstance()->getUInt16(kAdaptiveScan, 0) > 0;
+  if (bAdaptiveScan && !s_bAdaptiveScan) {
+    s_scanPlanner.reset(micros());
+  }
+  s_bAdaptiveScan = bAdaptiveScan;
+
+  bool bSensorStats =
+    Configuration::getInstance()->getUInt16(kSensorStats, 0) > 0;
+  if (bSensorStats && !s_bSensorStats) {
+    resetStats();
+  }
+  s_bSensorStats = bSensorStats;
+
+  bool bAutoLights =
+    Configuration::getInstance()->getUInt16(kAutoLights, 0) > 0;
+  if (s_bAutoLights && !bAutoLights) {
+    // Arrows lit by presses would stay lit, as nothing updates them any more
+    for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+      Lights::getInstance()->setStatus(
+        static_cast<lightIdentifier_t>(nPanel), false);
+    }
+  }
+  s_bAutoLights = bAutoLights;
+
+  bool bInstantLights =
+    bAutoLights &&
+    Configuration::getInstance()->getUInt16(kInstantLights, 1) > 0;
+  if (bInstantLights && !s_bInstantLights) {
+    // Panels lit before they were turned off may have been released since
+    s_nPanelsLit = 0;
+  }
+  s_bInstantLights = bInstantLights;
+
+  bool bProfileGesture =
+    Configuration::getInstance()->getUInt16(kProfileGesture, 0) > 0;
+  if (!bProfileGesture) {
+    // Don't count a hold from before the gesture was disabled
+    Profiles::getInstance()->updateGesture(false, millis(), s_apPanels);
+  }
+  s_bProfileGesture = bProfileGesture;
+}
+
+void updateReport();
+void updateSerial();
+void updateLights();
+
+// Show one color of the light self-test on all light groups
+static void showSelfTest(uint8_t nStep) {
+  CRGB color(nStep == 0 ? 255 : 0, nStep == 1 ? 255 : 0, nStep == 2 ? 255 : 0);
+  for (uint8_t nGroup = 0; nGroup < kNumLightGroups; nGroup++) {
+    Lights::getInstance()->illuminateStrip(
+      static_cast<lightIdentifier_t>(nGroup), color);
+  }
+  Lights::getInstance()->update();
+  Lights::getInstance()->show();
 }
 
 void setup() {
-  delay(1000);
+  // Read the configuration first since it selects the boot mode
+  uint32_t nStartUS = micros();
+  Configuration::getInstance()->read();
+  restoreLinearization();
+  s_nConfigReadUS = micros() - nStartUS;
+
+  Configuration::getInstance()->setRange(kFastBoot, 0, 1);
+  bool bFastBoot = Configuration::getInstance()->getUInt16(kFastBoot, 1) > 0;
+  if (!bFastBoot) {
+    delay(1000);
+  }
+
   s_strVersion.concat("Dance Pad Firmware " __DATE__);
   s_strVersion.concat(' ');
   s_strVersion.concat(__TIME__);
 
   pinMode(LED_BUILTIN, OUTPUT);
 
-  Configuration::getInstance()->read();
+  Profiles::getInstance()->read();
+  Crosstalk::getInstance()->read();
+  Baselines::getInstance()->read();
+  enableCycleCounter();
 
   Serial.begin(9600);
 
-  calibratePanels();
+  Configuration::getInstance()->setRange(kAutoLights, 0, 1);
+  Configuration::getInstance()->setRange(
+    kHidMode, kHidModeKeyboard, kHidModeGamepad);
+  Configuration::getInstance()->setRange(kCrosstalk, 0, 1);
+  Configuration::getInstance()->setRange(kAdaptiveScan, 0, 1);
+  Configuration::getInstance()->setRange(kSensorStats, 0, 1);
+  Configuration::getInstance()->setRange(kInstantLights, 0, 1);
+  Configuration::getInstance()->setRange(kProfileGesture, 0, 1);
+  onConfigUpdated();
+  Configuration::getInstance()->registerCallback(onConfigUpdated);
+  restoreBaselines();
+  Configuration::getInstance()->setEpoch(bootEpoch());
 
-  // Joystick.useManualSend(true);
-  // Joystick.hat(-1);
-  // Joystick.X(512);
-  // Joystick.Y(512);
-  // Joystick.Z(512);
+  s_scheduler.addPeriodic(
+    "scan", updatePanels, kPriorityScan, kMicrosPerSecond / kScanFrequency);
+  s_scheduler.addPeriodic(
+    "report",
+    updateReport,
+    kPriorityReport,
+    kMicrosPerSecond / kJoystickUpdateFrequency);
+  s_scheduler.addPeriodic(
+    "serial",
+    updateSerial,
+    kPrioritySerial,
+    kMicrosPerSecond / kSerialUpdateFrequency);
+  s_nFlashTask = s_scheduler.addEvent(
+    "flash", flashLights, kPriorityFlash, kFlashDeadlineUS);
+  s_scheduler.addPeriodic(
+    "lights",
+    updateLights,
+    kPriorityLights,
+    kMicrosPerSecond / kLEDUpdateFrequency);
+  s_scheduler.addPeriodic(
+    "baselines",
+    updateBaselines,
+    kPriorityMaintenance,
+    kMicrosPerSecond / kBaselineUpdateFrequency);
 
-  for (int i = 0; i < 3; i++) {
-    CRGB color(i == 0 ? 255 : 0, i == 1 ? 255 : 0, i == 2 ? 255 : 0);
-    Lights::getInstance()->illuminateStrip(enumLightsUpArrow, color);
-    Lights::getInstance()->illuminateStrip(enumLightsDownArrow, color);
-    Lights::getInstance()->illuminateStrip(enumLightsLeftArrow, color);
-    Lights::getInstance()->illuminateStrip(enumLightsRightArrow, color);
-    Lights::getInstance()->update();
-    FastLED.show();
-    FastLED.delay(200);
+  // Gamepad reports are only sent when they change
+  Joystick.useManualSend(true);
+  Joystick.hat(-1);
+
+  if (bFastBoot) {
+    // Run the self-test from the lights task so scanning starts right away
+    s_bSelfTest = true;
+    s_nSelfTestStartMS = millis();
+  } else {
+    for (uint8_t nStep = 0; nStep < kSelfTestSteps; nStep++) {
+      showSelfTest(nStep);
+      FastLED.delay(kSelfTestStepMS);
+    }
   }
+
+  s_nSetupDoneUS = micros();
+  LOG_INFO(kLogBoot, s_nSetupDoneUS, s_nConfigReadUS);
 }
 
 void printSensorValues() {
@@ -186,19 +798,28 @@ void decodeSextetStream() {
 
 // Process data sent over the serial connection
 //
-// Input data can either be lighting data in SextetStream format or a command.
-// When the input is lighting data, no response is sent. All commands are
+// Input data can either be lighting data in SextetStream format, an LED frame
+// starting with `~` (see LedFrame.h), or a command. When the input is lighting
+// data or a frame, no response is sent. All commands are
 // prefixed with `-` and terminated with a newline character. Commands may have
 // a single-line response terminated with a newline character (`\n`).
+//
+// A command may be tagged with a request ID as `#ID -COMMAND`. Its response is
+// then prefixed with `#ID ` and sent even if it's empty, so a host can have
+// several commands in flight and match each response to its command. Lines
+// without the prefix are never responses to tagged commands.
 class SerialProcessor {
 public:
-  SerialProcessor() {
+  SerialProcessor() : m_pFrame(NULL), m_nFrameCycles(0), m_nFrameByteMS(0) {
+    m_strRequestId.reserve(8);
     m_strCommand.reserve(32);
     m_strResponse.reserve(1024);
   }
 
   void update() {
-    if (Serial.available()) {
+    if (m_pFrame) {
+      decodeFrame();
+    } else if (Serial.available()) {
       char c = Serial.read();
       if (c >= 0x30 && c <= 0x6F) {
         // Light state. Read remaining 13 bytes of stream
@@ -207,9 +828,22 @@ public:
 
         // Update the lights
         decodeSextetStream();
-      } else if (c == '-') {
-        // Command terminated by newline
+      } else if (c == kLedFrameStart) {
+        m_pFrame = &Lights::getInstance()->beginFrame();
+        m_nFrameCycles = 0;
+        m_nFrameByteMS = millis();
+        decodeFrame();
+      } else if (c == '-' || c == '#') {
+        // Command terminated by newline, after the request ID if tagged
+        m_strRequestId = "";
+        if (c == '#') {
+          m_strRequestId = Serial.readStringUntil(' ');
+          Serial.readBytes(&c, 1);
+        }
         m_strCommand = Serial.readStringUntil('\n');
+        if (c != '-') {
+          m_strCommand = "";
+        }
         m_strCommand.trim();
         m_strResponse = "";
 
@@ -229,11 +863,66 @@ public:
           onCommandGetValues();
         } else if (m_strCommand.equalsIgnoreCase(kCmdCalibrate)) {
           calibratePanels();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdHealth)) {
+          onCommandGetHealth();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdAdc)) {
+          onCommandGetAdc();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdTasks)) {
+          onCommandGetTasks();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdGeneration)) {
+          onCommandGetGeneration();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdChanges)) {
+          onCommandGetChanges();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdSchema)) {
+          onCommandGetSchema();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdLayout)) {
+          onCommandGetLayout();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdBoot)) {
+          onCommandGetBoot();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdProfiles)) {
+          onCommandGetProfiles();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdProfile)) {
+          onCommandSetProfile();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdSaveProfile)) {
+          onCommandSaveProfile();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdLeds)) {
+          onCommandGetLeds();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdEvents)) {
+          onCommandGetEvents();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdLog)) {
+          onCommandGetLog();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdScan)) {
+          onCommandGetScan();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdCrosstalk)) {
+          onCommandGetCrosstalk();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdCrosstalkMatrix)) {
+          onCommandGetCrosstalkMatrix();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdLearnCrosstalk)) {
+          onCommandLearnCrosstalk();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdFinishCrosstalk)) {
+          onCommandFinishCrosstalk();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdClearCrosstalk)) {
+          Crosstalk::getInstance()->clear();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdSaveCrosstalk)) {
+          Crosstalk::getInstance()->write();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdBaselines)) {
+          onCommandGetBaselines();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdStats)) {
+          onCommandGetStats();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdResetStats)) {
+          resetStats();
+        } else if (m_strCommand.equalsIgnoreCase(kCmdStream)) {
+          onCommandGetStream();
         } else {
           m_strResponse = "Unknown command";
         }
 
-        if (m_strResponse.length() > 0) {
+        if (m_strRequestId.length() > 0) {
+          Serial.print('#');
+          Serial.print(m_strRequestId);
+          Serial.print(' ');
+          Serial.println(m_strResponse);
+        } else if (m_strResponse.length() > 0) {
           Serial.println(m_strResponse);
         }
       }
@@ -249,6 +938,31 @@ private:
   static const String kCmdReset;
   static const String kCmdValues;
   static const String kCmdCalibrate;
+  static const String kCmdHealth;
+  static const String kCmdAdc;
+  static const String kCmdTasks;
+  static const String kCmdGeneration;
+  static const String kCmdChanges;
+  static const String kCmdSchema;
+  static const String kCmdLayout;
+  static const String kCmdBoot;
+  static const String kCmdProfiles;
+  static const String kCmdProfile;
+  static const String kCmdSaveProfile;
+  static const String kCmdLeds;
+  static const String kCmdEvents;
+  static const String kCmdLog;
+  static const String kCmdScan;
+  static const String kCmdCrosstalk;
+  static const String kCmdCrosstalkMatrix;
+  static const String kCmdLearnCrosstalk;
+  static const String kCmdFinishCrosstalk;
+  static const String kCmdClearCrosstalk;
+  static const String kCmdSaveCrosstalk;
+  static const String kCmdBaselines;
+  static const String kCmdStats;
+  static const String kCmdResetStats;
+  static const String kCmdStream;
 
   static const String kConfigTypeStr;
   static const String kConfigTypeUInt16;
@@ -331,27 +1045,430 @@ private:
   }
 
   // Set a configuration value. The sender must provide an additional line:
-  // `TYPE KEY=VALUE\n`, where `TYPE` is `str`, `u16`, or `u32`.
+  // `TYPE KEY=VALUE\n`, where `TYPE` is `str`, `u16`, or `u32`. Integers
+  // outside of the item's range are rejected.
   void onCommandSetConfig() {
     String strType = Serial.readStringUntil(' ');
     String strKey = Serial.readStringUntil('=');
     String strValue = Serial.readStringUntil('\n');
+    Configuration* pConfig = Configuration::getInstance();
+    uint32_t nValue = strtoul(strValue.c_str(), NULL, 10);
     if (strType.equalsIgnoreCase(kConfigTypeStr)) {
-      Configuration::getInstance()->setString(strKey, strValue);
+      pConfig->setString(strKey, strValue);
       m_strResponse = kResponseSuccess;
+    } else if (!pConfig->isInRange(strKey, nValue)) {
+      m_strResponse = kResponseFailure;
     } else if (strType.equalsIgnoreCase(kConfigTypeUInt16)) {
-      Configuration::getInstance()->setUInt16(strKey, atoi(strValue.c_str()));
-      m_strResponse = kResponseSuccess;
+      if (nValue <= UINT16_MAX) {
+        pConfig->setUInt16(strKey, nValue);
+        m_strResponse = kResponseSuccess;
+      } else {
+        m_strResponse = kResponseFailure;
+      }
     } else if (strType.equalsIgnoreCase(kConfigTypeUInt32)) {
-      Configuration::getInstance()->setUInt32(strKey, atoi(strValue.c_str()));
+      pConfig->setUInt32(strKey, nValue);
       m_strResponse = kResponseSuccess;
     } else {
       m_strResponse = kResponseFailure;
     }
   }
 
-  // Save configuration items to EEPROM
-  void onCommandPersist() { Configuration::getInstance()->write(); }
+  // Get the configuration generation
+  void onCommandGetGeneration() {
+    m_strResponse.append(Configuration::getInstance()->getGeneration());
+  }
+
+  // Get configuration items changed after a generation. The sender must
+  // provide an additional line with `GENERATION[:EPOCH]`. The response is
+  // `GENERATION:EPOCH[,*],KEY=VALUE,...`, where `GENERATION` and `EPOCH` are
+  // current and `*` means the configuration was reset after the requested
+  // generation, so all items are included and any others should be discarded.
+  // Generations restart at every boot, so one from another epoch or from the
+  // future was read before the device rebooted and is treated as a reset too.
+  void onCommandGetChanges() {
+    String strLine = Serial.readStringUntil('\n');
+    char* pszEnd;
+    uint32_t nGeneration = strtoul(strLine.c_str(), &pszEnd, 10);
+    Configuration* pConfig = Configuration::getInstance();
+    bool bOtherEpoch =
+      *pszEnd == ':' && strtoul(pszEnd + 1, NULL, 10) != pConfig->getEpoch();
+    m_strResponse.append(pConfig->getGeneration());
+    m_strResponse.append(':');
+    m_strResponse.append(pConfig->getEpoch());
+    if (
+      bOtherEpoch || nGeneration < pConfig->getResetGeneration() ||
+      nGeneration > pConfig->getGeneration()) {
+      nGeneration = 0;
+      m_strResponse.append(",*");
+    }
+
+    String strChanges = pConfig->changesToString(nGeneration);
+    if (strChanges.length() > 0) {
+      m_strResponse.append(',');
+      m_strResponse.append(strChanges);
+    }
+  }
+
+  // Get the name, type, and range of each configuration item
+  void onCommandGetSchema() {
+    m_strResponse = Configuration::getInstance()->schemaToString();
+  }
+
+  // Get the layout of the panels as `NAME=ORIENTATION:N:E:S:W,...`, where the
+  // pins are corrected for the orientation.
+  void onCommandGetLayout() {
+    appendPanelLayout("up", s_panelUp);
+    appendPanelLayout("down", s_panelDown);
+    appendPanelLayout("left", s_panelLeft);
+    appendPanelLayout("right", s_panelRight);
+
+    // Remove trailing comma
+    m_strResponse.remove(m_strResponse.length() - 1);
+  }
+
+  void appendPanelLayout(const char* pszName, const Panel& panel) {
+    m_strResponse.append(pszName);
+    m_strResponse.append('=');
+    m_strResponse.append(panel.m_orientation);
+    m_strResponse.append(':');
+    m_strResponse.append(panel.getNorthSensor().getPin());
+    m_strResponse.append(':');
+    m_strResponse.append(panel.getEastSensor().getPin());
+    m_strResponse.append(':');
+    m_strResponse.append(panel.getSouthSensor().getPin());
+    m_strResponse.append(':');
+    m_strResponse.append(panel.getWestSensor().getPin());
+    m_strResponse.append(',');
+  }
+
+  // Get the boot timing as `CONFIG_US,SETUP_US,FIRST_REPORT_US`, where
+  // CONFIG_US is the time taken to read the configuration and the others are
+  // measured from reset.
+  void onCommandGetBoot() {
+    m_strResponse.append(s_nConfigReadUS);
+    m_strResponse.append(',');
+    m_strResponse.append(s_nSetupDoneUS);
+    m_strResponse.append(',');
+    m_strResponse.append(s_nFirstReportUS);
+  }
+
+  // Get the stored profiles as `ACTIVE,NAME0,NAME1,...`, where `ACTIVE` is
+  // the index of the profile applied most recently or 255 for none. Empty
+  // profiles have empty names.
+  void onCommandGetProfiles() {
+    Profiles* pProfiles = Profiles::getInstance();
+    m_strResponse.append(pProfiles->getActive());
+    for (uint8_t nProfile = 0; nProfile < kMaxProfiles; nProfile++) {
+      m_strResponse.append(',');
+      m_strResponse.append(pProfiles->getName(nProfile));
+    }
+  }
+
+  // Switch to a stored profile. The sender must provide an additional line
+  // with the index of the profile.
+  void onCommandSetProfile() {
+    uint8_t nProfile = Serial.readStringUntil('\n').toInt();
+    m_strResponse = Profiles::getInstance()->apply(nProfile, s_apPanels)
+                      ? kResponseSuccess
+                      : kResponseFailure;
+  }
+
+  // Store the current thresholds and lighting settings in a profile. The
+  // sender must provide an additional line: `INDEX NAME\n`. Names are
+  // truncated to 11 characters and may not contain commas.
+  void onCommandSaveProfile() {
+    uint8_t nProfile = Serial.readStringUntil(' ').toInt();
+    String strName = Serial.readStringUntil('\n');
+    strName.trim();
+    if (strName.indexOf(',') >= 0) {
+      m_strResponse = kResponseFailure;
+      return;
+    }
+    m_strResponse =
+      Profiles::getInstance()->save(nProfile, strName.c_str(), s_apPanels)
+        ? kResponseSuccess
+        : kResponseFailure;
+  }
+
+  // Get the LED topology and how many frames were sent as
+  // `STRANDS,LEDS_PER_STRAND,FRAMES_SENT,FRAMES_SKIPPED,SEGMENT,...`, where
+  // each segment is `GROUP:STRAND:OFFSET:COUNT:X:Y:DX:DY`. See LightSegment.
+  void onCommandGetLeds() {
+    Lights* pLights = Lights::getInstance();
+    m_strResponse.append(pLights->getNumStrands());
+    m_strResponse.append(',');
+    m_strResponse.append(pLights->getLedsPerStrand());
+    m_strResponse.append(',');
+    m_strResponse.append(pLights->getFramesSent());
+    m_strResponse.append(',');
+    m_strResponse.append(pLights->getFramesSkipped());
+    for (uint8_t nSegment = 0; nSegment < pLights->getNumSegments();
+         nSegment++) {
+      const LightSegment& segment = pLights->getSegment(nSegment);
+      m_strResponse.append(',');
+      m_strResponse.append(segment.nGroup);
+      m_strResponse.append(':');
+      m_strResponse.append(segment.nStrand);
+      m_strResponse.append(':');
+      m_strResponse.append(segment.nOffset);
+      m_strResponse.append(':');
+      m_strResponse.append(segment.nCount);
+      m_strResponse.append(':');
+      m_strResponse.append(segment.nX);
+      m_strResponse.append(':');
+      m_strResponse.append(segment.nY);
+      m_strResponse.append(':');
+      m_strResponse.append(segment.nStepX);
+      m_strResponse.append(':');
+      m_strResponse.append(segment.nStepY);
+    }
+  }
+
+  // Get press and release events after a cursor. The sender must provide an
+  // additional line with the cursor, which is 0 at first and then the NEXT
+  // value of the previous response. The response is
+  // `NEXT,LOST,TIME_US:PANEL:SENSOR:PRESSED:PEAK,...`, where LOST is the
+  // number of events overwritten before they were fetched, sensors are in
+  // north, east, south, west order before correcting for orientation, and
+  // PEAK is the pressure when pressed or the highest pressure during the
+  // press when released. At most 32 events are sent, so fetch again while
+  // NEXT is behind the journal.
+  void onCommandGetEvents() {
+    uint32_t nCursor = strtoul(Serial.readStringUntil('\n').c_str(), NULL, 10);
+    PressEvent aEvents[kMaxEventsPerResponse];
+    uint32_t nLost;
+    uint16_t nCount =
+      s_journal.read(nCursor, aEvents, kMaxEventsPerResponse, nLost);
+
+    m_strResponse.append(nCursor);
+    m_strResponse.append(',');
+    m_strResponse.append(nLost);
+    for (uint16_t nEvent = 0; nEvent < nCount; nEvent++) {
+      const PressEvent& event = aEvents[nEvent];
+      m_strResponse.append(',');
+      m_strResponse.append(event.nTimeUS);
+      m_strResponse.append(':');
+      m_strResponse.append(event.nSensor / 4);
+      m_strResponse.append(':');
+      m_strResponse.append(event.nSensor % 4);
+      m_strResponse.append(':');
+      m_strResponse.append(event.nFlags & kEventPressed ? 1 : 0);
+      m_strResponse.append(':');
+      m_strResponse.append(event.nPeak);
+    }
+  }
+
+  // Get log records after a cursor, which works as for the events command.
+  // The response is `NEXT,LOST,TIME_US:LEVEL:MESSAGE:ARG:...,...`, where
+  // MESSAGE is the index of the message in LogMessages.h and each ARG is an
+  // unsigned 32-bit integer, the two's complement of signed ones. At most 16
+  // records are sent.
+  void onCommandGetLog() {
+    uint32_t nCursor = strtoul(Serial.readStringUntil('\n').c_str(), NULL, 10);
+    LogRecord aRecords[kMaxLogRecordsPerResponse];
+    uint32_t nLost;
+    uint16_t nCount =
+      getLog().read(nCursor, aRecords, kMaxLogRecordsPerResponse, nLost);
+
+    m_strResponse.append(nCursor);
+    m_strResponse.append(',');
+    m_strResponse.append(nLost);
+    for (uint16_t nRecord = 0; nRecord < nCount; nRecord++) {
+      const LogRecord& record = aRecords[nRecord];
+      m_strResponse.append(',');
+      m_strResponse.append(record.nTimeUS);
+      m_strResponse.append(':');
+      m_strResponse.append(record.nLevel);
+      m_strResponse.append(':');
+      m_strResponse.append(record.nMessage);
+      for (uint8_t nArg = 0; nArg < record.nArgs; nArg++) {
+        m_strResponse.append(':');
+        m_strResponse.append(record.anArg[nArg]);
+      }
+    }
+  }
+
+  // Get the state of scanning as
+  // `ADAPTIVE,SLEEPING,ACTIVE,MAX_LATENCY_US,RATE_UP,RATE_DOWN,...`, where
+  // ACTIVE has a bit per panel sampled on every scan, MAX_LATENCY_US is the
+  // longest a press can go unseen, and each RATE is a panel's samples per
+  // second over the last second.
+  void onCommandGetScan() {
+    bool bAdaptive = s_bAdaptiveScan && !s_bCrosstalk &&
+                     !Crosstalk::getInstance()->isLearning();
+    m_strResponse.append(bAdaptive ? 1 : 0);
+    m_strResponse.append(',');
+    m_strResponse.append(bAdaptive && s_scanPlanner.isSleeping() ? 1 : 0);
+    m_strResponse.append(',');
+    m_strResponse.append(
+      bAdaptive ? s_scanPlanner.getActive() : s_scanPlanner.kAllPanels);
+    m_strResponse.append(',');
+    m_strResponse.append(
+      (bAdaptive ? s_scanPlanner.getMaxInterval() : 1) * kMicrosPerSecond /
+      kScanFrequency);
+    for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+      m_strResponse.append(',');
+      m_strResponse.append(s_scanPlanner.getRate(nPanel));
+    }
+  }
+
+  // Get the state of crosstalk compensation as
+  // `ENABLED,LEARNING_PANEL,SAMPLES,CYCLES,MAX_CYCLES`, where LEARNING_PANEL is
+  // the index of the panel being learned or 255 for none and CYCLES is the CPU
+  // cycles taken to compensate a scan.
+  void onCommandGetCrosstalk() {
+    Crosstalk* pCrosstalk = Crosstalk::getInstance();
+    m_strResponse.append(s_bCrosstalk ? 1 : 0);
+    m_strResponse.append(',');
+    m_strResponse.append(pCrosstalk->getLearningPanel());
+    m_strResponse.append(',');
+    m_strResponse.append(pCrosstalk->getNumSamples());
+    m_strResponse.append(',');
+    m_strResponse.append(s_nCrosstalkCycles);
+    m_strResponse.append(',');
+    m_strResponse.append(s_nMaxCrosstalkCycles);
+  }
+
+  // Get the crosstalk coefficients with 14 fractional bits, a row of 16 for
+  // each sensor in the order used by profiles. Each value is the coupling from
+  // a sensor into the sensor of the row.
+  void onCommandGetCrosstalkMatrix() {
+    Crosstalk* pCrosstalk = Crosstalk::getInstance();
+    for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+      for (uint8_t nSource = 0; nSource < kCrosstalkSensors; nSource++) {
+        m_strResponse.append(pCrosstalk->get(nVictim, nSource));
+        m_strResponse.append(',');
+      }
+    }
+
+    // Remove trailing comma
+    m_strResponse.remove(m_strResponse.length() - 1);
+  }
+
+  // Start learning the crosstalk from a panel while only it is pressed. The
+  // sender must provide an additional line with the index of the panel.
+  void onCommandLearnCrosstalk() {
+    uint8_t nPanel = Serial.readStringUntil('\n').toInt();
+    if (nPanel >= kCrosstalkPanels) {
+      m_strResponse = kResponseFailure;
+      return;
+    }
+    Crosstalk::getInstance()->startLearning(
+      nPanel, kCrosstalkLearnMinLoad << Adc::getInstance()->getShift());
+    m_strResponse = kResponseSuccess;
+  }
+
+  // Solve for the crosstalk from the panel being learned. Fails if too few
+  // presses were sampled. Coefficients are kept in memory until saved.
+  void onCommandFinishCrosstalk() {
+    m_strResponse = Crosstalk::getInstance()->finishLearning()
+                      ? kResponseSuccess
+                      : kResponseFailure;
+  }
+
+  // Get the saved baselines and how they were used at boot as
+  // `SAVED,SEEDED,WRITES,CHECK:BASELINE:NOISE,...`, where SAVED is 1 if there
+  // is a valid record, SEEDED is the number of sensors seeded from it at boot,
+  // and WRITES the number of records written since. Each sensor in the order
+  // used by profiles has its boot check result (see enumBaselineCheck) and its
+  // current baseline and noise for 10-bit readings.
+  void onCommandGetBaselines() {
+    Baselines* pBaselines = Baselines::getInstance();
+    m_strResponse.append(pBaselines->isValid() ? 1 : 0);
+    m_strResponse.append(',');
+    m_strResponse.append(s_nBaselinesSeeded);
+    m_strResponse.append(',');
+    m_strResponse.append(pBaselines->getWrites());
+    uint8_t nShift = Adc::getInstance()->getShift();
+    for (uint8_t n = 0; n < kBaselineSensors; n++) {
+      const Sensor& sensor = s_apPanels[n / 4]->getSensor(n % 4);
+      m_strResponse.append(',');
+      m_strResponse.append(s_aBaselineCheck[n]);
+      m_strResponse.append(':');
+      m_strResponse.append(sensor.getBaseline() >> nShift);
+      m_strResponse.append(':');
+      m_strResponse.append(sensor.getNoise() >> nShift);
+    }
+  }
+
+  // Get the statistics of a sensor since they were last reset. The sender
+  // must provide an additional line with the index of the sensor in the order
+  // used by profiles. The response is
+  // `SHIFT,ELAPSED_MS,IDLE,PRESSED,PEAKS,IDLE_BINS,PRESSED_BINS`, where SHIFT
+  // is the bits of ADC resolution above 10 of all values. IDLE has the
+  // distances from the baseline while idle, PRESSED the loads while pressed,
+  // and PEAKS the highest load of each press, each as
+  // `COUNT:SUM:SUM_OF_SQUARES:MIN:MAX`. The bins are
+  // `LOW:WIDTH:COUNT0:COUNT1:...`, where the first and last bins include
+  // everything outside them. Statistics are only kept while sensor_stats is
+  // set.
+  void onCommandGetStats() {
+    uint8_t nSensor = Serial.readStringUntil('\n').toInt();
+    if (nSensor >= kProfileSensors) {
+      m_strResponse = kResponseFailure;
+      return;
+    }
+    const SensorStats<kStatsBins>& stats = s_aStats[nSensor];
+    m_strResponse.append(Adc::getInstance()->getShift());
+    m_strResponse.append(',');
+    m_strResponse.append(millis() - s_nStatsStartMS);
+    appendMoments(stats.getIdle());
+    appendMoments(stats.getPressed());
+    appendMoments(stats.getPeaks());
+    appendHistogram(stats.getIdleBins());
+    appendHistogram(stats.getPressedBins());
+  }
+
+  void appendMoments(const Moments& moments) {
+    m_strResponse.append(',');
+    m_strResponse.append(moments.getCount());
+    m_strResponse.append(':');
+    if (moments.getSum() < 0) {
+      m_strResponse.append('-');
+    }
+    appendUInt64(
+      moments.getSum() < 0 ? -static_cast<uint64_t>(moments.getSum())
+                           : moments.getSum());
+    m_strResponse.append(':');
+    appendUInt64(moments.getSumSquares());
+    m_strResponse.append(':');
+    m_strResponse.append(moments.getCount() ? moments.getMin() : 0);
+    m_strResponse.append(':');
+    m_strResponse.append(moments.getCount() ? moments.getMax() : 0);
+  }
+
+  void appendHistogram(const Histogram<kStatsBins>& histogram) {
+    m_strResponse.append(',');
+    m_strResponse.append(histogram.getLow());
+    m_strResponse.append(':');
+    m_strResponse.append(histogram.getWidth());
+    for (uint8_t nBin = 0; nBin < kStatsBins; nBin++) {
+      m_strResponse.append(':');
+      m_strResponse.append(histogram.getCount(nBin));
+    }
+  }
+
+  // String has no 64-bit conversions
+  void appendUInt64(uint64_t nValue) {
+    char szDigits[20];
+    uint8_t nLength = 0;
+    do {
+      szDigits[nLength++] = '0' + nValue % 10;
+      nValue /= 10;
+    } while (nValue);
+    while (nLength) {
+      m_strResponse.append(szDigits[--nLength]);
+    }
+  }
+
+  // Save configuration items to EEPROM. Fails if they don't fit in the space
+  // left for them, see EepromLayout.h. Linearization tables go to a region of
+  // their own.
+  void onCommandPersist() {
+    saveLinearization();
+    m_strResponse = Configuration::getInstance()->write() ? kResponseSuccess
+                                                          : kResponseFailure;
+  }
 
   // Reset configuration items in memory
   void onCommandReset() { Configuration::getInstance()->reset(); }
@@ -378,7 +1495,136 @@ private:
     m_strResponse.remove(m_strResponse.length() - 1);
   }
 
+  // Get the health of each sensor as `FAULTY,STATUS,STRIKES` for each sensor
+  // in the same order as the values command.
+  void onCommandGetHealth() {
+    for (auto const* pPanel :
+         {&s_panelUp, &s_panelDown, &s_panelLeft, &s_panelRight}) {
+      for (auto const* pSensor :
+           {&pPanel->getNorthSensor(),
+            &pPanel->getEastSensor(),
+            &pPanel->getSouthSensor(),
+            &pPanel->getWestSensor()}) {
+        const SensorHealth& health = pSensor->getHealth();
+        m_strResponse.append(pSensor->isHealthy() ? 0 : 1);
+        m_strResponse.append(',');
+        m_strResponse.append(static_cast<int>(health.getStatus()));
+        m_strResponse.append(',');
+        m_strResponse.append(health.getStrikes());
+        m_strResponse.append(',');
+      }
+    }
+
+    // Remove trailing comma
+    m_strResponse.remove(m_strResponse.length() - 1);
+  }
+
+  // Get the ADC profile and its cost as `PROFILE,NUM_PROFILES,RESOLUTION,
+  // AVERAGING,MAX_VALUE,SAMPLE_NS,SCAN_US,MAX_SCAN_US`, where SAMPLE_NS is the
+  // time to read one sensor and SCAN_US is the time to update all panels.
+  void onCommandGetAdc() {
+    Adc* pAdc = Adc::getInstance();
+    m_strResponse.append(pAdc->getProfile());
+    m_strResponse.append(',');
+    m_strResponse.append(Adc::getNumProfiles());
+    m_strResponse.append(',');
+    m_strResponse.append(pAdc->getProfileSettings().nResolution);
+    m_strResponse.append(',');
+    m_strResponse.append(pAdc->getProfileSettings().nAveraging);
+    m_strResponse.append(',');
+    m_strResponse.append(pAdc->getMaxValue());
+    m_strResponse.append(',');
+    m_strResponse.append(pAdc->getSampleTimeNS());
+    m_strResponse.append(',');
+    m_strResponse.append(s_nScanTimeUS);
+    m_strResponse.append(',');
+    m_strResponse.append(s_nMaxScanTimeUS);
+  }
+
+  // Get the run time accounting of each scheduled task as
+  // `NAME:RUNS:OVERRUNS:SKIPPED:MAX_RUN_US:MAX_LATENCY_US,...` and reset it.
+  void onCommandGetTasks() {
+    for (uint8_t nTask = 0; nTask < s_scheduler.getNumTasks(); nTask++) {
+      const TaskStats& stats = s_scheduler.getStats(nTask);
+      m_strResponse.append(s_scheduler.getName(nTask));
+      m_strResponse.append(':');
+      m_strResponse.append(stats.nRuns);
+      m_strResponse.append(':');
+      m_strResponse.append(stats.nOverruns);
+      m_strResponse.append(':');
+      m_strResponse.append(stats.nSkipped);
+      m_strResponse.append(':');
+      m_strResponse.append(stats.nMaxRunTimeUS);
+      m_strResponse.append(':');
+      m_strResponse.append(stats.nMaxLatencyUS);
+      m_strResponse.append(',');
+    }
+    s_scheduler.resetStats();
+
+    // Remove trailing comma
+    m_strResponse.remove(m_strResponse.length() - 1);
+  }
+
+  // Get the state of streamed LED frames as `STREAMING,FRAMES,DROPPED,CYCLES,
+  // MAX_CYCLES,MAX_SLICE_CYCLES`, where FRAMES were shown, DROPPED were invalid
+  // or waiting for a keyframe, and CYCLES are the CPU cycles taken to decode a
+  // frame, including reading it and correcting its colors.
+  void onCommandGetStream() {
+    Lights* pLights = Lights::getInstance();
+    m_strResponse.append(pLights->isStreaming() ? 1 : 0);
+    m_strResponse.append(',');
+    m_strResponse.append(pLights->getStreamedFrames());
+    m_strResponse.append(',');
+    m_strResponse.append(pLights->getDroppedFrames());
+    m_strResponse.append(',');
+    m_strResponse.append(s_nFrameCycles);
+    m_strResponse.append(',');
+    m_strResponse.append(s_nMaxFrameCycles);
+    m_strResponse.append(',');
+    m_strResponse.append(s_nMaxFrameSliceCycles);
+  }
+
+  // Decode the bytes of the current LED frame that have arrived, up to
+  // kMaxFrameBytesPerUpdate
+  void decodeFrame() {
+    uint32_t nStartCycles = getCycleCount();
+    LedFrameDecoder::Result result = LedFrameDecoder::enumFrameIncomplete;
+    uint16_t nBytes = 0;
+    while (result == LedFrameDecoder::enumFrameIncomplete &&
+           nBytes < kMaxFrameBytesPerUpdate && Serial.available()) {
+      result = m_pFrame->feed(Serial.read());
+      nBytes++;
+    }
+
+    if (nBytes) {
+      m_nFrameByteMS = millis();
+    } else if (millis() - m_nFrameByteMS >= kFrameTimeoutMS) {
+      result = LedFrameDecoder::enumFrameInvalid;
+    }
+    if (result != LedFrameDecoder::enumFrameIncomplete) {
+      Lights::getInstance()->endFrame(result);
+      m_pFrame = NULL;
+    }
+
+    uint32_t nCycles = getCycleCount() - nStartCycles;
+    if (nCycles > s_nMaxFrameSliceCycles) {
+      s_nMaxFrameSliceCycles = nCycles;
+    }
+    m_nFrameCycles += nCycles;
+    if (result == LedFrameDecoder::enumFrameDone) {
+      s_nFrameCycles = m_nFrameCycles;
+      if (s_nFrameCycles > s_nMaxFrameCycles) {
+        s_nMaxFrameCycles = s_nFrameCycles;
+      }
+    }
+  }
+
+  String m_strRequestId; // Empty if the command isn't tagged
   String m_strCommand, m_strResponse;
+
+  LedFrameDecoder* m_pFrame; // Frame being decoded, if any
+  uint32_t m_nFrameCycles;   // Spent on the frame so far
+  uint32_t m_nFrameByteMS;   // When a byte of the frame last arrived
 };
 
 const String SerialProcessor::kCmdVersion = "version";
@@ -389,6 +1635,31 @@ const String SerialProcessor::kCmdPersist = "persist";
 const String SerialProcessor::kCmdReset = "reset";
 const String SerialProcessor::kCmdValues = "v";
 const String SerialProcessor::kCmdCalibrate = "calibrate";
+const String SerialProcessor::kCmdHealth = "health";
+const String SerialProcessor::kCmdAdc = "adc";
+const String SerialProcessor::kCmdTasks = "tasks";
+const String SerialProcessor::kCmdGeneration = "gen";
+const String SerialProcessor::kCmdChanges = "changes";
+const String SerialProcessor::kCmdSchema = "schema";
+const String SerialProcessor::kCmdLayout = "layout";
+const String SerialProcessor::kCmdBoot = "boot";
+const String SerialProcessor::kCmdProfiles = "profiles";
+const String SerialProcessor::kCmdProfile = "profile";
+const String SerialProcessor::kCmdSaveProfile = "saveprofile";
+const String SerialProcessor::kCmdLeds = "leds";
+const String SerialProcessor::kCmdEvents = "events";
+const String SerialProcessor::kCmdLog = "log";
+const String SerialProcessor::kCmdScan = "scan";
+const String SerialProcessor::kCmdCrosstalk = "crosstalk";
+const String SerialProcessor::kCmdCrosstalkMatrix = "crosstalkmatrix";
+const String SerialProcessor::kCmdLearnCrosstalk = "learncrosstalk";
+const String SerialProcessor::kCmdFinishCrosstalk = "finishcrosstalk";
+const String SerialProcessor::kCmdClearCrosstalk = "clearcrosstalk";
+const String SerialProcessor::kCmdSaveCrosstalk = "savecrosstalk";
+const String SerialProcessor::kCmdBaselines = "baselines";
+const String SerialProcessor::kCmdStats = "stats";
+const String SerialProcessor::kCmdResetStats = "resetstats";
+const String SerialProcessor::kCmdStream = "stream";
 
 const String SerialProcessor::kResponseSuccess = "!";
 const String SerialProcessor::kResponseFailure = "?";
@@ -399,14 +1670,42 @@ const String SerialProcessor::kConfigTypeUInt32 = "u32";
 
 static SerialProcessor s_serialProcessor;
 
-// void updateJoystick()
-// {
-//     Joystick.button(JOY_UP_BUTTON, s_panelUp.isPressed());
-//     Joystick.button(JOY_DOWN_BUTTON, s_panelDown.isPressed());
-//     Joystick.button(JOY_LEFT_BUTTON, s_panelLeft.isPressed());
-//     Joystick.button(JOY_RIGHT_BUTTON, s_panelRight.isPressed());
-//     Joystick.send_now();
-// }
+// Send a gamepad report if it differs from the last one sent. Packing uses
+// only the stack, and the Joystick calls write straight into the USB buffer.
+static void sendGamepadReport(const GamepadReport& report) {
+  Joystick.button(JOY_UP_BUTTON, report.nButtons & 0x01);
+  Joystick.button(JOY_DOWN_BUTTON, report.nButtons & 0x02);
+  Joystick.button(JOY_LEFT_BUTTON, report.nButtons & 0x04);
+  Joystick.button(JOY_RIGHT_BUTTON, report.nButtons & 0x08);
+  Joystick.X(report.anAxes[0]);
+  Joystick.Y(report.anAxes[1]);
+  Joystick.Z(report.anAxes[2]);
+  Joystick.Zrotate(report.anAxes[3]);
+  Joystick.send_now();
+}
+
+void updateGamepad() {
+  GamepadReport report;
+  report.nButtons = 0;
+  uint8_t nShift = Adc::getInstance()->getShift();
+  for (uint8_t nPanel = 0; nPanel < kProfilePanels; nPanel++) {
+    const Panel* pPanel = s_apPanels[nPanel];
+    uint16_t nLoad = pPanel->getLoad() >> nShift;
+    report.nButtons |= pPanel->isPressed() << nPanel;
+    report.anAxes[nPanel] =
+      nLoad < kGamepadDeadband ? 0 : (nLoad > 1023 ? 1023 : nLoad);
+  }
+
+  if (
+    s_bGamepadReportSent &&
+    memcmp(&report, &s_lastGamepadReport, sizeof(report)) == 0) {
+    return;
+  }
+
+  sendGamepadReport(report);
+  s_lastGamepadReport = report;
+  s_bGamepadReportSent = true;
+}
 
 void updateKeyboard() {
   if (s_panelUp.isPressed()) {
@@ -432,45 +1731,70 @@ void updateKeyboard() {
   Keyboard.send_now();
 }
 
-static elapsedMicros s_timeSinceJoystickUpdate;
-static elapsedMicros s_timeSinceLEDUpdate;
+// Release every button or key of a device, as if all panels were released
+void releaseHidDevice(uint16_t nHidMode) {
+  if (nHidMode == kHidModeGamepad) {
+    GamepadReport report;
+    memset(&report, 0, sizeof(report));
+    sendGamepadReport(report);
+    // The next report is sent whatever it holds
+    s_bGamepadReportSent = false;
+  } else {
+    Keyboard.releaseAll();
+    Keyboard.send_now();
+  }
+}
 
-const uint32_t kMicrosPerSecond = 1000000;
+void updateReport() {
+  if (s_nHidMode == kHidModeGamepad) {
+    updateGamepad();
+  } else {
+    updateKeyboard();
+  }
 
-static const String kAutoLights("auto_lights");
+  if (!s_nFirstReportUS) {
+    s_nFirstReportUS = micros();
+  }
+}
 
-void loop() {
-  // It takes about 17us to sample each sensor (taking the average of 4
-  // readings within the analogRead() call), so with 16 sensors we can read
-  // all panels about 3 times and still have about 150-200us left for lights,
-  // so read intervals should be very consistent.
-  updatePanels();
+void updateSerial() {
+  // Catch the configuration up with a profile switch before any command can
+  // change it
+  Profiles::getInstance()->commit(s_apPanels);
   s_serialProcessor.update();
+}
 
-  // Limit frequency of joystick reports
-  if (
-    s_timeSinceJoystickUpdate >= kMicrosPerSecond / kJoystickUpdateFrequency) {
-    s_timeSinceJoystickUpdate -= kMicrosPerSecond / kJoystickUpdateFrequency;
-    // updateJoystick();
-    updateKeyboard();
+void updateLights() {
+  if (s_bSelfTest) {
+    uint32_t nStep = (millis() - s_nSelfTestStartMS) / kSelfTestStepMS;
+    if (nStep < kSelfTestSteps) {
+      showSelfTest(nStep);
+      return;
+    }
+    s_bSelfTest = false;
   }
 
-  // Limit frequency of LEDs
-  if (s_timeSinceLEDUpdate >= kMicrosPerSecond / kLEDUpdateFrequency) {
-    s_timeSinceLEDUpdate -= kMicrosPerSecond / kLEDUpdateFrequency;
-    if (Configuration::getInstance()->getUInt16(kAutoLights, 0) > 0) {
-      Lights::getInstance()->setStatus(
-        enumLightsLeftArrow, s_panelLeft.isPressed());
-      Lights::getInstance()->setStatus(
-        enumLightsRightArrow, s_panelRight.isPressed());
-      Lights::getInstance()->setStatus(
-        enumLightsUpArrow, s_panelUp.isPressed());
-      Lights::getInstance()->setStatus(
-        enumLightsDownArrow, s_panelDown.isPressed());
-    }
-    Lights::getInstance()->update();
-    FastLED.show();
+  if (s_bAutoLights) {
+    Lights::getInstance()->setStatus(
+      enumLightsLeftArrow, s_panelLeft.isPressed());
+    Lights::getInstance()->setStatus(
+      enumLightsRightArrow, s_panelRight.isPressed());
+    Lights::getInstance()->setStatus(enumLightsUpArrow, s_panelUp.isPressed());
+    Lights::getInstance()->setStatus(
+      enumLightsDownArrow, s_panelDown.isPressed());
   }
+  Lights::getInstance()->update();
+  Lights::getInstance()->show();
+}
+
+void loop() {
+  // With the default ADC profile it takes about 17us to sample each sensor
+  // (taking the average of 4 readings within the analogRead() call), so with
+  // 16 sensors a scan takes about 270us. Scanning at 3 kHz leaves about 60us
+  // per scan for the other tasks, so read intervals should be very consistent.
+  // Other profiles trade scan time for resolution; see the `adc` command.
+  // Overruns are reported by the `tasks` command.
+  s_scheduler.runOnce();
 
   // printSensorValues();
-}
\ No newline at end of file
+}
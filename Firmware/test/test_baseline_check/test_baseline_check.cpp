@@ -0,0 +1,155 @@
+//
+// Host tests for checking saved baselines against live readings at boot.
+//
+#include <BaselineCheck.h>
+#include <unity.h>
+
+static const uint8_t kSensors = 4;
+static const uint16_t kMinTolerance = 8;
+
+static const uint16_t kStored[kSensors] = {100, 200, 300, 400};
+static const uint16_t kNoise[kSensors] = {1, 1, 5, 1};
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_tolerance_scales_with_noise() {
+  TEST_ASSERT_EQUAL_UINT16(8, baselineTolerance(0, kMinTolerance));
+  TEST_ASSERT_EQUAL_UINT16(8, baselineTolerance(2, kMinTolerance));
+  TEST_ASSERT_EQUAL_UINT16(20, baselineTolerance(5, kMinTolerance));
+  TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, baselineTolerance(20000, 0));
+}
+
+void test_keeps_agreeing_baselines() {
+  uint16_t anLive[kSensors] = {103, 195, 318, 400};
+  uint16_t anBaseline[kSensors];
+  enumBaselineCheck aResult[kSensors];
+
+  TEST_ASSERT_EQUAL_UINT8(
+    4,
+    checkBaselines(
+      kSensors, kStored, kNoise, anLive, kMinTolerance, anBaseline, aResult));
+  for (uint8_t n = 0; n < kSensors; n++) {
+    TEST_ASSERT_EQUAL_INT(enumBaselineKept, aResult[n]);
+    TEST_ASSERT_EQUAL_UINT16(kStored[n], anBaseline[n]);
+  }
+}
+
+// Someone standing on the first two sensors at boot
+void test_keeps_baselines_under_load() {
+  uint16_t anLive[kSensors] = {600, 450, 300, 400};
+  uint16_t anBaseline[kSensors];
+  enumBaselineCheck aResult[kSensors];
+
+  TEST_ASSERT_EQUAL_UINT8(
+    4,
+    checkBaselines(
+      kSensors, kStored, kNoise, anLive, kMinTolerance, anBaseline, aResult));
+  TEST_ASSERT_EQUAL_INT(enumBaselineLoaded, aResult[0]);
+  TEST_ASSERT_EQUAL_INT(enumBaselineLoaded, aResult[1]);
+  TEST_ASSERT_EQUAL_UINT16(100, anBaseline[0]);
+  TEST_ASSERT_EQUAL_UINT16(200, anBaseline[1]);
+}
+
+void test_replaces_stale_baselines() {
+  uint16_t anLive[kSensors] = {100, 150, 300, 400};
+  uint16_t anBaseline[kSensors];
+  enumBaselineCheck aResult[kSensors];
+
+  TEST_ASSERT_EQUAL_UINT8(
+    3,
+    checkBaselines(
+      kSensors, kStored, kNoise, anLive, kMinTolerance, anBaseline, aResult));
+  TEST_ASSERT_EQUAL_INT(enumBaselineStale, aResult[1]);
+  TEST_ASSERT_EQUAL_UINT16(150, anBaseline[1]);
+}
+
+// A shift of every reading can't be feet on the pad
+void test_rejects_record_when_every_sensor_is_above() {
+  uint16_t anLive[kSensors] = {200, 300, 400, 500};
+  uint16_t anBaseline[kSensors];
+  enumBaselineCheck aResult[kSensors];
+
+  TEST_ASSERT_EQUAL_UINT8(
+    0,
+    checkBaselines(
+      kSensors, kStored, kNoise, anLive, kMinTolerance, anBaseline, aResult));
+  for (uint8_t n = 0; n < kSensors; n++) {
+    TEST_ASSERT_EQUAL_INT(enumBaselineMissing, aResult[n]);
+    TEST_ASSERT_EQUAL_UINT16(anLive[n], anBaseline[n]);
+  }
+}
+
+void test_uses_live_readings_without_record() {
+  uint16_t anLive[kSensors] = {90, 600, 310, 20};
+  uint16_t anBaseline[kSensors];
+  enumBaselineCheck aResult[kSensors];
+
+  TEST_ASSERT_EQUAL_UINT8(
+    0,
+    checkBaselines(
+      kSensors, NULL, NULL, anLive, kMinTolerance, anBaseline, aResult));
+  for (uint8_t n = 0; n < kSensors; n++) {
+    TEST_ASSERT_EQUAL_INT(enumBaselineMissing, aResult[n]);
+    TEST_ASSERT_EQUAL_UINT16(anLive[n], anBaseline[n]);
+  }
+}
+
+// A stored baseline too low for its sensor reads as a press that never ends
+void test_expires_loaded_baseline_that_stays_flat() {
+  LoadedBaselineWatch watch;
+  watch.start(600, 8, 0);
+  TEST_ASSERT_TRUE(watch.isWatching());
+
+  uint32_t nTimeMS = 0;
+  for (; nTimeMS < kLoadedBaselineMS; nTimeMS += 1000) {
+    TEST_ASSERT_FALSE(watch.update(600 + nTimeMS / 1000 % 3, true, nTimeMS));
+  }
+  TEST_ASSERT_TRUE(watch.update(605, true, nTimeMS));
+  TEST_ASSERT_FALSE(watch.isWatching());
+  TEST_ASSERT_FALSE(watch.update(605, true, nTimeMS + 1000));
+}
+
+// Someone standing on the panel shifts their weight
+void test_keeps_loaded_baseline_while_reading_moves() {
+  LoadedBaselineWatch watch;
+  watch.start(600, 8, 0);
+
+  uint32_t nTimeMS = 0;
+  for (; nTimeMS < 3 * kLoadedBaselineMS; nTimeMS += 1000) {
+    uint16_t nPressure = nTimeMS / 1000 % 8 == 0 ? 650 : 600;
+    TEST_ASSERT_FALSE(watch.update(nPressure, true, nTimeMS));
+  }
+  TEST_ASSERT_TRUE(watch.isWatching());
+
+  // Until they stand still
+  TEST_ASSERT_FALSE(watch.update(650, true, nTimeMS));
+  TEST_ASSERT_FALSE(watch.update(650, true, nTimeMS + kLoadedBaselineMS - 1));
+  TEST_ASSERT_TRUE(watch.update(650, true, nTimeMS + kLoadedBaselineMS));
+}
+
+// A release shows the stored baseline was below a real load
+void test_keeps_loaded_baseline_once_released() {
+  LoadedBaselineWatch watch;
+  watch.start(600, 8, 0);
+
+  TEST_ASSERT_FALSE(watch.update(600, true, 1000));
+  TEST_ASSERT_FALSE(watch.update(105, false, 2000));
+  TEST_ASSERT_FALSE(watch.isWatching());
+  TEST_ASSERT_FALSE(watch.update(600, true, 2 * kLoadedBaselineMS));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_tolerance_scales_with_noise);
+  RUN_TEST(test_keeps_agreeing_baselines);
+  RUN_TEST(test_keeps_baselines_under_load);
+  RUN_TEST(test_replaces_stale_baselines);
+  RUN_TEST(test_rejects_record_when_every_sensor_is_above);
+  RUN_TEST(test_uses_live_readings_without_record);
+  RUN_TEST(test_expires_loaded_baseline_that_stays_flat);
+  RUN_TEST(test_keeps_loaded_baseline_while_reading_moves);
+  RUN_TEST(test_keeps_loaded_baseline_once_released);
+  return UNITY_END();
+}
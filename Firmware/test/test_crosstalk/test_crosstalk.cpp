@@ -0,0 +1,177 @@
+//
+// Host tests for learning and compensating crosstalk between panels.
+//
+#include <Crosstalk.h>
+#include <random>
+#include <unity.h>
+
+// The firmware library isn't built for host tests
+#include <Crosstalk.cpp>
+#include <EEPROM.cpp>
+
+static const uint8_t kPanel = 1;
+static const uint8_t kFirstSource = kPanel * kCrosstalkSensorsPerPanel;
+static const float kOne = 1 << kCrosstalkShift;
+
+// Coupling from each sensor of kPanel into each sensor, 0 on kPanel itself
+static float coupling(uint8_t nVictim, uint8_t nSource) {
+  if (nVictim / kCrosstalkSensorsPerPanel == kPanel) {
+    return 0;
+  }
+  return 0.01f * ((nVictim * 7 + nSource * 3) % 20);
+}
+
+// Learn kPanel from presses that move weight around its sensors, with the
+// load of every other sensor being the coupling plus noise
+static bool learn(float fScale, uint32_t nSamples) {
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> load(0, 1500);
+  std::uniform_int_distribution<int> noise(-3, 3);
+
+  Crosstalk* pCrosstalk = Crosstalk::getInstance();
+  pCrosstalk->startLearning(kPanel, 200);
+  for (uint32_t nSample = 0; nSample < nSamples; nSample++) {
+    uint16_t anLoad[kCrosstalkSensors] = {};
+    for (uint8_t n = 0; n < kCrosstalkSensorsPerPanel; n++) {
+      anLoad[kFirstSource + n] = load(rng);
+    }
+    for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+      if (nVictim / kCrosstalkSensorsPerPanel == kPanel) {
+        continue;
+      }
+      float fLoad = noise(rng);
+      for (uint8_t n = 0; n < kCrosstalkSensorsPerPanel; n++) {
+        fLoad += fScale * coupling(nVictim, kFirstSource + n) *
+                 anLoad[kFirstSource + n];
+      }
+      anLoad[nVictim] = fLoad < 0 ? 0 : fLoad;
+    }
+    pCrosstalk->learn(anLoad);
+  }
+  return pCrosstalk->finishLearning();
+}
+
+void setUp() {
+  Crosstalk::getInstance()->clear();
+  Crosstalk::getInstance()->cancelLearning();
+}
+
+void tearDown() {}
+
+void test_learns_coefficients() {
+  TEST_ASSERT_TRUE(learn(1, 2 * kCrosstalkMinSamples));
+
+  const Crosstalk* pCrosstalk = Crosstalk::getInstance();
+  for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+    for (uint8_t nSource = 0; nSource < kCrosstalkSensors; nSource++) {
+      bool bLearned =
+        nSource / kCrosstalkSensorsPerPanel == kPanel &&
+        nVictim / kCrosstalkSensorsPerPanel != kPanel;
+      // Within 0.005 of the coupling, which the ridge and noise account for
+      int nExpected = bLearned ? coupling(nVictim, nSource) * kOne : 0;
+      TEST_ASSERT_INT_WITHIN(
+        82, nExpected, pCrosstalk->get(nVictim, nSource));
+    }
+  }
+}
+
+void test_needs_samples() {
+  TEST_ASSERT_TRUE(learn(1, 2 * kCrosstalkMinSamples));
+  int16_t nCoefficient = Crosstalk::getInstance()->get(0, kFirstSource + 1);
+
+  // Too few samples keep the previous coefficients
+  TEST_ASSERT_FALSE(learn(2, kCrosstalkMinSamples - 1));
+  TEST_ASSERT_FALSE(Crosstalk::getInstance()->isLearning());
+  TEST_ASSERT_EQUAL_INT(
+    nCoefficient, Crosstalk::getInstance()->get(0, kFirstSource + 1));
+}
+
+void test_coefficients_are_clamped() {
+  // Couplings of up to 3.8 times the load don't fit in the fixed-point range
+  TEST_ASSERT_TRUE(learn(20, 2 * kCrosstalkMinSamples));
+
+  const Crosstalk* pCrosstalk = Crosstalk::getInstance();
+  bool bClamped = false;
+  for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+    for (uint8_t n = 0; n < kCrosstalkSensorsPerPanel; n++) {
+      bClamped |= pCrosstalk->get(nVictim, kFirstSource + n) == INT16_MAX;
+    }
+  }
+  TEST_ASSERT_TRUE(bClamped);
+}
+
+void test_coupling_never_exceeds_load() {
+  TEST_ASSERT_TRUE(learn(20, 2 * kCrosstalkMinSamples));
+
+  std::mt19937 rng(2);
+  std::uniform_int_distribution<int> load(0, 4095);
+  const Crosstalk* pCrosstalk = Crosstalk::getInstance();
+  for (int nScan = 0; nScan < 1000; nScan++) {
+    uint16_t anLoad[kCrosstalkSensors];
+    uint16_t anCoupling[kCrosstalkSensors];
+    for (uint8_t n = 0; n < kCrosstalkSensors; n++) {
+      anLoad[n] = load(rng);
+    }
+    pCrosstalk->compensate(anLoad, anCoupling);
+    for (uint8_t n = 0; n < kCrosstalkSensors; n++) {
+      TEST_ASSERT_LESS_OR_EQUAL_UINT32(anLoad[n], anCoupling[n]);
+    }
+  }
+}
+
+void test_compensate() {
+  TEST_ASSERT_TRUE(learn(1, 2 * kCrosstalkMinSamples));
+
+  // Only kPanel is loaded, so the other sensors only see its coupling
+  uint16_t anLoad[kCrosstalkSensors] = {};
+  uint16_t anCoupling[kCrosstalkSensors];
+  for (uint8_t n = 0; n < kCrosstalkSensorsPerPanel; n++) {
+    anLoad[kFirstSource + n] = 1000;
+  }
+  for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+    if (nVictim / kCrosstalkSensorsPerPanel != kPanel) {
+      anLoad[nVictim] = 4095;
+    }
+  }
+  Crosstalk::getInstance()->compensate(anLoad, anCoupling);
+
+  for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+    float fExpected = 0;
+    for (uint8_t n = 0; n < kCrosstalkSensorsPerPanel; n++) {
+      fExpected += coupling(nVictim, kFirstSource + n) * 1000;
+    }
+    TEST_ASSERT_UINT16_WITHIN(25, fExpected, anCoupling[nVictim]);
+  }
+}
+
+void test_record_round_trip() {
+  TEST_ASSERT_TRUE(learn(1, 2 * kCrosstalkMinSamples));
+  Crosstalk* pCrosstalk = Crosstalk::getInstance();
+  int16_t nCoefficient = pCrosstalk->get(0, kFirstSource);
+  TEST_ASSERT_TRUE(nCoefficient != 0);
+
+  pCrosstalk->write();
+  pCrosstalk->clear();
+  pCrosstalk->read();
+  TEST_ASSERT_EQUAL_INT(nCoefficient, pCrosstalk->get(0, kFirstSource));
+
+  // A record with a bad checksum reads as all zeros
+  EEPROM.m_data[kEepromCrosstalkOffset + sizeof(CrosstalkRecord) - 1] ^= 1;
+  pCrosstalk->read();
+  for (uint8_t nVictim = 0; nVictim < kCrosstalkSensors; nVictim++) {
+    for (uint8_t nSource = 0; nSource < kCrosstalkSensors; nSource++) {
+      TEST_ASSERT_EQUAL_INT(0, pCrosstalk->get(nVictim, nSource));
+    }
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_learns_coefficients);
+  RUN_TEST(test_needs_samples);
+  RUN_TEST(test_coefficients_are_clamped);
+  RUN_TEST(test_coupling_never_exceeds_load);
+  RUN_TEST(test_compensate);
+  RUN_TEST(test_record_round_trip);
+  return UNITY_END();
+}
@@ -0,0 +1,95 @@
+//
+// Host tests for the press event journal.
+//
+#include <EventJournal.h>
+#include <unity.h>
+
+static PressEvent makeEvent(uint32_t nTimeUS) {
+  PressEvent event;
+  event.nTimeUS = nTimeUS;
+  event.nPeak = 0;
+  event.nSensor = 0;
+  event.nFlags = kEventPressed;
+  return event;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_reads_events_since_cursor() {
+  EventJournal<8> journal;
+  PressEvent aEvents[8];
+  uint32_t nCursor = 0;
+  uint32_t nLost;
+
+  TEST_ASSERT_EQUAL_UINT16(0, journal.read(nCursor, aEvents, 8, nLost));
+
+  journal.push(makeEvent(10));
+  journal.push(makeEvent(20));
+  TEST_ASSERT_EQUAL_UINT16(2, journal.read(nCursor, aEvents, 8, nLost));
+  TEST_ASSERT_EQUAL_UINT32(2, nCursor);
+  TEST_ASSERT_EQUAL_UINT32(0, nLost);
+  TEST_ASSERT_EQUAL_UINT32(10, aEvents[0].nTimeUS);
+  TEST_ASSERT_EQUAL_UINT32(20, aEvents[1].nTimeUS);
+
+  journal.push(makeEvent(30));
+  TEST_ASSERT_EQUAL_UINT16(1, journal.read(nCursor, aEvents, 8, nLost));
+  TEST_ASSERT_EQUAL_UINT32(30, aEvents[0].nTimeUS);
+  TEST_ASSERT_EQUAL_UINT32(3, journal.getHead());
+}
+
+void test_reads_are_limited_to_buffer_size() {
+  EventJournal<8> journal;
+  PressEvent aEvents[2];
+  uint32_t nCursor = 0;
+  uint32_t nLost;
+
+  for (uint32_t n = 0; n < 5; n++) {
+    journal.push(makeEvent(n));
+  }
+  TEST_ASSERT_EQUAL_UINT16(2, journal.read(nCursor, aEvents, 2, nLost));
+  TEST_ASSERT_EQUAL_UINT16(2, journal.read(nCursor, aEvents, 2, nLost));
+  TEST_ASSERT_EQUAL_UINT32(3, aEvents[1].nTimeUS);
+  TEST_ASSERT_EQUAL_UINT16(1, journal.read(nCursor, aEvents, 2, nLost));
+  TEST_ASSERT_EQUAL_UINT32(5, nCursor);
+}
+
+void test_overwritten_events_are_lost() {
+  EventJournal<8> journal;
+  PressEvent aEvents[8];
+  uint32_t nCursor = 0;
+  uint32_t nLost;
+
+  for (uint32_t n = 0; n < 20; n++) {
+    journal.push(makeEvent(n));
+  }
+
+  // 7 of the 8 slots can be read
+  TEST_ASSERT_EQUAL_UINT16(7, journal.read(nCursor, aEvents, 8, nLost));
+  TEST_ASSERT_EQUAL_UINT32(13, nLost);
+  TEST_ASSERT_EQUAL_UINT32(13, aEvents[0].nTimeUS);
+  TEST_ASSERT_EQUAL_UINT32(19, aEvents[6].nTimeUS);
+  TEST_ASSERT_EQUAL_UINT32(20, nCursor);
+}
+
+void test_cursor_ahead_of_journal_starts_over() {
+  EventJournal<8> journal;
+  PressEvent aEvents[8];
+  uint32_t nCursor = 1000;
+  uint32_t nLost;
+
+  journal.push(makeEvent(10));
+  TEST_ASSERT_EQUAL_UINT16(1, journal.read(nCursor, aEvents, 8, nLost));
+  TEST_ASSERT_EQUAL_UINT32(0, nLost);
+  TEST_ASSERT_EQUAL_UINT32(1, nCursor);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_reads_events_since_cursor);
+  RUN_TEST(test_reads_are_limited_to_buffer_size);
+  RUN_TEST(test_overwritten_events_are_lost);
+  RUN_TEST(test_cursor_ahead_of_journal_starts_over);
+  return UNITY_END();
+}
@@ -0,0 +1,125 @@
+//
+// Host tests for decoding LED frames streamed by a host.
+//
+#include <LedFrame.h>
+#include <unity.h>
+
+static const uint16_t kLeds = 8;
+
+static uint8_t s_anLeds[kLeds * 3];
+
+// Wrap ops in a frame with its header and checksum and decode it, a byte at a
+// time
+static LedFrameDecoder::Result decode(
+  uint8_t nFlags,
+  const uint8_t* anOps,
+  uint16_t nLength) {
+  uint8_t nSum1 = 0;
+  uint8_t nSum2 = 0;
+  for (uint16_t n = 0; n < nLength; n++) {
+    nSum1 = (nSum1 + anOps[n]) % 255;
+    nSum2 = (nSum2 + nSum1) % 255;
+  }
+
+  LedFrameDecoder decoder;
+  decoder.begin(s_anLeds, kLeds);
+  LedFrameDecoder::Result result = decoder.feed(nFlags);
+  result = decoder.feed(nLength & 0xFF);
+  result = decoder.feed(nLength >> 8);
+  for (uint16_t n = 0; n < nLength; n++) {
+    result = decoder.feed(anOps[n]);
+    if (result != LedFrameDecoder::enumFrameIncomplete) {
+      return result;
+    }
+  }
+  result = decoder.feed(nSum1);
+  if (result != LedFrameDecoder::enumFrameIncomplete) {
+    return result;
+  }
+  return decoder.feed(nSum2);
+}
+
+void setUp() {
+  for (uint16_t n = 0; n < sizeof(s_anLeds); n++) {
+    s_anLeds[n] = 0xAA;
+  }
+}
+
+void tearDown() {}
+
+void test_literal_colors() {
+  uint8_t anOps[1 + kLeds * 3] = {kLedFrameOpLiteral | (kLeds - 1)};
+  for (uint16_t n = 0; n < kLeds * 3; n++) {
+    anOps[1 + n] = n;
+  }
+  TEST_ASSERT_EQUAL(
+    LedFrameDecoder::enumFrameDone, decode(0, anOps, sizeof(anOps)));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(anOps + 1, s_anLeds, sizeof(s_anLeds));
+}
+
+void test_runs_and_skips() {
+  const uint8_t anOps[] = {
+    kLedFrameOpRun | 2, 1, 2, 3, kLedFrameOpSkip | 1, kLedFrameOpRun, 4, 5, 6};
+  TEST_ASSERT_EQUAL(
+    LedFrameDecoder::enumFrameDone, decode(0, anOps, sizeof(anOps)));
+
+  const uint8_t anExpected[kLeds * 3] = {
+    1, 2, 3, 1, 2, 3, 1, 2, 3, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA,
+    4, 5, 6, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(anExpected, s_anLeds, sizeof(s_anLeds));
+}
+
+void test_keyframe_starts_from_black() {
+  const uint8_t anOps[] = {kLedFrameOpSkip | 6, kLedFrameOpRun, 9, 9, 9};
+  TEST_ASSERT_EQUAL(
+    LedFrameDecoder::enumFrameDone,
+    decode(kLedFrameKey, anOps, sizeof(anOps)));
+
+  uint8_t anExpected[kLeds * 3] = {};
+  anExpected[21] = anExpected[22] = anExpected[23] = 9;
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(anExpected, s_anLeds, sizeof(s_anLeds));
+}
+
+void test_empty_frame() {
+  TEST_ASSERT_EQUAL(LedFrameDecoder::enumFrameDone, decode(0, NULL, 0));
+  TEST_ASSERT_EQUAL_UINT8(0xAA, s_anLeds[0]);
+}
+
+void test_invalid_frames() {
+  // Past the last LED
+  const uint8_t anPast[] = {kLedFrameOpSkip | 7, kLedFrameOpRun, 1, 2, 3};
+  TEST_ASSERT_EQUAL(
+    LedFrameDecoder::enumFrameInvalid, decode(0, anPast, sizeof(anPast)));
+
+  // Reserved op
+  const uint8_t anReserved[] = {0xC0};
+  TEST_ASSERT_EQUAL(
+    LedFrameDecoder::enumFrameInvalid,
+    decode(0, anReserved, sizeof(anReserved)));
+
+  // Ends in the middle of a color
+  const uint8_t anShort[] = {kLedFrameOpRun, 1, 2};
+  TEST_ASSERT_EQUAL(
+    LedFrameDecoder::enumFrameInvalid, decode(0, anShort, sizeof(anShort)));
+
+  // Corrupted checksum
+  LedFrameDecoder decoder;
+  decoder.begin(s_anLeds, kLeds);
+  const uint8_t anFrame[] = {0, 1, 0, kLedFrameOpSkip, 0, 1};
+  LedFrameDecoder::Result result = LedFrameDecoder::enumFrameIncomplete;
+  for (uint8_t nByte : anFrame) {
+    result = decoder.feed(nByte);
+  }
+  TEST_ASSERT_EQUAL(LedFrameDecoder::enumFrameInvalid, result);
+  TEST_ASSERT_FALSE(decoder.isDecoding());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_literal_colors);
+  RUN_TEST(test_runs_and_skips);
+  RUN_TEST(test_keyframe_starts_from_black);
+  RUN_TEST(test_empty_frame);
+  RUN_TEST(test_invalid_frames);
+  return UNITY_END();
+}
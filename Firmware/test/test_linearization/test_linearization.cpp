@@ -0,0 +1,118 @@
+//
+// Host tests for mapping raw sensor readings through a linearization table.
+//
+#include <Linearization.h>
+#include <unity.h>
+
+// The firmware library isn't built for host tests
+#include <Linearization.cpp>
+
+// Table for 10-bit readings with a steep first segment and a flat last one
+static const char* const kTable = "100:0;300:400;700:800;900:850";
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_parse_errors() {
+  const char* const apszInvalid[] = {
+    "", // Empty
+    "100:200", // Single point
+    "100:200;300", // Missing separator
+    "100:200;100:300", // X not increasing
+    "300:200;100:300", // X decreasing
+    "100:200;1024:300", // X out of range
+    "100:200;300:1024", // Y out of range
+    "-1:200;300:400", // Negative
+    "0:0;1:1;2:2;3:3;4:4;5:5;6:6;7:7;8:8", // Too many points
+  };
+
+  Linearization linearization;
+  for (const char* pszInvalid : apszInvalid) {
+    TEST_ASSERT_TRUE(linearization.parse(kTable, 0));
+    TEST_ASSERT_FALSE_MESSAGE(linearization.parse(pszInvalid, 0), pszInvalid);
+    TEST_ASSERT_FALSE(linearization.isEnabled());
+
+    // Readings pass through while disabled
+    TEST_ASSERT_EQUAL_UINT16(500, linearization.apply(500));
+  }
+
+  // The most points a table can have
+  TEST_ASSERT_TRUE(
+    linearization.parse("0:0;1:1;2:2;3:3;4:4;5:5;6:6;7:7", 0));
+}
+
+void test_endpoints() {
+  Linearization linearization;
+  TEST_ASSERT_TRUE(linearization.parse(kTable, 0));
+  TEST_ASSERT_TRUE(linearization.isEnabled());
+
+  // Every point maps to its Y value
+  TEST_ASSERT_EQUAL_UINT16(0, linearization.apply(100));
+  TEST_ASSERT_EQUAL_UINT16(400, linearization.apply(300));
+  TEST_ASSERT_EQUAL_UINT16(800, linearization.apply(700));
+  TEST_ASSERT_EQUAL_UINT16(850, linearization.apply(900));
+
+  // Readings outside of the table are extrapolated from the nearest segment,
+  // and clamped at 0
+  TEST_ASSERT_EQUAL_UINT16(0, linearization.apply(50));
+  TEST_ASSERT_EQUAL_UINT16(0, linearization.apply(0));
+  TEST_ASSERT_EQUAL_UINT16(880, linearization.apply(1023));
+}
+
+void test_segments() {
+  Linearization linearization;
+  TEST_ASSERT_TRUE(linearization.parse(kTable, 0));
+
+  // Halfway along each segment
+  TEST_ASSERT_EQUAL_UINT16(200, linearization.apply(200));
+  TEST_ASSERT_EQUAL_UINT16(600, linearization.apply(500));
+  TEST_ASSERT_EQUAL_UINT16(825, linearization.apply(800));
+
+  // An increasing table maps increasing readings to non-decreasing values
+  uint16_t nPrevious = linearization.apply(0);
+  for (uint16_t nRaw = 1; nRaw <= 1023; nRaw++) {
+    uint16_t nValue = linearization.apply(nRaw);
+    TEST_ASSERT_TRUE(nValue >= nPrevious);
+    nPrevious = nValue;
+  }
+}
+
+void test_shift() {
+  // Points are given for 10-bit readings and shifted to 12 bits
+  Linearization linearization;
+  TEST_ASSERT_TRUE(linearization.parse(kTable, 2));
+
+  TEST_ASSERT_EQUAL_UINT16(0, linearization.apply(100 << 2));
+  TEST_ASSERT_EQUAL_UINT16(400 << 2, linearization.apply(300 << 2));
+  TEST_ASSERT_EQUAL_UINT16(600 << 2, linearization.apply(500 << 2));
+  TEST_ASSERT_EQUAL_UINT16(850 << 2, linearization.apply(900 << 2));
+  TEST_ASSERT_EQUAL_UINT16(3523, linearization.apply(1023 << 2));
+
+  // Steps between 10-bit readings are kept
+  TEST_ASSERT_EQUAL_UINT16(
+    (600 << 2) + 1, linearization.apply((500 << 2) + 1));
+}
+
+void test_format_points() {
+  uint16_t anX[Linearization::kMaxPoints];
+  uint16_t anY[Linearization::kMaxPoints];
+  uint8_t nPoints = Linearization::parsePoints(kTable, anX, anY);
+  TEST_ASSERT_EQUAL_UINT8(4, nPoints);
+  TEST_ASSERT_EQUAL_UINT16(300, anX[1]);
+  TEST_ASSERT_EQUAL_UINT16(400, anY[1]);
+  TEST_ASSERT_EQUAL_STRING(
+    kTable, Linearization::formatPoints(nPoints, anX, anY).c_str());
+
+  TEST_ASSERT_EQUAL_UINT8(0, Linearization::parsePoints("1:2", anX, anY));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_errors);
+  RUN_TEST(test_endpoints);
+  RUN_TEST(test_segments);
+  RUN_TEST(test_shift);
+  RUN_TEST(test_format_points);
+  return UNITY_END();
+}
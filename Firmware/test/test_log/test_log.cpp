@@ -0,0 +1,86 @@
+//
+// Host tests for deferred binary logging.
+//
+// Built with only warnings and errors enabled, so info and debug call sites
+// must compile away.
+//
+#define LOG_LEVEL LOG_LEVEL_WARN
+#include <Log.h>
+#include <unity.h>
+
+static uint32_t s_nTimeUS = 0;
+
+LogJournal& getLog() {
+  static LogJournal s_log;
+  return s_log;
+}
+
+uint32_t getLogTimeUS() { return s_nTimeUS; }
+
+// Counts evaluations of the arguments of a call site
+static uint32_t s_nEvaluated = 0;
+
+static uint32_t evaluate(uint32_t nValue) {
+  s_nEvaluated++;
+  return nValue;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_makes_records() {
+  LogRecord record;
+  makeLogRecord(record, 1234, LOG_LEVEL_INFO, kLogAdcProfile, 2, -5);
+  TEST_ASSERT_EQUAL_UINT32(1234, record.nTimeUS);
+  TEST_ASSERT_EQUAL_UINT8(LOG_LEVEL_INFO, record.nLevel);
+  TEST_ASSERT_EQUAL_UINT8(kLogAdcProfile, record.nMessage);
+  TEST_ASSERT_EQUAL_UINT8(2, record.nArgs);
+  TEST_ASSERT_EQUAL_UINT32(2, record.anArg[0]);
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFB, record.anArg[1]);
+
+  makeLogRecord(record, 0, LOG_LEVEL_ERROR, kLogBoot);
+  TEST_ASSERT_EQUAL_UINT8(0, record.nArgs);
+}
+
+void test_enabled_levels_are_recorded() {
+  uint32_t nCursor = 0;
+  uint32_t nLost;
+  LogRecord aRecords[4];
+  getLog().read(nCursor, aRecords, 4, nLost);
+
+  s_nTimeUS = 500;
+  LOG_WARN(kLogFrameDropped, 3, 100);
+  LOG_ERROR(kLogBoot, 1, 2);
+  TEST_ASSERT_EQUAL_UINT16(2, getLog().read(nCursor, aRecords, 4, nLost));
+  TEST_ASSERT_EQUAL_UINT32(500, aRecords[0].nTimeUS);
+  TEST_ASSERT_EQUAL_UINT8(LOG_LEVEL_WARN, aRecords[0].nLevel);
+  TEST_ASSERT_EQUAL_UINT8(kLogFrameDropped, aRecords[0].nMessage);
+  TEST_ASSERT_EQUAL_UINT32(100, aRecords[0].anArg[1]);
+  TEST_ASSERT_EQUAL_UINT8(LOG_LEVEL_ERROR, aRecords[1].nLevel);
+}
+
+void test_disabled_levels_are_removed() {
+  uint32_t nCursor = 0;
+  uint32_t nLost;
+  LogRecord aRecords[4];
+  getLog().read(nCursor, aRecords, 4, nLost);
+
+  s_nEvaluated = 0;
+  LOG_INFO(kLogBaselinesSaved, evaluate(1));
+  LOG_DEBUG(kLogSensorEdge, evaluate(1), evaluate(2), evaluate(3));
+  TEST_ASSERT_EQUAL_UINT32(0, s_nEvaluated);
+  TEST_ASSERT_EQUAL_UINT16(0, getLog().read(nCursor, aRecords, 4, nLost));
+
+  LOG_WARN(kLogBaselinesSaved, evaluate(1));
+  TEST_ASSERT_EQUAL_UINT32(1, s_nEvaluated);
+  TEST_ASSERT_EQUAL_UINT16(1, getLog().read(nCursor, aRecords, 4, nLost));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_makes_records);
+  RUN_TEST(test_enabled_levels_are_recorded);
+  RUN_TEST(test_disabled_levels_are_removed);
+  return UNITY_END();
+}
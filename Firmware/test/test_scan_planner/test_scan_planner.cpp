@@ -0,0 +1,172 @@
+//
+// Host tests for adaptive scan planning, including the detection latency bound
+// under random presses.
+//
+#include <ScanPlanner.h>
+#include <stdlib.h>
+#include <unity.h>
+
+static const uint32_t kScanUS = 333;
+static const uint32_t kHoldUS = 500000;
+static const uint32_t kSleepUS = 5000000;
+
+typedef ScanPlanner<4, 3, 12> Planner;
+
+// Count the panels in a mask
+static uint8_t count(uint8_t nMask) {
+  uint8_t nCount = 0;
+  for (; nMask; nMask &= nMask - 1) {
+    nCount++;
+  }
+  return nCount;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_samples_every_panel_after_reset() {
+  Planner planner(kHoldUS, kSleepUS);
+  for (uint32_t nScan = 0; nScan < 10; nScan++) {
+    TEST_ASSERT_EQUAL_HEX8(Planner::kAllPanels, planner.plan(nScan * kScanUS));
+  }
+}
+
+void test_idle_panels_are_staggered() {
+  Planner planner(kHoldUS, kSleepUS);
+  uint32_t nNowUS = kHoldUS;
+
+  // Over a cycle, each idle panel is sampled once and no scan samples more
+  // than two panels
+  uint8_t anSamples[4] = {};
+  for (uint8_t nScan = 0; nScan < 3; nScan++) {
+    uint8_t nMask = planner.plan(nNowUS);
+    TEST_ASSERT_TRUE(count(nMask) <= 2);
+    for (uint8_t nPanel = 0; nPanel < 4; nPanel++) {
+      anSamples[nPanel] += (nMask >> nPanel) & 1;
+    }
+    nNowUS += kScanUS;
+  }
+  for (uint8_t nPanel = 0; nPanel < 4; nPanel++) {
+    TEST_ASSERT_EQUAL_UINT8(1, anSamples[nPanel]);
+  }
+}
+
+void test_active_panel_is_sampled_every_scan() {
+  Planner planner(kHoldUS, kSleepUS);
+  uint32_t nNowUS = kHoldUS;
+  planner.plan(nNowUS);
+  planner.report(2, true, nNowUS);
+
+  for (uint32_t nScan = 1; nScan * kScanUS < kHoldUS; nScan++) {
+    TEST_ASSERT_TRUE(planner.plan(nNowUS + nScan * kScanUS) & (1 << 2));
+  }
+  planner.plan(nNowUS + kHoldUS);
+  TEST_ASSERT_EQUAL_HEX8(0, planner.getActive());
+}
+
+void test_sleeps_and_wakes_within_one_scan() {
+  Planner planner(kHoldUS, kSleepUS);
+  uint32_t nNowUS = 0;
+  while (!planner.isSleeping()) {
+    planner.plan(nNowUS);
+    nNowUS += kScanUS;
+  }
+  TEST_ASSERT_TRUE(nNowUS >= kSleepUS);
+
+  // Find the next scan that samples panel 1 and report activity on it
+  uint8_t nMask;
+  do {
+    nMask = planner.plan(nNowUS);
+    nNowUS += kScanUS;
+  } while (!(nMask & (1 << 1)));
+  planner.report(1, true, nNowUS);
+
+  TEST_ASSERT_FALSE(planner.isSleeping());
+  TEST_ASSERT_EQUAL_HEX8(Planner::kAllPanels, planner.plan(nNowUS));
+}
+
+void test_reports_rates() {
+  Planner planner(kHoldUS, kSleepUS);
+  uint32_t nNowUS = kHoldUS;
+  planner.reset(nNowUS);
+  for (uint32_t nScan = 0; nScan <= 7000; nScan++) {
+    uint8_t nMask = planner.plan(nNowUS);
+    planner.count(nMask, nNowUS);
+    if (nMask & 1) {
+      planner.report(0, true, nNowUS);
+    }
+    nNowUS += kScanUS;
+  }
+
+  // The active panel gets the full scan rate and idle panels a third of it
+  TEST_ASSERT_UINT16_WITHIN(30, 3000, planner.getRate(0));
+  TEST_ASSERT_UINT16_WITHIN(30, 1000, planner.getRate(1));
+}
+
+// Random presses of random lengths on random panels, with long gaps so the
+// pad goes idle and to sleep. Every press must be seen within the bound.
+void test_detection_latency_is_bounded() {
+  Planner planner(kHoldUS, kSleepUS);
+  srand(1234);
+
+  uint32_t anPressStartUS[4] = {};
+  uint32_t anPressEndUS[4] = {};
+  bool abSeen[4] = {true, true, true, true};
+  uint32_t nMaxLatencyUS = 0;
+  uint32_t nPresses = 0;
+  uint32_t nNextPressUS = 0;
+  uint8_t anSinceSample[4] = {};
+
+  const uint32_t kBoundUS = Planner::getMaxInterval() * kScanUS;
+  for (uint32_t nNowUS = 0; nNowUS < 600000000; nNowUS += kScanUS) {
+    if (nNowUS >= nNextPressUS) {
+      uint8_t nPanel = rand() % 4;
+      if (abSeen[nPanel] && nNowUS >= anPressEndUS[nPanel]) {
+        anPressStartUS[nPanel] = nNowUS;
+        anPressEndUS[nPanel] = nNowUS + kBoundUS + rand() % 200000;
+        abSeen[nPanel] = false;
+        nPresses++;
+      }
+      // Mostly short gaps, sometimes long enough to sleep
+      nNextPressUS = nNowUS + (rand() % 10 ? rand() % 400000
+                                           : kSleepUS + rand() % 5000000);
+    }
+
+    uint8_t nMask = planner.plan(nNowUS);
+    for (uint8_t nPanel = 0; nPanel < 4; nPanel++) {
+      if (!(nMask & (1 << nPanel))) {
+        anSinceSample[nPanel]++;
+        TEST_ASSERT_LESS_THAN_UINT32(
+          Planner::getMaxInterval(), anSinceSample[nPanel]);
+        continue;
+      }
+      anSinceSample[nPanel] = 0;
+
+      bool bPressed = nNowUS >= anPressStartUS[nPanel] &&
+                      nNowUS < anPressEndUS[nPanel];
+      planner.report(nPanel, bPressed, nNowUS);
+      if (bPressed && !abSeen[nPanel]) {
+        abSeen[nPanel] = true;
+        uint32_t nLatencyUS = nNowUS - anPressStartUS[nPanel];
+        if (nLatencyUS > nMaxLatencyUS) {
+          nMaxLatencyUS = nLatencyUS;
+        }
+      }
+    }
+  }
+
+  TEST_ASSERT_GREATER_THAN_UINT32(500, nPresses);
+  TEST_ASSERT_LESS_THAN_UINT32(kBoundUS, nMaxLatencyUS);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_samples_every_panel_after_reset);
+  RUN_TEST(test_idle_panels_are_staggered);
+  RUN_TEST(test_active_panel_is_sampled_every_scan);
+  RUN_TEST(test_sleeps_and_wakes_within_one_scan);
+  RUN_TEST(test_reports_rates);
+  RUN_TEST(test_detection_latency_is_bounded);
+  return UNITY_END();
+}
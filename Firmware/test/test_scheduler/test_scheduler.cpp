@@ -0,0 +1,157 @@
+//
+// Host tests for the task scheduler using a virtual clock.
+//
+#include <Scheduler.h>
+#include <unity.h>
+
+static uint32_t s_nNowUS;
+static uint32_t virtualClock() { return s_nNowUS; }
+
+// Order tasks ran in, one character per run
+static char s_pszTrace[64];
+static uint8_t s_nTrace;
+
+static void trace(char c) {
+  if (s_nTrace < sizeof(s_pszTrace) - 1) {
+    s_pszTrace[s_nTrace++] = c;
+    s_pszTrace[s_nTrace] = '\0';
+  }
+}
+
+static void taskScan() {
+  trace('S');
+  s_nNowUS += 100;
+}
+static void taskReport() {
+  trace('R');
+  s_nNowUS += 10;
+}
+static void taskLights() {
+  trace('L');
+  s_nNowUS += 500;
+}
+static void taskEvent() { trace('E'); }
+
+void setUp() {
+  s_nNowUS = 0;
+  s_nTrace = 0;
+  s_pszTrace[0] = '\0';
+}
+
+void tearDown() {}
+
+// Run the scheduler until the virtual clock reaches nEndUS
+template <uint8_t N>
+static void runUntil(Scheduler<N>& scheduler, uint32_t nEndUS) {
+  while (s_nNowUS < nEndUS) {
+    if (!scheduler.runOnce()) {
+      s_nNowUS++;
+    }
+  }
+}
+
+void test_runs_highest_priority_first() {
+  Scheduler<4> scheduler(virtualClock);
+  scheduler.addPeriodic("lights", taskLights, 3, 10000);
+  scheduler.addPeriodic("report", taskReport, 1, 1000);
+  scheduler.addPeriodic("scan", taskScan, 0, 333);
+
+  // All released at once
+  TEST_ASSERT_TRUE(scheduler.runOnce());
+  TEST_ASSERT_TRUE(scheduler.runOnce());
+  TEST_ASSERT_TRUE(scheduler.runOnce());
+  TEST_ASSERT_EQUAL_STRING("SRL", s_pszTrace);
+}
+
+void test_periodic_task_keeps_phase() {
+  Scheduler<4> scheduler(virtualClock);
+  uint8_t nScan = scheduler.addPeriodic("scan", taskScan, 0, 333);
+
+  runUntil(scheduler, 3330);
+
+  const TaskStats& stats = scheduler.getStats(nScan);
+  TEST_ASSERT_EQUAL_UINT32(10, stats.nRuns);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.nOverruns);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.nSkipped);
+  TEST_ASSERT_EQUAL_UINT32(100, stats.nMaxRunTimeUS);
+}
+
+void test_low_priority_task_delays_by_at_most_one_run() {
+  Scheduler<4> scheduler(virtualClock);
+  uint8_t nScan = scheduler.addPeriodic("scan", taskScan, 0, 333);
+  uint8_t nReport = scheduler.addPeriodic("report", taskReport, 1, 1000);
+  scheduler.addPeriodic("lights", taskLights, 3, 10000);
+
+  runUntil(scheduler, 100000);
+
+  // Lights take 500us, so the scan can be blocked for that long but no more
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(
+    500, scheduler.getStats(nScan).nMaxLatencyUS);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(
+    600, scheduler.getStats(nReport).nMaxLatencyUS);
+  TEST_ASSERT_EQUAL_UINT32(100, scheduler.getStats(nReport).nRuns);
+}
+
+void test_overruns_and_skips_are_counted() {
+  Scheduler<4> scheduler(virtualClock);
+  uint8_t nScan = scheduler.addPeriodic("scan", taskScan, 0, 50);
+
+  runUntil(scheduler, 1000);
+
+  // Each 100us run misses its 50us deadline. Every run after the first starts
+  // one release late, so the release following it is dropped.
+  const TaskStats& stats = scheduler.getStats(nScan);
+  TEST_ASSERT_EQUAL_UINT32(10, stats.nRuns);
+  TEST_ASSERT_EQUAL_UINT32(10, stats.nOverruns);
+  TEST_ASSERT_EQUAL_UINT32(9, stats.nSkipped);
+
+  scheduler.resetStats();
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.getStats(nScan).nRuns);
+}
+
+void test_event_task_runs_once_per_signal() {
+  Scheduler<4> scheduler(virtualClock);
+  uint8_t nEvent = scheduler.addEvent("event", taskEvent, 2, 1000);
+
+  TEST_ASSERT_FALSE(scheduler.runOnce());
+
+  scheduler.signal(nEvent);
+  scheduler.signal(nEvent);
+  TEST_ASSERT_TRUE(scheduler.runOnce());
+  TEST_ASSERT_FALSE(scheduler.runOnce());
+  TEST_ASSERT_EQUAL_STRING("E", s_pszTrace);
+}
+
+void test_event_task_deadline() {
+  Scheduler<4> scheduler(virtualClock);
+  uint8_t nEvent = scheduler.addEvent("event", taskEvent, 2, 1000);
+  scheduler.addPeriodic("lights", taskLights, 3, 10000);
+
+  // Signalled while the lights are running, so it waits for them
+  TEST_ASSERT_TRUE(scheduler.runOnce());
+  scheduler.signal(nEvent);
+  s_nNowUS += 1500;
+  TEST_ASSERT_TRUE(scheduler.runOnce());
+
+  TEST_ASSERT_EQUAL_STRING("LE", s_pszTrace);
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.getStats(nEvent).nOverruns);
+}
+
+void test_table_is_bounded() {
+  Scheduler<1> scheduler(virtualClock);
+  TEST_ASSERT_EQUAL_UINT8(0, scheduler.addPeriodic("a", taskScan, 0, 100));
+  TEST_ASSERT_EQUAL_UINT8(
+    Scheduler<1>::kInvalidTask, scheduler.addEvent("b", taskEvent, 0, 100));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_runs_highest_priority_first);
+  RUN_TEST(test_periodic_task_keeps_phase);
+  RUN_TEST(test_low_priority_task_delays_by_at_most_one_run);
+  RUN_TEST(test_overruns_and_skips_are_counted);
+  RUN_TEST(test_event_task_runs_once_per_signal);
+  RUN_TEST(test_event_task_deadline);
+  RUN_TEST(test_table_is_bounded);
+  return UNITY_END();
+}
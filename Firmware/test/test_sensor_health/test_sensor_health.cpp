@@ -0,0 +1,159 @@
+//
+// Host tests for scoring the health of a sensor's signal.
+//
+#include <SensorHealth.h>
+#include <unity.h>
+
+// The firmware library isn't built for host tests. This also brings in the
+// length of an evaluation window, kWindowMS.
+#include <SensorHealth.cpp>
+
+static const uint16_t kIdle = 100;
+static const uint16_t kRail = 1023;
+
+// Feed a reading every millisecond from nStartMS until nEndMS and return
+// nEndMS
+static uint32_t feed(
+  SensorHealth& health,
+  uint16_t nValue,
+  bool bPressed,
+  uint32_t nStartMS,
+  uint32_t nEndMS) {
+  for (uint32_t nTimeMS = nStartMS; nTimeMS < nEndMS; nTimeMS++) {
+    health.update(nValue, bPressed, nTimeMS);
+  }
+  return nEndMS;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_rail_is_stuck() {
+  SensorHealth health;
+  health.onPanelStateChanged(true);
+
+  // Three seconds on the rail, then a strike for each window
+  uint32_t nTimeMS = feed(health, kRail, true, 0, 5 * kWindowMS);
+  TEST_ASSERT_FALSE(health.isFaulty());
+  TEST_ASSERT_EQUAL_UINT8(2, health.getStrikes());
+
+  feed(health, kRail, true, nTimeMS, nTimeMS + 1);
+  TEST_ASSERT_TRUE(health.isFaulty());
+  TEST_ASSERT_EQUAL(enumSensorHealthStuck, health.getStatus());
+}
+
+void test_long_saturated_press_stays_healthy() {
+  // A heavy player holding a freeze arrow loads every sensor of the panel
+  SensorHealth health;
+  health.onPanelStateChanged(true);
+  health.setNeighborsPressed(true);
+
+  feed(health, kRail, true, 0, 20 * kWindowMS);
+  TEST_ASSERT_FALSE(health.isFaulty());
+  TEST_ASSERT_EQUAL_UINT8(0, health.getStrikes());
+  TEST_ASSERT_EQUAL(enumSensorHealthOK, health.getStatus());
+
+  // Once the neighbors are released, the rail counts from then on
+  health.setNeighborsPressed(false);
+  feed(health, kRail, true, 20 * kWindowMS, 25 * kWindowMS);
+  TEST_ASSERT_FALSE(health.isFaulty());
+  feed(health, kRail, true, 25 * kWindowMS, 26 * kWindowMS + 1);
+  TEST_ASSERT_TRUE(health.isFaulty());
+}
+
+void test_silent_presses_are_stuck() {
+  // A broken wire reads 0 however hard its panel is pressed
+  SensorHealth health;
+  uint32_t nTimeMS = feed(health, 0, false, 0, 10);
+  for (uint8_t nPress = 0; nPress < 25; nPress++) {
+    health.onPanelStateChanged(true);
+    nTimeMS = feed(health, 0, false, nTimeMS, nTimeMS + 10);
+    health.onPanelStateChanged(false);
+    nTimeMS = feed(health, 0, false, nTimeMS, nTimeMS + 10);
+  }
+  TEST_ASSERT_FALSE(health.isFaulty());
+
+  feed(health, 0, false, nTimeMS, nTimeMS + 3 * kWindowMS);
+  TEST_ASSERT_TRUE(health.isFaulty());
+  TEST_ASSERT_EQUAL(enumSensorHealthStuck, health.getStatus());
+}
+
+void test_responding_presses_are_healthy() {
+  SensorHealth health;
+  uint32_t nTimeMS = feed(health, 0, false, 0, 10);
+  for (uint8_t nPress = 0; nPress < 100; nPress++) {
+    health.onPanelStateChanged(true);
+    nTimeMS = feed(health, 300, true, nTimeMS, nTimeMS + 100);
+    health.onPanelStateChanged(false);
+    nTimeMS = feed(health, 0, false, nTimeMS, nTimeMS + 100);
+  }
+  TEST_ASSERT_FALSE(health.isFaulty());
+  TEST_ASSERT_EQUAL_UINT8(0, health.getStrikes());
+}
+
+void test_drift() {
+  // The idle level rises by more than a baseline can follow every window
+  SensorHealth health;
+  uint32_t nTimeMS = 0;
+  for (uint16_t nWindow = 0; nWindow < 5; nWindow++) {
+    nTimeMS = feed(
+      health, kIdle + 100 * nWindow, false, nTimeMS, nTimeMS + kWindowMS);
+  }
+  TEST_ASSERT_TRUE(health.isFaulty());
+  TEST_ASSERT_EQUAL(enumSensorHealthDrifting, health.getStatus());
+}
+
+void test_slow_drift_is_healthy() {
+  SensorHealth health;
+  uint32_t nTimeMS = 0;
+  for (uint16_t nWindow = 0; nWindow < 10; nWindow++) {
+    nTimeMS = feed(
+      health, kIdle + 20 * nWindow, false, nTimeMS, nTimeMS + kWindowMS);
+  }
+  TEST_ASSERT_FALSE(health.isFaulty());
+  TEST_ASSERT_EQUAL_UINT8(0, health.getStrikes());
+}
+
+void test_oscillation() {
+  // A loose connection toggling every 5 ms
+  SensorHealth health;
+  uint32_t nTimeMS = 0;
+  while (nTimeMS < 4 * kWindowMS) {
+    uint16_t nValue = (nTimeMS / 5) % 2 ? kIdle + 200 : kIdle;
+    nTimeMS = feed(health, nValue, false, nTimeMS, nTimeMS + 5);
+  }
+  TEST_ASSERT_TRUE(health.isFaulty());
+  TEST_ASSERT_EQUAL(enumSensorHealthOscillating, health.getStatus());
+}
+
+void test_strikes_decay() {
+  SensorHealth health;
+  uint32_t nTimeMS = feed(health, kRail, true, 0, 5 * kWindowMS + 1);
+  TEST_ASSERT_TRUE(health.isFaulty());
+  TEST_ASSERT_EQUAL_UINT8(3, health.getStrikes());
+
+  // A clean window removes a strike and the sensor is healthy once they're
+  // all gone
+  nTimeMS = feed(health, kIdle, false, nTimeMS, nTimeMS + 2 * kWindowMS);
+  TEST_ASSERT_TRUE(health.isFaulty());
+  TEST_ASSERT_EQUAL_UINT8(1, health.getStrikes());
+  TEST_ASSERT_EQUAL(enumSensorHealthOK, health.getStatus());
+
+  feed(health, kIdle, false, nTimeMS, nTimeMS + kWindowMS);
+  TEST_ASSERT_FALSE(health.isFaulty());
+  TEST_ASSERT_EQUAL_UINT8(0, health.getStrikes());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_rail_is_stuck);
+  RUN_TEST(test_long_saturated_press_stays_healthy);
+  RUN_TEST(test_silent_presses_are_stuck);
+  RUN_TEST(test_responding_presses_are_healthy);
+  RUN_TEST(test_drift);
+  RUN_TEST(test_slow_drift_is_healthy);
+  RUN_TEST(test_oscillation);
+  RUN_TEST(test_strikes_decay);
+  return UNITY_END();
+}
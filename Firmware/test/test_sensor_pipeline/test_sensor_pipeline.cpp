@@ -0,0 +1,153 @@
+//
+// Host tests for the sensor pipeline and its stages.
+//
+#include <SensorPipeline.h>
+#include <unity.h>
+
+// Source of readings set by the test
+class TestSource {
+public:
+  uint16_t read() { return s_nReading; }
+
+  static uint16_t s_nReading;
+};
+
+uint16_t TestSource::s_nReading = 0;
+
+typedef SensorPipeline<TestSource> Pipeline;
+
+// Feed a reading at a time and return whether the pipeline is pressed
+static bool feed(Pipeline& pipeline, uint16_t nReading, uint32_t nTimeMS) {
+  TestSource::s_nReading = nReading;
+  pipeline.update(nTimeMS);
+  return pipeline.isPressed();
+}
+
+static void start(Pipeline& pipeline, uint16_t nBaseline) {
+  pipeline.getDetector().setOffsets(150, 110);
+  TestSource::s_nReading = nBaseline;
+  pipeline.read();
+  pipeline.calibrate();
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_hysteresis() {
+  Pipeline pipeline;
+  start(pipeline, 100);
+  TEST_ASSERT_EQUAL_UINT16(250, pipeline.getDetector().getTriggerThreshold());
+  TEST_ASSERT_EQUAL_UINT16(210, pipeline.getDetector().getReleaseThreshold());
+
+  TEST_ASSERT_FALSE(feed(pipeline, 249, 0));
+  TEST_ASSERT_TRUE(feed(pipeline, 250, 1));
+  // Stays pressed between the thresholds
+  TEST_ASSERT_TRUE(feed(pipeline, 220, 2));
+  TEST_ASSERT_FALSE(feed(pipeline, 210, 3));
+  TEST_ASSERT_FALSE(feed(pipeline, 240, 4));
+}
+
+void test_early_press() {
+  Pipeline pipeline;
+  start(pipeline, 100);
+  pipeline.getDetector().setSlopeRise(40);
+
+  // Rising fast above the release threshold presses early
+  TEST_ASSERT_FALSE(feed(pipeline, 150, 0));
+  TEST_ASSERT_FALSE(feed(pipeline, 180, 1));
+  TEST_ASSERT_TRUE(feed(pipeline, 215, 2));
+  TEST_ASSERT_TRUE(feed(pipeline, 260, 3));
+  TEST_ASSERT_EQUAL_UINT32(0, pipeline.getDetector().getFalseStarts());
+  for (uint8_t n = 0; n < kSlopeWindow; n++) {
+    TEST_ASSERT_FALSE(feed(pipeline, 100, 4 + n));
+  }
+
+  // Canceled when the trigger threshold isn't reached in time
+  TEST_ASSERT_FALSE(feed(pipeline, 150, 20));
+  TEST_ASSERT_FALSE(feed(pipeline, 180, 21));
+  TEST_ASSERT_TRUE(feed(pipeline, 230, 22));
+  TEST_ASSERT_TRUE(feed(pipeline, 230, 22 + kSlopeConfirmMS - 1));
+  TEST_ASSERT_FALSE(feed(pipeline, 230, 22 + kSlopeConfirmMS));
+  TEST_ASSERT_EQUAL_UINT32(1, pipeline.getDetector().getFalseStarts());
+}
+
+void test_no_early_press_when_loaded_at_calibration() {
+  // A sensor already loaded above the release threshold hasn't risen
+  Pipeline pipeline;
+  pipeline.getDetector().setSlopeRise(40);
+  start(pipeline, 100);
+  for (uint32_t nTimeMS = 0; nTimeMS < 2 * kSlopeConfirmMS; nTimeMS++) {
+    TEST_ASSERT_FALSE(feed(pipeline, 230, nTimeMS));
+  }
+
+  // Nor after recalibrating while loaded
+  TestSource::s_nReading = 300;
+  pipeline.read();
+  pipeline.calibrate();
+  for (uint32_t nTimeMS = 100; nTimeMS < 100 + 2 * kSlopeConfirmMS;
+       nTimeMS++) {
+    TEST_ASSERT_FALSE(feed(pipeline, 300 + 130, nTimeMS));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, pipeline.getDetector().getFalseStarts());
+}
+
+void test_idle_recalibration() {
+  Pipeline pipeline;
+  start(pipeline, 100);
+
+  TEST_ASSERT_TRUE(feed(pipeline, 300, 0));
+  TEST_ASSERT_FALSE(feed(pipeline, 120, 1000));
+  feed(pipeline, 120, 1000 + kIdleRecalibrationMS);
+  TEST_ASSERT_EQUAL_UINT16(100, pipeline.getBaseline());
+  TEST_ASSERT_FALSE(pipeline.getBaselineTracker().isSettled());
+
+  feed(pipeline, 120, 1001 + kIdleRecalibrationMS);
+  TEST_ASSERT_EQUAL_UINT16(120, pipeline.getBaseline());
+  TEST_ASSERT_EQUAL_UINT16(270, pipeline.getDetector().getTriggerThreshold());
+  TEST_ASSERT_TRUE(pipeline.getBaselineTracker().isSettled());
+}
+
+void test_tracking_baseline() {
+  SensorPipeline<TestSource, PassThroughFilter, TrackingBaseline<2>> pipeline;
+  pipeline.getDetector().setOffsets(150, 110);
+  TestSource::s_nReading = 100;
+  pipeline.read();
+  pipeline.calibrate();
+
+  TestSource::s_nReading = 140;
+  for (uint8_t n = 0; n < 32; n++) {
+    pipeline.update(n);
+  }
+  TEST_ASSERT_UINT16_WITHIN(1, 140, pipeline.getBaseline());
+  TEST_ASSERT_UINT16_WITHIN(
+    1, 290, pipeline.getDetector().getTriggerThreshold());
+  TEST_ASSERT_TRUE(pipeline.getBaselineTracker().isSettled());
+
+  // Frozen while pressed
+  TestSource::s_nReading = 400;
+  pipeline.update(32);
+  pipeline.update(33);
+  TEST_ASSERT_TRUE(pipeline.isPressed());
+  TEST_ASSERT_UINT16_WITHIN(1, 140, pipeline.getBaseline());
+}
+
+void test_moving_average() {
+  MovingAverageFilter<4> filter;
+  TEST_ASSERT_EQUAL_UINT16(100, filter.apply(100));
+  TEST_ASSERT_EQUAL_UINT16(125, filter.apply(200));
+  TEST_ASSERT_EQUAL_UINT16(150, filter.apply(200));
+  TEST_ASSERT_EQUAL_UINT16(175, filter.apply(200));
+  TEST_ASSERT_EQUAL_UINT16(200, filter.apply(200));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_hysteresis);
+  RUN_TEST(test_early_press);
+  RUN_TEST(test_no_early_press_when_loaded_at_calibration);
+  RUN_TEST(test_idle_recalibration);
+  RUN_TEST(test_tracking_baseline);
+  RUN_TEST(test_moving_average);
+  return UNITY_END();
+}
@@ -0,0 +1,106 @@
+//
+// Host tests for the running statistics of sensors.
+//
+#include <SensorStats.h>
+#include <stdlib.h>
+#include <unity.h>
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_moments_are_exact() {
+  Moments moments;
+  int32_t anValues[1000];
+  for (uint16_t n = 0; n < 1000; n++) {
+    anValues[n] = rand() % 8192 - 4096;
+    moments.add(anValues[n]);
+  }
+
+  int64_t nSum = 0;
+  uint64_t nSumSquares = 0;
+  int32_t nMin = INT32_MAX;
+  int32_t nMax = INT32_MIN;
+  for (uint16_t n = 0; n < 1000; n++) {
+    nSum += anValues[n];
+    nSumSquares += static_cast<int64_t>(anValues[n]) * anValues[n];
+    nMin = anValues[n] < nMin ? anValues[n] : nMin;
+    nMax = anValues[n] > nMax ? anValues[n] : nMax;
+  }
+  TEST_ASSERT_EQUAL_UINT32(1000, moments.getCount());
+  TEST_ASSERT_TRUE(nSum == moments.getSum());
+  TEST_ASSERT_TRUE(nSumSquares == moments.getSumSquares());
+  TEST_ASSERT_EQUAL_INT32(nMin, moments.getMin());
+  TEST_ASSERT_EQUAL_INT32(nMax, moments.getMax());
+}
+
+// A day of 12-bit readings at 3 kHz fits
+void test_moments_hold_a_day_of_samples() {
+  Moments moments;
+  const uint32_t kSamples = 3000UL * 86400;
+  for (uint32_t n = 0; n < kSamples; n++) {
+    moments.add(4095);
+  }
+  TEST_ASSERT_TRUE(moments.getSum() == 4095LL * kSamples);
+  TEST_ASSERT_TRUE(moments.getSumSquares() == 4095ULL * 4095 * kSamples);
+}
+
+void test_histogram_clamps_to_outer_bins() {
+  Histogram<4> histogram;
+  histogram.configure(-4, 1);
+  int32_t anValues[] = {-100, -4, -3, -2, 1, 2, 3, 4, 100};
+  for (int32_t nValue : anValues) {
+    histogram.add(nValue);
+  }
+  TEST_ASSERT_EQUAL_INT32(2, histogram.getWidth());
+  TEST_ASSERT_EQUAL_UINT32(3, histogram.getCount(0));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getCount(1));
+  TEST_ASSERT_EQUAL_UINT32(1, histogram.getCount(2));
+  TEST_ASSERT_EQUAL_UINT32(4, histogram.getCount(3));
+}
+
+void test_sensor_stats_split_idle_and_pressed() {
+  SensorStats<4> stats;
+  stats.configure(-2, 0, 0, 4);
+
+  const uint16_t kBaseline = 100;
+  uint16_t anIdle[] = {99, 100, 101, 100};
+  uint16_t anPress[] = {150, 180, 170};
+  for (uint16_t nValue : anIdle) {
+    stats.add(nValue, kBaseline, false);
+  }
+  for (uint8_t nPress = 0; nPress < 2; nPress++) {
+    for (uint16_t nValue : anPress) {
+      stats.add(nValue + nPress * 10, kBaseline, true);
+    }
+    stats.add(100, kBaseline, false);
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(6, stats.getIdle().getCount());
+  TEST_ASSERT_TRUE(stats.getIdle().getSum() == 0);
+  TEST_ASSERT_TRUE(stats.getIdle().getSumSquares() == 2);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.getIdleBins().getCount(1));
+  TEST_ASSERT_EQUAL_UINT32(4, stats.getIdleBins().getCount(2));
+
+  TEST_ASSERT_EQUAL_UINT32(6, stats.getPressed().getCount());
+  TEST_ASSERT_EQUAL_INT32(50, stats.getPressed().getMin());
+  TEST_ASSERT_EQUAL_UINT32(6, stats.getPressedBins().getCount(3));
+
+  // One peak per press, added on release
+  TEST_ASSERT_EQUAL_UINT32(2, stats.getPeaks().getCount());
+  TEST_ASSERT_TRUE(stats.getPeaks().getSum() == 80 + 90);
+  TEST_ASSERT_EQUAL_INT32(90, stats.getPeaks().getMax());
+
+  stats.reset();
+  TEST_ASSERT_EQUAL_UINT32(0, stats.getIdle().getCount());
+  TEST_ASSERT_EQUAL_UINT32(0, stats.getIdleBins().getCount(2));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_moments_are_exact);
+  RUN_TEST(test_moments_hold_a_day_of_samples);
+  RUN_TEST(test_histogram_clamps_to_outer_bins);
+  RUN_TEST(test_sensor_stats_split_idle_and_pressed);
+  return UNITY_END();
+}